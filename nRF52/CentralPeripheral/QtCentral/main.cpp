@@ -1,6 +1,8 @@
 #include <QCoreApplication>
 #include <QLowEnergyController>
 #include <QBluetoothDeviceDiscoveryAgent>
+#include <QElapsedTimer>
+#include <QSettings>
 #include <QTimer>
 #include <iostream>
 #include <memory>
@@ -12,6 +14,7 @@ namespace
     constexpr char LED_ON = 1;
     constexpr char LED_OFF = 0;
     constexpr int BLE_SCAN_TIMEOUT_MS = 5000;                       // Scan timeout in milliseconds
+    constexpr int CACHED_CONNECT_TIMEOUT_MS = 3000;                 // Scan instead if the remembered address doesn't connect by then
     constexpr int TIMER_MS = 1000;                                  // TimerEvent() called every TIMER_MS milliseconds
     constexpr unsigned int LED_TOGGLE_TIME_SEC  = 2;                // Toggle the LED this frequently
     constexpr unsigned int NORDIC_BLINKY_SERVICE_UUID = 0x1523;     // Blinky service UUID
@@ -25,11 +28,27 @@ class NordicCentral : public QObject
         NordicCentral() = default;
         ~NordicCentral() = default;
 
+        // Connects straight to the device connected to last time, without scanning
         void Start()
         {
             std::cout << "Starting..." << std::endl;
+            m_startTime.start();
             StartTimer();
-            StartDicoveryAgent();
+
+            QString address = m_settings.value("address").toString();
+            if(address.isEmpty())
+            {
+                StartDicoveryAgent();
+                return;
+            }
+
+            m_device = QBluetoothDeviceInfo(QBluetoothAddress(address), DEVICE_NAME, 0);
+            m_device.setCoreConfigurations(QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
+            m_bCached = true;
+            m_connectTimer.setSingleShot(true);
+            connect(&m_connectTimer, &QTimer::timeout, this, &NordicCentral::CachedConnectFailed);
+            m_connectTimer.start(CACHED_CONNECT_TIMEOUT_MS);
+            CreateController();
         }
 
     private:
@@ -65,9 +84,12 @@ class NordicCentral : public QObject
             connect(m_controller, &QLowEnergyController::connectionUpdated, this, &NordicCentral::ConnectionUpdated);
 
             connect(m_controller, static_cast<void (QLowEnergyController::*)(QLowEnergyController::Error)>(&QLowEnergyController::error),
-                    this, [](QLowEnergyController::Error)
+                    this, [this](QLowEnergyController::Error)
             {
-                // For debugging
+                if(m_bCached && !m_bGotDescriptors)
+                {
+                    CachedConnectFailed();
+                }
             });
 
             connect(m_controller, &QLowEnergyController::connected, this, [this]()
@@ -104,27 +126,74 @@ class NordicCentral : public QObject
             }
         }
 
+        // The address is forgotten and the device scanned for as usual
+        void CachedConnectFailed()
+        {
+            if(!m_bCached || m_bGotDescriptors)
+            {
+                return;
+            }
+
+            std::cout << "Remembered device not found, scanning" << std::endl;
+            m_bCached = false;
+            m_connectTimer.stop();
+            m_settings.remove("address");
+            m_controller->disconnect(this);
+            m_controller->disconnectFromDevice();
+            m_controller->deleteLater();
+            m_controller = nullptr;
+
+            // The service may have been found already, but it belongs to the old controller
+            delete m_service;
+            m_service = nullptr;
+            m_bGattFound = false;
+            StartDicoveryAgent();
+        }
+
+        // Only written when it's changed, with the handles so a change of firmware shows
+        void RememberDevice()
+        {
+            QString address = m_device.address().toString();
+            int ledHandle = m_LEDChar.handle();
+            if(m_settings.value("address").toString() != address || m_settings.value("ledHandle").toInt() != ledHandle)
+            {
+                m_settings.setValue("address", address);
+                m_settings.setValue("ledHandle", ledHandle);
+            }
+        }
+
         void ServiceDiscovered(const QBluetoothUuid &gatt)
         {
             if(gatt.data1 == NORDIC_BLINKY_SERVICE_UUID)
             {
                 m_gatt = gatt;
                 m_bGattFound = true;
+
+                // Our device has only the one service we want, so no need to wait for the rest
+                if(m_bCached)
+                {
+                    CreateService();
+                }
             }
         }
 
         void ServiceScanDone()
         {
-            if(m_bGattFound)
+            if(m_bGattFound && !m_service)
             {
-                m_service = m_controller->createServiceObject(m_gatt, this);
-                if(m_service)
-                {
-                    connect(m_service, &QLowEnergyService::stateChanged, this, &NordicCentral::ServiceStateChanged);
-                    connect(m_service, &QLowEnergyService::characteristicChanged, this, &NordicCentral::NordicBlinkyButtonPress);
-                    connect(m_service, &QLowEnergyService::descriptorWritten, this, &NordicCentral::ConfirmedDescriptorWrite);
-                    m_service->discoverDetails();
-                }
+                CreateService();
+            }
+        }
+
+        void CreateService()
+        {
+            m_service = m_controller->createServiceObject(m_gatt, this);
+            if(m_service)
+            {
+                connect(m_service, &QLowEnergyService::stateChanged, this, &NordicCentral::ServiceStateChanged);
+                connect(m_service, &QLowEnergyService::characteristicChanged, this, &NordicCentral::NordicBlinkyButtonPress);
+                connect(m_service, &QLowEnergyService::descriptorWritten, this, &NordicCentral::ConfirmedDescriptorWrite);
+                m_service->discoverDetails();
             }
         }
 
@@ -196,6 +265,9 @@ class NordicCentral : public QObject
                         }
                     }
                     m_bGotDescriptors = true;
+                    m_connectTimer.stop();
+                    RememberDevice();
+                    std::cout << "Ready after " << m_startTime.elapsed() << "ms" << std::endl;
                     break;
                 }
                 case QLowEnergyService::InvalidService:
@@ -231,6 +303,10 @@ class NordicCentral : public QObject
         QLowEnergyCharacteristic                        m_LEDChar;
         QLowEnergyService*                              m_service = nullptr;
         QTimer                                          m_timer;
+        QTimer                                          m_connectTimer;
+        QElapsedTimer                                   m_startTime;
+        QSettings                                       m_settings{"IMU4U", "QtCentral"};
+        bool                                            m_bCached = false;   // Connecting to the remembered address
         uint32_t                                        m_TimerCounter = 0;
         bool                                            m_bGattFound = false;
         bool                                            m_bGotDescriptors = false;
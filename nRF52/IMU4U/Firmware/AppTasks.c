@@ -0,0 +1,265 @@
+#include "AppTasks.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
+#include "app_error.h"
+#include "nrf_log.h"
+#include "nrf_log_ctrl.h"
+#include "nrf_pwr_mgmt.h"
+#include "Recorder.h"
+#include "StreamEncoder.h"
+#include "TimeStamp.h"
+#include "Transport.h"
+
+#include <string.h>
+
+#define ACQUISITION_TASK_PRIORITY   4
+#define STREAMING_TASK_PRIORITY     3   // The SoftDevice handler and timer tasks run at 2
+#define PROCESSING_TASK_PRIORITY    1
+
+#define ACQUISITION_STACK_SIZE      256  // In words
+#define STREAMING_STACK_SIZE        256
+#define PROCESSING_STACK_SIZE       384
+
+#define SAMPLE_QUEUE_LENGTH         32   // About 2.5 seconds of samples at 12.5Hz
+#define PROCESSING_POLL_MS          10   // How often the processing task looks for flash and download work without samples arriving
+#define STATS_INTERVAL_MS           1000
+#define STATS_LOG_INTERVALS         10   // Log the stats every this many intervals
+
+// Acquisition task notification bits
+#define NOTIFY_DATA_READY           0x01
+#define NOTIFY_POWER_STATE          0x02
+
+static StaticTask_t gAcquisitionTCB;
+static StackType_t  gAcquisitionStack[ACQUISITION_STACK_SIZE];
+static StaticTask_t gStreamingTCB;
+static StackType_t  gStreamingStack[STREAMING_STACK_SIZE];
+static StaticTask_t gProcessingTCB;
+static StackType_t  gProcessingStack[PROCESSING_STACK_SIZE];
+static StaticTask_t gIdleTCB;
+static StackType_t  gIdleStack[configMINIMAL_STACK_SIZE];
+static StaticTask_t gTimerTCB;
+static StackType_t  gTimerStack[configTIMER_TASK_STACK_DEPTH];
+
+static StaticQueue_t gSampleQueueBuffer;
+static uint8_t       gSampleQueueStorage[SAMPLE_QUEUE_LENGTH * sizeof(IMUSample)];
+static QueueHandle_t gSampleQueue = NULL;
+
+static TaskHandle_t gTasks[APP_TASK_COUNT];
+static const char* const gTaskNames[APP_TASK_COUNT] = { "Acquire", "Stream", "Process", "Idle" };
+
+static volatile enum IMU_POWER_STATE gRequestedPowerState = IMU_POWER_OFF;
+static volatile uint32_t gSamplesDropped = 0;
+static volatile uint16_t gSampleQueueHighWater = 0;
+
+static AppTaskStats gStats;
+static uint32_t gLastRunTime[APP_TASK_COUNT];
+static uint32_t gLastStatsTime = 0;
+
+void AppTasksDataReady()
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if(gTasks[APP_TASK_ACQUISITION] != NULL)
+    {
+        xTaskNotifyFromISR(gTasks[APP_TASK_ACQUISITION], NOTIFY_DATA_READY, eSetBits, &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+}
+
+void AppTasksPushSample(const IMUSample* pSample)
+{
+    if(xQueueSend(gSampleQueue, pSample, 0) != pdTRUE)
+    {
+        ++gSamplesDropped;
+        return;
+    }
+
+    UBaseType_t waiting = uxQueueMessagesWaiting(gSampleQueue);
+    if(waiting > gSampleQueueHighWater)
+    {
+        gSampleQueueHighWater = (uint16_t)waiting;
+    }
+}
+
+void AppTasksRadioEventFromISR()
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if(gTasks[APP_TASK_STREAMING] != NULL)
+    {
+        vTaskNotifyGiveFromISR(gTasks[APP_TASK_STREAMING], &higherPriorityTaskWoken);
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+}
+
+void AppTasksSetIMUPowerState(enum IMU_POWER_STATE State)
+{
+    gRequestedPowerState = State;
+    xTaskNotify(gTasks[APP_TASK_ACQUISITION], NOTIFY_POWER_STATE, eSetBits);
+}
+
+void AppTasksGetStats(AppTaskStats* pStats)
+{
+    taskENTER_CRITICAL();
+    *pStats = gStats;
+    taskEXIT_CRITICAL();
+}
+
+static void AcquisitionTask(void* pArg)
+{
+    for(;;)
+    {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+
+        if(events & NOTIFY_POWER_STATE)
+        {
+            IMUSetPowerState(gRequestedPowerState);
+        }
+
+        if(events & NOTIFY_DATA_READY)
+        {
+            IMUReadPending();
+        }
+    }
+}
+
+static void StreamingTask(void* pArg)
+{
+    for(;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        StreamEncoderFlush(TransportActive());
+    }
+}
+
+static void LogStats()
+{
+    for(int i = 0; i < APP_TASK_COUNT; ++i)
+    {
+        NRF_LOG_INFO("%s: %d%% CPU, %d stack words free", gTaskNames[i], gStats.CPUPercent[i], gStats.StackHighWater[i]);
+    }
+    NRF_LOG_INFO("Sample queue: %d of %d used at most, %d dropped",
+                 gStats.SampleQueueHighWater, gStats.SampleQueueLength, gStats.SamplesDropped);
+}
+
+static void UpdateStats()
+{
+    AppTaskStats stats;
+    uint32_t runTime[APP_TASK_COUNT];
+    uint32_t now = TimeStampNow();
+    uint32_t elapsed = now - gLastStatsTime;
+
+    if(gTasks[APP_TASK_IDLE] == NULL)
+    {
+        gTasks[APP_TASK_IDLE] = xTaskGetIdleTaskHandle();
+    }
+
+    for(int i = 0; i < APP_TASK_COUNT; ++i)
+    {
+        TaskStatus_t status;
+        vTaskGetInfo(gTasks[i], &status, pdTRUE, eInvalid);
+
+        runTime[i] = status.ulRunTimeCounter;
+        stats.CPUPercent[i] = elapsed > 0 ? (uint8_t)(((uint64_t)(runTime[i] - gLastRunTime[i]) * 100) / elapsed) : 0;
+        stats.StackHighWater[i] = status.usStackHighWaterMark;
+    }
+
+    stats.SampleQueueHighWater = gSampleQueueHighWater;
+    stats.SampleQueueLength = SAMPLE_QUEUE_LENGTH;
+    stats.SamplesDropped = gSamplesDropped;
+
+    taskENTER_CRITICAL();
+    gStats = stats;
+    taskEXIT_CRITICAL();
+
+    memcpy(gLastRunTime, runTime, sizeof(runTime));
+    gLastStatsTime = now;
+}
+
+static void ProcessingTask(void* pArg)
+{
+    TickType_t lastStats = xTaskGetTickCount();
+    uint32_t statsCount = 0;
+
+    for(;;)
+    {
+        IMUSample sample;
+        if(xQueueReceive(gSampleQueue, &sample, pdMS_TO_TICKS(PROCESSING_POLL_MS)) == pdTRUE)
+        {
+            // Samples are also taken while only recording, there's no one to stream those to
+            if(TransportActive()->Ready())
+            {
+                StreamEncoderPushSample(&sample);
+            }
+            RecorderPushSample(&sample);
+        }
+
+        RecorderProcess();
+
+        if(xTaskGetTickCount() - lastStats >= pdMS_TO_TICKS(STATS_INTERVAL_MS))
+        {
+            lastStats = xTaskGetTickCount();
+            UpdateStats();
+            if(++statsCount % STATS_LOG_INTERVALS == 0)
+            {
+                LogStats();
+            }
+        }
+    }
+}
+
+void InitAppTasks()
+{
+    gSampleQueue = xQueueCreateStatic(SAMPLE_QUEUE_LENGTH, sizeof(IMUSample), gSampleQueueStorage, &gSampleQueueBuffer);
+
+    gTasks[APP_TASK_ACQUISITION] = xTaskCreateStatic(AcquisitionTask, gTaskNames[APP_TASK_ACQUISITION], ACQUISITION_STACK_SIZE,
+                                                     NULL, ACQUISITION_TASK_PRIORITY, gAcquisitionStack, &gAcquisitionTCB);
+    gTasks[APP_TASK_STREAMING] = xTaskCreateStatic(StreamingTask, gTaskNames[APP_TASK_STREAMING], STREAMING_STACK_SIZE,
+                                                   NULL, STREAMING_TASK_PRIORITY, gStreamingStack, &gStreamingTCB);
+    gTasks[APP_TASK_PROCESSING] = xTaskCreateStatic(ProcessingTask, gTaskNames[APP_TASK_PROCESSING], PROCESSING_STACK_SIZE,
+                                                    NULL, PROCESSING_TASK_PRIORITY, gProcessingStack, &gProcessingTCB);
+    gTasks[APP_TASK_IDLE] = NULL;  // Created by the scheduler
+
+    memset(&gStats, 0, sizeof(gStats));
+    gLastStatsTime = TimeStampNow();
+}
+
+// Called by the FreeRTOS port from configPRE_SLEEP_PROCESSING, with the RTC already
+// set to wake us for the next task
+void AppTasksSleep(void)
+{
+    nrf_pwr_mgmt_run();
+}
+
+void vApplicationIdleHook(void)
+{
+    while(NRF_LOG_PROCESS())
+    {
+    }
+}
+
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char* pcTaskName)
+{
+    APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
+}
+
+void vApplicationMallocFailedHook(void)
+{
+    APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
+}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t** ppTCB, StackType_t** ppStack, uint32_t* pStackSize)
+{
+    *ppTCB = &gIdleTCB;
+    *ppStack = gIdleStack;
+    *pStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t** ppTCB, StackType_t** ppStack, uint32_t* pStackSize)
+{
+    *ppTCB = &gTimerTCB;
+    *ppStack = gTimerStack;
+    *pStackSize = configTIMER_TASK_STACK_DEPTH;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include "IMU.h"
+
+// The firmware's FreeRTOS tasks, highest priority first:
+//   Acquisition:  Reads the sensors when they signal data ready and applies power
+//                 state changes.  Samples go into a bounded queue.
+//   Streaming:    Woken just before each radio event to pack queued samples into
+//                 packets for the active transport.
+//   Processing:   Takes samples off the queue for the stream encoder and the
+//                 recorder, and does the recorder's flash writes and downloads.
+// The SoftDevice's events are handled by the SDK's own task, below streaming.
+
+enum APP_TASK
+{
+    APP_TASK_ACQUISITION,
+    APP_TASK_STREAMING,
+    APP_TASK_PROCESSING,
+    APP_TASK_IDLE,
+    APP_TASK_COUNT
+};
+
+typedef struct AppTaskStats
+{
+    uint8_t  CPUPercent[APP_TASK_COUNT];      // Over the last stats interval
+    uint16_t StackHighWater[APP_TASK_COUNT];  // Fewest free stack words seen
+    uint16_t SampleQueueHighWater;            // Most samples the queue has held
+    uint16_t SampleQueueLength;
+    uint32_t SamplesDropped;                  // Samples the queue had no room for
+} AppTaskStats;
+
+// Creates the tasks and queues.  Call before vTaskStartScheduler().
+void InitAppTasks();
+
+// Called from the IMU's data ready interrupt (see IMU_DATA_READY_CALLBACK)
+void AppTasksDataReady();
+
+// Called by the IMU with each new sample, in the acquisition task (see IMU_CALLBACK)
+void AppTasksPushSample(const IMUSample* pSample);
+
+// Called from the radio notification interrupt before each radio event
+void AppTasksRadioEventFromISR();
+
+// Asks the acquisition task to move the sensors to the given power state
+void AppTasksSetIMUPowerState(enum IMU_POWER_STATE State);
+
+void AppTasksGetStats(AppTaskStats* pStats);
@@ -0,0 +1,376 @@
+#include "FlashLog.h"
+
+#include <string.h>
+
+#define FLASH_LOG_PAGE_MAGIC    0x4C553449  // "I4UL"
+#define FLASH_LOG_ERASED_WORD   0xFFFFFFFF
+#define FLASH_LOG_ERASED_LENGTH 0xFFFF
+#define FLASH_LOG_NO_PAGE       0xFFFF
+
+// Rounds a record's size up to a multiple of four bytes
+#define FLASH_LOG_ALIGN(SIZE)   (((SIZE) + 3) & ~3UL)
+
+typedef struct FlashLogPageHeader
+{
+    uint32_t Magic;
+    uint32_t Sequence;
+} FlashLogPageHeader;
+
+static FlashLogConfig gConfig;
+static bool           gMounted = false;
+
+// The page index.  Entry i describes the i'th page of the log (in log order): which
+// physical page it lives in, how many bytes past the header are used, and where those
+// bytes start in the stream.
+static uint16_t gPageCount = 0;
+static uint16_t gPagePhysical[FLASH_LOG_MAX_PAGES];
+static uint16_t gPageUsed[FLASH_LOG_MAX_PAGES];
+static uint32_t gPageStreamStart[FLASH_LOG_MAX_PAGES];
+static uint32_t gPageSequence[FLASH_LOG_MAX_PAGES];
+
+static bool     gLastPageClosed = false;  // No more appends to the last page (it hit a bad record)
+static uint16_t gNextPhysical = 0;        // Physical page the next new log page goes in
+static uint32_t gNextSequence = 0;        // Sequence number of the next new log page
+
+// Word aligned staging buffer for a record, since flash writes must be word aligned
+static uint32_t gRecordBuffer[(FLASH_LOG_RECORD_HEADER_SIZE + FLASH_LOG_MAX_RECORD_SIZE) / 4];
+
+static uint16_t CRC16(const uint8_t* pData, uint32_t Length)
+{
+    // CRC-16/CCITT-FALSE
+    uint16_t crc = 0xFFFF;
+    for(uint32_t i = 0; i < Length; ++i)
+    {
+        crc ^= (uint16_t)pData[i] << 8;
+        for(int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t PageAddress(uint16_t PhysicalPage)
+{
+    return gConfig.StartAddress + (uint32_t)PhysicalPage * gConfig.PageSize;
+}
+
+static uint32_t PageDataSize()
+{
+    return gConfig.PageSize - FLASH_LOG_PAGE_HEADER_SIZE;
+}
+
+static uint32_t StreamEnd()
+{
+    if(gPageCount == 0)
+    {
+        return 0;
+    }
+    return gPageStreamStart[gPageCount - 1] + gPageUsed[gPageCount - 1];
+}
+
+// Walks the records of a page, returning how many bytes past the header hold good
+// records.  *pClosed is set if the walk stopped on something other than erased flash.
+static uint16_t ScanPage(uint16_t PhysicalPage, bool* pClosed)
+{
+    uint8_t* pRecord = (uint8_t*)gRecordBuffer;
+    uint32_t pageAddress = PageAddress(PhysicalPage);
+    uint32_t offset = FLASH_LOG_PAGE_HEADER_SIZE;
+
+    *pClosed = false;
+    while(offset + FLASH_LOG_RECORD_HEADER_SIZE <= gConfig.PageSize)
+    {
+        if(!gConfig.pOps->Read(pageAddress + offset, pRecord, FLASH_LOG_RECORD_HEADER_SIZE))
+        {
+            *pClosed = true;
+            break;
+        }
+
+        uint16_t length = (uint16_t)(pRecord[0] | (pRecord[1] << 8));
+        uint16_t crc = (uint16_t)(pRecord[2] | (pRecord[3] << 8));
+        if(length == FLASH_LOG_ERASED_LENGTH)
+        {
+            break;
+        }
+
+        uint32_t recordSize = FLASH_LOG_ALIGN(FLASH_LOG_RECORD_HEADER_SIZE + length);
+        if(length == 0 || length > FLASH_LOG_MAX_RECORD_SIZE || offset + recordSize > gConfig.PageSize ||
+           !gConfig.pOps->Read(pageAddress + offset + FLASH_LOG_RECORD_HEADER_SIZE, pRecord, length) ||
+           CRC16(pRecord, length) != crc)
+        {
+            *pClosed = true;
+            break;
+        }
+
+        offset += recordSize;
+    }
+
+    return (uint16_t)(offset - FLASH_LOG_PAGE_HEADER_SIZE);
+}
+
+static bool IsLogPage(uint16_t PhysicalPage)
+{
+    for(uint16_t i = 0; i < gPageCount; ++i)
+    {
+        if(gPagePhysical[i] == PhysicalPage)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Erases the next free physical page and adds it to the end of the log
+static enum FLASH_LOG_STATUS OpenNewPage()
+{
+    if(gPageCount == gConfig.PageCount)
+    {
+        return FLASH_LOG_FULL;
+    }
+
+    // Pages are handed out in order so the log is normally one run of pages, but skip
+    // over any log page in the way in case a previous erase was interrupted
+    while(IsLogPage(gNextPhysical))
+    {
+        gNextPhysical = (uint16_t)((gNextPhysical + 1) % gConfig.PageCount);
+    }
+
+    uint16_t physical = gNextPhysical;
+    FlashLogPageHeader header = { FLASH_LOG_PAGE_MAGIC, gNextSequence };
+
+    gNextPhysical = (uint16_t)((gNextPhysical + 1) % gConfig.PageCount);
+    ++gNextSequence;
+
+    if(!gConfig.pOps->ErasePage(PageAddress(physical)) ||
+       !gConfig.pOps->Write(PageAddress(physical), &header, sizeof(header)))
+    {
+        return FLASH_LOG_IO_ERROR;
+    }
+
+    gPagePhysical[gPageCount] = physical;
+    gPageSequence[gPageCount] = header.Sequence;
+    gPageUsed[gPageCount] = 0;
+    gPageStreamStart[gPageCount] = StreamEnd();
+    ++gPageCount;
+    gLastPageClosed = false;
+
+    return FLASH_LOG_OK;
+}
+
+enum FLASH_LOG_STATUS FlashLogMount(const FlashLogConfig* pConfig)
+{
+    gMounted = false;
+
+    if(pConfig == NULL || pConfig->pOps == NULL || pConfig->PageCount == 0 ||
+       pConfig->PageCount > FLASH_LOG_MAX_PAGES || (pConfig->PageSize % 4) != 0 ||
+       pConfig->PageSize < FLASH_LOG_PAGE_HEADER_SIZE + FLASH_LOG_RECORD_HEADER_SIZE + FLASH_LOG_MAX_RECORD_SIZE ||
+       pConfig->PageSize - FLASH_LOG_PAGE_HEADER_SIZE > 0xFFFF)
+    {
+        return FLASH_LOG_INVALID_PARAM;
+    }
+
+    gConfig = *pConfig;
+    gPageCount = 0;
+
+    // Read every page header, keeping the pages that belong to the log sorted by sequence
+    for(uint16_t physical = 0; physical < gConfig.PageCount; ++physical)
+    {
+        FlashLogPageHeader header;
+        if(!gConfig.pOps->Read(PageAddress(physical), &header, sizeof(header)))
+        {
+            return FLASH_LOG_IO_ERROR;
+        }
+
+        if(header.Magic != FLASH_LOG_PAGE_MAGIC)
+        {
+            continue;
+        }
+
+        uint16_t i = gPageCount;
+        while(i > 0 && gPageSequence[i - 1] > header.Sequence)
+        {
+            gPagePhysical[i] = gPagePhysical[i - 1];
+            gPageSequence[i] = gPageSequence[i - 1];
+            --i;
+        }
+        gPagePhysical[i] = physical;
+        gPageSequence[i] = header.Sequence;
+        ++gPageCount;
+    }
+
+    // Find where the records in each page end and lay the pages out in the stream
+    uint32_t streamOffset = 0;
+    gLastPageClosed = false;
+    for(uint16_t i = 0; i < gPageCount; ++i)
+    {
+        gPageUsed[i] = ScanPage(gPagePhysical[i], &gLastPageClosed);
+        gPageStreamStart[i] = streamOffset;
+        streamOffset += gPageUsed[i];
+    }
+
+    if(gPageCount > 0)
+    {
+        gNextPhysical = (uint16_t)((gPagePhysical[gPageCount - 1] + 1) % gConfig.PageCount);
+        gNextSequence = gPageSequence[gPageCount - 1] + 1;
+    }
+    else
+    {
+        gNextPhysical = 0;
+        gNextSequence = 0;
+    }
+
+    gMounted = true;
+    return FLASH_LOG_OK;
+}
+
+enum FLASH_LOG_STATUS FlashLogAppend(const void* pData, uint16_t Length)
+{
+    if(!gMounted || pData == NULL || Length == 0 || Length > FLASH_LOG_MAX_RECORD_SIZE)
+    {
+        return FLASH_LOG_INVALID_PARAM;
+    }
+
+    uint32_t recordSize = FLASH_LOG_ALIGN(FLASH_LOG_RECORD_HEADER_SIZE + Length);
+    if(gPageCount == 0 || gLastPageClosed || gPageUsed[gPageCount - 1] + recordSize > PageDataSize())
+    {
+        enum FLASH_LOG_STATUS status = OpenNewPage();
+        if(status != FLASH_LOG_OK)
+        {
+            return status;
+        }
+    }
+
+    // Build the record, leaving the padding at the erased value
+    uint8_t* pRecord = (uint8_t*)gRecordBuffer;
+    uint16_t crc = CRC16((const uint8_t*)pData, Length);
+    gRecordBuffer[(recordSize / 4) - 1] = FLASH_LOG_ERASED_WORD;
+    pRecord[0] = (uint8_t)(Length & 0xFF);
+    pRecord[1] = (uint8_t)(Length >> 8);
+    pRecord[2] = (uint8_t)(crc & 0xFF);
+    pRecord[3] = (uint8_t)(crc >> 8);
+    memcpy(&pRecord[FLASH_LOG_RECORD_HEADER_SIZE], pData, Length);
+
+    uint16_t page = gPageCount - 1;
+    uint32_t address = PageAddress(gPagePhysical[page]) + FLASH_LOG_PAGE_HEADER_SIZE + gPageUsed[page];
+    if(!gConfig.pOps->Write(address, gRecordBuffer, recordSize))
+    {
+        // Whatever made it to flash will fail its CRC, so don't append after it
+        gLastPageClosed = true;
+        return FLASH_LOG_IO_ERROR;
+    }
+
+    gPageUsed[page] = (uint16_t)(gPageUsed[page] + recordSize);
+    return FLASH_LOG_OK;
+}
+
+enum FLASH_LOG_STATUS FlashLogErase()
+{
+    if(!gMounted)
+    {
+        return FLASH_LOG_INVALID_PARAM;
+    }
+
+    // Erase newest first, so if we're interrupted the remaining pages are still a valid
+    // (shorter) log
+    while(gPageCount > 0)
+    {
+        if(!gConfig.pOps->ErasePage(PageAddress(gPagePhysical[gPageCount - 1])))
+        {
+            return FLASH_LOG_IO_ERROR;
+        }
+        --gPageCount;
+    }
+
+    gLastPageClosed = false;
+    return FLASH_LOG_OK;
+}
+
+uint32_t FlashLogStreamSize()
+{
+    return gMounted ? StreamEnd() : 0;
+}
+
+uint32_t FlashLogCapacity()
+{
+    return gMounted ? gConfig.PageCount * PageDataSize() : 0;
+}
+
+uint32_t FlashLogReadStream(uint32_t Offset, void* pBuffer, uint32_t Length)
+{
+    if(!gMounted || Offset >= StreamEnd())
+    {
+        return 0;
+    }
+
+    // Binary search for the last page starting at or before the offset
+    uint16_t low = 0;
+    uint16_t high = gPageCount - 1;
+    while(low < high)
+    {
+        uint16_t middle = (uint16_t)((low + high + 1) / 2);
+        if(gPageStreamStart[middle] <= Offset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    uint8_t* pOut = (uint8_t*)pBuffer;
+    uint32_t copied = 0;
+    for(uint16_t page = low; page < gPageCount && copied < Length; ++page)
+    {
+        uint32_t pageOffset = Offset + copied - gPageStreamStart[page];
+        if(pageOffset >= gPageUsed[page])
+        {
+            continue;  // Empty page
+        }
+
+        uint32_t chunk = gPageUsed[page] - pageOffset;
+        if(chunk > Length - copied)
+        {
+            chunk = Length - copied;
+        }
+
+        uint32_t address = PageAddress(gPagePhysical[page]) + FLASH_LOG_PAGE_HEADER_SIZE + pageOffset;
+        if(!gConfig.pOps->Read(address, &pOut[copied], chunk))
+        {
+            break;
+        }
+        copied += chunk;
+    }
+
+    return copied;
+}
+
+uint32_t FlashLogParseRecord(const uint8_t* pStream, uint32_t Size, const uint8_t** ppPayload, uint16_t* pLength, bool* pValid)
+{
+    if(Size < FLASH_LOG_RECORD_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    uint16_t length = (uint16_t)(pStream[0] | (pStream[1] << 8));
+    uint16_t crc = (uint16_t)(pStream[2] | (pStream[3] << 8));
+    if(length == 0 || length > FLASH_LOG_MAX_RECORD_SIZE)
+    {
+        // The length can't be trusted, so there's no telling where the next record is
+        *pValid = false;
+        *ppPayload = NULL;
+        *pLength = 0;
+        return Size;
+    }
+
+    uint32_t recordSize = FLASH_LOG_ALIGN(FLASH_LOG_RECORD_HEADER_SIZE + length);
+    if(Size < recordSize)
+    {
+        return 0;
+    }
+
+    *ppPayload = &pStream[FLASH_LOG_RECORD_HEADER_SIZE];
+    *pLength = length;
+    *pValid = CRC16(*ppPayload, length) == crc;
+    return recordSize;
+}
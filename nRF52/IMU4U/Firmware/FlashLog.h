@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// An append-only log of variable length records kept in a region of flash.
+//
+// Each flash page starts with a small header holding a magic value and a sequence
+// number.  When mounting, the page headers are read to build an index of which pages
+// hold the log and in what order, so the log can start on any page (the next log after
+// an erase starts where the last one ended, spreading wear across the region).
+//
+// Records are a 16 bit length, a CRC-16 of the payload and the payload itself, padded
+// to a multiple of four bytes.  A torn write (e.g. power lost while writing) fails its
+// CRC when mounting, and the log resumes on a fresh page.
+//
+// The log's pages, minus their headers, form a contiguous "stream" of records which is
+// what gets downloaded.  Offsets into the stream are stable for the life of the log,
+// so a download can be resumed from any offset.
+//
+// Flash access goes through FlashLogOps so the log can run against real flash on the
+// nRF52 or a block of RAM on a PC.  This module has no SDK dependencies.
+
+#define FLASH_LOG_MAX_PAGES          64
+#define FLASH_LOG_PAGE_HEADER_SIZE    8
+#define FLASH_LOG_RECORD_HEADER_SIZE  4
+#define FLASH_LOG_MAX_RECORD_SIZE   512
+
+enum FLASH_LOG_STATUS
+{
+    FLASH_LOG_OK,
+    FLASH_LOG_FULL,
+    FLASH_LOG_INVALID_PARAM,
+    FLASH_LOG_IO_ERROR
+};
+
+// Flash operations used by the log.  Each returns true on success and doesn't return
+// until the operation has completed.  Addresses and lengths passed to Write() are always
+// multiples of four.  ErasePage() is given the address of the start of a page.
+typedef struct FlashLogOps
+{
+    bool (*Read)(uint32_t Address, void* pData, uint32_t Length);
+    bool (*Write)(uint32_t Address, const void* pData, uint32_t Length);
+    bool (*ErasePage)(uint32_t Address);
+} FlashLogOps;
+
+typedef struct FlashLogConfig
+{
+    const FlashLogOps* pOps;
+    uint32_t           StartAddress;  // Address of the first page of the region
+    uint32_t           PageSize;      // Size in bytes of a flash page
+    uint16_t           PageCount;     // Number of pages in the region (FLASH_LOG_MAX_PAGES at most)
+} FlashLogConfig;
+
+// Scans the region and builds the page index.  Must be called before anything else.
+enum FLASH_LOG_STATUS FlashLogMount(const FlashLogConfig* pConfig);
+
+// Appends a record of 1 to FLASH_LOG_MAX_RECORD_SIZE bytes.  Returns FLASH_LOG_FULL if
+// there's no room left for it.
+enum FLASH_LOG_STATUS FlashLogAppend(const void* pData, uint16_t Length);
+
+// Erases every page holding the log, leaving it empty.
+enum FLASH_LOG_STATUS FlashLogErase();
+
+// The number of stream bytes currently in the log
+uint32_t FlashLogStreamSize();
+
+// The number of stream bytes the region can hold in total
+uint32_t FlashLogCapacity();
+
+// Copies up to Length bytes of the stream, starting at Offset, into pBuffer.  Returns
+// the number of bytes copied, which is zero once Offset reaches the end of the stream.
+uint32_t FlashLogReadStream(uint32_t Offset, void* pBuffer, uint32_t Length);
+
+// Parses the record at the start of pStream, a piece of stream as returned by
+// FlashLogReadStream().  Returns the number of stream bytes the record occupies, header
+// and padding included, or zero if Size doesn't cover the whole record.  *pValid is set
+// to whether the record's length and CRC check out.
+uint32_t FlashLogParseRecord(const uint8_t* pStream, uint32_t Size, const uint8_t** ppPayload, uint16_t* pLength, bool* pValid);
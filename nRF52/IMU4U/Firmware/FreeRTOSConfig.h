@@ -0,0 +1,121 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+// Based on the nRF5 SDK's FreeRTOS example configuration.  The tick comes from RTC1 (so
+// app_timer must be the FreeRTOS flavour), and TimeStamp.h's RTC2 doubles as the
+// run time stats clock.
+
+#ifdef SOFTDEVICE_PRESENT
+#include "nrf_soc.h"
+#endif
+#include "app_util_platform.h"
+
+#define configTICK_SOURCE                                         FREERTOS_USE_RTC
+
+#define configUSE_PREEMPTION                                      1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION                   0
+#define configUSE_TICKLESS_IDLE                                   1
+#define configUSE_TICKLESS_IDLE_SIMPLE_DEBUG                      1
+#define configCPU_CLOCK_HZ                                        ( SystemCoreClock )
+#define configTICK_RATE_HZ                                        1024
+#define configMAX_PRIORITIES                                      ( 5 )
+#define configMINIMAL_STACK_SIZE                                  ( 60 )
+#define configTOTAL_HEAP_SIZE                                     ( 4096 )
+#define configMAX_TASK_NAME_LEN                                   ( 8 )
+#define configUSE_16_BIT_TICKS                                    0
+#define configIDLE_SHOULD_YIELD                                   1
+#define configUSE_MUTEXES                                         1
+#define configUSE_RECURSIVE_MUTEXES                               1
+#define configUSE_COUNTING_SEMAPHORES                             1
+#define configUSE_ALTERNATIVE_API                                 0
+#define configQUEUE_REGISTRY_SIZE                                 2
+#define configUSE_QUEUE_SETS                                      0
+#define configUSE_TIME_SLICING                                    0
+#define configUSE_NEWLIB_REENTRANT                                0
+#define configENABLE_BACKWARD_COMPATIBILITY                       1
+
+// Hooks.  The idle hook drains the log, sleeping is done in configPRE_SLEEP_PROCESSING.
+#define configUSE_IDLE_HOOK                                       1
+#define configUSE_TICK_HOOK                                       0
+#define configCHECK_FOR_STACK_OVERFLOW                            2
+#define configUSE_MALLOC_FAILED_HOOK                              1
+
+// Run time stats, for the per task CPU usage report (see AppTasks.h)
+#define configGENERATE_RUN_TIME_STATS                             1
+#define configUSE_TRACE_FACILITY                                  1
+#define configUSE_STATS_FORMATTING_FUNCTIONS                      0
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()                  // InitTimeStamp() starts it before the scheduler
+#define portGET_RUN_TIME_COUNTER_VALUE()                          TimeStampNow()
+
+// Co-routine definitions.
+#define configUSE_CO_ROUTINES                                     0
+#define configMAX_CO_ROUTINE_PRIORITIES                           ( 2 )
+
+// Software timer definitions.  app_timer runs on these.
+#define configUSE_TIMERS                                          1
+#define configTIMER_TASK_PRIORITY                                 ( 2 )
+#define configTIMER_QUEUE_LENGTH                                  32
+#define configTIMER_TASK_STACK_DEPTH                              ( 256 )
+
+// Tickless idle configuration
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP                     2
+
+// Let nrf_pwr_mgmt put the CPU to sleep rather than the port's own __WFE() loop.  The
+// port has already programmed the RTC to wake us for the next task, so all that's left
+// is to wait for an event the way the rest of the SDK expects.
+#define configPRE_SLEEP_PROCESSING( xIdleTime )                   do { AppTasksSleep(); ( xIdleTime ) = 0; } while(0)
+#define configPOST_SLEEP_PROCESSING( xIdleTime )
+
+// The application's own tasks and queues are allocated statically, the SoftDevice
+// handler task still comes from the heap
+#define configSUPPORT_DYNAMIC_ALLOCATION                          1
+#define configSUPPORT_STATIC_ALLOCATION                           1
+
+// Set the following definitions to 1 to include the API function, or zero to exclude
+// the API function.
+#define INCLUDE_vTaskPrioritySet                                  1
+#define INCLUDE_uxTaskPriorityGet                                 1
+#define INCLUDE_vTaskDelete                                       1
+#define INCLUDE_vTaskSuspend                                      1
+#define INCLUDE_xResumeFromISR                                    1
+#define INCLUDE_vTaskDelayUntil                                   1
+#define INCLUDE_vTaskDelay                                        1
+#define INCLUDE_xTaskGetSchedulerState                            1
+#define INCLUDE_xTaskGetCurrentTaskHandle                         1
+#define INCLUDE_uxTaskGetStackHighWaterMark                       1
+#define INCLUDE_xTaskGetIdleTaskHandle                            1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle                    1
+#define INCLUDE_pcTaskGetTaskName                                 1
+#define INCLUDE_eTaskGetState                                     1
+#define INCLUDE_xEventGroupSetBitFromISR                          1
+#define INCLUDE_xTimerPendFunctionCall                            1
+
+// The lowest interrupt priority that can be used in a call to a "set priority" function.
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY                   0xf
+
+// The highest interrupt priority that can be used by any interrupt service routine that
+// makes calls to interrupt safe FreeRTOS API functions.
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY              _PRIO_APP_HIGH
+
+#define configKERNEL_INTERRUPT_PRIORITY                           configLIBRARY_LOWEST_INTERRUPT_PRIORITY
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY                      configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+#define configMAX_API_CALL_INTERRUPT_PRIORITY                     configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+
+#define configASSERT( x )                                         ASSERT( x )
+
+// FreeRTOS handlers mapped onto the CMSIS names
+#define vPortSVCHandler                                           SVC_Handler
+#define xPortPendSVHandler                                        PendSV_Handler
+
+// Tick source
+#define FREERTOS_USE_RTC                                          0
+#define FREERTOS_USE_SYSTICK                                      1
+#define configSYSTICK_CLOCK_HZ                                    ( 32768UL )
+#define xPortSysTickHandler                                       RTC1_IRQHandler
+
+#ifndef __ASSEMBLER__
+#include "TimeStamp.h"
+void AppTasksSleep(void);
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#include "GATTTransport.h"
+#include "ble.h"
+#include "nrf_sdh_ble.h"
+
+#include <string.h>
+
+#define GATT_TRANSPORT_OBSERVER_PRIO  2
+#define ATT_NOTIFICATION_HEADER_SIZE  3
+
+static nrf_ble_gatt_t const* gpGATT = NULL;
+static uint16_t gConnHandle = BLE_CONN_HANDLE_INVALID;
+static uint16_t gValueHandles[TRANSPORT_CHANNEL_COUNT];
+
+static bool GATTReady()
+{
+    return gpGATT != NULL && gConnHandle != BLE_CONN_HANDLE_INVALID;
+}
+
+static uint16_t GATTMaxPacketSize()
+{
+    if(!GATTReady())
+    {
+        return 0;
+    }
+
+    uint16_t size = nrf_ble_gatt_eff_mtu_get(gpGATT, gConnHandle) - ATT_NOTIFICATION_HEADER_SIZE;
+    return size < TRANSPORT_MAX_PACKET_SIZE ? size : TRANSPORT_MAX_PACKET_SIZE;
+}
+
+static ret_code_t GATTSend(enum TRANSPORT_CHANNEL Channel, const uint8_t* pData, uint16_t Length)
+{
+    ble_gatts_hvx_params_t params;
+
+    if(!GATTReady())
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.type   = BLE_GATT_HVX_NOTIFICATION;
+    params.handle = gValueHandles[Channel];
+    params.p_data = pData;
+    params.p_len  = &Length;
+
+    return sd_ble_gatts_hvx(gConnHandle, &params);
+}
+
+static void GATTTransportBLEEventHandler(ble_evt_t const* pEvent, void* pContext)
+{
+    switch (pEvent->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            gConnHandle = pEvent->evt.gap_evt.conn_handle;
+            break;
+        case BLE_GAP_EVT_DISCONNECTED:
+            gConnHandle = BLE_CONN_HANDLE_INVALID;
+            break;
+        default:
+            break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(gGATTTransportObserver, GATT_TRANSPORT_OBSERVER_PRIO, GATTTransportBLEEventHandler, NULL);
+
+static const Transport gGATTTransport =
+{
+    .Name          = "GATT",
+    .Ready         = GATTReady,
+    .MaxPacketSize = GATTMaxPacketSize,
+    .Send          = GATTSend,
+};
+
+void InitGATTTransport(nrf_ble_gatt_t const* pGATT, uint16_t StreamValueHandle, uint16_t RecordValueHandle)
+{
+    gpGATT = pGATT;
+    gValueHandles[TRANSPORT_CHANNEL_STREAM] = StreamValueHandle;
+    gValueHandles[TRANSPORT_CHANNEL_RECORD] = RecordValueHandle;
+}
+
+const Transport* GATTTransport()
+{
+    return &gGATTTransport;
+}
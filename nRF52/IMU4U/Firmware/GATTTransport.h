@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+#include "nrf_ble_gatt.h"
+#include "Transport.h"
+
+// Sends packets as notifications, sized to the connection's ATT MTU.  Stream packets go
+// out on the IMU characteristic and recording packets on the record data characteristic.
+void InitGATTTransport(nrf_ble_gatt_t const* pGATT, uint16_t StreamValueHandle, uint16_t RecordValueHandle);
+
+const Transport* GATTTransport();
@@ -5,6 +5,8 @@
 #include "nrf.h"
 #include "bsp.h"
 #include "nrf_drv_twi.h"
+#include "app_util_platform.h"
+#include "TimeStamp.h"
 
 #include <string.h>
 
@@ -36,6 +38,9 @@
 #define FXOS8700_REG_M_CTRL_REG1  0x5B
 #define FXOS8700_REG_M_CTRL_REG2  0x5C
 
+#define FXOS8700_CTRL_REG1_STANDBY 0x2C  // 6.25Hz hybrid, reduced noise, standby
+#define FXOS8700_CTRL_REG1_ACTIVE  0x2D  // As above but active
+
 #define FXAS21002C_ADDR           0x21
 #define FXAS21002C_WHO_AM_I_VAL   0xD7
 #define FXAS21002C_REG_STATUS     0x00
@@ -52,6 +57,10 @@
 #define FXAS21002C_REG_CTRL_REG1  0x13
 #define FXAS21002C_REG_CTRL_REG2  0x14
 
+#define FXAS21002C_CTRL_REG1_STANDBY 0x1C  // 12.5Hz, standby
+#define FXAS21002C_CTRL_REG1_READY   0x1D  // 12.5Hz, ready (drive circuitry on, no output)
+#define FXAS21002C_CTRL_REG1_ACTIVE  0x1E  // 12.5Hz, active
+
 #define ONE_G_IN_LSB          16384.0f
 #define MICRO_TESLA_PER_LSB       0.1f
 #define MILLI_DEGREES_PER_LSB  7.8125f
@@ -63,11 +72,17 @@
 #define ACCEL_MAG_LED        BSP_LED_3
 
 static IMU_CALLBACK CallbackFunction;
+static IMU_DATA_READY_CALLBACK DataReadyCallbackFunction;
 static bool CallbackActive = false;
-static struct IMUData CurrentIMUData;
+static IMUSample CurrentIMUSample;
 static const nrf_drv_twi_t m_twi = NRF_DRV_TWI_INSTANCE(TWI_INSTANCE_ID);
 volatile static uint32_t g_AccelMagIntCount = 0;
 volatile static uint32_t g_GyroIntCount = 0;
+volatile static bool g_AccelMagDataReady = false;
+volatile static bool g_GyroDataReady = false;
+static enum IMU_POWER_STATE PowerState = IMU_POWER_OFF;
+static uint64_t PowerResidency[IMU_POWER_STATE_COUNT];
+static uint32_t PowerResidencyTime = 0;  // When PowerResidency was last brought up to date
 
 void InitFXOS8700CQ();
 void InitFXAS21002C();
@@ -77,19 +92,28 @@ void GetAccelMagData();
 void DataReadyInterruptHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action);
 void SetupInterruptPin(nrfx_gpiote_pin_t pin);
 void InitGPIOInterrupts();
+void EnableDataReadyInterrupts(bool enable);
+void UpdatePowerResidency();
 void TWIHandler(nrf_drv_twi_evt_t const * p_event, void * p_context);
 uint8_t I2CReadByte(uint8_t slaveAddress, uint8_t regAddress);
 void I2CWriteByte(uint8_t slaveAddress, uint8_t regAddress, uint8_t data);
 
-enum IMU_ERROR_STATUS InitIMU(IMU_CALLBACK IMUCallbackFunction)
+enum IMU_ERROR_STATUS InitIMU(IMU_CALLBACK IMUCallbackFunction, IMU_DATA_READY_CALLBACK DataReadyCallback)
 {
-    memset(&CurrentIMUData, 0, sizeof(IMUData));
+    memset(&CurrentIMUSample, 0, sizeof(IMUSample));
     CallbackFunction = IMUCallbackFunction;
+    DataReadyCallbackFunction = DataReadyCallback;
     InitTWI();            // Setup the two wire interface
     InitGPIOInterrupts(); // Setup interrupt pins for the Gyroscope and Accelerometer/Magnometer
     InitFXAS21002C();     // Setup the gyroscope  
     InitFXOS8700CQ();     // Setup the accelerometer/magnometer   
 
+    // Both sensors were left in standby, nothing needs the bus until someone wants data
+    nrf_drv_twi_disable(&m_twi);
+    PowerState = IMU_POWER_OFF;
+    PowerResidencyTime = TimeStampNow();
+    memset(PowerResidency, 0, sizeof(PowerResidency));
+
     return IMU_OK;
 }
 
@@ -105,6 +129,78 @@ enum IMU_ERROR_STATUS StopIMU()
     return IMU_OK;
 }
 
+enum IMU_ERROR_STATUS IMUSetPowerState(enum IMU_POWER_STATE State)
+{
+    if(State == PowerState)
+    {
+        return IMU_OK;
+    }
+
+    UpdatePowerResidency();
+
+    if(PowerState == IMU_POWER_OFF)
+    {
+        nrf_drv_twi_enable(&m_twi);
+    }
+
+    switch(State)
+    {
+        case IMU_POWER_OFF:
+            EnableDataReadyInterrupts(false);
+            I2CWriteByte(FXOS8700CQ_ADDR, FXOS8700_REG_CTRL_REG1, FXOS8700_CTRL_REG1_STANDBY);
+            I2CWriteByte(FXAS21002C_ADDR, FXAS21002C_REG_CTRL_REG1, FXAS21002C_CTRL_REG1_STANDBY);
+            nrf_drv_twi_disable(&m_twi);
+            break;
+
+        case IMU_POWER_STANDBY:
+            EnableDataReadyInterrupts(false);
+            I2CWriteByte(FXOS8700CQ_ADDR, FXOS8700_REG_CTRL_REG1, FXOS8700_CTRL_REG1_STANDBY);
+            I2CWriteByte(FXAS21002C_ADDR, FXAS21002C_REG_CTRL_REG1, FXAS21002C_CTRL_REG1_READY);
+            break;
+
+        case IMU_POWER_ACTIVE:
+            I2CWriteByte(FXAS21002C_ADDR, FXAS21002C_REG_CTRL_REG1, FXAS21002C_CTRL_REG1_ACTIVE);
+            I2CWriteByte(FXOS8700CQ_ADDR, FXOS8700_REG_CTRL_REG1, FXOS8700_CTRL_REG1_ACTIVE);
+
+            // A sample left unread when the sensors were last stopped holds its
+            // interrupt line low, and we only see falling edges.  Reading clears it.
+            GetAccelMagData();
+            GetGryoData();
+            g_AccelMagDataReady = false;
+            g_GyroDataReady = false;
+            EnableDataReadyInterrupts(true);
+            break;
+
+        default:
+            return IMU_ERROR;
+    }
+
+    PowerState = State;
+    return IMU_OK;
+}
+
+enum IMU_POWER_STATE IMUGetPowerState()
+{
+    return PowerState;
+}
+
+void IMUGetPowerResidency(uint64_t Residency[IMU_POWER_STATE_COUNT])
+{
+    UpdatePowerResidency();
+    memcpy(Residency, PowerResidency, sizeof(PowerResidency));
+}
+
+// Adds the time since the last update to the current state.  Time stamps wrap every 36
+// hours, so this needs calling more often than that (reading the residency does it).
+void UpdatePowerResidency()
+{
+    CRITICAL_REGION_ENTER();
+    uint32_t now = TimeStampNow();
+    PowerResidency[PowerState] += (uint32_t)(now - PowerResidencyTime);
+    PowerResidencyTime = now;
+    CRITICAL_REGION_EXIT();
+}
+
 void InitFXOS8700CQ()
 {
     // Make sure the accelerometer/magnometer is what we think it is
@@ -156,8 +252,8 @@ void InitFXOS8700CQ()
     // Bit 5-3: 101 (6.25Hz output data rate (note below we're in hybrid mode))
     // Bit 2:     1 (Reduced noise mode)
     // Bit 1:     0 (Normal I2C read mode 100kbit/s)
-    // Bit 0:     1 (Change from standby to active)
-    I2CWriteByte(FXOS8700CQ_ADDR, FXOS8700_REG_CTRL_REG1, 0x2D);
+    // Bit 0:     0 (Stay in standby, IMUSetPowerState() makes it active)
+    I2CWriteByte(FXOS8700CQ_ADDR, FXOS8700_REG_CTRL_REG1, FXOS8700_CTRL_REG1_STANDBY);
 
     // MCTRL_REG1 (0x5B) - Magnetometer control register
     // Bit 7:     0 (Auto-calibration feature is disabled)
@@ -237,8 +333,8 @@ void InitFXAS21002C()
     // Bit 6:     0 (Don't reset the device)
     // Bit 5:     0 (Self test disabled)
     // Bit 4-2: 111 (12.5 Hz output data rate)
-    // Bit 0-1:  10 (Move from stanby mode to active)
-    I2CWriteByte(FXAS21002C_ADDR, FXAS21002C_REG_CTRL_REG1, 0x1E);
+    // Bit 0-1:  00 (Stay in standby, IMUSetPowerState() makes it active)
+    I2CWriteByte(FXAS21002C_ADDR, FXAS21002C_REG_CTRL_REG1, FXAS21002C_CTRL_REG1_STANDBY);
 
     // Wait a moment after configuring
     nrf_delay_ms(100);
@@ -265,7 +361,8 @@ void InitTWI()
 void GetGryoData()
 {
     // Read the Gyroscope status and x,y,z values
-    CurrentIMUData.GyroStatus = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_STATUS);
+    CurrentIMUSample.GyroTime = TimeStampNow();
+    CurrentIMUSample.Data.GyroStatus = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_STATUS);
     uint8_t xMSB = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_OUT_X_MSB);
     uint8_t xLSB = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_OUT_X_LSB);
     uint8_t yMSB = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_OUT_Y_MSB);
@@ -274,15 +371,16 @@ void GetGryoData()
     uint8_t zLSB = I2CReadByte(FXAS21002C_ADDR, FXAS21002C_REG_OUT_Z_LSB);
 
     // Convert MSB/LSB values into meaningful data
-    CurrentIMUData.Gyro.X = (int16_t)((xMSB << 8) | xLSB);
-    CurrentIMUData.Gyro.Y = (int16_t)((yMSB << 8) | yLSB);
-    CurrentIMUData.Gyro.Z = (int16_t)((zMSB << 8) | zLSB);
+    CurrentIMUSample.Data.Gyro.X = (int16_t)((xMSB << 8) | xLSB);
+    CurrentIMUSample.Data.Gyro.Y = (int16_t)((yMSB << 8) | yLSB);
+    CurrentIMUSample.Data.Gyro.Z = (int16_t)((zMSB << 8) | zLSB);
 }
 
 void GetAccelMagData()
 {
     // Read the accelerometer status and x,y,z values
-    CurrentIMUData.AccelStatus = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_STATUS);
+    CurrentIMUSample.AccelMagTime = TimeStampNow();
+    CurrentIMUSample.Data.AccelStatus = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_STATUS);
     uint8_t axMSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_OUT_X_MSB);
     uint8_t axLSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_OUT_X_LSB);
     uint8_t ayMSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_OUT_Y_MSB);
@@ -291,7 +389,7 @@ void GetAccelMagData()
     uint8_t azLSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_OUT_Z_LSB);            
     
     // Read the magnometer status and x,y,z values
-    CurrentIMUData.MagStatus = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_M_DR_STATUS);
+    CurrentIMUSample.Data.MagStatus = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_M_DR_STATUS);
     uint8_t mxMSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_M_OUT_X_MSB);
     uint8_t mxLSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_M_OUT_X_LSB);
     uint8_t myMSB = I2CReadByte(FXOS8700CQ_ADDR, FXOS8700_REG_M_OUT_Y_MSB);
@@ -303,14 +401,14 @@ void GetAccelMagData()
     // Note that the accelerometer data is only 14 bits of precision.  The low 6 bits 
     // are in bits 2-to-7.  The value is signed, so we just put into a signed 16 bit
     // so the sign conversion to signed data is easy.
-    CurrentIMUData.Accel.X = (int16_t)((axMSB << 8) | axLSB);
-    CurrentIMUData.Accel.Y = (int16_t)((ayMSB << 8) | ayLSB);
-    CurrentIMUData.Accel.Z = (int16_t)((azMSB << 8) | azLSB);
+    CurrentIMUSample.Data.Accel.X = (int16_t)((axMSB << 8) | axLSB);
+    CurrentIMUSample.Data.Accel.Y = (int16_t)((ayMSB << 8) | ayLSB);
+    CurrentIMUSample.Data.Accel.Z = (int16_t)((azMSB << 8) | azLSB);
 
     // Convert magnometer MSB/LSB values into meaningful data.
-    CurrentIMUData.Mag.X = (int16_t)((mxMSB << 8) | mxLSB);
-    CurrentIMUData.Mag.Y = (int16_t)((mxMSB << 8) | myLSB);
-    CurrentIMUData.Mag.Z = (int16_t)((mzMSB << 8) | mzLSB);
+    CurrentIMUSample.Data.Mag.X = (int16_t)((mxMSB << 8) | mxLSB);
+    CurrentIMUSample.Data.Mag.Y = (int16_t)((mxMSB << 8) | myLSB);
+    CurrentIMUSample.Data.Mag.Z = (int16_t)((mzMSB << 8) | mzLSB);
 }
 
 void DataReadyInterruptHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t action)
@@ -318,18 +416,38 @@ void DataReadyInterruptHandler(nrf_drv_gpiote_pin_t pin, nrf_gpiote_polarity_t a
     if(pin == ACCEL_MAG_INTERRUPT_PIN)
     {     
         nrf_gpio_pin_toggle(ACCEL_MAG_LED); // Toggle LED to show interrupt still being called
-        GetAccelMagData();
-        //if(CallbackActive) CallbackFunction(&CurrentIMUData);
+        g_AccelMagDataReady = true;
         ++g_AccelMagIntCount;
     }
 
     if(pin == GYRO_INTERRUPT_PIN)
     {     
         nrf_gpio_pin_toggle(GYRO_LED); // Toggle LED to show interrupt still being called
-        GetGryoData();
-        if(CallbackActive) CallbackFunction(&CurrentIMUData);
+        g_GyroDataReady = true;
         ++g_GyroIntCount;
     }
+
+    if(DataReadyCallbackFunction != NULL)
+    {
+        DataReadyCallbackFunction();
+    }
+}
+
+void IMUReadPending()
+{
+    if(g_AccelMagDataReady)
+    {
+        g_AccelMagDataReady = false;
+        GetAccelMagData();
+    }
+
+    // A sample is complete when the gyro, the faster of the two sensors, has been read
+    if(g_GyroDataReady)
+    {
+        g_GyroDataReady = false;
+        GetGryoData();
+        if(CallbackActive) CallbackFunction(&CurrentIMUSample);
+    }
 }
 
 void SetupInterruptPin(nrfx_gpiote_pin_t pin)
@@ -339,8 +457,6 @@ void SetupInterruptPin(nrfx_gpiote_pin_t pin)
     
     ret_code_t err_code = nrf_drv_gpiote_in_init(pin, &in_config, DataReadyInterruptHandler);
     APP_ERROR_CHECK(err_code);
-
-    nrf_drv_gpiote_in_event_enable(pin, true);
 }
 
 void InitGPIOInterrupts()
@@ -352,6 +468,20 @@ void InitGPIOInterrupts()
     SetupInterruptPin(ACCEL_MAG_INTERRUPT_PIN);
 }
 
+void EnableDataReadyInterrupts(bool enable)
+{
+    if(enable)
+    {
+        nrf_drv_gpiote_in_event_enable(GYRO_INTERRUPT_PIN, true);
+        nrf_drv_gpiote_in_event_enable(ACCEL_MAG_INTERRUPT_PIN, true);
+    }
+    else
+    {
+        nrf_drv_gpiote_in_event_disable(GYRO_INTERRUPT_PIN);
+        nrf_drv_gpiote_in_event_disable(ACCEL_MAG_INTERRUPT_PIN);
+    }
+}
+
 
 void TWIHandler(nrf_drv_twi_evt_t const * p_event, void * p_context)
 {
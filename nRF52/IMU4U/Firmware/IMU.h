@@ -20,7 +20,19 @@ typedef struct IMUData
     uint8_t ErrorStatus;
 } IMUData;
 
-typedef void (*IMU_CALLBACK)(const IMUData*);
+// An IMU reading along with when each sensor was read (see TimeStamp.h)
+typedef struct IMUSample
+{
+    uint32_t AccelMagTime;
+    uint32_t GyroTime;
+    IMUData  Data;
+} IMUSample;
+
+typedef void (*IMU_CALLBACK)(const IMUSample*);
+
+// Called from the data ready interrupt.  The sensors aren't read in the interrupt, this
+// should wake whoever calls IMUReadPending().
+typedef void (*IMU_DATA_READY_CALLBACK)(void);
 
 enum IMU_ERROR_STATUS
 {
@@ -28,6 +40,30 @@ enum IMU_ERROR_STATUS
     IMU_ERROR
 };
 
-enum IMU_ERROR_STATUS InitIMU(IMU_CALLBACK Callback);
+// Sensor power states.  In OFF both sensors are in standby and the TWI bus is disabled.
+// In STANDBY the accel/mag is in standby and the gyro is in its ready mode, so it can
+// start sampling within a few milliseconds rather than the 60ms it needs from standby.
+// Only ACTIVE samples and raises data ready interrupts.
+enum IMU_POWER_STATE
+{
+    IMU_POWER_OFF,
+    IMU_POWER_STANDBY,
+    IMU_POWER_ACTIVE,
+    IMU_POWER_STATE_COUNT
+};
+
+// Sets up the sensors and leaves them in IMU_POWER_OFF
+enum IMU_ERROR_STATUS InitIMU(IMU_CALLBACK Callback, IMU_DATA_READY_CALLBACK DataReadyCallback);
 enum IMU_ERROR_STATUS StartIMU();
-enum IMU_ERROR_STATUS StopIMU();
\ No newline at end of file
+enum IMU_ERROR_STATUS StopIMU();
+
+// Reads the sensors that have signalled data ready since the last call, calling the
+// IMU_CALLBACK with each new sample
+void IMUReadPending();
+
+// Must be called from the same context as IMUReadPending(), since both use the TWI bus
+enum IMU_ERROR_STATUS IMUSetPowerState(enum IMU_POWER_STATE State);
+enum IMU_POWER_STATE IMUGetPowerState();
+
+// Time spent in each power state since InitIMU(), in time stamp ticks (see TimeStamp.h)
+void IMUGetPowerResidency(uint64_t Residency[IMU_POWER_STATE_COUNT]);
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "L2CAPTransport.h"
+#include "app_util_platform.h"
+#include "ble.h"
+#include "ble_l2cap.h"
+#include "nrf_log.h"
+#include "nrf_sdh_ble.h"
+
+#include <string.h>
+
+#define L2CAP_TRANSPORT_OBSERVER_PRIO  2
+
+#define L2CAP_MPS             247   // One K-frame fills an LL packet at the maximum data length
+#define L2CAP_RX_MTU          64    // The central only sends us small SDUs
+#define L2CAP_SDU_LENGTH_SIZE 2     // The first K-frame of each SDU carries the SDU length
+#define L2CAP_TX_QUEUE_SIZE   4     // SDUs the SoftDevice holds for us at once
+#define L2CAP_RX_QUEUE_SIZE   1
+
+typedef struct L2CAPTxBuffer
+{
+    uint8_t Data[TRANSPORT_MAX_PACKET_SIZE];
+    bool    InUse;  // Owned by the SoftDevice until BLE_L2CAP_EVT_CH_TX
+} L2CAPTxBuffer;
+
+static uint16_t gConnHandle = BLE_CONN_HANDLE_INVALID;
+static uint16_t gLocalCID = BLE_L2CAP_CID_INVALID;
+static volatile bool gChannelOpen = false;
+static uint16_t gPeerMTU = 0;
+static uint16_t gPeerMPS = 0;
+static volatile uint32_t gCredits = 0;  // K-frames the peer will currently accept
+
+static uint8_t gRxBuffer[L2CAP_RX_MTU];
+static L2CAPTxBuffer gTxBuffers[L2CAP_TX_QUEUE_SIZE];
+
+static uint32_t CreditsForSDU(uint16_t Length)
+{
+    return (Length + L2CAP_SDU_LENGTH_SIZE + gPeerMPS - 1) / gPeerMPS;
+}
+
+static void ReleaseTxBuffer(const uint8_t* pData)
+{
+    for(int i = 0; i < L2CAP_TX_QUEUE_SIZE; ++i)
+    {
+        if(gTxBuffers[i].Data == pData)
+        {
+            gTxBuffers[i].InUse = false;
+        }
+    }
+}
+
+static void ResetChannel()
+{
+    gChannelOpen = false;
+    gLocalCID = BLE_L2CAP_CID_INVALID;
+    gCredits = 0;
+    for(int i = 0; i < L2CAP_TX_QUEUE_SIZE; ++i)
+    {
+        gTxBuffers[i].InUse = false;
+    }
+}
+
+static void FillRxParams(ble_l2cap_ch_setup_params_t* pParams)
+{
+    memset(pParams, 0, sizeof(*pParams));
+    pParams->rx_params.rx_mtu         = L2CAP_RX_MTU;
+    pParams->rx_params.rx_mps         = L2CAP_MPS;
+    pParams->rx_params.sdu_buf.p_data = gRxBuffer;
+    pParams->rx_params.sdu_buf.len    = sizeof(gRxBuffer);
+}
+
+static bool L2CAPReady()
+{
+    return gChannelOpen;
+}
+
+static uint16_t L2CAPMaxPacketSize()
+{
+    if(!gChannelOpen)
+    {
+        return 0;
+    }
+
+    return gPeerMTU < TRANSPORT_MAX_PACKET_SIZE ? gPeerMTU : TRANSPORT_MAX_PACKET_SIZE;
+}
+
+static ret_code_t L2CAPSend(enum TRANSPORT_CHANNEL Channel, const uint8_t* pData, uint16_t Length)
+{
+    L2CAPTxBuffer* pBuffer = NULL;
+
+    if(!gChannelOpen)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if(Length > L2CAPMaxPacketSize())
+    {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    // Hold packets back until the peer has credit for them rather than letting them sit
+    // in the SoftDevice, so the producer can keep adding fresh samples to its packet
+    uint32_t credits = CreditsForSDU(Length);
+
+    CRITICAL_REGION_ENTER();
+    if(gCredits >= credits)
+    {
+        for(int i = 0; i < L2CAP_TX_QUEUE_SIZE; ++i)
+        {
+            if(!gTxBuffers[i].InUse)
+            {
+                pBuffer = &gTxBuffers[i];
+                pBuffer->InUse = true;
+                gCredits -= credits;
+                break;
+            }
+        }
+    }
+    CRITICAL_REGION_EXIT();
+
+    if(pBuffer == NULL)
+    {
+        return NRF_ERROR_RESOURCES;
+    }
+
+    memcpy(pBuffer->Data, pData, Length);
+
+    ble_data_t sdu;
+    sdu.p_data = pBuffer->Data;
+    sdu.len    = Length;
+
+    ret_code_t errCode = sd_ble_l2cap_ch_tx(gConnHandle, gLocalCID, &sdu);
+    if(errCode != NRF_SUCCESS)
+    {
+        CRITICAL_REGION_ENTER();
+        pBuffer->InUse = false;
+        gCredits += credits;
+        CRITICAL_REGION_EXIT();
+    }
+
+    return errCode;
+}
+
+static void L2CAPTransportBLEEventHandler(ble_evt_t const* pEvent, void* pContext)
+{
+    ble_l2cap_evt_t const* pL2CAPEvent = &pEvent->evt.l2cap_evt;
+    ble_l2cap_ch_setup_params_t params;
+
+    switch (pEvent->header.evt_id)
+    {
+        case BLE_GAP_EVT_CONNECTED:
+            gConnHandle = pEvent->evt.gap_evt.conn_handle;
+            ResetChannel();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            gConnHandle = BLE_CONN_HANDLE_INVALID;
+            ResetChannel();
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP_REQUEST:
+            {
+                // The central is opening a channel to us
+                uint16_t localCID = pL2CAPEvent->local_cid;
+                FillRxParams(&params);
+                if(pL2CAPEvent->params.ch_setup_request.le_psm == L2CAP_TRANSPORT_PSM && gLocalCID == BLE_L2CAP_CID_INVALID)
+                {
+                    params.status = BLE_L2CAP_CH_STATUS_CODE_SUCCESS;
+                }
+                else
+                {
+                    params.status = BLE_L2CAP_CH_STATUS_CODE_LE_PSM_NOT_SUPPORTED;
+                }
+                sd_ble_l2cap_ch_setup(pL2CAPEvent->conn_handle, &localCID, &params);
+            }
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP:
+            gLocalCID = pL2CAPEvent->local_cid;
+            gPeerMTU  = pL2CAPEvent->params.ch_setup.tx_params.tx_mtu;
+            gPeerMPS  = pL2CAPEvent->params.ch_setup.tx_params.peer_mps;
+            gCredits  = pL2CAPEvent->params.ch_setup.tx_params.credits;
+            gChannelOpen = true;
+            NRF_LOG_INFO("L2CAP channel open, MTU %d, MPS %d", gPeerMTU, gPeerMPS);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SETUP_REFUSED:
+            NRF_LOG_INFO("L2CAP channel refused, status 0x%x", pL2CAPEvent->params.ch_setup_refused.status);
+            ResetChannel();
+            break;
+
+        case BLE_L2CAP_EVT_CH_RELEASED:
+            NRF_LOG_INFO("L2CAP channel released");
+            ResetChannel();
+            break;
+
+        case BLE_L2CAP_EVT_CH_CREDIT:
+            CRITICAL_REGION_ENTER();
+            gCredits += pL2CAPEvent->params.credit.credits;
+            CRITICAL_REGION_EXIT();
+            break;
+
+        case BLE_L2CAP_EVT_CH_TX:
+            ReleaseTxBuffer(pL2CAPEvent->params.tx.sdu_buf.p_data);
+            break;
+
+        case BLE_L2CAP_EVT_CH_SDU_BUF_RELEASED:
+            ReleaseTxBuffer(pL2CAPEvent->params.ch_sdu_buf_released.sdu_buf.p_data);
+            break;
+
+        case BLE_L2CAP_EVT_CH_RX:
+            {
+                // Nothing is expected from the central yet, hand the buffer straight back
+                ble_data_t sdu;
+                sdu.p_data = gRxBuffer;
+                sdu.len    = sizeof(gRxBuffer);
+                sd_ble_l2cap_ch_rx(pL2CAPEvent->conn_handle, pL2CAPEvent->local_cid, &sdu);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+NRF_SDH_BLE_OBSERVER(gL2CAPTransportObserver, L2CAP_TRANSPORT_OBSERVER_PRIO, L2CAPTransportBLEEventHandler, NULL);
+
+static const Transport gL2CAPTransport =
+{
+    .Name          = "L2CAP",
+    .Ready         = L2CAPReady,
+    .MaxPacketSize = L2CAPMaxPacketSize,
+    .Send          = L2CAPSend,
+};
+
+ret_code_t L2CAPTransportConfigure(uint8_t ConnCfgTag, uint32_t RAMStart)
+{
+    ble_cfg_t bleCfg;
+
+    memset(&bleCfg, 0, sizeof(bleCfg));
+    bleCfg.conn_cfg.conn_cfg_tag = ConnCfgTag;
+    bleCfg.conn_cfg.params.l2cap_conn_cfg.rx_mps        = L2CAP_MPS;
+    bleCfg.conn_cfg.params.l2cap_conn_cfg.tx_mps        = L2CAP_MPS;
+    bleCfg.conn_cfg.params.l2cap_conn_cfg.rx_queue_size = L2CAP_RX_QUEUE_SIZE;
+    bleCfg.conn_cfg.params.l2cap_conn_cfg.tx_queue_size = L2CAP_TX_QUEUE_SIZE;
+    bleCfg.conn_cfg.params.l2cap_conn_cfg.ch_count      = 1;
+
+    return sd_ble_cfg_set(BLE_CONN_CFG_L2CAP, &bleCfg, RAMStart);
+}
+
+ret_code_t L2CAPTransportOpen(uint16_t PSM)
+{
+    ble_l2cap_ch_setup_params_t params;
+
+    if(gConnHandle == BLE_CONN_HANDLE_INVALID || gLocalCID != BLE_L2CAP_CID_INVALID)
+    {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    FillRxParams(&params);
+    params.le_psm = PSM;
+
+    uint16_t localCID = BLE_L2CAP_CID_INVALID;
+    ret_code_t errCode = sd_ble_l2cap_ch_setup(gConnHandle, &localCID, &params);
+    if(errCode == NRF_SUCCESS)
+    {
+        // Remember the channel so we don't try to open a second one while this is pending
+        gLocalCID = localCID;
+    }
+
+    return errCode;
+}
+
+void L2CAPTransportClose()
+{
+    if(gConnHandle != BLE_CONN_HANDLE_INVALID && gLocalCID != BLE_L2CAP_CID_INVALID)
+    {
+        sd_ble_l2cap_ch_release(gConnHandle, gLocalCID);
+    }
+}
+
+const Transport* L2CAPTransport()
+{
+    return &gL2CAPTransport;
+}
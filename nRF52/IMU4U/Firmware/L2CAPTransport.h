@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include "sdk_errors.h"
+#include "Transport.h"
+
+// Sends packets as SDUs on an LE L2CAP connection-oriented channel.  A channel carries
+// SDUs far larger than a notification, with no ATT header or per-packet handle, and the
+// peer paces us with credits rather than the GATT notification queue.
+//
+// The channel is either opened by the central to L2CAP_TRANSPORT_PSM, or opened by
+// IMU4U to a PSM the central is listening on (see L2CAPTransportOpen()).  While no
+// channel is open TransportActive() falls back to GATT.
+
+#define L2CAP_TRANSPORT_PSM  0x0081  // LE PSM IMU4U accepts channels on
+
+// Registers the channel configuration with the SoftDevice.  Must be called between
+// nrf_sdh_ble_default_cfg_set() and nrf_sdh_ble_enable().
+ret_code_t L2CAPTransportConfigure(uint8_t ConnCfgTag, uint32_t RAMStart);
+
+// Opens a channel to a PSM the connected central is listening on
+ret_code_t L2CAPTransportOpen(uint16_t PSM);
+
+// Releases the channel, packets go back to GATT
+void L2CAPTransportClose();
+
+const Transport* L2CAPTransport();
@@ -0,0 +1,303 @@
+#include "Recorder.h"
+#include "FlashLog.h"
+#include "SampleCodec.h"
+#include "Transport.h"
+#include "app_util.h"
+#include "nordic_common.h"
+#include "nrf_fstorage.h"
+#include "nrf_fstorage_sd.h"
+#include "nrf_log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include <string.h>
+
+// The top 256 KB of flash is reserved for recordings (see FLASH_SIZE in IMU4U.emProject)
+#define RECORDER_FLASH_START   0xC0000
+#define RECORDER_FLASH_END     0x100000
+#define RECORDER_PAGE_SIZE     4096
+#define RECORDER_PAGE_COUNT    ((RECORDER_FLASH_END - RECORDER_FLASH_START) / RECORDER_PAGE_SIZE)
+
+#define RECORDER_BLOCK_SIZE    240   // Max bytes in a compressed block
+#define RECORDER_BLOCK_HEADER  2     // Version and sample count
+#define RECORDER_BLOCK_COUNT   2     // One filling while the other is written to flash
+
+#define DOWNLOAD_HEADER_SIZE   5     // Packet type and stream offset
+
+typedef struct RecorderBlock
+{
+    uint8_t          Data[RECORDER_BLOCK_SIZE];
+    uint16_t         Length;
+    volatile bool    Full;        // Waiting to be written to flash
+    SampleCodecState CodecState;
+} RecorderBlock;
+
+static void FlashEventHandler(nrf_fstorage_evt_t* pEvent);
+
+NRF_FSTORAGE_DEF(nrf_fstorage_t gFlashStorage) =
+{
+    .evt_handler = FlashEventHandler,
+    .start_addr  = RECORDER_FLASH_START,
+    .end_addr    = RECORDER_FLASH_END - 1,
+};
+
+static RecorderBlock    gBlocks[RECORDER_BLOCK_COUNT];
+static uint8_t          gFillBlock = 0;
+static volatile bool    gFlashOpFailed = false;
+static volatile bool    gRecording = false;
+static volatile bool    gFlushPartial = false;
+static volatile bool    gEraseRequested = false;
+static volatile uint32_t gDroppedSamples = 0;
+
+static volatile bool    gDownloading = false;
+static volatile uint32_t gDownloadOffset = 0;
+static uint8_t          gDownloadChunk[TRANSPORT_MAX_PACKET_SIZE];
+
+static void FlashEventHandler(nrf_fstorage_evt_t* pEvent)
+{
+    if(pEvent->result != NRF_SUCCESS)
+    {
+        gFlashOpFailed = true;
+    }
+}
+
+static bool WaitForFlash()
+{
+    // The SoftDevice reports completion through a SoC event, which is dispatched by
+    // another task, so give it the CPU while we wait
+    while(nrf_fstorage_is_busy(&gFlashStorage))
+    {
+        vTaskDelay(1);
+    }
+    return !gFlashOpFailed;
+}
+
+static bool FlashRead(uint32_t Address, void* pData, uint32_t Length)
+{
+    return nrf_fstorage_read(&gFlashStorage, Address, pData, Length) == NRF_SUCCESS;
+}
+
+static bool FlashWrite(uint32_t Address, const void* pData, uint32_t Length)
+{
+    gFlashOpFailed = false;
+    if(nrf_fstorage_write(&gFlashStorage, Address, pData, Length, NULL) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    return WaitForFlash();
+}
+
+static bool FlashErasePage(uint32_t Address)
+{
+    gFlashOpFailed = false;
+    if(nrf_fstorage_erase(&gFlashStorage, Address, 1, NULL) != NRF_SUCCESS)
+    {
+        return false;
+    }
+    return WaitForFlash();
+}
+
+static const FlashLogOps gFlashLogOps =
+{
+    .Read      = FlashRead,
+    .Write     = FlashWrite,
+    .ErasePage = FlashErasePage,
+};
+
+static void ResetBlock(RecorderBlock* pBlock)
+{
+    SampleCodecReset(&pBlock->CodecState);
+    pBlock->Data[0] = RECORDER_BLOCK_VERSION;
+    pBlock->Data[1] = 0;
+    pBlock->Length = RECORDER_BLOCK_HEADER;
+    pBlock->Full = false;
+}
+
+ret_code_t InitRecorder()
+{
+    for(int i = 0; i < RECORDER_BLOCK_COUNT; ++i)
+    {
+        ResetBlock(&gBlocks[i]);
+    }
+
+    ret_code_t errCode = nrf_fstorage_init(&gFlashStorage, &nrf_fstorage_sd, NULL);
+    VERIFY_SUCCESS(errCode);
+
+    FlashLogConfig config;
+    config.pOps         = &gFlashLogOps;
+    config.StartAddress = RECORDER_FLASH_START;
+    config.PageSize     = RECORDER_PAGE_SIZE;
+    config.PageCount    = RECORDER_PAGE_COUNT;
+
+    if(FlashLogMount(&config) != FLASH_LOG_OK)
+    {
+        return NRF_ERROR_INTERNAL;
+    }
+
+    NRF_LOG_INFO("Recording holds %d of %d bytes", FlashLogStreamSize(), FlashLogCapacity());
+    return NRF_SUCCESS;
+}
+
+void RecorderStart()
+{
+    gRecording = true;
+}
+
+void RecorderStop()
+{
+    gRecording = false;
+    gFlushPartial = true;
+}
+
+void RecorderErase()
+{
+    gRecording = false;
+    gEraseRequested = true;
+}
+
+void RecorderPushSample(const IMUSample* pSample)
+{
+    if(!gRecording)
+    {
+        return;
+    }
+
+    RecorderBlock* pBlock = &gBlocks[gFillBlock];
+    if(pBlock->Full)
+    {
+        // Both blocks are waiting on flash
+        ++gDroppedSamples;
+        return;
+    }
+
+    uint16_t length = SampleCodecEncode(&pBlock->CodecState, pSample, &pBlock->Data[pBlock->Length],
+                                        RECORDER_BLOCK_SIZE - pBlock->Length);
+    if(length == 0)
+    {
+        // This block is done, start the next one with this sample
+        pBlock->Full = true;
+        gFillBlock = (gFillBlock + 1) % RECORDER_BLOCK_COUNT;
+        pBlock = &gBlocks[gFillBlock];
+        if(pBlock->Full)
+        {
+            ++gDroppedSamples;
+            return;
+        }
+        length = SampleCodecEncode(&pBlock->CodecState, pSample, &pBlock->Data[pBlock->Length],
+                                   RECORDER_BLOCK_SIZE - pBlock->Length);
+    }
+
+    pBlock->Length += length;
+    ++pBlock->Data[1];
+}
+
+void RecorderStartDownload(uint32_t Offset)
+{
+    gDownloadOffset = Offset;
+    gDownloading = true;
+}
+
+void RecorderStopDownload()
+{
+    gDownloading = false;
+}
+
+void RecorderGetStatus(RecorderStatus* pStatus)
+{
+    pStatus->Recording      = gRecording;
+    pStatus->Downloading    = gDownloading;
+    pStatus->StreamSize     = FlashLogStreamSize();
+    pStatus->Capacity       = FlashLogCapacity();
+    pStatus->DroppedSamples = gDroppedSamples;
+}
+
+static void WriteBlock(RecorderBlock* pBlock)
+{
+    if(pBlock->Data[1] > 0)
+    {
+        enum FLASH_LOG_STATUS status = FlashLogAppend(pBlock->Data, pBlock->Length);
+        if(status != FLASH_LOG_OK)
+        {
+            gDroppedSamples += pBlock->Data[1];
+            if(status == FLASH_LOG_FULL)
+            {
+                NRF_LOG_INFO("Recording stopped, flash is full");
+                gRecording = false;
+            }
+        }
+    }
+
+    ResetBlock(pBlock);
+}
+
+static void SendDownloadChunks()
+{
+    while(gDownloading)
+    {
+        const Transport* pTransport = TransportActive();
+        uint16_t chunkSize = pTransport->MaxPacketSize();
+        if(chunkSize <= DOWNLOAD_HEADER_SIZE)
+        {
+            gDownloading = false;
+            break;
+        }
+
+        uint32_t offset = gDownloadOffset;
+        uint32_t length = FlashLogReadStream(offset, &gDownloadChunk[DOWNLOAD_HEADER_SIZE], chunkSize - DOWNLOAD_HEADER_SIZE);
+        gDownloadChunk[0] = TRANSPORT_PACKET_RECORD;
+        uint32_encode(offset, &gDownloadChunk[1]);
+
+        ret_code_t errCode = pTransport->Send(TRANSPORT_CHANNEL_RECORD, gDownloadChunk, (uint16_t)(DOWNLOAD_HEADER_SIZE + length));
+        if(errCode == NRF_ERROR_RESOURCES)
+        {
+            break;  // Queue is full, carry on when the main loop next runs
+        }
+        else if(errCode != NRF_SUCCESS)
+        {
+            gDownloading = false;
+        }
+        else if(length == 0)
+        {
+            gDownloading = false;  // That was the end marker
+        }
+        else
+        {
+            gDownloadOffset = offset + length;
+        }
+    }
+}
+
+void RecorderProcess()
+{
+    // Write blocks the interrupt has filled
+    for(int i = 0; i < RECORDER_BLOCK_COUNT; ++i)
+    {
+        if(gBlocks[i].Full)
+        {
+            WriteBlock(&gBlocks[i]);
+        }
+    }
+
+    // After stopping, write out the block that was still being filled
+    if(gFlushPartial && !gRecording)
+    {
+        gFlushPartial = false;
+        WriteBlock(&gBlocks[gFillBlock]);
+    }
+
+    if(gEraseRequested)
+    {
+        gEraseRequested = false;
+        gDownloading = false;
+        for(int i = 0; i < RECORDER_BLOCK_COUNT; ++i)
+        {
+            ResetBlock(&gBlocks[i]);
+        }
+        if(FlashLogErase() != FLASH_LOG_OK)
+        {
+            NRF_LOG_INFO("Erasing the recording failed");
+        }
+    }
+
+    SendDownloadChunks();
+}
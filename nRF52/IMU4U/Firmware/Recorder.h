@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+#include "IMU.h"
+
+// Records IMU samples to a reserved region of flash so nothing is lost when the BLE
+// link is poor or absent, and streams the recording back to the central on request.
+//
+// Samples are compressed (see SampleCodec.h) into blocks which are appended to a flash
+// log (see FlashLog.h).  Each block is independently decodable:
+//   Byte 0:   RECORDER_BLOCK_VERSION
+//   Byte 1:   Number of samples in the block
+//   Byte 2-n: The encoded samples
+//
+// A download sends the log's record stream over the active transport (see Transport.h)
+// as a series of chunks, each as large as the transport currently allows:
+//   Byte 0:    TRANSPORT_PACKET_RECORD
+//   Byte 1-4:  Little endian 32 bit stream offset of the chunk's first data byte
+//   Byte 5-n:  Stream data
+// A chunk with no data after the offset marks the end of the download.  Since offsets
+// are stable, an interrupted download can be resumed from the last offset received.
+
+#define RECORDER_BLOCK_VERSION  1
+
+typedef struct RecorderStatus
+{
+    bool     Recording;
+    bool     Downloading;
+    uint32_t StreamSize;      // Bytes of recording in flash
+    uint32_t Capacity;        // Bytes the flash region can hold
+    uint32_t DroppedSamples;  // Samples lost because flash couldn't keep up or was full
+} RecorderStatus;
+
+// Mounts the flash log.  Must be called after the SoftDevice is enabled.
+ret_code_t InitRecorder();
+
+// Start or stop appending samples to the recording
+void RecorderStart();
+void RecorderStop();
+
+// Erases the recording.  The erase happens in RecorderProcess().
+void RecorderErase();
+
+// Adds a sample to the recording (if recording)
+void RecorderPushSample(const IMUSample* pSample);
+
+// Starts sending the recording from the given stream offset
+void RecorderStartDownload(uint32_t Offset);
+void RecorderStopDownload();
+
+void RecorderGetStatus(RecorderStatus* pStatus);
+
+// Call regularly from the task that pushes samples.  Writes completed blocks to flash
+// and keeps the download going.  The task is blocked while flash operations complete.
+void RecorderProcess();
@@ -0,0 +1,127 @@
+#include "SampleCodec.h"
+
+#include <string.h>
+
+static uint32_t ZigZagEncode(int32_t Value)
+{
+    return ((uint32_t)Value << 1) ^ (uint32_t)(Value >> 31);
+}
+
+static int32_t ZigZagDecode(uint32_t Value)
+{
+    return (int32_t)(Value >> 1) ^ -(int32_t)(Value & 1);
+}
+
+static uint16_t WriteVarInt(uint8_t* pBuffer, uint32_t Value)
+{
+    uint16_t length = 0;
+    while(Value >= 0x80)
+    {
+        pBuffer[length++] = (uint8_t)(Value | 0x80);
+        Value >>= 7;
+    }
+    pBuffer[length++] = (uint8_t)Value;
+    return length;
+}
+
+// Returns the number of bytes read, or zero if the buffer ends mid value or the value
+// is longer than a 32 bit integer can be.
+static uint16_t ReadVarInt(const uint8_t* pBuffer, uint16_t BufferSize, uint32_t* pValue)
+{
+    uint32_t value = 0;
+    for(uint16_t i = 0; i < BufferSize && i < 5; ++i)
+    {
+        value |= (uint32_t)(pBuffer[i] & 0x7F) << (7 * i);
+        if((pBuffer[i] & 0x80) == 0)
+        {
+            *pValue = value;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+void SampleCodecReset(SampleCodecState* pState)
+{
+    memset(&pState->Previous, 0, sizeof(IMUSample));
+}
+
+uint16_t SampleCodecEncode(SampleCodecState* pState, const IMUSample* pSample, uint8_t* pBuffer, uint16_t BufferSize)
+{
+    const IMUSample* pPrev = &pState->Previous;
+    uint8_t encoded[SAMPLE_CODEC_MAX_SAMPLE_SIZE];
+    uint16_t length = 0;
+
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)(pSample->AccelMagTime - pPrev->AccelMagTime)));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)(pSample->GyroTime - pPrev->GyroTime)));
+
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Mag.X - pPrev->Data.Mag.X));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Mag.Y - pPrev->Data.Mag.Y));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Mag.Z - pPrev->Data.Mag.Z));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Accel.X - pPrev->Data.Accel.X));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Accel.Y - pPrev->Data.Accel.Y));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Accel.Z - pPrev->Data.Accel.Z));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Gyro.X - pPrev->Data.Gyro.X));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Gyro.Y - pPrev->Data.Gyro.Y));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.Gyro.Z - pPrev->Data.Gyro.Z));
+
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.MagStatus - pPrev->Data.MagStatus));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.AccelStatus - pPrev->Data.AccelStatus));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.GyroStatus - pPrev->Data.GyroStatus));
+    length += WriteVarInt(&encoded[length], ZigZagEncode((int32_t)pSample->Data.ErrorStatus - pPrev->Data.ErrorStatus));
+
+    if(length > BufferSize)
+    {
+        return 0;
+    }
+
+    memcpy(pBuffer, encoded, length);
+    pState->Previous = *pSample;
+    return length;
+}
+
+uint16_t SampleCodecDecode(SampleCodecState* pState, const uint8_t* pBuffer, uint16_t BufferSize, IMUSample* pSample)
+{
+    // Deltas for the two time stamps, nine axes and four status bytes, in the order
+    // SampleCodecEncode() writes them.
+    enum { FIELD_COUNT = 15 };
+    int32_t deltas[FIELD_COUNT];
+    uint16_t offset = 0;
+
+    for(int i = 0; i < FIELD_COUNT; ++i)
+    {
+        uint32_t value;
+        uint16_t length = ReadVarInt(&pBuffer[offset], BufferSize - offset, &value);
+        if(length == 0)
+        {
+            return 0;
+        }
+        deltas[i] = ZigZagDecode(value);
+        offset += length;
+    }
+
+    const IMUSample* pPrev = &pState->Previous;
+    IMUSample sample;
+
+    sample.AccelMagTime = pPrev->AccelMagTime + (uint32_t)deltas[0];
+    sample.GyroTime     = pPrev->GyroTime + (uint32_t)deltas[1];
+
+    sample.Data.Mag.X   = (int16_t)(pPrev->Data.Mag.X + deltas[2]);
+    sample.Data.Mag.Y   = (int16_t)(pPrev->Data.Mag.Y + deltas[3]);
+    sample.Data.Mag.Z   = (int16_t)(pPrev->Data.Mag.Z + deltas[4]);
+    sample.Data.Accel.X = (int16_t)(pPrev->Data.Accel.X + deltas[5]);
+    sample.Data.Accel.Y = (int16_t)(pPrev->Data.Accel.Y + deltas[6]);
+    sample.Data.Accel.Z = (int16_t)(pPrev->Data.Accel.Z + deltas[7]);
+    sample.Data.Gyro.X  = (int16_t)(pPrev->Data.Gyro.X + deltas[8]);
+    sample.Data.Gyro.Y  = (int16_t)(pPrev->Data.Gyro.Y + deltas[9]);
+    sample.Data.Gyro.Z  = (int16_t)(pPrev->Data.Gyro.Z + deltas[10]);
+
+    sample.Data.MagStatus   = (uint8_t)(pPrev->Data.MagStatus + deltas[11]);
+    sample.Data.AccelStatus = (uint8_t)(pPrev->Data.AccelStatus + deltas[12]);
+    sample.Data.GyroStatus  = (uint8_t)(pPrev->Data.GyroStatus + deltas[13]);
+    sample.Data.ErrorStatus = (uint8_t)(pPrev->Data.ErrorStatus + deltas[14]);
+
+    pState->Previous = sample;
+    *pSample = sample;
+    return offset;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "IMU.h"
+
+// Compresses IMU samples by storing each field as the difference from the previous
+// sample.  Differences are zigzag encoded (so small negative values stay small) and
+// then written as variable length integers, 7 bits per byte.  The first sample after
+// a reset is stored against an all zero sample.
+//
+// This module has no SDK dependencies so the same code can be built and exercised on
+// a PC.
+
+// Largest possible encoding of one sample: two 32 bit time stamps (5 bytes each), nine
+// 16 bit axis deltas (3 bytes each) and four status bytes (2 bytes each).
+#define SAMPLE_CODEC_MAX_SAMPLE_SIZE  45
+
+typedef struct SampleCodecState
+{
+    IMUSample Previous;
+} SampleCodecState;
+
+// Resets the state so the next sample is encoded (or decoded) from scratch.  Call
+// before each independently decodable block.
+void SampleCodecReset(SampleCodecState* pState);
+
+// Appends the encoding of one sample to pBuffer.  Returns the number of bytes written,
+// or zero if the sample doesn't fit in BufferSize bytes (in which case the state is
+// left untouched).
+uint16_t SampleCodecEncode(SampleCodecState* pState, const IMUSample* pSample, uint8_t* pBuffer, uint16_t BufferSize);
+
+// Decodes one sample from pBuffer.  Returns the number of bytes consumed, or zero if
+// the buffer doesn't hold a complete sample.
+uint16_t SampleCodecDecode(SampleCodecState* pState, const uint8_t* pBuffer, uint16_t BufferSize, IMUSample* pSample);
@@ -0,0 +1,159 @@
+#include "StreamEncoder.h"
+#include "SampleCodec.h"
+#include "TimeStamp.h"
+#include "app_util.h"
+#include "nrf.h"
+
+#include <string.h>
+
+#define STREAM_QUEUE_SIZE       64   // Must be a power of two
+#define STREAM_MAX_PACKET_COUNT 255  // The sample count is one byte
+
+// Samples waiting to be packed.  The IMU interrupt only moves the head and the flush
+// only moves the tail, so neither needs to lock out the other.
+static IMUSample gQueue[STREAM_QUEUE_SIZE];
+static volatile uint32_t gQueueHead = 0;
+static volatile uint32_t gQueueTail = 0;
+
+// A packet that has been built but not yet accepted by the transport
+static uint8_t  gPacket[TRANSPORT_MAX_PACKET_SIZE];
+static uint16_t gPacketLength = 0;
+static uint8_t  gPacketSamples = 0;
+static uint32_t gPacketSampleTimes[STREAM_MAX_PACKET_COUNT];
+
+static const uint32_t gAgeBucketLimitsMS[STREAM_AGE_BUCKET_COUNT - 1] = STREAM_AGE_BUCKET_LIMITS_MS;
+static uint32_t gAgeBucketLimits[STREAM_AGE_BUCKET_COUNT - 1];  // In time stamp ticks
+
+static uint16_t gSequence = 0;
+static SampleCodecState gCodecState;
+static StreamEncoderStats gStats;
+
+void InitStreamEncoder()
+{
+    gQueueHead = 0;
+    gQueueTail = 0;
+    gPacketLength = 0;
+    gPacketSamples = 0;
+    gSequence = 0;
+    memset(&gStats, 0, sizeof(gStats));
+
+    for(int i = 0; i < STREAM_AGE_BUCKET_COUNT - 1; ++i)
+    {
+        gAgeBucketLimits[i] = TIMESTAMP_MS_TO_TICKS(gAgeBucketLimitsMS[i]);
+    }
+}
+
+void StreamEncoderPushSample(const IMUSample* pSample)
+{
+    uint32_t head = gQueueHead;
+    if(head - gQueueTail >= STREAM_QUEUE_SIZE)
+    {
+        ++gStats.SamplesDropped;
+        return;
+    }
+
+    gQueue[head & (STREAM_QUEUE_SIZE - 1)] = *pSample;
+    __DMB();
+    gQueueHead = head + 1;
+}
+
+// Packs queued samples into gPacket, up to MaxSize bytes
+static void BuildPacket(uint16_t MaxSize)
+{
+    uint16_t length = STREAM_PACKET_HEADER_SIZE;
+    uint8_t count = 0;
+
+    SampleCodecReset(&gCodecState);
+
+    while(gQueueTail != gQueueHead && count < STREAM_MAX_PACKET_COUNT)
+    {
+        const IMUSample* pSample = &gQueue[gQueueTail & (STREAM_QUEUE_SIZE - 1)];
+        uint16_t sampleLength = SampleCodecEncode(&gCodecState, pSample, &gPacket[length], MaxSize - length);
+        if(sampleLength == 0)
+        {
+            if(count == 0)
+            {
+                // Not even one sample fits at this packet size, don't let it block the queue
+                ++gStats.SamplesDropped;
+                ++gQueueTail;
+                continue;
+            }
+            break;
+        }
+
+        gPacketSampleTimes[count] = pSample->GyroTime;  // The gyro read is what triggers the sample
+        length += sampleLength;
+        ++count;
+        ++gQueueTail;
+    }
+
+    gPacket[0] = TRANSPORT_PACKET_SAMPLES;
+    gPacket[1] = count;
+    uint16_encode(gSequence, &gPacket[2]);
+
+    gPacketSamples = count;
+    gPacketLength = count > 0 ? length : 0;
+}
+
+static void RecordSampleAges()
+{
+    uint32_t now = TimeStampNow();
+
+    for(int i = 0; i < gPacketSamples; ++i)
+    {
+        uint32_t age = now - gPacketSampleTimes[i];
+        int bucket = 0;
+        while(bucket < STREAM_AGE_BUCKET_COUNT - 1 && age > gAgeBucketLimits[bucket])
+        {
+            ++bucket;
+        }
+        ++gStats.AgeHistogram[bucket];
+    }
+}
+
+void StreamEncoderFlush(const Transport* pTransport)
+{
+    while(true)
+    {
+        if(gPacketLength == 0)
+        {
+            uint16_t maxSize = pTransport->MaxPacketSize();
+            if(gQueueTail == gQueueHead || maxSize <= STREAM_PACKET_HEADER_SIZE)
+            {
+                return;
+            }
+
+            BuildPacket(maxSize);
+            if(gPacketLength == 0)
+            {
+                return;
+            }
+        }
+
+        ret_code_t errCode = pTransport->Send(TRANSPORT_CHANNEL_STREAM, gPacket, gPacketLength);
+        if(errCode == NRF_ERROR_RESOURCES)
+        {
+            return;  // Try this packet again on the next flush
+        }
+
+        if(errCode == NRF_SUCCESS)
+        {
+            ++gStats.PacketsSent;
+            gStats.SamplesSent += gPacketSamples;
+            RecordSampleAges();
+        }
+        else
+        {
+            gStats.SamplesDropped += gPacketSamples;
+        }
+
+        // Move on even if the packet was lost, so the central sees the gap
+        ++gSequence;
+        gPacketLength = 0;
+    }
+}
+
+void StreamEncoderGetStats(StreamEncoderStats* pStats)
+{
+    *pStats = gStats;
+}
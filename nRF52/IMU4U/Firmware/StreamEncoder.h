@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include "IMU.h"
+#include "Transport.h"
+
+// Packs live IMU samples into stream packets and hands them to a transport.  Each
+// packet holds as many samples as the transport's current packet size allows:
+//   Byte 0:    TRANSPORT_PACKET_SAMPLES
+//   Byte 1:    Number of samples in the packet
+//   Byte 2-3:  Little endian packet sequence number, so the central can spot lost packets
+//   Byte 4-n:  The samples, compressed with SampleCodec (reset for every packet)
+
+#define STREAM_PACKET_HEADER_SIZE  4
+
+// How old samples are when their packet is handed to the transport, counted in buckets
+// with these upper bounds in milliseconds.  The last bucket holds everything older.
+#define STREAM_AGE_BUCKET_LIMITS_MS  { 5, 10, 20, 50, 100, 200, 500 }
+#define STREAM_AGE_BUCKET_COUNT      8
+
+typedef struct StreamEncoderStats
+{
+    uint32_t PacketsSent;
+    uint32_t SamplesSent;
+    uint32_t SamplesDropped;  // Samples the queue had no room for, or the transport refused
+    uint32_t AgeHistogram[STREAM_AGE_BUCKET_COUNT];
+} StreamEncoderStats;
+
+void InitStreamEncoder();
+
+// Queues a sample for the next packet.  May run concurrently with StreamEncoderFlush(),
+// but only from one context at a time.
+void StreamEncoderPushSample(const IMUSample* pSample);
+
+// Sends the queued samples, packing them into as few packets as possible.  Stops when
+// the queue is empty or the transport can't take any more.  Called just before each
+// connection event so packets carry the freshest samples available.
+void StreamEncoderFlush(const Transport* pTransport);
+
+void StreamEncoderGetStats(StreamEncoderStats* pStats);
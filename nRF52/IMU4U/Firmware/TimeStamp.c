@@ -0,0 +1,58 @@
+#include "TimeStamp.h"
+#include "app_util_platform.h"
+#include "nrf.h"
+#include "nrf_rtc.h"
+
+// RTC0 belongs to the SoftDevice and RTC1 to app_timer, so time stamps get RTC2 to
+// themselves.  This keeps the time base independent of whatever drives app_timer.
+#define TIMESTAMP_RTC               NRF_RTC2
+#define TIMESTAMP_RTC_IRQn          RTC2_IRQn
+#define TIMESTAMP_RTC_BITS          24
+#define TIMESTAMP_RTC_HALF_RANGE    (1UL << (TIMESTAMP_RTC_BITS - 1))
+
+static volatile uint32_t gOverflowCount = 0;
+
+void RTC2_IRQHandler(void)
+{
+    if(nrf_rtc_event_pending(TIMESTAMP_RTC, NRF_RTC_EVENT_OVERFLOW))
+    {
+        nrf_rtc_event_clear(TIMESTAMP_RTC, NRF_RTC_EVENT_OVERFLOW);
+        ++gOverflowCount;
+    }
+}
+
+void InitTimeStamp()
+{
+    nrf_rtc_task_trigger(TIMESTAMP_RTC, NRF_RTC_TASK_STOP);
+    nrf_rtc_task_trigger(TIMESTAMP_RTC, NRF_RTC_TASK_CLEAR);
+    nrf_rtc_prescaler_set(TIMESTAMP_RTC, 0);  // No prescaling, tick at 32768 Hz
+    nrf_rtc_event_clear(TIMESTAMP_RTC, NRF_RTC_EVENT_OVERFLOW);
+    nrf_rtc_int_enable(TIMESTAMP_RTC, NRF_RTC_INT_OVERFLOW_MASK);
+
+    NVIC_SetPriority(TIMESTAMP_RTC_IRQn, APP_IRQ_PRIORITY_HIGH);
+    NVIC_ClearPendingIRQ(TIMESTAMP_RTC_IRQn);
+    NVIC_EnableIRQ(TIMESTAMP_RTC_IRQn);
+
+    nrf_rtc_task_trigger(TIMESTAMP_RTC, NRF_RTC_TASK_START);
+}
+
+uint32_t TimeStampNow()
+{
+    uint32_t counter;
+    uint32_t overflowCount;
+
+    CRITICAL_REGION_ENTER();
+    counter = nrf_rtc_counter_get(TIMESTAMP_RTC);
+    overflowCount = gOverflowCount;
+
+    // If we're called from an interrupt at the same or higher priority than the RTC's, the
+    // overflow may have happened without being counted yet.  A small counter value with the
+    // event still pending means the counter has already wrapped.
+    if(nrf_rtc_event_pending(TIMESTAMP_RTC, NRF_RTC_EVENT_OVERFLOW) && counter < TIMESTAMP_RTC_HALF_RANGE)
+    {
+        ++overflowCount;
+    }
+    CRITICAL_REGION_EXIT();
+
+    return (overflowCount << TIMESTAMP_RTC_BITS) | counter;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+// Time stamps are in ticks of the 32.768 kHz low frequency clock
+#define TIMESTAMP_TICKS_PER_SECOND  32768
+
+// Converts milliseconds to time stamp ticks
+#define TIMESTAMP_MS_TO_TICKS(MS)   ((uint32_t)(((uint64_t)(MS) * TIMESTAMP_TICKS_PER_SECOND) / 1000))
+
+// Starts the free running RTC used for time stamping.  The low frequency clock must
+// already be running (the SoftDevice starts it when it's enabled).
+void InitTimeStamp();
+
+// Returns the current time in ticks.  The RTC counter is only 24 bits, so it's extended
+// to 32 bits using its overflow interrupt.  Wraps around roughly every 36 hours.  Safe
+// to call from any interrupt priority.
+uint32_t TimeStampNow();
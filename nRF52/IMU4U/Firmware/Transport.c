@@ -0,0 +1,14 @@
+#include "Transport.h"
+#include "GATTTransport.h"
+#include "L2CAPTransport.h"
+
+const Transport* TransportActive()
+{
+    const Transport* pL2CAP = L2CAPTransport();
+    if(pL2CAP->Ready())
+    {
+        return pL2CAP;
+    }
+
+    return GATTTransport();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdk_errors.h"
+
+// A way of getting packets to the central.  Code producing packets (the stream encoder
+// and the recorder's download) only deals with this interface, so it doesn't care
+// whether data goes out as GATT notifications or over an L2CAP channel.
+//
+// Every packet starts with one of the TRANSPORT_PACKET_* type bytes so packets can
+// share a single L2CAP channel.
+
+#define TRANSPORT_PACKET_SAMPLES  0x01  // Compressed IMU samples (see StreamEncoder.h)
+#define TRANSPORT_PACKET_RECORD   0x02  // A chunk of a recording download (see Recorder.h)
+#define TRANSPORT_PACKET_SYNC     0x03  // Reply to a clock sync request (see CONTROL_OP_SYNC in main.c)
+
+// Largest packet any transport will be asked to send
+#define TRANSPORT_MAX_PACKET_SIZE 1024
+
+// Packets are tagged with the logical channel they belong to.  The GATT transport
+// sends each channel on its own characteristic; the L2CAP transport sends everything
+// on one channel and relies on the packet type byte.
+enum TRANSPORT_CHANNEL
+{
+    TRANSPORT_CHANNEL_STREAM,
+    TRANSPORT_CHANNEL_RECORD,
+    TRANSPORT_CHANNEL_COUNT
+};
+
+typedef struct Transport
+{
+    const char* Name;
+
+    // Whether the transport is connected and able to take packets
+    bool (*Ready)(void);
+
+    // The largest packet Send() will currently accept, zero when not ready
+    uint16_t (*MaxPacketSize)(void);
+
+    // Queues a packet for sending.  The data is copied, so the buffer can be reused as
+    // soon as this returns.  Returns NRF_SUCCESS, or NRF_ERROR_RESOURCES if the packet
+    // can't be queued right now and should be offered again later.  Other errors mean
+    // the packet can't be sent at all.
+    ret_code_t (*Send)(enum TRANSPORT_CHANNEL Channel, const uint8_t* pData, uint16_t Length);
+} Transport;
+
+// Returns the transport data should currently go out on: L2CAP when the central has a
+// channel open, otherwise GATT notifications.
+const Transport* TransportActive();
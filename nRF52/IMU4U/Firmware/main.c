@@ -8,6 +8,7 @@
 #include "ble_hci.h"
 #include "ble_srv_common.h"
 #include "ble_advdata.h"
+#include "ble_radio_notification.h"
 #include "ble_conn_params.h"
 #include "boards.h"
 #include "nordic_common.h"
@@ -21,9 +22,20 @@
 #include "nrf_log_default_backends.h"
 #include "nrf_pwr_mgmt.h"
 #include "nrf_sdh_ble.h"
+#include "nrf_sdh_freertos.h"
 #include "sdk_common.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
+#include "AppTasks.h"
+
+#include "GATTTransport.h"
 #include "IMU.h"
+#include "L2CAPTransport.h"
+#include "Recorder.h"
+#include "StreamEncoder.h"
+#include "TimeStamp.h"
+#include "Transport.h"
 
 #define CONNECTED_LED                   BSP_BOARD_LED_0                         // Is on when device has connected.
 #define LEDBUTTON_LED                   BSP_BOARD_LED_1                         // LED to be toggled with the help of the LED Button Service.
@@ -50,6 +62,10 @@
 
 #define DEAD_BEEF                       0xDEADBEEF                              // Value used as error code on stack dump, can be used to identify stack location on stack unwind.
 
+#define HVN_TX_QUEUE_SIZE               8                                       // Notifications the SoftDevice can queue per connection, so bulk transfers fill each connection event
+
+#define RADIO_NOTIFICATION_DISTANCE     NRF_RADIO_NOTIFICATION_DISTANCE_800US    // How long before each radio event stream packets are assembled
+
 #define SEND_IMU_DATA_FREQUENCY        5                                        // The timer checking for display update occurs every 100 milliseconds
 #define SEND_IMU_DATA_TIME_MS          1000/SEND_IMU_DATA_FREQUENCY             // The timer checking for display update occurs every 100 milliseconds
 
@@ -80,9 +96,45 @@ static ble_gap_adv_data_t gAdvData =
 #define IMU4U_UUID_BUTTON_CHAR 0x1524
 #define IMU4U_UUID_LED_CHAR    0x1525
 #define IMU4U_UUID_IMU_CHAR    0x1526
-
-// Contains the most current IMU data
-static IMUData gCurrIMUData;
+#define IMU4U_UUID_CONTROL_CHAR 0x1527
+#define IMU4U_UUID_RECORD_CHAR 0x1528
+#define IMU4U_UUID_STATS_CHAR  0x1529
+
+// Opcodes written to the control characteristic (first byte of the write)
+#define CONTROL_OP_RECORD_START    0x01  // Start recording samples to flash
+#define CONTROL_OP_RECORD_STOP     0x02  // Stop recording
+#define CONTROL_OP_RECORD_ERASE    0x03  // Erase the recording
+#define CONTROL_OP_DOWNLOAD_START  0x04  // Download the recording, followed by the 32 bit stream offset to start from
+#define CONTROL_OP_DOWNLOAD_STOP   0x05  // Abort a download
+#define CONTROL_OP_L2CAP_OPEN      0x06  // Open an L2CAP channel for streaming, followed by the 16 bit PSM the central listens on
+#define CONTROL_OP_L2CAP_CLOSE     0x07  // Close the L2CAP channel, streaming goes back to notifications
+#define CONTROL_OP_SYNC            0x08  // Clock sync request, followed by an 8 bit token (see SYNC_PACKET_SIZE)
+
+// The reply to CONTROL_OP_SYNC, sent on the stream channel so it takes the same path as
+// the samples whose time stamps it relates to the central's clock:
+//   Byte 0:    TRANSPORT_PACKET_SYNC
+//   Byte 1:    The request's token
+//   Bytes 2-5: Time stamp (see TimeStamp.h) of when the request arrived
+#define SYNC_PACKET_SIZE           6
+
+// Reading the control characteristic returns the recorder status:
+//   Byte 0:     Flags (bit 0 recording, bit 1 downloading)
+//   Bytes 1-4:  Bytes of recording in flash
+//   Bytes 5-8:  Bytes the flash can hold
+//   Bytes 9-12: Samples dropped while recording
+#define CONTROL_STATUS_SIZE        13
+
+// Reading the stats characteristic returns:
+//   Byte 0:      Current IMU power state (see IMU_POWER_STATE)
+//   Bytes 1-12:  Milliseconds spent in the off, standby and active power states
+//   Bytes 13-16: Samples streamed
+//   Bytes 17-20: Samples dropped from the stream
+//   Bytes 21-52: Sample age histogram, one 32 bit count per bucket (see STREAM_AGE_BUCKET_LIMITS_MS)
+//   Bytes 53-56: CPU percentage used by the acquisition, streaming, processing and idle tasks
+//   Byte 57:     Most samples the sample queue has held
+#define STATS_SIZE                 (21 + 4 * STREAM_AGE_BUCKET_COUNT + APP_TASK_COUNT + 1)
+
+static bool gIMUSubscribed = false;                                             // Whether the central has notifications of the IMU characteristic enabled.
 
 // Various forward declarations
 void InitLog();
@@ -90,26 +142,31 @@ void InitLED();
 void InitTimers();
 void InitButtons();
 void InitPowerMgmt();
-void IdleStateHandler();
 void InitBLEStack();
 void InitConnectionParams();
 void InitGATT();
 void InitGAPParams();
 void InitServices();
 void InitAdvertising();
+void InitRadioNotification();
 void TimerHandler(void* pContext);
-void SendIMUState();
 void CheckButtonState();
-void StartAdvertising();
+void StartAdvertising(void* pContext);
 void StartIMUTimer();
-void IMUCallback(const IMUData* pIMUData);
+void UpdateControlStatus();
+void UpdateStats();
+void UpdateIMUPowerState();
 
 
 typedef struct IMU4UServiceStruct IMU4UServiceStruct;
 typedef void (*IMU4UWriteHandler) (uint16_t connHandle, IMU4UServiceStruct* pIMU4U, uint8_t newState);
+typedef void (*IMU4UControlHandler) (uint16_t connHandle, IMU4UServiceStruct* pIMU4U, const uint8_t* pData, uint16_t length);
+typedef void (*IMU4USubscriptionHandler) (uint16_t connHandle, IMU4UServiceStruct* pIMU4U, bool subscribed);
 typedef struct IMU4UInitStruct
 {
-    IMU4UWriteHandler LEDWriteHandler; // Event handler to be called when the LED Characteristic is written.
+    IMU4UWriteHandler        LEDWriteHandler;        // Event handler to be called when the LED Characteristic is written.
+    IMU4UControlHandler      ControlWriteHandler;    // Event handler to be called when the Control Characteristic is written.
+    IMU4USubscriptionHandler IMUSubscriptionHandler; // Event handler to be called when notifications of the IMU Characteristic are enabled or disabled.
 } IMU4UInitStruct;
 
 struct IMU4UServiceStruct  // Service structure. This structure contains various status information for the service.
@@ -118,33 +175,45 @@ struct IMU4UServiceStruct  // Service structure. This structure contains various
     ble_gatts_char_handles_t  LEDCharHandle;    // Handles related to the LED Characteristic.
     ble_gatts_char_handles_t  ButtonCharHandle; // Handles related to the Button Characteristic.
     ble_gatts_char_handles_t  IMUCharHandle;    // Handles related to the IMU Characteristic.
+    ble_gatts_char_handles_t  ControlCharHandle; // Handles related to the Control Characteristic.
+    ble_gatts_char_handles_t  RecordCharHandle; // Handles related to the Record Data Characteristic.
+    ble_gatts_char_handles_t  StatsCharHandle;  // Handles related to the Stats Characteristic.
     uint8_t                   UUIDType;         // UUID type for the LED Button Service.
     IMU4UWriteHandler         LEDWriteHandler;  // Event handler to be called when the LED Characteristic is written.
+    IMU4UControlHandler       ControlWriteHandler; // Event handler to be called when the Control Characteristic is written.
+    IMU4USubscriptionHandler  IMUSubscriptionHandler; // Event handler to be called when the IMU Characteristic's CCCD is written.
 };
 
 int main(void)
 {
     InitLog();
     InitLED();
-    InitIMU(IMUCallback);
+    InitIMU(AppTasksPushSample, AppTasksDataReady);
     InitTimers();
     InitButtons();
     InitPowerMgmt();
     InitBLEStack();
+    InitTimeStamp();
+    APP_ERROR_CHECK(InitRecorder());
+    InitStreamEncoder();
     InitGAPParams();
     InitGATT();
     InitServices();
     InitAdvertising();
     InitConnectionParams();
-    
-    StartAdvertising();
+    InitRadioNotification();
+    InitAppTasks();
+
+    // SoftDevice events are handled in their own task, which starts advertising once
+    // the scheduler is running
+    nrf_sdh_freertos_init(StartAdvertising, NULL);
     StartIMU();
     StartIMUTimer();
 
-    while(1)
-    {
-        IdleStateHandler();
-    }
+    vTaskStartScheduler();
+
+    // Only get here if there wasn't enough memory to start the scheduler
+    APP_ERROR_HANDLER(NRF_ERROR_NO_MEM);
 }
 
 void BLEEventHandler(ble_evt_t const* pEvent, void* pContext)
@@ -163,6 +232,18 @@ void BLEEventHandler(ble_evt_t const* pEvent, void* pContext)
                 {
                     pIMU->LEDWriteHandler(pEvent->evt.gap_evt.conn_handle, pIMU, pWriteEvent->data[0]);
                 }
+                else if((pWriteEvent->handle == pIMU->ControlCharHandle.value_handle) &&
+                        (pWriteEvent->len >= 1) &&
+                        (pIMU->ControlWriteHandler != NULL))
+                {
+                    pIMU->ControlWriteHandler(pEvent->evt.gap_evt.conn_handle, pIMU, pWriteEvent->data, pWriteEvent->len);
+                }
+                else if((pWriteEvent->handle == pIMU->IMUCharHandle.cccd_handle) &&
+                        (pWriteEvent->len == 2) &&
+                        (pIMU->IMUSubscriptionHandler != NULL))
+                {
+                    pIMU->IMUSubscriptionHandler(pEvent->evt.gap_evt.conn_handle, pIMU, ble_srv_is_notification_enabled(pWriteEvent->data));
+                }
             }
             break;
         default:
@@ -182,6 +263,8 @@ void InitIMUService(IMU4UServiceStruct* pService, const IMU4UInitStruct* pInit)
     ret_code_t errCode;    
 
     pService->LEDWriteHandler = pInit->LEDWriteHandler;
+    pService->ControlWriteHandler = pInit->ControlWriteHandler;
+    pService->IMUSubscriptionHandler = pInit->IMUSubscriptionHandler;
 
     // Add service.
     ble_uuid128_t baseUUID = {IMU4U_UUID_BASE};
@@ -224,19 +307,58 @@ void InitIMUService(IMU4UServiceStruct* pService, const IMU4UInitStruct* pInit)
     errCode = characteristic_add(pService->ServiceHandle, &newChar, &pService->LEDCharHandle);
     VERIFY_SUCCESS(errCode);
      
-    // Add IMU characteristic.
+    // Add IMU characteristic.  Stream packets (see StreamEncoder.h) are notified on this.
     memset(&newChar, 0, sizeof(newChar));
     newChar.uuid              = IMU4U_UUID_IMU_CHAR;
     newChar.uuid_type         = pService->UUIDType;
-    newChar.init_len          = sizeof(IMUData);
-    newChar.max_len           = sizeof(IMUData);
-    newChar.char_props.read   = 1;
+    newChar.init_len          = 0;
+    newChar.max_len           = NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3;
+    newChar.is_var_len        = true;
     newChar.char_props.notify = 1;
-    newChar.read_access       = SEC_OPEN;
     newChar.cccd_write_access = SEC_OPEN;
 
     errCode = characteristic_add(pService->ServiceHandle, &newChar, &pService->IMUCharHandle);
     VERIFY_SUCCESS(errCode);
+
+    // Add Control characteristic.
+    memset(&newChar, 0, sizeof(newChar));
+    newChar.uuid             = IMU4U_UUID_CONTROL_CHAR;
+    newChar.uuid_type        = pService->UUIDType;
+    newChar.init_len         = CONTROL_STATUS_SIZE;
+    newChar.max_len          = CONTROL_STATUS_SIZE;
+    newChar.is_var_len       = true;
+    newChar.char_props.read  = 1;
+    newChar.char_props.write = 1;
+    newChar.read_access      = SEC_OPEN;
+    newChar.write_access     = SEC_OPEN;
+
+    errCode = characteristic_add(pService->ServiceHandle, &newChar, &pService->ControlCharHandle);
+    VERIFY_SUCCESS(errCode);
+
+    // Add Record Data characteristic.  Downloads of the recording are notified on this.
+    memset(&newChar, 0, sizeof(newChar));
+    newChar.uuid              = IMU4U_UUID_RECORD_CHAR;
+    newChar.uuid_type         = pService->UUIDType;
+    newChar.init_len          = 0;
+    newChar.max_len           = NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 3;
+    newChar.is_var_len        = true;
+    newChar.char_props.notify = 1;
+    newChar.cccd_write_access = SEC_OPEN;
+
+    errCode = characteristic_add(pService->ServiceHandle, &newChar, &pService->RecordCharHandle);
+    VERIFY_SUCCESS(errCode);
+
+    // Add Stats characteristic.
+    memset(&newChar, 0, sizeof(newChar));
+    newChar.uuid             = IMU4U_UUID_STATS_CHAR;
+    newChar.uuid_type        = pService->UUIDType;
+    newChar.init_len         = STATS_SIZE;
+    newChar.max_len          = STATS_SIZE;
+    newChar.char_props.read  = 1;
+    newChar.read_access      = SEC_OPEN;
+
+    errCode = characteristic_add(pService->ServiceHandle, &newChar, &pService->StatsCharHandle);
+    VERIFY_SUCCESS(errCode);
 }
 
 void InitLED()
@@ -290,9 +412,17 @@ BLE_IMU4U_SERVICE(gIMU4UService);  // IMU4U Service instance
 NRF_BLE_GATT_DEF(gGATT);           // GATT module instance
 NRF_BLE_QWR_DEF(gQWR);             // Context for the Queued Write module
 
+static void GATTEventHandler(nrf_ble_gatt_t* pGATT, nrf_ble_gatt_evt_t const* pEvent)
+{
+    if(pEvent->evt_id == NRF_BLE_GATT_EVT_ATT_MTU_UPDATED)
+    {
+        NRF_LOG_INFO("ATT MTU is %d", pEvent->params.att_mtu_effective);
+    }
+}
+
 void InitGATT()
 {
-    ret_code_t errCode = nrf_ble_gatt_init(&gGATT, NULL);
+    ret_code_t errCode = nrf_ble_gatt_init(&gGATT, GATTEventHandler);
     APP_ERROR_CHECK(errCode);
 }
 
@@ -356,6 +486,80 @@ static void LEDWriteHandler(uint16_t connHandle, IMU4UServiceStruct* pService, u
     }
 }
 
+// If the reply can't be queued the central just asks again later
+static void SendSyncReply(uint8_t token, uint32_t receivedAt)
+{
+    uint8_t packet[SYNC_PACKET_SIZE];
+
+    packet[0] = TRANSPORT_PACKET_SYNC;
+    packet[1] = token;
+    uint32_encode(receivedAt, &packet[2]);
+    TransportActive()->Send(TRANSPORT_CHANNEL_STREAM, packet, sizeof(packet));
+}
+
+static void ControlWriteHandler(uint16_t connHandle, IMU4UServiceStruct* pService, const uint8_t* pData, uint16_t length)
+{
+    // Taken first so sync requests are time stamped as close to their arrival as we can
+    uint32_t receivedAt = TimeStampNow();
+
+    switch(pData[0])
+    {
+        case CONTROL_OP_RECORD_START:
+            NRF_LOG_INFO("Record start received");
+            RecorderStart();
+            UpdateIMUPowerState();
+            break;
+        case CONTROL_OP_RECORD_STOP:
+            NRF_LOG_INFO("Record stop received");
+            RecorderStop();
+            UpdateIMUPowerState();
+            break;
+        case CONTROL_OP_RECORD_ERASE:
+            NRF_LOG_INFO("Record erase received");
+            RecorderErase();
+            break;
+        case CONTROL_OP_DOWNLOAD_START:
+            if(length >= 5)
+            {
+                uint32_t offset = uint32_decode(&pData[1]);
+                NRF_LOG_INFO("Download from %d received", offset);
+                RecorderStartDownload(offset);
+            }
+            break;
+        case CONTROL_OP_DOWNLOAD_STOP:
+            NRF_LOG_INFO("Download stop received");
+            RecorderStopDownload();
+            break;
+        case CONTROL_OP_L2CAP_OPEN:
+            if(length >= 3)
+            {
+                uint16_t psm = uint16_decode(&pData[1]);
+                NRF_LOG_INFO("L2CAP open to PSM 0x%x received", psm);
+                L2CAPTransportOpen(psm);
+            }
+            break;
+        case CONTROL_OP_L2CAP_CLOSE:
+            NRF_LOG_INFO("L2CAP close received");
+            L2CAPTransportClose();
+            break;
+        case CONTROL_OP_SYNC:
+            if(length >= 2)
+            {
+                SendSyncReply(pData[1], receivedAt);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void IMUSubscriptionHandler(uint16_t connHandle, IMU4UServiceStruct* pService, bool subscribed)
+{
+    NRF_LOG_INFO("IMU notifications %s", subscribed ? "enabled" : "disabled");
+    gIMUSubscribed = subscribed;
+    UpdateIMUPowerState();
+}
+
 void InitServices()
 {
     ret_code_t         errCode;
@@ -370,7 +574,12 @@ void InitServices()
 
     // Initialize the service
     ConnErrorHandler.LEDWriteHandler = LEDWriteHandler;
+    ConnErrorHandler.ControlWriteHandler = ControlWriteHandler;
+    ConnErrorHandler.IMUSubscriptionHandler = IMUSubscriptionHandler;
     InitIMUService(&gIMU4UService, &ConnErrorHandler);    
+
+    // Stream and recording packets go out as notifications on these when there's no L2CAP channel
+    InitGATTTransport(&gGATT, gIMU4UService.IMUCharHandle.value_handle, gIMU4UService.RecordCharHandle.value_handle);
 }
 
 static void ConnEventHandler(ble_conn_params_evt_t* pEvent)
@@ -410,7 +619,7 @@ void InitConnectionParams()
 }
 
 
-void StartAdvertising()
+void StartAdvertising(void* pContext)
 {
     ret_code_t errCode;
 
@@ -432,15 +641,19 @@ static void ble_evt_handler(ble_evt_t const* pEvent, void* pContect)
             APP_ERROR_CHECK(errCode);
             errCode = app_button_enable();
             APP_ERROR_CHECK(errCode);
+            UpdateIMUPowerState();
             break;
 
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected");
             bsp_board_led_off(CONNECTED_LED);
             gConnHandle = BLE_CONN_HANDLE_INVALID;
+            gIMUSubscribed = false;
+            RecorderStopDownload();
+            UpdateIMUPowerState();
             errCode = app_button_disable();
             APP_ERROR_CHECK(errCode);
-            StartAdvertising();
+            StartAdvertising(NULL);
             break;
         default:            
             break;
@@ -460,14 +673,49 @@ void InitBLEStack()
     errCode = nrf_sdh_ble_default_cfg_set(APP_BLE_CONN_CFG_TAG, &ramStart);
     APP_ERROR_CHECK(errCode);
 
+    // Let more than one notification be queued at a time
+    ble_cfg_t bleCfg;
+    memset(&bleCfg, 0, sizeof(bleCfg));
+    bleCfg.conn_cfg.conn_cfg_tag = APP_BLE_CONN_CFG_TAG;
+    bleCfg.conn_cfg.params.gatts_conn_cfg.hvn_tx_queue_size = HVN_TX_QUEUE_SIZE;
+    errCode = sd_ble_cfg_set(BLE_CONN_CFG_GATTS, &bleCfg, ramStart);
+    APP_ERROR_CHECK(errCode);
+
+    // Allow one L2CAP channel for streaming
+    errCode = L2CAPTransportConfigure(APP_BLE_CONN_CFG_TAG, ramStart);
+    APP_ERROR_CHECK(errCode);
+
     // Enable BLE stack.
     errCode = nrf_sdh_ble_enable(&ramStart);
     APP_ERROR_CHECK(errCode);
 
+    // Let connection events run past their configured length while there's data to send
+    ble_opt_t bleOpt;
+    memset(&bleOpt, 0, sizeof(bleOpt));
+    bleOpt.common_opt.conn_evt_ext.enable = 1;
+    errCode = sd_ble_opt_set(BLE_COMMON_OPT_CONN_EVT_EXT, &bleOpt);
+    APP_ERROR_CHECK(errCode);
+
     // Register a handler for BLE events.
     NRF_SDH_BLE_OBSERVER(m_ble_observer, APP_BLE_OBSERVER_PRIO, ble_evt_handler, NULL);
 }
 
+static void RadioNotificationHandler(bool radioActive)
+{
+    // Build packets right before the radio event that will send them, rather than on a
+    // timer, so samples don't sit in a queue waiting for the connection event
+    if(radioActive)
+    {
+        AppTasksRadioEventFromISR();
+    }
+}
+
+void InitRadioNotification()
+{
+    ret_code_t errCode = ble_radio_notification_init(APP_IRQ_PRIORITY_LOW, RADIO_NOTIFICATION_DISTANCE, RadioNotificationHandler);
+    APP_ERROR_CHECK(errCode);
+}
+
 void InitButtons()
 {
     ret_code_t errCode;
@@ -494,37 +742,97 @@ void InitPowerMgmt()
     APP_ERROR_CHECK(errCode);
 }
 
-void IdleStateHandler()
+void TimerHandler(void* pContext)
+{   
+    UpdateIMUPowerState();
+    CheckButtonState();
+    UpdateControlStatus();
+    UpdateStats();
+}
+
+// Samples only while something wants them: a subscriber to the IMU characteristic, an
+// open L2CAP channel or a recording.  While connected the sensors are kept in standby
+// so a subscription gets data quickly.
+void UpdateIMUPowerState()
 {
-    if (NRF_LOG_PROCESS() == false)
+    RecorderStatus status;
+    enum IMU_POWER_STATE state;
+
+    RecorderGetStatus(&status);
+    if(status.Recording || gIMUSubscribed || L2CAPTransport()->Ready())
+    {
+        state = IMU_POWER_ACTIVE;
+    }
+    else if(gConnHandle != BLE_CONN_HANDLE_INVALID)
     {
-        nrf_pwr_mgmt_run();
+        state = IMU_POWER_STANDBY;
+    }
+    else
+    {
+        state = IMU_POWER_OFF;
+    }
+
+    if(state != IMUGetPowerState())
+    {
+        // The sensors are only touched from the acquisition task
+        AppTasksSetIMUPowerState(state);
     }
 }
 
-void IMUCallback(const IMUData* pIMUData)
+void UpdateStats()
 {
-    gCurrIMUData = *pIMUData;
-}
+    uint64_t residency[IMU_POWER_STATE_COUNT];
+    StreamEncoderStats streamStats;
+    AppTaskStats taskStats;
+    uint8_t value[STATS_SIZE];
+    ble_gatts_value_t gattsValue;
+
+    IMUGetPowerResidency(residency);
+    value[0] = (uint8_t)IMUGetPowerState();
+    for(int i = 0; i < IMU_POWER_STATE_COUNT; ++i)
+    {
+        uint32_encode((uint32_t)((residency[i] * 1000) / TIMESTAMP_TICKS_PER_SECOND), &value[1 + 4 * i]);
+    }
 
-void TimerHandler(void* pContext)
-{   
-    SendIMUState();
-    CheckButtonState();
+    StreamEncoderGetStats(&streamStats);
+    uint32_encode(streamStats.SamplesSent, &value[13]);
+    uint32_encode(streamStats.SamplesDropped, &value[17]);
+    for(int i = 0; i < STREAM_AGE_BUCKET_COUNT; ++i)
+    {
+        uint32_encode(streamStats.AgeHistogram[i], &value[21 + 4 * i]);
+    }
+
+    AppTasksGetStats(&taskStats);
+    for(int i = 0; i < APP_TASK_COUNT; ++i)
+    {
+        value[53 + i] = taskStats.CPUPercent[i];
+    }
+    value[53 + APP_TASK_COUNT] = (uint8_t)taskStats.SampleQueueHighWater;
+
+    memset(&gattsValue, 0, sizeof(gattsValue));
+    gattsValue.len     = sizeof(value);
+    gattsValue.p_value = value;
+
+    sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, gIMU4UService.StatsCharHandle.value_handle, &gattsValue);
 }
 
-void SendIMUState()
+void UpdateControlStatus()
 {
-    ble_gatts_hvx_params_t params;
-    uint16_t length = sizeof(IMUData);
+    RecorderStatus status;
+    uint8_t value[CONTROL_STATUS_SIZE];
+    ble_gatts_value_t gattsValue;
+
+    RecorderGetStatus(&status);
+    value[0] = (status.Recording ? 0x01 : 0x00) | (status.Downloading ? 0x02 : 0x00);
+    uint32_encode(status.StreamSize, &value[1]);
+    uint32_encode(status.Capacity, &value[5]);
+    uint32_encode(status.DroppedSamples, &value[9]);
 
-    memset(&params, 0, sizeof(params));
-    params.type   = BLE_GATT_HVX_NOTIFICATION;
-    params.handle = gIMU4UService.IMUCharHandle.value_handle;
-    params.p_data = (uint8_t*)(&gCurrIMUData);
-    params.p_len  = &length;
+    memset(&gattsValue, 0, sizeof(gattsValue));
+    gattsValue.len     = sizeof(value);
+    gattsValue.p_value = value;
 
-    sd_ble_gatts_hvx(gConnHandle, &params); 
+    sd_ble_gatts_value_set(BLE_CONN_HANDLE_INVALID, gIMU4UService.ControlCharHandle.value_handle, &gattsValue);
 }
 
 void CheckButtonState()
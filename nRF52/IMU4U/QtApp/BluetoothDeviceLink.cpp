@@ -0,0 +1,261 @@
+#include "BluetoothDeviceLink.h"
+#include "BluetoothScanner.h"
+#include "IMU4UService.h"
+
+namespace
+{
+    constexpr int CACHED_CONNECT_TIMEOUT_MS = 3000;   // A device that's advertising is normally connected well within this
+    constexpr int CONNECT_TIMEOUT_MS = 10000;         // Any other attempt, which may include the device waking up
+}
+
+BluetoothDeviceLink::BluetoothDeviceLink(const QBluetoothDeviceInfo& Device, DeviceCache& Cache, QObject* pParent) :
+    QObject(pParent), m_device(Device), m_Cache(Cache)
+{
+    m_ConnectTimer.setSingleShot(true);
+    connect(&m_ConnectTimer, &QTimer::timeout, this, &BluetoothDeviceLink::ConnectFailed);
+}
+
+void BluetoothDeviceLink::SetCallbacks(const Callbacks& Callbacks)
+{
+    m_Callbacks = Callbacks;
+}
+
+// Also called to reconnect, keeping the controller but starting afresh with the service
+void BluetoothDeviceLink::Connect()
+{
+    m_bReady = false;
+    m_bFailed = false;
+    m_bGattFound = false;
+    m_Characteristics.clear();
+    if(m_service)
+    {
+        m_service->deleteLater();
+        m_service = nullptr;
+    }
+
+    if(!m_bEverConnected)
+    {
+        m_bCached = m_Cache.Find(BluetoothScanner::DeviceId(m_device), m_Cached);
+    }
+    m_ConnectTimer.start(m_bCached && !m_bEverConnected ? CACHED_CONNECT_TIMEOUT_MS : CONNECT_TIMEOUT_MS);
+
+    if(m_controller)
+    {
+        m_controller->connectToDevice();
+    }
+    else
+    {
+        CreateController();
+    }
+}
+
+void BluetoothDeviceLink::Subscribe(uint16_t Characteristic)
+{
+    auto it = m_Characteristics.find(Characteristic);
+    if(it != m_Characteristics.end())
+    {
+        auto NotificationDesc = it->descriptor(QBluetoothUuid::ClientCharacteristicConfiguration);
+        m_service->writeDescriptor(NotificationDesc, QByteArray::fromHex("0100"));
+    }
+}
+
+void BluetoothDeviceLink::Write(uint16_t Characteristic, const QByteArray& Value)
+{
+    auto it = m_Characteristics.find(Characteristic);
+    if(it != m_Characteristics.end())
+    {
+        m_service->writeCharacteristic(*it, Value);
+    }
+}
+
+void BluetoothDeviceLink::CreateController()
+{
+    // Make connections
+    //! [Connect-Signals-1]
+    m_controller = QLowEnergyController::createCentral(m_device, this);
+    //! [Connect-Signals-1]
+    m_controller->setRemoteAddressType(QLowEnergyController::PublicAddress);
+
+    //! [Connect-Signals-2]
+    connect(m_controller, &QLowEnergyController::serviceDiscovered, this, &BluetoothDeviceLink::ServiceDiscovered);
+    connect(m_controller, &QLowEnergyController::discoveryFinished, this, &BluetoothDeviceLink::ServiceScanDone);
+    connect(m_controller, &QLowEnergyController::connectionUpdated, this, &BluetoothDeviceLink::ConnectionUpdated);
+
+    connect(m_controller, static_cast<void (QLowEnergyController::*)(QLowEnergyController::Error)>(&QLowEnergyController::error),
+            this, [this](QLowEnergyController::Error)
+    {
+        if(!m_bReady)
+        {
+            ConnectFailed();
+        }
+    });
+
+    connect(m_controller, &QLowEnergyController::connected, this, [this]()
+    {
+        m_controller->discoverServices();
+    });
+
+    connect(m_controller, &QLowEnergyController::disconnected, this, [this]()
+    {
+        m_Characteristics.clear();
+        if(!m_bReady)
+        {
+            // Dropped while still setting up
+            ConnectFailed();
+            return;
+        }
+
+        m_bReady = false;
+        if(m_Callbacks.Disconnected)
+        {
+            m_Callbacks.Disconnected();
+        }
+    });
+
+    connect(m_controller, &QLowEnergyController::stateChanged, this, []()
+    {
+        // For debugging
+    });
+
+    // Connect
+    m_controller->connectToDevice();
+    //! [Connect-Signals-2]
+}
+
+void BluetoothDeviceLink::ServiceDiscovered(const QBluetoothUuid &gatt)
+{
+    if(gatt.data1 == NORDIC_BLINKY_SERVICE_UUID)
+    {
+        m_gatt = gatt;
+        m_bGattFound = true;
+
+        // The cache says this is the one, so there's no need to wait for the rest
+        if(m_bCached && gatt == m_Cached.Service)
+        {
+            CreateService();
+        }
+    }
+}
+
+void BluetoothDeviceLink::ServiceScanDone()
+{
+    if(m_bGattFound && !m_service)
+    {
+        CreateService();
+    }
+}
+
+void BluetoothDeviceLink::CreateService()
+{
+    m_service = m_controller->createServiceObject(m_gatt, this);
+    if(m_service)
+    {
+        connect(m_service, &QLowEnergyService::stateChanged, this, &BluetoothDeviceLink::ServiceStateChanged);
+        connect(m_service, &QLowEnergyService::characteristicChanged, this, &BluetoothDeviceLink::CharacteristicChanged);
+        connect(m_service, &QLowEnergyService::descriptorWritten, this, &BluetoothDeviceLink::ConfirmedDescriptorWrite);
+        m_service->discoverDetails();
+    }
+}
+
+// Only written when it's new or different, so the settings aren't rewritten every connection
+void BluetoothDeviceLink::StoreLayout()
+{
+    DeviceCache::Entry entry;
+    entry.Id = BluetoothScanner::DeviceId(m_device);
+    entry.Name = m_device.name();
+    entry.Service = m_gatt;
+    for(auto it = m_Characteristics.begin(); it != m_Characteristics.end(); ++it)
+    {
+        entry.Handles.insert(it.key(), static_cast<uint16_t>(it->handle()));
+    }
+
+    if(!m_bCached || entry.Service != m_Cached.Service || entry.Handles != m_Cached.Handles)
+    {
+        m_Cache.Store(entry);
+        m_Cached = entry;
+        m_bCached = true;
+    }
+}
+
+void BluetoothDeviceLink::ConnectFailed()
+{
+    if(m_bFailed || m_bReady)
+    {
+        return;
+    }
+
+    // A remembered address that's never worked this time has probably gone stale
+    m_bFailed = true;
+    m_ConnectTimer.stop();
+    if(m_bCached && !m_bEverConnected)
+    {
+        m_Cache.Forget(m_Cached.Id);
+        m_bCached = false;
+    }
+    if(m_controller && m_controller->state() != QLowEnergyController::UnconnectedState)
+    {
+        m_controller->disconnectFromDevice();
+    }
+    if(m_Callbacks.ConnectFailed)
+    {
+        m_Callbacks.ConnectFailed();
+    }
+}
+
+void BluetoothDeviceLink::ConnectionUpdated()
+{
+    // For debugging
+}
+
+void BluetoothDeviceLink::ServiceStateChanged(QLowEnergyService::ServiceState s)
+{
+    switch (s)
+    {
+        case QLowEnergyService::DiscoveringServices:
+            // For debugging
+            break;
+        case QLowEnergyService::ServiceDiscovered:
+        {
+            auto chars = m_service->characteristics();
+            for(int i = 0; i < chars.size(); ++i)
+            {
+                if(chars[i].isValid())
+                {
+                    m_Characteristics.insert(static_cast<uint16_t>(chars[i].uuid().data1), chars[i]);
+                }
+            }
+            StoreLayout();
+
+            m_ConnectTimer.stop();
+            m_bReady = true;
+            m_bEverConnected = true;
+            if(m_Callbacks.Connected)
+            {
+                m_Callbacks.Connected();
+            }
+            break;
+        }
+        case QLowEnergyService::InvalidService:
+            // For debugging
+            break;
+        case QLowEnergyService::LocalService:
+            // For debugging
+            break;
+        case QLowEnergyService::DiscoveryRequired:
+            // For debugging
+            break;
+    }
+}
+
+void BluetoothDeviceLink::CharacteristicChanged(const QLowEnergyCharacteristic &c, const QByteArray &value)
+{
+    if(m_Callbacks.Notification)
+    {
+        m_Callbacks.Notification(static_cast<uint16_t>(c.uuid().data1), value);
+    }
+}
+
+void BluetoothDeviceLink::ConfirmedDescriptorWrite(const QLowEnergyDescriptor&, const QByteArray&)
+{
+    // For debugging
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QBluetoothDeviceInfo>
+#include <QHash>
+#include <QLowEnergyController>
+#include <QTimer>
+#include "DeviceCache.h"
+#include "IDeviceLink.h"
+
+// IDeviceLink over Qt Bluetooth, to a device found by BluetoothScanner or remembered in a
+// DeviceCache.  Once connected the device's GATT layout is stored in the cache.  When
+// there's a layout cached already, the service is set up as soon as it's seen rather
+// than after every service has been discovered, and the layout found is checked against
+// the cached one.  Connect() can be called again after Disconnected or ConnectFailed to
+// reconnect.  A cached device that can't be connected to within a few seconds the first
+// time is forgotten, as it's probably moved or changed address.
+class BluetoothDeviceLink : public QObject, public IDeviceLink
+{
+    public:
+        BluetoothDeviceLink(const QBluetoothDeviceInfo& Device, DeviceCache& Cache, QObject* pParent = nullptr);
+
+        void SetCallbacks(const Callbacks& Callbacks) override;
+        void Connect() override;
+        void Subscribe(uint16_t Characteristic) override;
+        void Write(uint16_t Characteristic, const QByteArray& Value) override;
+
+    private:
+        void CreateController();
+        void CreateService();
+        void StoreLayout();
+        void ConnectFailed();
+        void ServiceDiscovered(const QBluetoothUuid &gatt);
+        void ServiceScanDone();
+        void ConnectionUpdated();
+        void ServiceStateChanged(QLowEnergyService::ServiceState s);
+        void CharacteristicChanged(const QLowEnergyCharacteristic &c, const QByteArray &value);
+        void ConfirmedDescriptorWrite(const QLowEnergyDescriptor&, const QByteArray&);
+
+        Callbacks                                       m_Callbacks;
+        QBluetoothDeviceInfo                            m_device;
+        QLowEnergyController*                           m_controller = nullptr;
+        QBluetoothUuid                                  m_gatt;
+        QLowEnergyService*                              m_service = nullptr;
+        QHash<uint16_t, QLowEnergyCharacteristic>       m_Characteristics;
+        bool                                            m_bGattFound = false;
+        DeviceCache&                                    m_Cache;
+        DeviceCache::Entry                              m_Cached;
+        bool                                            m_bCached = false;        // m_Cached was found in m_Cache
+        bool                                            m_bReady = false;         // Between the Connected and Disconnected callbacks
+        bool                                            m_bEverConnected = false;
+        bool                                            m_bFailed = false;        // This attempt, so it's only reported once
+        QTimer                                          m_ConnectTimer{this};
+};
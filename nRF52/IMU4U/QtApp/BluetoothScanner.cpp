@@ -0,0 +1,99 @@
+#include "BluetoothScanner.h"
+
+namespace
+{
+    constexpr int BLE_SCAN_TIMEOUT_MS = 5000;   // Scan timeout in milliseconds
+}
+
+BluetoothScanner::BluetoothScanner(QObject* pParent) : QObject(pParent)
+{
+    m_Agent.setLowEnergyDiscoveryTimeout(BLE_SCAN_TIMEOUT_MS);
+    connect(&m_Agent, &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &BluetoothScanner::DeviceDiscovered);
+    connect(&m_Agent, &QBluetoothDeviceDiscoveryAgent::finished, this, &BluetoothScanner::Finished);
+    connect(&m_Agent, &QBluetoothDeviceDiscoveryAgent::canceled, this, &BluetoothScanner::Finished);
+    connect(&m_Agent, static_cast<void (QBluetoothDeviceDiscoveryAgent::*)(QBluetoothDeviceDiscoveryAgent::Error)>
+            (&QBluetoothDeviceDiscoveryAgent::error), this, [](QBluetoothDeviceDiscoveryAgent::Error)
+    {
+        // For debugging
+    });
+}
+
+void BluetoothScanner::Start(const QStringList& Patterns, int MaxDevices, FoundCallback OnFound, const QSet<QString>& Ignore,
+                             std::function<void()> OnFinished)
+{
+    m_Patterns.clear();
+    for(const auto& pattern : Patterns)
+    {
+        m_Patterns.append(QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard));
+    }
+    m_MaxDevices = MaxDevices;
+    m_OnFound = std::move(OnFound);
+    m_OnFinished = std::move(OnFinished);
+    m_Found.clear();
+    m_Ignore = Ignore;
+    m_Agent.start(QBluetoothDeviceDiscoveryAgent::LowEnergyMethod);
+}
+
+void BluetoothScanner::Stop()
+{
+    m_Agent.stop();
+}
+
+bool BluetoothScanner::Scanning() const
+{
+    return m_Agent.isActive();
+}
+
+QString BluetoothScanner::DeviceId(const QBluetoothDeviceInfo& Device)
+{
+    return Device.address().isNull() ? Device.deviceUuid().toString() : Device.address().toString();
+}
+
+bool BluetoothScanner::Matches(const QStringList& Patterns, const QString& Name, const QString& Id)
+{
+    for(const auto& pattern : Patterns)
+    {
+        QRegExp regExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+        if(regExp.exactMatch(Name) || regExp.exactMatch(Id))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool BluetoothScanner::Matches(const QBluetoothDeviceInfo& Device) const
+{
+    for(const auto& pattern : m_Patterns)
+    {
+        if(pattern.exactMatch(Device.name()) || pattern.exactMatch(DeviceId(Device)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BluetoothScanner::DeviceDiscovered(const QBluetoothDeviceInfo& Device)
+{
+    // Devices can be reported again as their advertising data changes
+    if(m_Found.contains(DeviceId(Device)) || m_Ignore.contains(DeviceId(Device)) || !Matches(Device))
+    {
+        return;
+    }
+
+    m_Found.insert(DeviceId(Device));
+    if(m_MaxDevices > 0 && m_Found.size() >= m_MaxDevices)
+    {
+        m_Agent.stop();
+    }
+    m_OnFound(Device);
+}
+
+void BluetoothScanner::Finished()
+{
+    if(m_OnFinished)
+    {
+        m_OnFinished();
+    }
+}
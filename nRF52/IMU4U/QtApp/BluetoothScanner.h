@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <QBluetoothDeviceDiscoveryAgent>
+#include <QList>
+#include <QRegExp>
+#include <QSet>
+#include <QStringList>
+
+// Looks for IMU4Us over Qt Bluetooth.  Devices are chosen by patterns matched against
+// their address or name, with * and ? wildcards.  Each match is reported as soon as it's
+// seen, so connecting to it can get going while the scan carries on looking for the rest.
+class BluetoothScanner : public QObject
+{
+    public:
+        using FoundCallback = std::function<void(const QBluetoothDeviceInfo& Device)>;
+
+        explicit BluetoothScanner(QObject* pParent = nullptr);
+
+        // Reports each matching device once, apart from those whose IDs are in Ignore,
+        // e.g. as they're already being connected to.  The scan stops after MaxDevices
+        // matches (0 for no limit) or when it times out, then calls OnFinished.
+        void Start(const QStringList& Patterns, int MaxDevices, FoundCallback OnFound, const QSet<QString>& Ignore = QSet<QString>(),
+                   std::function<void()> OnFinished = nullptr);
+        void Stop();
+        bool Scanning() const;
+
+        // The address on most platforms, but macOS only gives out a UUID
+        static QString DeviceId(const QBluetoothDeviceInfo& Device);
+
+        // Whether Name or Id matches any of Patterns
+        static bool Matches(const QStringList& Patterns, const QString& Name, const QString& Id);
+
+    private:
+        bool Matches(const QBluetoothDeviceInfo& Device) const;
+        void DeviceDiscovered(const QBluetoothDeviceInfo& Device);
+        void Finished();
+
+        QBluetoothDeviceDiscoveryAgent m_Agent{this};
+        QList<QRegExp>                 m_Patterns;
+        int                            m_MaxDevices = 0;
+        FoundCallback                  m_OnFound;
+        std::function<void()>          m_OnFinished;
+        QSet<QString>                  m_Found;
+        QSet<QString>                  m_Ignore;
+};
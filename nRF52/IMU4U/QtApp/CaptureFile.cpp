@@ -0,0 +1,124 @@
+#include "CaptureFile.h"
+#include <cstring>
+
+namespace
+{
+    void PutLittleEndian(uint8_t* pBytes, uint64_t Value, size_t Size)
+    {
+        for(size_t i = 0; i < Size; ++i)
+        {
+            pBytes[i] = static_cast<uint8_t>(Value >> (8 * i));
+        }
+    }
+
+    uint64_t GetLittleEndian(const uint8_t* pBytes, size_t Size)
+    {
+        uint64_t value = 0;
+        for(size_t i = 0; i < Size; ++i)
+        {
+            value |= static_cast<uint64_t>(pBytes[i]) << (8 * i);
+        }
+        return value;
+    }
+}
+
+bool CaptureWriter::Open(const std::string& FileName)
+{
+    Close();
+    m_File.open(FileName, std::ios::binary | std::ios::trunc);
+    if(!m_File)
+    {
+        return false;
+    }
+
+    uint8_t header[Capture::FILE_HEADER_SIZE];
+    std::memcpy(header, Capture::MAGIC, sizeof(Capture::MAGIC));
+    PutLittleEndian(&header[sizeof(Capture::MAGIC)], Capture::VERSION, 2);
+    m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+    return static_cast<bool>(m_File);
+}
+
+void CaptureWriter::Close()
+{
+    if(m_File.is_open())
+    {
+        m_File.close();
+    }
+}
+
+bool CaptureWriter::IsOpen() const
+{
+    return m_File.is_open();
+}
+
+bool CaptureWriter::Write(uint64_t TimeNs, uint16_t Device, uint16_t Characteristic, const uint8_t* pPayload, size_t Size)
+{
+    if(Size > UINT16_MAX)
+    {
+        return false;
+    }
+
+    uint8_t header[Capture::RECORD_HEADER_SIZE];
+    PutLittleEndian(&header[0], TimeNs, 8);
+    PutLittleEndian(&header[8], Device, 2);
+    PutLittleEndian(&header[10], Characteristic, 2);
+    PutLittleEndian(&header[12], Size, 2);
+    m_File.write(reinterpret_cast<const char*>(header), sizeof(header));
+    m_File.write(reinterpret_cast<const char*>(pPayload), Size);
+    return static_cast<bool>(m_File);
+}
+
+bool CaptureReader::Open(const std::string& FileName)
+{
+    Close();
+    m_File.open(FileName, std::ios::binary);
+    return Rewind();
+}
+
+void CaptureReader::Close()
+{
+    if(m_File.is_open())
+    {
+        m_File.close();
+    }
+}
+
+bool CaptureReader::Rewind()
+{
+    m_File.clear();
+    m_File.seekg(0);
+
+    uint8_t header[Capture::FILE_HEADER_SIZE];
+    if(!m_File.read(reinterpret_cast<char*>(header), sizeof(header)))
+    {
+        return false;
+    }
+    m_Version = static_cast<uint16_t>(GetLittleEndian(&header[sizeof(Capture::MAGIC)], 2));
+    return std::memcmp(header, Capture::MAGIC, sizeof(Capture::MAGIC)) == 0 && (m_Version == 1 || m_Version == Capture::VERSION);
+}
+
+bool CaptureReader::Read(CaptureRecord& Record)
+{
+    uint8_t header[Capture::RECORD_HEADER_SIZE];
+    if(m_Version == 1)
+    {
+        // No device ID, everything came from the one device
+        if(!m_File.read(reinterpret_cast<char*>(&header[2]), Capture::VERSION_1_RECORD_HEADER_SIZE))
+        {
+            return false;
+        }
+        std::memmove(header, &header[2], 8);
+        header[8] = 0;
+        header[9] = 0;
+    }
+    else if(!m_File.read(reinterpret_cast<char*>(header), sizeof(header)))
+    {
+        return false;
+    }
+
+    Record.TimeNs = GetLittleEndian(&header[0], 8);
+    Record.Device = static_cast<uint16_t>(GetLittleEndian(&header[8], 2));
+    Record.Characteristic = static_cast<uint16_t>(GetLittleEndian(&header[10], 2));
+    Record.Payload.resize(static_cast<size_t>(GetLittleEndian(&header[12], 2)));
+    return static_cast<bool>(m_File.read(reinterpret_cast<char*>(Record.Payload.data()), Record.Payload.size()));
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Notification payloads as they arrived from the IMU4Us, for replaying later (see
+// ReplaySource.h).  The file starts with the 8 byte MAGIC and a little endian uint16
+// VERSION, then holds one record per notification:
+//   Byte 0-7:   Little endian nanoseconds since the capture started
+//   Byte 8-9:   Little endian ID of the device it came from (see NordicCentral.h)
+//   Byte 10-11: Little endian 16 bit UUID of the characteristic it came from
+//   Byte 12-13: Little endian payload size
+//   Byte 14-n:  The payload
+// Version 1 files, from before there could be more than one device, have no device ID
+// and are read as all coming from device 0.
+namespace Capture
+{
+    constexpr char     MAGIC[8] = { 'I', 'M', 'U', '4', 'U', 'C', 'A', 'P' };
+    constexpr uint16_t VERSION = 2;
+    constexpr size_t   FILE_HEADER_SIZE = sizeof(MAGIC) + 2;
+    constexpr size_t   RECORD_HEADER_SIZE = 14;
+    constexpr size_t   VERSION_1_RECORD_HEADER_SIZE = 12;
+}
+
+struct CaptureRecord
+{
+    uint64_t             TimeNs = 0;
+    uint16_t             Device = 0;
+    uint16_t             Characteristic = 0;
+    std::vector<uint8_t> Payload;
+};
+
+class CaptureWriter
+{
+    public:
+        bool Open(const std::string& FileName);
+        void Close();
+        bool IsOpen() const;
+
+        bool Write(uint64_t TimeNs, uint16_t Device, uint16_t Characteristic, const uint8_t* pPayload, size_t Size);
+
+    private:
+        std::ofstream m_File;
+};
+
+class CaptureReader
+{
+    public:
+        bool Open(const std::string& FileName);
+        void Close();
+
+        // Back to the first record
+        bool Rewind();
+
+        // Returns false at the end of the file or if the next record is truncated.
+        // Record's payload vector is reused, so reading into the same record doesn't
+        // allocate once it's grown to the largest payload.
+        bool Read(CaptureRecord& Record);
+
+    private:
+        std::ifstream m_File;
+        uint16_t      m_Version = 0;
+};
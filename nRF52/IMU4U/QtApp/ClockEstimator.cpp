@@ -0,0 +1,316 @@
+#include "ClockEstimator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;       // Device time stamp rate (see IMUData.h)
+    constexpr double NS_PER_TICK = 1e9 / TICKS_PER_SECOND;
+    constexpr double MIN_UNCERTAINTY_NS = 100000.0;    // No round trip is trusted to better than this
+    constexpr double OUTLIER_FACTOR = 3.0;             // Round trips this many times the typical length are skipped
+    constexpr double TYPICAL_ROUND_TRIP_WEIGHT = 0.1;  // How quickly the typical round trip follows new ones
+    constexpr uint64_t MIN_ROUND_TRIPS_FOR_OUTLIERS = 4;
+    constexpr double BOUND_LOOSENING_NS_PER_S = 50000.0;   // Well over the skew the line can lag a swing by
+    constexpr double SKEW_WINDOW_S = 20.0;             // Replies are reduced to the earliest in each window this long
+    constexpr uint64_t MIN_SKEW_WINDOWS = 3;           // Until then the line's skew is used
+    constexpr double SKEW_WINDOW_NOISE_NS = 30000.0;   // Scatter of a window's earliest reply
+    constexpr double SKEW_JERK_NOISE = 30.0;           // How freely the skew's rate of change wanders, in ns^2/s^5
+    constexpr double INITIAL_SKEW_NOISE = 10000.0;     // How far out the line's skew may be to start with, in ns/s
+    constexpr double INITIAL_SKEW_RATE_NOISE = 100.0;  // ns/s^2
+}
+
+ClockEstimator::ClockEstimator(double Forgetting) : m_Forgetting(Forgetting)
+{
+}
+
+void ClockEstimator::Reset()
+{
+    *this = ClockEstimator(m_Forgetting);
+}
+
+bool ClockEstimator::AddRoundTrip(uint64_t HostSendNs, uint64_t HostReceiveNs, uint32_t DeviceTicks)
+{
+    if(HostReceiveNs < HostSendNs)
+    {
+        return false;
+    }
+
+    double roundTripNs = static_cast<double>(HostReceiveNs - HostSendNs);
+    if(m_RoundTrips >= MIN_ROUND_TRIPS_FOR_OUTLIERS && roundTripNs > OUTLIER_FACTOR * m_TypicalRoundTripNs)
+    {
+        return false;
+    }
+    m_TypicalRoundTripNs = m_RoundTrips == 0 ? roundTripNs :
+                           m_TypicalRoundTripNs + TYPICAL_ROUND_TRIP_WEIGHT * (roundTripNs - m_TypicalRoundTripNs);
+
+    Track(DeviceTicks);
+    int64_t ticks = Extend(DeviceTicks);
+    double hostNs = HostSendNs + roundTripNs / 2.0;
+    double deviceNs = ticks * NS_PER_TICK;
+    if(!m_bHaveOrigin)
+    {
+        m_X0 = ticks;
+        m_Y0 = hostNs - deviceNs;
+        m_bHaveOrigin = true;
+    }
+
+    double x = DeviceSeconds(ticks);
+    double y = hostNs - deviceNs - m_Y0;
+    if(m_RoundTrips > 0)
+    {
+        double residual = y - Predict(x);
+        m_ResidualSquared = m_Forgetting * m_ResidualSquared + (1.0 - m_Forgetting) * residual * residual;
+    }
+
+    double uncertainty = std::max(roundTripNs / 2.0, MIN_UNCERTAINTY_NS) / MIN_UNCERTAINTY_NS;
+    double w = 1.0 / (uncertainty * uncertainty);
+    m_Sw = m_Forgetting * m_Sw + w;
+    m_Swx = m_Forgetting * m_Swx + w * x;
+    m_Swy = m_Forgetting * m_Swy + w * y;
+    m_Swxx = m_Forgetting * m_Swxx + w * x * x;
+    m_Swxy = m_Forgetting * m_Swxy + w * x * y;
+    m_LatestX = x;
+    ++m_RoundTrips;
+    Solve();
+
+    Tighten(m_Lower, x, HostSendNs - deviceNs - m_Y0, 1.0);
+    Tighten(m_Upper, x, HostReceiveNs - deviceNs - m_Y0, -1.0);
+    TrackSkew(x, HostReceiveNs - deviceNs - m_Y0);
+    return true;
+}
+
+void ClockEstimator::AddArrival(uint32_t DeviceTicks, uint64_t HostNs)
+{
+    Track(DeviceTicks);
+    if(!Valid())
+    {
+        return;
+    }
+
+    int64_t ticks = Extend(DeviceTicks);
+    if(Tighten(m_Upper, DeviceSeconds(ticks), HostNs - ticks * NS_PER_TICK - m_Y0, -1.0))
+    {
+        ++m_ArrivalCorrections;
+    }
+}
+
+bool ClockEstimator::Valid() const
+{
+    return m_RoundTrips > 0;
+}
+
+uint64_t ClockEstimator::ToHostNs(uint32_t DeviceTicks) const
+{
+    int64_t ticks = Extend(DeviceTicks);
+    double hostNs = ticks * NS_PER_TICK + m_Y0 + Offset(DeviceSeconds(ticks));
+    return hostNs > 0.0 ? static_cast<uint64_t>(hostNs) : 0;
+}
+
+double ClockEstimator::OffsetNs() const
+{
+    return m_Y0 + Offset(m_LatestX);
+}
+
+double ClockEstimator::SkewPpm() const
+{
+    return Skew() / 1000.0;
+}
+
+double ClockEstimator::ResidualNs() const
+{
+    return std::sqrt(m_ResidualSquared);
+}
+
+uint64_t ClockEstimator::RoundTrips() const
+{
+    return m_RoundTrips;
+}
+
+uint64_t ClockEstimator::ArrivalCorrections() const
+{
+    return m_ArrivalCorrections;
+}
+
+// Time stamps are taken to be within half a wrap of the latest one seen
+int64_t ClockEstimator::Extend(uint32_t DeviceTicks) const
+{
+    return m_LastExtended + static_cast<int32_t>(DeviceTicks - m_LastTicks);
+}
+
+void ClockEstimator::Track(uint32_t DeviceTicks)
+{
+    if(!m_bHaveTicks)
+    {
+        m_LastTicks = DeviceTicks;
+        m_LastExtended = DeviceTicks;
+        m_bHaveTicks = true;
+    }
+
+    int64_t extended = Extend(DeviceTicks);
+    if(extended > m_LastExtended)
+    {
+        m_LastTicks = DeviceTicks;
+        m_LastExtended = extended;
+    }
+}
+
+double ClockEstimator::DeviceSeconds(int64_t ExtendedTicks) const
+{
+    return (ExtendedTicks - m_X0) / TICKS_PER_SECOND;
+}
+
+double ClockEstimator::Predict(double DeviceSeconds) const
+{
+    return m_A + m_B * DeviceSeconds;
+}
+
+void ClockEstimator::Solve()
+{
+    // Until the round trips are spread out in time there's only the offset to go on
+    double determinant = m_Sw * m_Swxx - m_Swx * m_Swx;
+    if(determinant > 1e-9 * m_Sw * m_Sw)
+    {
+        m_B = (m_Sw * m_Swxy - m_Swx * m_Swy) / determinant;
+    }
+    m_A = (m_Swy - m_B * m_Swx) / m_Sw;
+}
+
+double ClockEstimator::Offset(double DeviceSeconds) const
+{
+    double lower = BoundAt(m_Lower, DeviceSeconds, 1.0);
+    double upper = BoundAt(m_Upper, DeviceSeconds, -1.0);
+    if(m_Lower.bValid && m_Upper.bValid)
+    {
+        return (lower + upper) / 2.0;
+    }
+
+    double offset = Predict(DeviceSeconds);
+    if(m_Lower.bValid)
+    {
+        offset = std::max(offset, lower);
+    }
+    if(m_Upper.bValid)
+    {
+        offset = std::min(offset, upper);
+    }
+    return offset;
+}
+
+double ClockEstimator::BoundAt(const Bound& Bound, double DeviceSeconds, double Sign) const
+{
+    double elapsed = DeviceSeconds - Bound.X;
+    return Bound.Y + m_B * elapsed - Sign * BOUND_LOOSENING_NS_PER_S * std::fabs(elapsed);
+}
+
+// Returns true if Y is tighter than the bound already was
+bool ClockEstimator::Tighten(Bound& Bound, double DeviceSeconds, double Y, double Sign)
+{
+    if(Bound.bValid && Sign * (Y - BoundAt(Bound, DeviceSeconds, Sign)) <= 0.0)
+    {
+        return false;
+    }
+    Bound.bValid = true;
+    Bound.X = DeviceSeconds;
+    Bound.Y = Y;
+    return true;
+}
+
+double ClockEstimator::Skew() const
+{
+    return m_SkewWindows >= MIN_SKEW_WINDOWS ? m_SkewState[1] : m_B;
+}
+
+// Keeps the earliest reply of each window, judged relative to the skew so far so that the
+// window's slope doesn't favour its end, and filters it once the window is over
+void ClockEstimator::TrackSkew(double DeviceSeconds, double UpperY)
+{
+    if(m_bSkewWindow && DeviceSeconds >= m_SkewWindowStart + SKEW_WINDOW_S)
+    {
+        FilterSkew(m_SkewWindowX, m_SkewWindowY);
+        m_bSkewWindow = false;
+    }
+
+    double skew = Skew();
+    if(!m_bSkewWindow || UpperY - skew * DeviceSeconds < m_SkewWindowY - skew * m_SkewWindowX)
+    {
+        if(!m_bSkewWindow)
+        {
+            m_SkewWindowStart = DeviceSeconds;
+            m_bSkewWindow = true;
+        }
+        m_SkewWindowX = DeviceSeconds;
+        m_SkewWindowY = UpperY;
+    }
+}
+
+// A Kalman filter of offset, skew and the skew's rate of change, driven by white noise in
+// how that rate changes, and measuring only the offset
+void ClockEstimator::FilterSkew(double DeviceSeconds, double Y)
+{
+    double* s = m_SkewState;
+    double (&P)[3][3] = m_SkewCovariance;
+    const double measurementVariance = SKEW_WINDOW_NOISE_NS * SKEW_WINDOW_NOISE_NS;
+    if(m_SkewWindows == 0)
+    {
+        s[0] = Y;
+        s[1] = m_B;
+        s[2] = 0.0;
+        P[0][0] = measurementVariance;
+        P[1][1] = INITIAL_SKEW_NOISE * INITIAL_SKEW_NOISE;
+        P[2][2] = INITIAL_SKEW_RATE_NOISE * INITIAL_SKEW_RATE_NOISE;
+    }
+    else
+    {
+        double dt = DeviceSeconds - m_SkewX;
+        double dt2 = dt * dt;
+        double dt3 = dt2 * dt;
+        const double F[3][3] = {{1.0, dt, dt2 / 2.0}, {0.0, 1.0, dt}, {0.0, 0.0, 1.0}};
+        const double Q[3][3] = {{dt3 * dt2 / 20.0, dt3 * dt / 8.0, dt3 / 6.0},
+                                {dt3 * dt / 8.0,   dt3 / 3.0,      dt2 / 2.0},
+                                {dt3 / 6.0,        dt2 / 2.0,      dt}};
+
+        // Predict
+        double predicted[3] = {};
+        double FP[3][3] = {};
+        for(int i = 0; i < 3; ++i)
+        {
+            for(int j = 0; j < 3; ++j)
+            {
+                predicted[i] += F[i][j] * s[j];
+                for(int k = 0; k < 3; ++k)
+                {
+                    FP[i][j] += F[i][k] * P[k][j];
+                }
+            }
+        }
+        for(int i = 0; i < 3; ++i)
+        {
+            s[i] = predicted[i];
+            for(int j = 0; j < 3; ++j)
+            {
+                P[i][j] = SKEW_JERK_NOISE * Q[i][j];
+                for(int k = 0; k < 3; ++k)
+                {
+                    P[i][j] += FP[i][k] * F[j][k];
+                }
+            }
+        }
+
+        // Correct
+        double innovation = Y - s[0];
+        double variance = P[0][0] + measurementVariance;
+        const double gain[3] = {P[0][0] / variance, P[1][0] / variance, P[2][0] / variance};
+        const double measured[3] = {P[0][0], P[0][1], P[0][2]};
+        for(int i = 0; i < 3; ++i)
+        {
+            s[i] += gain[i] * innovation;
+            for(int j = 0; j < 3; ++j)
+            {
+                P[i][j] -= gain[i] * measured[j];
+            }
+        }
+    }
+
+    m_SkewX = DeviceSeconds;
+    ++m_SkewWindows;
+}
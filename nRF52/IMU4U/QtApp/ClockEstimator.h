@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+
+// Works out how one device's time stamps (see IMUData.h) map onto the host's clock, as
+// an offset plus a skew, since the device's 32kHz crystal runs a little fast or slow
+// and drifts with temperature.
+//
+// The main evidence is sync round trips (CONTROL_OP_SYNC in IMU4UService.h): the device
+// stamped the request somewhere between it being sent and the reply arriving.  A
+// weighted least squares line is fitted through the midpoints, trusting each less the
+// longer its round trip took, with older ones gradually forgotten so the estimate
+// follows drift.  Round trips that took far longer than usual are skipped.
+//
+// The line gives the skew, but over a link with connection events the midpoint is late:
+// the request goes out at the next event while the reply waits for later ones.  So the
+// offset comes from bounds instead.  A request can't have been stamped before it was
+// sent, and neither it nor a sample can have been stamped after arriving back.  The
+// tightest of each is carried forward along the line, loosening slowly so that it
+// follows drift the line hasn't caught up with, and the estimate sits midway between.
+//
+// The line's slope is too noisy to show as the skew: its round trips are only remembered
+// for a minute or so, and their midpoints scatter by several ms.  So the skew shown is
+// tracked separately, over minutes.  The earliest reply in each window of time (relative
+// to the skew so far) is only the link's quickest delivery away from the device's clock,
+// and a small Kalman filter follows those with an offset, a skew and the skew's rate of
+// change, so that it keeps up as the skew swings with temperature.
+//
+// All times on the host side are nanoseconds from any fixed point.
+class ClockEstimator
+{
+    public:
+        static constexpr double DEFAULT_FORGETTING = 0.98;   // Weight kept by each older round trip per new one
+
+        explicit ClockEstimator(double Forgetting = DEFAULT_FORGETTING);
+
+        void Reset();
+
+        // A sync request sent at HostSendNs was stamped DeviceTicks by the device, and its
+        // reply arrived at HostReceiveNs.  Returns false if it was skipped as an outlier.
+        bool AddRoundTrip(uint64_t HostSendNs, uint64_t HostReceiveNs, uint32_t DeviceTicks);
+
+        // A sample stamped DeviceTicks arrived at HostNs
+        void AddArrival(uint32_t DeviceTicks, uint64_t HostNs);
+
+        // Only once there's been a round trip
+        bool Valid() const;
+        uint64_t ToHostNs(uint32_t DeviceTicks) const;
+
+        double OffsetNs() const;    // Host time less device time, at the latest round trip
+        double SkewPpm() const;     // How many ns the host's clock gains per ms of the device's (see above)
+        double ResidualNs() const;  // RMS distance of round trips from the estimate before they were added
+        uint64_t RoundTrips() const;
+        uint64_t ArrivalCorrections() const;   // Samples that tightened the upper bound
+
+    private:
+        // A bound on host less device time (relative to m_Y0), as tight as it got at X
+        struct Bound
+        {
+            bool   bValid = false;
+            double X = 0.0;   // Device seconds
+            double Y = 0.0;   // ns
+        };
+
+        int64_t Extend(uint32_t DeviceTicks) const;
+        void Track(uint32_t DeviceTicks);
+        double DeviceSeconds(int64_t ExtendedTicks) const;   // Since the first round trip
+        double Predict(double DeviceSeconds) const;          // Host less device ns, relative to m_Y0
+        void Solve();
+        double Offset(double DeviceSeconds) const;   // Host less device ns, relative to m_Y0, within the bounds
+
+        // Sign is +1 for a lower bound, -1 for an upper one
+        double BoundAt(const Bound& Bound, double DeviceSeconds, double Sign) const;
+        bool Tighten(Bound& Bound, double DeviceSeconds, double Y, double Sign);
+
+        double Skew() const;        // ns per second
+        void TrackSkew(double DeviceSeconds, double UpperY);
+        void FilterSkew(double DeviceSeconds, double Y);
+
+        double   m_Forgetting;
+
+        // Device ticks extended past 32 bits
+        bool     m_bHaveTicks = false;
+        uint32_t m_LastTicks = 0;
+        int64_t  m_LastExtended = 0;
+
+        // The fit is of host less device time against device time, both relative to the
+        // first round trip to keep the sums small
+        bool     m_bHaveOrigin = false;
+        int64_t  m_X0 = 0;        // Extended ticks
+        double   m_Y0 = 0.0;      // ns
+        double   m_Sw = 0.0;
+        double   m_Swx = 0.0;
+        double   m_Swy = 0.0;
+        double   m_Swxx = 0.0;
+        double   m_Swxy = 0.0;
+        double   m_A = 0.0;       // ns
+        double   m_B = 0.0;       // ns per second
+        double   m_LatestX = 0.0;
+        Bound    m_Lower;   // From requests being sent
+        Bound    m_Upper;   // From replies and samples arriving
+
+        // The earliest reply in the current window, and the filter following them
+        bool     m_bSkewWindow = false;
+        double   m_SkewWindowStart = 0.0;
+        double   m_SkewWindowX = 0.0;
+        double   m_SkewWindowY = 0.0;
+        uint64_t m_SkewWindows = 0;
+        double   m_SkewX = 0.0;                     // Of the latest window filtered
+        double   m_SkewState[3] = {};               // ns, ns per second and ns per second squared, at m_SkewX
+        double   m_SkewCovariance[3][3] = {};
+
+        double   m_TypicalRoundTripNs = 0.0;
+        double   m_ResidualSquared = 0.0;
+        uint64_t m_RoundTrips = 0;
+        uint64_t m_ArrivalCorrections = 0;
+};
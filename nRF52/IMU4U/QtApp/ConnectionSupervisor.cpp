@@ -0,0 +1,136 @@
+#include "ConnectionSupervisor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;   // Device time stamp rate (see IMUData.h)
+    constexpr double INTERVAL_SMOOTHING = 0.1;     // Weight of the newest spacing in the average
+    constexpr double GAP_SLACK_S = 0.5;            // How much longer the device's gap can be than the host's before it's not believed
+}
+
+ConnectionSupervisor::ConnectionSupervisor(uint32_t Seed) : ConnectionSupervisor(Settings(), Seed)
+{
+}
+
+ConnectionSupervisor::ConnectionSupervisor(const Settings& Settings, uint32_t Seed) : m_Settings(Settings), m_Random(Seed)
+{
+}
+
+void ConnectionSupervisor::Connecting()
+{
+    m_State = STATE::CONNECTING;
+}
+
+void ConnectionSupervisor::Connected(uint64_t HostNs)
+{
+    if(m_bInOutage)
+    {
+        m_bInOutage = false;
+        m_bEstimatePending = true;
+        m_LastOutageNs = HostNs - m_OutageStartNs;
+        m_TotalOutageNs += m_LastOutageNs;
+    }
+    m_Attempts = 0;
+    m_State = STATE::CONNECTED;
+}
+
+int ConnectionSupervisor::Lost(uint64_t HostNs)
+{
+    if(m_State == STATE::CONNECTED)
+    {
+        m_bInOutage = true;
+        m_OutageStartNs = HostNs;
+        ++m_Outages;
+    }
+    m_State = STATE::WAITING;
+
+    double delay = std::min<double>(m_Settings.MaxDelayMs, m_Settings.InitialDelayMs * std::pow(m_Settings.Multiplier, m_Attempts));
+    delay *= 1.0 - m_Settings.Jitter * std::uniform_real_distribution<double>(0.0, 1.0)(m_Random);
+    ++m_Attempts;
+    return static_cast<int>(delay);
+}
+
+bool ConnectionSupervisor::SamplesArrived(const IMUSample* pSamples, size_t Count, uint64_t HostNs)
+{
+    if(Count == 0)
+    {
+        return false;
+    }
+
+    bool bEstimated = false;
+    if(m_bEstimatePending)
+    {
+        EstimateLoss(pSamples[0].GyroTime, HostNs);
+        m_bEstimatePending = false;
+        bEstimated = true;
+    }
+
+    // Spacing within a packet, which lost packets can't spoil, or between packets if
+    // they only carry one sample
+    double interval = -1.0;
+    if(Count > 1)
+    {
+        interval = static_cast<uint32_t>(pSamples[Count - 1].GyroTime - pSamples[0].GyroTime) / static_cast<double>(Count - 1);
+    }
+    else if(m_bHaveTicks && !bEstimated)
+    {
+        interval = static_cast<uint32_t>(pSamples[0].GyroTime - m_LastTicks);
+    }
+    if(interval > 0.0)
+    {
+        m_IntervalTicks = m_IntervalTicks > 0.0 ? m_IntervalTicks + INTERVAL_SMOOTHING * (interval - m_IntervalTicks) : interval;
+    }
+
+    m_bHaveTicks = true;
+    m_LastTicks = pSamples[Count - 1].GyroTime;
+    m_LastArrivalNs = HostNs;
+    return bEstimated;
+}
+
+// Neither side of the gap was received, so it's one less than the spacings it spans
+void ConnectionSupervisor::EstimateLoss(uint32_t FirstTicks, uint64_t HostNs)
+{
+    if(!m_bHaveTicks || m_IntervalTicks <= 0.0)
+    {
+        return;
+    }
+
+    double gapTicks = static_cast<uint32_t>(FirstTicks - m_LastTicks);
+    double hostGapS = (HostNs - m_LastArrivalNs) / 1e9;
+    if(gapTicks / TICKS_PER_SECOND > hostGapS + GAP_SLACK_S)
+    {
+        gapTicks = hostGapS * TICKS_PER_SECOND;
+    }
+    m_SamplesLost += static_cast<uint64_t>(std::max(0.0, std::round(gapTicks / m_IntervalTicks) - 1.0));
+}
+
+ConnectionSupervisor::STATE ConnectionSupervisor::State() const
+{
+    return m_State;
+}
+
+uint32_t ConnectionSupervisor::Attempts() const
+{
+    return m_Attempts;
+}
+
+uint32_t ConnectionSupervisor::Outages() const
+{
+    return m_Outages;
+}
+
+uint64_t ConnectionSupervisor::LastOutageNs() const
+{
+    return m_LastOutageNs;
+}
+
+uint64_t ConnectionSupervisor::TotalOutageNs() const
+{
+    return m_TotalOutageNs;
+}
+
+uint64_t ConnectionSupervisor::SamplesLost() const
+{
+    return m_SamplesLost;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include "IMUData.h"
+
+// Keeps one device's connection going and accounts for the time it wasn't.  Told what
+// the link does, it says how long to wait before trying again: exponentially longer
+// after each failed attempt up to MaxDelayMs, with a random part taken off so a room of
+// devices that dropped together don't all come back at once.  A connection resets it.
+//
+// An outage runs from losing an established connection to the next one.  What was
+// missed is estimated from the device's time stamps either side of the gap in samples,
+// at the spacing they had before, or from how long the gap was on the host's clock if
+// the time stamps don't fit (the device may have restarted).
+//
+// All times on the host side are nanoseconds from any fixed point.
+class ConnectionSupervisor
+{
+    public:
+        enum class STATE
+        {
+            IDLE,         // Not asked to connect yet
+            CONNECTING,
+            CONNECTED,
+            WAITING       // For the next attempt
+        };
+
+        struct Settings
+        {
+            int    InitialDelayMs = 250;
+            int    MaxDelayMs = 30000;
+            double Multiplier = 2.0;
+            double Jitter = 0.5;          // Up to this fraction of each delay is taken off at random
+        };
+
+        explicit ConnectionSupervisor(uint32_t Seed = 1);
+        ConnectionSupervisor(const Settings& Settings, uint32_t Seed);
+
+        void Connecting();
+        void Connected(uint64_t HostNs);
+
+        // The connection dropped or an attempt failed.  Returns how long to wait before
+        // the next attempt.
+        int Lost(uint64_t HostNs);
+
+        // Every decoded sample, in order, with when they arrived.  Returns true when these
+        // finish off an outage's estimate, so SamplesLost() has changed.
+        bool SamplesArrived(const IMUSample* pSamples, size_t Count, uint64_t HostNs);
+
+        STATE State() const;
+        uint32_t Attempts() const;          // Failed in a row
+        uint32_t Outages() const;
+        uint64_t LastOutageNs() const;
+        uint64_t TotalOutageNs() const;
+        uint64_t SamplesLost() const;       // Estimated, over every outage so far
+
+    private:
+        void EstimateLoss(uint32_t FirstTicks, uint64_t HostNs);
+
+        Settings     m_Settings;
+        std::mt19937 m_Random;
+        STATE        m_State = STATE::IDLE;
+        uint32_t     m_Attempts = 0;
+
+        // Outages
+        bool         m_bInOutage = false;
+        bool         m_bEstimatePending = false;   // Waiting for the first samples after one
+        uint64_t     m_OutageStartNs = 0;
+        uint32_t     m_Outages = 0;
+        uint64_t     m_LastOutageNs = 0;
+        uint64_t     m_TotalOutageNs = 0;
+        uint64_t     m_SamplesLost = 0;
+
+        // The samples before an outage
+        bool         m_bHaveTicks = false;
+        uint32_t     m_LastTicks = 0;
+        uint64_t     m_LastArrivalNs = 0;
+        double       m_IntervalTicks = 0.0;        // Average spacing of samples, 0 until known
+};
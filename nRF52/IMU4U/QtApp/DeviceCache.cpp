@@ -0,0 +1,114 @@
+#include "DeviceCache.h"
+#include <QBluetoothAddress>
+
+namespace
+{
+    constexpr int MAX_ENTRIES = 64;   // The oldest are forgotten after this many
+}
+
+QBluetoothDeviceInfo DeviceCache::Entry::DeviceInfo() const
+{
+    // macOS only gives out UUIDs, everywhere else it's the address
+    QBluetoothAddress address(Id);
+    QBluetoothDeviceInfo info = address.isNull() ? QBluetoothDeviceInfo(QBluetoothUuid(Id), Name, 0) : QBluetoothDeviceInfo(address, Name, 0);
+    info.setCoreConfigurations(QBluetoothDeviceInfo::LowEnergyCoreConfiguration);
+    return info;
+}
+
+DeviceCache::DeviceCache() : m_Settings("IMU4U", "DeviceCache")
+{
+    int count = m_Settings.beginReadArray("devices");
+    for(int i = 0; i < count; ++i)
+    {
+        m_Settings.setArrayIndex(i);
+        Entry entry;
+        entry.Id = m_Settings.value("id").toString();
+        entry.Name = m_Settings.value("name").toString();
+        entry.Service = QBluetoothUuid(m_Settings.value("service").toString());
+        const QStringList handles = m_Settings.value("handles").toStringList();
+        for(const QString& handle : handles)
+        {
+            // Each is "characteristic=handle", both in hex
+            QStringList parts = handle.split('=');
+            if(parts.size() == 2)
+            {
+                entry.Handles.insert(static_cast<uint16_t>(parts[0].toUShort(nullptr, 16)), static_cast<uint16_t>(parts[1].toUShort(nullptr, 16)));
+            }
+        }
+        if(!entry.Id.isEmpty() && !entry.Service.isNull() && !entry.Handles.isEmpty())
+        {
+            m_Entries.append(entry);
+        }
+    }
+    m_Settings.endArray();
+}
+
+QList<DeviceCache::Entry> DeviceCache::Entries() const
+{
+    return m_Entries;
+}
+
+bool DeviceCache::Find(const QString& Id, Entry& Entry) const
+{
+    for(const auto& entry : m_Entries)
+    {
+        if(entry.Id == Id)
+        {
+            Entry = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+void DeviceCache::Store(const Entry& Entry)
+{
+    Forget(Entry.Id);
+    m_Entries.prepend(Entry);
+    while(m_Entries.size() > MAX_ENTRIES)
+    {
+        m_Entries.removeLast();
+    }
+    Save();
+}
+
+void DeviceCache::Forget(const QString& Id)
+{
+    for(int i = 0; i < m_Entries.size(); ++i)
+    {
+        if(m_Entries[i].Id == Id)
+        {
+            m_Entries.removeAt(i);
+            Save();
+            return;
+        }
+    }
+}
+
+void DeviceCache::Clear()
+{
+    m_Entries.clear();
+    Save();
+}
+
+void DeviceCache::Save()
+{
+    m_Settings.remove("devices");
+    m_Settings.beginWriteArray("devices", m_Entries.size());
+    for(int i = 0; i < m_Entries.size(); ++i)
+    {
+        const Entry& entry = m_Entries[i];
+        QStringList handles;
+        for(auto it = entry.Handles.begin(); it != entry.Handles.end(); ++it)
+        {
+            handles.append(QString("%1=%2").arg(it.key(), 0, 16).arg(it.value(), 0, 16));
+        }
+        m_Settings.setArrayIndex(i);
+        m_Settings.setValue("id", entry.Id);
+        m_Settings.setValue("name", entry.Name);
+        m_Settings.setValue("service", entry.Service.toString());
+        m_Settings.setValue("handles", handles);
+    }
+    m_Settings.endArray();
+    m_Settings.sync();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QBluetoothDeviceInfo>
+#include <QBluetoothUuid>
+#include <QHash>
+#include <QList>
+#include <QSettings>
+#include <QString>
+
+// Remembers the IMU4Us connected to before, kept in the user's settings between runs.
+// For each it has the ID (see BluetoothScanner::DeviceId()) so the next run can connect
+// straight to it instead of scanning, and the GATT layout seen last time: the service
+// and the handle of each characteristic.  A link checks the layout it finds against
+// this, and stores it again if the device's firmware has changed it.
+class DeviceCache
+{
+    public:
+        struct Entry
+        {
+            QString                   Id;
+            QString                   Name;
+            QBluetoothUuid            Service;
+            QHash<uint16_t, uint16_t> Handles;   // Characteristic UUID to handle
+
+            // Enough to connect with, without having scanned
+            QBluetoothDeviceInfo DeviceInfo() const;
+        };
+
+        DeviceCache();
+
+        QList<Entry> Entries() const;   // Most recently stored first
+        bool Find(const QString& Id, Entry& Entry) const;
+        void Store(const Entry& Entry);
+        void Forget(const QString& Id);
+        void Clear();
+
+    private:
+        void Save();
+
+        QSettings    m_Settings;
+        QList<Entry> m_Entries;
+};
@@ -0,0 +1,93 @@
+// One pass of RealFFT's complex FFT, included into each of its kernels with these defined
+// for its lane type V:
+//   LOAD(p) STORE(p, v) SET1(f) ADD SUB MUL
+// and with Pass, pTwiddles, pInReal, pInImag, pOutReal and pOutImag in scope.  WIDTH
+// butterflies next to each other in the stride are done at once, so Pass.Stride has to be
+// a multiple of WIDTH.
+//
+// Each radix-4 butterfly takes a, b, c and d a quarter of the sub-transform apart and
+// writes
+//   y0 = (a + c) + (b + d)
+//   y1 = w1 ((a - c) - i (b - d))
+//   y2 = w2 ((a + c) - (b + d))
+//   y3 = w3 ((a - c) + i (b - d))
+// next to each other at the pass's stride.
+
+{
+    const size_t s = Pass.Stride;
+    if(Pass.Radix == 4)
+    {
+        const size_t m = Pass.Length / 4;
+        const float* pW1Real = pTwiddles;
+        const float* pW1Imag = pW1Real + m;
+        const float* pW2Real = pW1Imag + m;
+        const float* pW2Imag = pW2Real + m;
+        const float* pW3Real = pW2Imag + m;
+        const float* pW3Imag = pW3Real + m;
+        for(size_t p = 0; p < m; ++p)
+        {
+            const V w1r = SET1(pW1Real[p]);
+            const V w1i = SET1(pW1Imag[p]);
+            const V w2r = SET1(pW2Real[p]);
+            const V w2i = SET1(pW2Imag[p]);
+            const V w3r = SET1(pW3Real[p]);
+            const V w3i = SET1(pW3Imag[p]);
+            const size_t in = s * p;
+            const size_t out = s * 4 * p;
+            for(size_t q = 0; q < s; q += WIDTH)
+            {
+                const V ar = LOAD(pInReal + in + q);
+                const V ai = LOAD(pInImag + in + q);
+                const V br = LOAD(pInReal + in + s * m + q);
+                const V bi = LOAD(pInImag + in + s * m + q);
+                const V cr = LOAD(pInReal + in + 2 * s * m + q);
+                const V ci = LOAD(pInImag + in + 2 * s * m + q);
+                const V dr = LOAD(pInReal + in + 3 * s * m + q);
+                const V di = LOAD(pInImag + in + 3 * s * m + q);
+
+                const V apcr = ADD(ar, cr);
+                const V apci = ADD(ai, ci);
+                const V amcr = SUB(ar, cr);
+                const V amci = SUB(ai, ci);
+                const V bpdr = ADD(br, dr);
+                const V bpdi = ADD(bi, di);
+                const V bmdr = SUB(br, dr);
+                const V bmdi = SUB(bi, di);
+
+                STORE(pOutReal + out + q, ADD(apcr, bpdr));
+                STORE(pOutImag + out + q, ADD(apci, bpdi));
+
+                const V x1r = ADD(amcr, bmdi);
+                const V x1i = SUB(amci, bmdr);
+                STORE(pOutReal + out + s + q, SUB(MUL(x1r, w1r), MUL(x1i, w1i)));
+                STORE(pOutImag + out + s + q, ADD(MUL(x1r, w1i), MUL(x1i, w1r)));
+
+                const V x2r = SUB(apcr, bpdr);
+                const V x2i = SUB(apci, bpdi);
+                STORE(pOutReal + out + 2 * s + q, SUB(MUL(x2r, w2r), MUL(x2i, w2i)));
+                STORE(pOutImag + out + 2 * s + q, ADD(MUL(x2r, w2i), MUL(x2i, w2r)));
+
+                const V x3r = SUB(amcr, bmdi);
+                const V x3i = ADD(amci, bmdr);
+                STORE(pOutReal + out + 3 * s + q, SUB(MUL(x3r, w3r), MUL(x3i, w3i)));
+                STORE(pOutImag + out + 3 * s + q, ADD(MUL(x3r, w3i), MUL(x3i, w3r)));
+            }
+        }
+    }
+    else
+    {
+        // The last pass when there's an odd number of factors of two, sub-transforms of
+        // two with no twiddles left
+        for(size_t q = 0; q < s; q += WIDTH)
+        {
+            const V ar = LOAD(pInReal + q);
+            const V ai = LOAD(pInImag + q);
+            const V br = LOAD(pInReal + s + q);
+            const V bi = LOAD(pInImag + s + q);
+            STORE(pOutReal + q, ADD(ar, br));
+            STORE(pOutImag + q, ADD(ai, bi));
+            STORE(pOutReal + s + q, SUB(ar, br));
+            STORE(pOutImag + s + q, SUB(ai, bi));
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include "FusionEngine.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr size_t MAX_WIDTH = 8;   // Lanes are padded to a multiple of this
+    constexpr size_t FIELD_COUNT = 11;
+
+    void StepScalar(const FusionEngine::Lanes* pLanes, size_t Count, float Beta)
+    {
+#define V                float
+#define WIDTH            1
+#define LOAD(p)          (*(p))
+#define STORE(p, v)      (*(p) = (v))
+#define SET1(f)          (f)
+#define ADD(a, b)        ((a) + (b))
+#define SUB(a, b)        ((a) - (b))
+#define MUL(a, b)        ((a) * (b))
+#define DIV(a, b)        ((a) / (b))
+#define SQRT(a)          std::sqrt(a)
+#define GT(a, b)         ((a) > (b))
+#define AND(a, b)        ((a) && (b))
+#define SELECT(m, a, b)  ((m) ? (a) : (b))
+#include "FusionKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+#undef DIV
+#undef SQRT
+#undef GT
+#undef AND
+#undef SELECT
+    }
+
+#ifdef SIMD_X86
+    SIMD_TARGET("sse2")
+    void StepSSE2(const FusionEngine::Lanes* pLanes, size_t Count, float Beta)
+    {
+#define V                __m128
+#define WIDTH            4
+#define LOAD(p)          _mm_loadu_ps(p)
+#define STORE(p, v)      _mm_storeu_ps((p), (v))
+#define SET1(f)          _mm_set1_ps(f)
+#define ADD(a, b)        _mm_add_ps((a), (b))
+#define SUB(a, b)        _mm_sub_ps((a), (b))
+#define MUL(a, b)        _mm_mul_ps((a), (b))
+#define DIV(a, b)        _mm_div_ps((a), (b))
+#define SQRT(a)          _mm_sqrt_ps(a)
+#define GT(a, b)         _mm_cmpgt_ps((a), (b))
+#define AND(a, b)        _mm_and_ps((a), (b))
+#define SELECT(m, a, b)  _mm_or_ps(_mm_and_ps((m), (a)), _mm_andnot_ps((m), (b)))
+#include "FusionKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+#undef DIV
+#undef SQRT
+#undef GT
+#undef AND
+#undef SELECT
+    }
+
+    SIMD_TARGET("avx2")
+    void StepAVX2(const FusionEngine::Lanes* pLanes, size_t Count, float Beta)
+    {
+#define V                __m256
+#define WIDTH            8
+#define LOAD(p)          _mm256_loadu_ps(p)
+#define STORE(p, v)      _mm256_storeu_ps((p), (v))
+#define SET1(f)          _mm256_set1_ps(f)
+#define ADD(a, b)        _mm256_add_ps((a), (b))
+#define SUB(a, b)        _mm256_sub_ps((a), (b))
+#define MUL(a, b)        _mm256_mul_ps((a), (b))
+#define DIV(a, b)        _mm256_div_ps((a), (b))
+#define SQRT(a)          _mm256_sqrt_ps(a)
+#define GT(a, b)         _mm256_cmp_ps((a), (b), _CMP_GT_OQ)
+#define AND(a, b)        _mm256_and_ps((a), (b))
+#define SELECT(m, a, b)  _mm256_blendv_ps((b), (a), (m))
+#include "FusionKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+#undef DIV
+#undef SQRT
+#undef GT
+#undef AND
+#undef SELECT
+    }
+#endif
+}
+
+FusionEngine::FusionEngine(size_t DeviceCount, float Beta, SIMD_LEVEL Level) :
+    m_DeviceCount(DeviceCount), m_LaneCount((DeviceCount + MAX_WIDTH - 1) / MAX_WIDTH * MAX_WIDTH), m_Beta(Beta),
+    m_Level(SimdSupported(Level) ? Level : SIMD_LEVEL::SCALAR), m_Storage(FIELD_COUNT * m_LaneCount, 0.0f)
+{
+    float* pFields[FIELD_COUNT];
+    for(size_t field = 0; field < FIELD_COUNT; ++field)
+    {
+        pFields[field] = m_Storage.data() + field * m_LaneCount;
+    }
+    m_Lanes = Lanes{ pFields[0], pFields[1], pFields[2], pFields[3], pFields[4], pFields[5], pFields[6],
+                     pFields[7], pFields[8], pFields[9], pFields[10] };
+
+    // Padding lanes included, so they stay well behaved
+    for(size_t lane = 0; lane < m_LaneCount; ++lane)
+    {
+        m_Lanes.pQ0[lane] = 1.0f;
+    }
+}
+
+size_t FusionEngine::DeviceCount() const
+{
+    return m_DeviceCount;
+}
+
+SIMD_LEVEL FusionEngine::Level() const
+{
+    return m_Level;
+}
+
+void FusionEngine::SetInput(size_t Device, float GyroX, float GyroY, float GyroZ, float AccelX, float AccelY, float AccelZ, float Dt)
+{
+    m_Lanes.pGyroX[Device] = GyroX;
+    m_Lanes.pGyroY[Device] = GyroY;
+    m_Lanes.pGyroZ[Device] = GyroZ;
+    m_Lanes.pAccelX[Device] = AccelX;
+    m_Lanes.pAccelY[Device] = AccelY;
+    m_Lanes.pAccelZ[Device] = AccelZ;
+    m_Lanes.pDt[Device] = Dt;
+}
+
+void FusionEngine::Step()
+{
+    switch(m_Level)
+    {
+#ifdef SIMD_X86
+        case SIMD_LEVEL::AVX2:
+            StepAVX2(&m_Lanes, m_LaneCount, m_Beta);
+            break;
+        case SIMD_LEVEL::SSE2:
+            StepSSE2(&m_Lanes, m_LaneCount, m_Beta);
+            break;
+#endif
+        default:
+            StepScalar(&m_Lanes, m_LaneCount, m_Beta);
+            break;
+    }
+
+    // Consumed, so anything not given a new reading next time stands still
+    std::fill(m_Lanes.pDt, m_Lanes.pDt + m_LaneCount, 0.0f);
+}
+
+Quaternion FusionEngine::Orientation(size_t Device) const
+{
+    Quaternion q;
+    q.W = m_Lanes.pQ0[Device];
+    q.X = m_Lanes.pQ1[Device];
+    q.Y = m_Lanes.pQ2[Device];
+    q.Z = m_Lanes.pQ3[Device];
+    return q;
+}
+
+void FusionEngine::Reset(size_t Device)
+{
+    m_Lanes.pQ0[Device] = 1.0f;
+    m_Lanes.pQ1[Device] = 0.0f;
+    m_Lanes.pQ2[Device] = 0.0f;
+    m_Lanes.pQ3[Device] = 0.0f;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MadgwickFilter.h"
+#include "Quaternion.h"
+#include "SimdSupport.h"
+
+// MadgwickFilter for many devices at once.  Each quantity is kept in an array across the
+// devices rather than each device's in a struct, so one step updates eight devices per
+// instruction with AVX2, four with SSE2, or one at a time without either.  The lanes
+// get the same arithmetic as MadgwickFilter, in the same order.
+//
+// Each device's next reading is staged with SetInput(), then Step() moves every device
+// on together.  Devices with nothing staged step by zero time, which leaves them be.
+class FusionEngine
+{
+    public:
+        // Level falls back to SCALAR if the CPU can't run it
+        FusionEngine(size_t DeviceCount, float Beta = MadgwickFilter::DEFAULT_BETA, SIMD_LEVEL Level = BestSimdLevel());
+
+        size_t DeviceCount() const;
+        SIMD_LEVEL Level() const;
+
+        // Gyro in radians per second, accel in any unit, Dt in seconds.  Staging another
+        // reading for the same device before Step() replaces the first.
+        void SetInput(size_t Device, float GyroX, float GyroY, float GyroZ, float AccelX, float AccelY, float AccelZ, float Dt);
+        void Step();
+
+        Quaternion Orientation(size_t Device) const;
+        void Reset(size_t Device);
+
+        // The arrays one step works through, padded to a whole number of AVX2 registers
+        struct Lanes
+        {
+            float* pQ0;
+            float* pQ1;
+            float* pQ2;
+            float* pQ3;
+            float* pGyroX;
+            float* pGyroY;
+            float* pGyroZ;
+            float* pAccelX;
+            float* pAccelY;
+            float* pAccelZ;
+            float* pDt;
+        };
+
+    private:
+        size_t             m_DeviceCount;
+        size_t             m_LaneCount;
+        float              m_Beta;
+        SIMD_LEVEL         m_Level;
+        std::vector<float> m_Storage;
+        Lanes              m_Lanes;
+};
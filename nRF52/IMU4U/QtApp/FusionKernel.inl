@@ -0,0 +1,79 @@
+// One step of MadgwickFilter::Update() for WIDTH devices at a time, included into each of
+// FusionEngine's kernels with these defined for its lane type V:
+//   LOAD(p) STORE(p, v) SET1(f) ADD SUB MUL DIV SQRT GT(a, b) AND(m1, m2) SELECT(m, a, b)
+// and with pLanes, Count (a multiple of WIDTH) and Beta in scope.  The branches of the
+// scalar filter become masks, and its arithmetic is done in the same order.
+
+for(size_t i = 0; i < Count; i += WIDTH)
+{
+    const V zero = SET1(0.0f);
+    const V half = SET1(0.5f);
+    const V two = SET1(2.0f);
+    const V four = SET1(4.0f);
+    const V eight = SET1(8.0f);
+    const V beta = SET1(Beta);
+
+    V q0 = LOAD(pLanes->pQ0 + i);
+    V q1 = LOAD(pLanes->pQ1 + i);
+    V q2 = LOAD(pLanes->pQ2 + i);
+    V q3 = LOAD(pLanes->pQ3 + i);
+    V gx = LOAD(pLanes->pGyroX + i);
+    V gy = LOAD(pLanes->pGyroY + i);
+    V gz = LOAD(pLanes->pGyroZ + i);
+    V ax = LOAD(pLanes->pAccelX + i);
+    V ay = LOAD(pLanes->pAccelY + i);
+    V az = LOAD(pLanes->pAccelZ + i);
+    V dt = LOAD(pLanes->pDt + i);
+
+    // Rate of change of the quaternion from the gyro
+    V qDot0 = MUL(half, SUB(SUB(SUB(zero, MUL(q1, gx)), MUL(q2, gy)), MUL(q3, gz)));
+    V qDot1 = MUL(half, SUB(ADD(MUL(q0, gx), MUL(q2, gz)), MUL(q3, gy)));
+    V qDot2 = MUL(half, ADD(SUB(MUL(q0, gy), MUL(q1, gz)), MUL(q3, gx)));
+    V qDot3 = MUL(half, SUB(ADD(MUL(q0, gz), MUL(q1, gy)), MUL(q2, gx)));
+
+    // Worked out for every lane, and only used where the accel reading is usable
+    V accelNorm = SQRT(ADD(ADD(MUL(ax, ax), MUL(ay, ay)), MUL(az, az)));
+    ax = DIV(ax, accelNorm);
+    ay = DIV(ay, accelNorm);
+    az = DIV(az, accelNorm);
+
+    V _2q0 = MUL(two, q0);
+    V _2q1 = MUL(two, q1);
+    V _2q2 = MUL(two, q2);
+    V _2q3 = MUL(two, q3);
+    V _4q0 = MUL(four, q0);
+    V _4q1 = MUL(four, q1);
+    V _4q2 = MUL(four, q2);
+    V _8q1 = MUL(eight, q1);
+    V _8q2 = MUL(eight, q2);
+    V q0q0 = MUL(q0, q0);
+    V q1q1 = MUL(q1, q1);
+    V q2q2 = MUL(q2, q2);
+    V q3q3 = MUL(q3, q3);
+
+    V s0 = SUB(ADD(ADD(MUL(_4q0, q2q2), MUL(_2q2, ax)), MUL(_4q0, q1q1)), MUL(_2q1, ay));
+    V s1 = ADD(ADD(ADD(SUB(SUB(ADD(SUB(MUL(_4q1, q3q3), MUL(_2q3, ax)), MUL(MUL(four, q0q0), q1)), MUL(_2q0, ay)), _4q1),
+                       MUL(_8q1, q1q1)), MUL(_8q1, q2q2)), MUL(_4q1, az));
+    V s2 = ADD(ADD(ADD(SUB(SUB(ADD(ADD(MUL(MUL(four, q0q0), q2), MUL(_2q0, ax)), MUL(_4q2, q3q3)), MUL(_2q3, ay)), _4q2),
+                       MUL(_8q2, q1q1)), MUL(_8q2, q2q2)), MUL(_4q2, az));
+    V s3 = SUB(ADD(SUB(MUL(MUL(four, q1q1), q3), MUL(_2q1, ax)), MUL(MUL(four, q2q2), q3)), MUL(_2q2, ay));
+
+    V stepNorm = SQRT(ADD(ADD(ADD(MUL(s0, s0), MUL(s1, s1)), MUL(s2, s2)), MUL(s3, s3)));
+    auto bCorrect = AND(GT(accelNorm, zero), GT(stepNorm, zero));
+    qDot0 = SELECT(bCorrect, SUB(qDot0, DIV(MUL(beta, s0), stepNorm)), qDot0);
+    qDot1 = SELECT(bCorrect, SUB(qDot1, DIV(MUL(beta, s1), stepNorm)), qDot1);
+    qDot2 = SELECT(bCorrect, SUB(qDot2, DIV(MUL(beta, s2), stepNorm)), qDot2);
+    qDot3 = SELECT(bCorrect, SUB(qDot3, DIV(MUL(beta, s3), stepNorm)), qDot3);
+
+    q0 = ADD(q0, MUL(qDot0, dt));
+    q1 = ADD(q1, MUL(qDot1, dt));
+    q2 = ADD(q2, MUL(qDot2, dt));
+    q3 = ADD(q3, MUL(qDot3, dt));
+
+    V norm = SQRT(ADD(ADD(ADD(MUL(q0, q0), MUL(q1, q1)), MUL(q2, q2)), MUL(q3, q3)));
+    auto bNormalize = GT(norm, zero);
+    STORE(pLanes->pQ0 + i, SELECT(bNormalize, DIV(q0, norm), q0));
+    STORE(pLanes->pQ1 + i, SELECT(bNormalize, DIV(q1, norm), q1));
+    STORE(pLanes->pQ2 + i, SELECT(bNormalize, DIV(q2, norm), q2));
+    STORE(pLanes->pQ3 + i, SELECT(bNormalize, DIV(q3, norm), q3));
+}
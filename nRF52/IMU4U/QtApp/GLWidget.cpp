@@ -1,43 +1,295 @@
 #include "GLWidget.h"
 
-#include <QPainter>
-#include <QPaintEvent>
-#include <QTimer>
+#include <algorithm>
+#include <cstddef>
 
-GLWidget::GLWidget(QWidget *parent) : QOpenGLWidget(parent)
+namespace
 {
-    QLinearGradient gradient(QPointF(50, -20), QPointF(80, 20));
-    gradient.setColorAt(0.0, Qt::white);
-    gradient.setColorAt(1.0, QColor(0xa6, 0xce, 0x39));
+    constexpr float  BOARD_HALF_LENGTH = 1.0f;    // Along the sensor's X axis
+    constexpr float  BOARD_HALF_WIDTH = 0.7f;     // Along Y
+    constexpr float  BOARD_HALF_THICKNESS = 0.1f; // Along Z
+    constexpr float  FIELD_OF_VIEW_DEGREES = 45.0f;
+    constexpr float  CAMERA_DISTANCE = 4.0f;
+    constexpr double FRAME_TIME_SMOOTHING = 0.05; // Weight of the newest frame in the frame time average
+    constexpr float  WATERFALL_FRACTION = 0.35f;  // Of the widget's height, at the bottom
+    constexpr float  WATERFALL_FLOOR_DB = -90.0f; // Levels drawn black
+    constexpr float  WATERFALL_CEILING_DB = -10.0f; // Levels drawn white
 
-    background = QBrush(QColor(0, 0, 0));
-    circleBrush = QBrush(gradient);
-    circlePen = QPen(Qt::black);
-    circlePen.setWidth(1);
-    textPen = QPen(Qt::white);
-    textFont.setPixelSize(50);
+    const char* VERTEX_SHADER =
+        "#version 330 core\n"
+        "layout(location = 0) in vec3 position;\n"
+        "layout(location = 1) in vec3 colour;\n"
+        "uniform mat4 mvp;\n"
+        "out vec3 fragmentColour;\n"
+        "void main()\n"
+        "{\n"
+        "    fragmentColour = colour;\n"
+        "    gl_Position = mvp * vec4(position, 1.0);\n"
+        "}\n";
 
-    m_Elapsed = 0;
-    setFixedSize(460, 400);
-    setAutoFillBackground(false);
+    const char* FRAGMENT_SHADER =
+        "#version 330 core\n"
+        "in vec3 fragmentColour;\n"
+        "out vec4 colour;\n"
+        "void main()\n"
+        "{\n"
+        "    colour = vec4(fragmentColour, 1.0);\n"
+        "}\n";
+
+    // A quad over the whole viewport from gl_VertexID, drawn as a 4 vertex strip
+    const char* WATERFALL_VERTEX_SHADER =
+        "#version 330 core\n"
+        "out vec2 position;\n"
+        "void main()\n"
+        "{\n"
+        "    position = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+        "    gl_Position = vec4(2.0 * position - 1.0, 0.0, 1.0);\n"
+        "}\n";
+
+    // Bins run left to right and groups top to bottom, each with its newest row at the top
+    const char* WATERFALL_FRAGMENT_SHADER =
+        "#version 330 core\n"
+        "in vec2 position;\n"
+        "uniform sampler2D levels;\n"
+        "uniform int newestRow;\n"
+        "uniform int rows;\n"
+        "uniform int groups;\n"
+        "uniform float floorDb;\n"
+        "uniform float rangeDb;\n"
+        "out vec4 colour;\n"
+        "void main()\n"
+        "{\n"
+        "    float down = (1.0 - position.y) * float(groups);\n"
+        "    int group = min(int(down), groups - 1);\n"
+        "    int age = min(int(fract(down) * float(rows)), rows - 1);\n"
+        "    int row = (newestRow - age + rows) % rows;\n"
+        "    int bin = min(int(position.x * float(textureSize(levels, 0).x)), textureSize(levels, 0).x - 1);\n"
+        "    float t = clamp((texelFetch(levels, ivec2(bin, group * rows + row), 0).r - floorDb) / rangeDb, 0.0, 1.0);\n"
+        "    colour = vec4(clamp(3.0 * t - 1.0, 0.0, 1.0), clamp(3.0 * t - 2.0, 0.0, 1.0),\n"
+        "                  clamp(3.0 * t, 0.0, 1.0) - clamp(3.0 * t - 1.0, 0.0, 1.0) + clamp(3.0 * t - 2.0, 0.0, 1.0), 1.0);\n"
+        "}\n";
+
+    struct Vertex
+    {
+        float Position[3];
+        float Colour[3];
+    };
+
+    // Appends the two triangles of one face of the board.  Corners are given anticlockwise
+    // seen from outside.
+    void AddFace(Vertex*& pVertex, const float (&Corners)[4][3], const float (&Colour)[3])
+    {
+        const int order[6] = { 0, 1, 2, 0, 2, 3 };
+        for(int index : order)
+        {
+            for(int i = 0; i < 3; ++i)
+            {
+                pVertex->Position[i] = Corners[index][i];
+                pVertex->Colour[i] = Colour[i];
+            }
+            ++pVertex;
+        }
+    }
+}
+
+GLWidget::GLWidget(QWidget *parent) : QOpenGLWidget(parent), m_VertexBuffer(QOpenGLBuffer::VertexBuffer)
+{
+    setFixedSize(460, 460);
+
+    // The sensor's Z axis points out of the top of the board, show that as up with X to
+    // the right and Y going into the screen
+    m_View.translate(0.0f, 0.0f, -CAMERA_DISTANCE);
+    m_View.rotate(30.0f, 1.0f, 0.0f, 0.0f);
+    m_View.rotate(-90.0f, 1.0f, 0.0f, 0.0f);
+}
+
+GLWidget::~GLWidget()
+{
+    makeCurrent();
+    m_VAO.destroy();
+    m_VertexBuffer.destroy();
+    m_WaterfallVAO.destroy();
+    if(m_WaterfallTexture != 0)
+    {
+        glDeleteTextures(1, &m_WaterfallTexture);
+    }
+    doneCurrent();
 }
 
-void GLWidget::Animate()
+void GLWidget::SetOrientation(const Quaternion& Orientation)
 {
-    m_Elapsed = (m_Elapsed + qobject_cast<QTimer*>(sender())->interval()) % 1000;
+    m_Orientation = QQuaternion(Orientation.W, Orientation.X, Orientation.Y, Orientation.Z);
     update();
 }
 
-void GLWidget::paintEvent(QPaintEvent *event)
+void GLWidget::AddSpectrum(const SpectrumAnalyzer::Spectrum& Spectrum)
+{
+    if(m_Levels.empty())
+    {
+        m_Bins = static_cast<int>(Spectrum.Bins);
+        m_Levels.assign(GROUP_COUNT * WATERFALL_ROWS * Spectrum.Bins, WATERFALL_FLOOR_DB);
+    }
+
+    m_NewestRow = (m_NewestRow + 1) % WATERFALL_ROWS;
+    for(int group = 0; group < GROUP_COUNT; ++group)
+    {
+        const float* pX = &Spectrum.LevelsDb[(group * 3) * Spectrum.Bins];
+        const float* pY = pX + Spectrum.Bins;
+        const float* pZ = pY + Spectrum.Bins;
+        float* pRow = &m_Levels[(group * WATERFALL_ROWS + m_NewestRow) * m_Bins];
+        for(int bin = 0; bin < m_Bins; ++bin)
+        {
+            pRow[bin] = std::max({ pX[bin], pY[bin], pZ[bin] });
+        }
+    }
+    m_RowsToUpload = std::min(m_RowsToUpload + 1, WATERFALL_ROWS);
+    update();
+}
+
+double GLWidget::FrameTimeMs() const
+{
+    return m_FrameTimeMs;
+}
+
+void GLWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER);
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER);
+    m_Program.link();
+    m_MVPLocation = m_Program.uniformLocation("mvp");
+
+    const float x = BOARD_HALF_LENGTH;
+    const float y = BOARD_HALF_WIDTH;
+    const float z = BOARD_HALF_THICKNESS;
+    const float top[4][3]    = { {-x, -y,  z}, { x, -y,  z}, { x,  y,  z}, {-x,  y,  z} };
+    const float bottom[4][3] = { {-x,  y, -z}, { x,  y, -z}, { x, -y, -z}, {-x, -y, -z} };
+    const float front[4][3]  = { { x, -y, -z}, { x,  y, -z}, { x,  y,  z}, { x, -y,  z} };
+    const float back[4][3]   = { {-x,  y, -z}, {-x, -y, -z}, {-x, -y,  z}, {-x,  y,  z} };
+    const float left[4][3]   = { {-x, -y, -z}, { x, -y, -z}, { x, -y,  z}, {-x, -y,  z} };
+    const float right[4][3]  = { { x,  y, -z}, {-x,  y, -z}, {-x,  y,  z}, { x,  y,  z} };
+    const float green[3] = { 0.65f, 0.81f, 0.22f };
+    const float grey[3]  = { 0.35f, 0.35f, 0.35f };
+    const float red[3]   = { 0.85f, 0.20f, 0.20f };
+    const float edge[3]  = { 0.55f, 0.55f, 0.55f };
+
+    Vertex vertices[6 * 6];
+    Vertex* pVertex = vertices;
+    AddFace(pVertex, top, green);
+    AddFace(pVertex, bottom, grey);
+    AddFace(pVertex, front, red);  // +X end, so the heading is easy to see
+    AddFace(pVertex, back, edge);
+    AddFace(pVertex, left, edge);
+    AddFace(pVertex, right, edge);
+    m_VertexCount = static_cast<int>(pVertex - vertices);
+
+    m_VAO.create();
+    m_VAO.bind();
+    m_VertexBuffer.create();
+    m_VertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    m_VertexBuffer.bind();
+    m_VertexBuffer.allocate(vertices, sizeof(vertices));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, Position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, Colour)));
+    m_VAO.release();
+    m_VertexBuffer.release();
+
+    m_WaterfallProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, WATERFALL_VERTEX_SHADER);
+    m_WaterfallProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, WATERFALL_FRAGMENT_SHADER);
+    m_WaterfallProgram.link();
+    m_NewestRowLocation = m_WaterfallProgram.uniformLocation("newestRow");
+    m_WaterfallProgram.bind();
+    m_WaterfallProgram.setUniformValue("levels", 0);
+    m_WaterfallProgram.setUniformValue("rows", WATERFALL_ROWS);
+    m_WaterfallProgram.setUniformValue("groups", GROUP_COUNT);
+    m_WaterfallProgram.setUniformValue("floorDb", WATERFALL_FLOOR_DB);
+    m_WaterfallProgram.setUniformValue("rangeDb", WATERFALL_CEILING_DB - WATERFALL_FLOOR_DB);
+    m_WaterfallProgram.release();
+    m_WaterfallVAO.create();
+
+    glEnable(GL_CULL_FACE);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    m_FrameTimer.start();
+}
+
+void GLWidget::resizeGL(int Width, int Height)
+{
+    int boardHeight = Height - static_cast<int>(Height * WATERFALL_FRACTION);
+    m_Projection.setToIdentity();
+    m_Projection.perspective(FIELD_OF_VIEW_DEGREES, static_cast<float>(Width) / (boardHeight > 0 ? boardHeight : 1), 0.1f, 100.0f);
+}
+
+// Makes the texture the first time there's a spectrum, then only sends the rows added since
+void GLWidget::UploadSpectra()
 {
-    QPainter painter;
-    painter.begin(this);
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.fillRect(event->rect(), background);
-    painter.translate(100, 100);
-    painter.setPen(textPen);
-    painter.setFont(textFont);
-    painter.drawText(QRect(45, 25, 200, 75), Qt::AlignCenter, QStringLiteral("OpenGL"));
-    painter.drawText(QRect(45, 75, 200, 80), Qt::AlignCenter, QStringLiteral("Display"));
-    painter.end();
+    glActiveTexture(GL_TEXTURE0);
+    if(m_TextureBins == 0)
+    {
+        glGenTextures(1, &m_WaterfallTexture);
+        glBindTexture(GL_TEXTURE_2D, m_WaterfallTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_Bins, GROUP_COUNT * WATERFALL_ROWS, 0, GL_RED, GL_FLOAT, m_Levels.data());
+        m_TextureBins = m_Bins;
+        m_RowsToUpload = 0;
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, m_WaterfallTexture);
+    for(; m_RowsToUpload > 0; --m_RowsToUpload)
+    {
+        int row = (m_NewestRow - m_RowsToUpload + 1 + WATERFALL_ROWS) % WATERFALL_ROWS;
+        for(int group = 0; group < GROUP_COUNT; ++group)
+        {
+            int y = group * WATERFALL_ROWS + row;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, m_Bins, 1, GL_RED, GL_FLOAT, &m_Levels[y * m_Bins]);
+        }
+    }
+}
+
+void GLWidget::paintGL()
+{
+    double frameMs = m_FrameTimer.nsecsElapsed() / 1.0e6;
+    m_FrameTimer.restart();
+    m_FrameTimeMs += FRAME_TIME_SMOOTHING * (frameMs - m_FrameTimeMs);
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    int pixelWidth = static_cast<int>(width() * devicePixelRatioF());
+    int pixelHeight = static_cast<int>(height() * devicePixelRatioF());
+    int waterfallHeight = static_cast<int>(pixelHeight * WATERFALL_FRACTION);
+
+    QMatrix4x4 model;
+    model.rotate(m_Orientation);
+
+    glViewport(0, waterfallHeight, pixelWidth, pixelHeight - waterfallHeight);
+    glEnable(GL_DEPTH_TEST);
+    m_Program.bind();
+    m_Program.setUniformValue(m_MVPLocation, m_Projection * m_View * model);
+    m_VAO.bind();
+    glDrawArrays(GL_TRIANGLES, 0, m_VertexCount);
+    m_VAO.release();
+    m_Program.release();
+
+    if(m_Levels.empty())
+    {
+        return;
+    }
+    UploadSpectra();
+
+    glViewport(0, 0, pixelWidth, waterfallHeight);
+    glDisable(GL_DEPTH_TEST);
+    m_WaterfallProgram.bind();
+    m_WaterfallProgram.setUniformValue(m_NewestRowLocation, m_NewestRow);
+    m_WaterfallVAO.bind();
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    m_WaterfallVAO.release();
+    m_WaterfallProgram.release();
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
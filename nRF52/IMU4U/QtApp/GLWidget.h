@@ -1,29 +1,72 @@
 #pragma once
 
-#include <QBrush>
-#include <QFont>
-#include <QPen>
-#include <QWidget>
+#include <QElapsedTimer>
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
 #include <QOpenGLWidget>
+#include <QQuaternion>
+#include <vector>
+#include "Quaternion.h"
+#include "SpectrumAnalyzer.h"
 
-class GLWidget : public QOpenGLWidget
+// Draws the IMU4U board turned to the latest orientation, with a waterfall of vibration
+// spectra underneath: accel, gyro and mag stacked top to bottom, each the loudest of its
+// three axes in every bin, newest spectrum at the top.  The waterfall is a float texture
+// with one row per spectrum written over the oldest, and the fragment shader reads the
+// rows back in order and colours them by level, so a new spectrum only uploads its own
+// rows.  Needs a 3.3 core profile context (see main.cpp).  Only redraws when given a new
+// orientation or spectrum, and Qt merges several of those into one frame.  Nothing is
+// allocated per frame.
+class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
     Q_OBJECT
 
     public:
         GLWidget(QWidget *parent);
+        ~GLWidget();
 
-    public slots:
-        void Animate();
+        static constexpr int GROUP_COUNT = 3;         // Accel, gyro, mag
+        static constexpr int WATERFALL_ROWS = 128;    // Spectra shown
+
+        // Device orientation, in the sensor's axes
+        void SetOrientation(const Quaternion& Orientation);
+
+        // Every spectrum should have the same number of bins
+        void AddSpectrum(const SpectrumAnalyzer::Spectrum& Spectrum);
+
+        // Smoothed time between frames
+        double FrameTimeMs() const;
 
     protected:
-        void paintEvent(QPaintEvent *event) override;
+        void initializeGL() override;
+        void resizeGL(int Width, int Height) override;
+        void paintGL() override;
 
     private:
-        int m_Elapsed;
-        QBrush background;
-        QBrush circleBrush;
-        QFont textFont;
-        QPen circlePen;
-        QPen textPen;
+        void UploadSpectra();
+
+        QOpenGLShaderProgram     m_Program;
+        QOpenGLBuffer            m_VertexBuffer;
+        QOpenGLVertexArrayObject m_VAO;
+        int                      m_MVPLocation = -1;
+        int                      m_VertexCount = 0;
+        QMatrix4x4               m_Projection;
+        QMatrix4x4               m_View;
+        QQuaternion              m_Orientation;
+        QElapsedTimer            m_FrameTimer;
+        double                   m_FrameTimeMs = 0.0;
+
+        // Waterfall
+        QOpenGLShaderProgram     m_WaterfallProgram;
+        QOpenGLVertexArrayObject m_WaterfallVAO;      // Empty, the shader makes its own corners
+        GLuint                   m_WaterfallTexture = 0;
+        int                      m_NewestRowLocation = -1;
+        int                      m_Bins = 0;
+        int                      m_TextureBins = 0;   // 0 until the texture is made
+        std::vector<float>       m_Levels;            // What the texture should hold, GROUP_COUNT blocks of WATERFALL_ROWS rows of m_Bins
+        int                      m_NewestRow = WATERFALL_ROWS - 1;
+        int                      m_RowsToUpload = 0;
 };
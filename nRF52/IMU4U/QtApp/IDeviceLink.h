@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <QByteArray>
+
+// The link to an IMU4U, real or otherwise.  Characteristics are identified by their 16
+// bit UUIDs (see IMU4UService.h).  All calls and callbacks happen on the thread that
+// created the link.
+class IDeviceLink
+{
+    public:
+        struct Callbacks
+        {
+            std::function<void()> Connected;   // The service's characteristics are ready to use
+            std::function<void()> Disconnected;
+            std::function<void()> ConnectFailed;   // Never got as far as Connected
+            std::function<void(uint16_t Characteristic, const QByteArray& Value)> Notification;
+        };
+
+        virtual ~IDeviceLink() = default;
+
+        virtual void SetCallbacks(const Callbacks& Callbacks) = 0;
+
+        // Connects to the device the link was made for.  Called again after Disconnected
+        // or ConnectFailed to reconnect.
+        virtual void Connect() = 0;
+
+        virtual void Subscribe(uint16_t Characteristic) = 0;
+        virtual void Write(uint16_t Characteristic, const QByteArray& Value) = 0;
+};
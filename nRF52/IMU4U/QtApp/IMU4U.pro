@@ -1,9 +1,69 @@
 QT          += widgets bluetooth
 
-HEADERS     = GLWidget.h \
+HEADERS     = BluetoothDeviceLink.h \
+              BluetoothScanner.h \
+              CaptureFile.h \
+              ClockEstimator.h \
+              ConnectionSupervisor.h \
+              DeviceCache.h \
+              FFTKernel.inl \
+              FusionEngine.h \
+              FusionKernel.inl \
+              GLWidget.h \
+              IDeviceLink.h \
+              IMU4UService.h \
+              IMUData.h \
+              MadgwickFilter.h \
               NordicCentral.h \
-              Window.h
-SOURCES     = GLWidget.cpp \
+              ProcessingStages.h \
+              Quaternion.h \
+              RealFFT.h \
+              ReplaySource.h \
+              SPSCRing.h \
+              SampleArchive.h \
+              SampleCodec.h \
+              SampleMerger.h \
+              SamplePublisher.h \
+              SampleServer.h \
+              SensorResampler.h \
+              SharedSampleRing.h \
+              SimdSupport.h \
+              SimulatedDeviceLink.h \
+              SpectrumAnalyzer.h \
+              StageGraph.h \
+              StreamDecoder.h \
+              StripChartWidget.h \
+              UnitConverter.h \
+              Window.h \
+              WorkStealingPool.h
+SOURCES     = BluetoothDeviceLink.cpp \
+              BluetoothScanner.cpp \
+              CaptureFile.cpp \
+              ClockEstimator.cpp \
+              ConnectionSupervisor.cpp \
+              DeviceCache.cpp \
+              FusionEngine.cpp \
+              GLWidget.cpp \
+              MadgwickFilter.cpp \
               main.cpp \
               NordicCentral.cpp \
-              Window.cpp
+              ProcessingStages.cpp \
+              RealFFT.cpp \
+              ReplaySource.cpp \
+              SampleArchive.cpp \
+              SampleCodec.cpp \
+              SampleMerger.cpp \
+              SamplePublisher.cpp \
+              SampleServer.cpp \
+              SensorResampler.cpp \
+              SimdSupport.cpp \
+              SimulatedDeviceLink.cpp \
+              SpectrumAnalyzer.cpp \
+              StageGraph.cpp \
+              StreamDecoder.cpp \
+              StripChartWidget.cpp \
+              UnitConverter.cpp \
+              Window.cpp \
+              WorkStealingPool.cpp
+
+unix:!macx:LIBS += -lrt
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+// The IMU4U's GATT service (see Firmware/main.c), shared by the device links
+
+constexpr char DEVICE_NAME[] = "TMD_IMU4U";                   // What the IMU4U advertises itself as
+
+constexpr uint16_t NORDIC_BLINKY_SERVICE_UUID = 0x1523;       // Blinky service UUID
+constexpr uint16_t NORDIC_BLINKY_BUTTON_CHAR_UUID = 0x1524;   // Button characteristic UUID
+constexpr uint16_t NORDIC_BLINKY_LED_CHAR_UUID = 0x1525;      // LED characteristic UUID
+constexpr uint16_t NORDIC_BLINKY_IMU_CHAR_UUID = 0x1526;      // IMU characteristic UUID
+constexpr uint16_t NORDIC_BLINKY_CONTROL_CHAR_UUID = 0x1527;  // Control characteristic UUID
+constexpr uint16_t NORDIC_BLINKY_RECORD_CHAR_UUID = 0x1528;   // Record data characteristic UUID
+
+constexpr char CONTROL_OP_RECORD_START = 0x01;                // Control characteristic opcodes
+constexpr char CONTROL_OP_RECORD_STOP = 0x02;
+constexpr char CONTROL_OP_RECORD_ERASE = 0x03;
+constexpr char CONTROL_OP_DOWNLOAD_START = 0x04;
+constexpr char CONTROL_OP_DOWNLOAD_STOP = 0x05;
+constexpr char CONTROL_OP_SYNC = 0x08;                        // Followed by a token, answered with a PACKET_TYPE::SYNC
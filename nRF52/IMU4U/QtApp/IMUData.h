@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// These mirror the layouts in Firmware/IMU.h
+
+typedef struct ThreeDimData
+{
+    int16_t X;
+    int16_t Y;
+    int16_t Z;
+} ThreeDimData;
+
+typedef struct IMUData
+{
+    ThreeDimData Mag;
+    ThreeDimData Accel;
+    ThreeDimData Gyro;
+    uint8_t MagStatus;
+    uint8_t AccelStatus;
+    uint8_t GyroStatus;
+    uint8_t ErrorStatus;
+} IMUData;
+
+// An IMU reading along with the device's RTC time stamps (32768 ticks per second) of
+// when each sensor was read
+typedef struct IMUSample
+{
+    uint32_t AccelMagTime;
+    uint32_t GyroTime;
+    IMUData  Data;
+} IMUSample;
@@ -0,0 +1,73 @@
+#include "MadgwickFilter.h"
+
+MadgwickFilter::MadgwickFilter(float Beta) : m_Beta(Beta)
+{
+}
+
+void MadgwickFilter::Update(float GyroX, float GyroY, float GyroZ, float AccelX, float AccelY, float AccelZ, float Dt)
+{
+    float q0 = m_Q.W;
+    float q1 = m_Q.X;
+    float q2 = m_Q.Y;
+    float q3 = m_Q.Z;
+
+    // Rate of change of the quaternion from the gyro
+    float qDot0 = 0.5f * (-q1 * GyroX - q2 * GyroY - q3 * GyroZ);
+    float qDot1 = 0.5f * ( q0 * GyroX + q2 * GyroZ - q3 * GyroY);
+    float qDot2 = 0.5f * ( q0 * GyroY - q1 * GyroZ + q3 * GyroX);
+    float qDot3 = 0.5f * ( q0 * GyroZ + q1 * GyroY - q2 * GyroX);
+
+    // Without a usable accelerometer reading (e.g. free fall) all we can do is integrate
+    float accelNorm = std::sqrt(AccelX * AccelX + AccelY * AccelY + AccelZ * AccelZ);
+    if(accelNorm > 0.0f)
+    {
+        AccelX /= accelNorm;
+        AccelY /= accelNorm;
+        AccelZ /= accelNorm;
+
+        // Gradient of the error between the measured and estimated gravity directions
+        float _2q0 = 2.0f * q0;
+        float _2q1 = 2.0f * q1;
+        float _2q2 = 2.0f * q2;
+        float _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0;
+        float _4q1 = 4.0f * q1;
+        float _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1;
+        float _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0;
+        float q1q1 = q1 * q1;
+        float q2q2 = q2 * q2;
+        float q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * AccelX + _4q0 * q1q1 - _2q1 * AccelY;
+        float s1 = _4q1 * q3q3 - _2q3 * AccelX + 4.0f * q0q0 * q1 - _2q0 * AccelY - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * AccelZ;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * AccelX + _4q2 * q3q3 - _2q3 * AccelY - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * AccelZ;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * AccelX + 4.0f * q2q2 * q3 - _2q2 * AccelY;
+
+        float stepNorm = std::sqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+        if(stepNorm > 0.0f)
+        {
+            qDot0 -= m_Beta * s0 / stepNorm;
+            qDot1 -= m_Beta * s1 / stepNorm;
+            qDot2 -= m_Beta * s2 / stepNorm;
+            qDot3 -= m_Beta * s3 / stepNorm;
+        }
+    }
+
+    m_Q.W = q0 + qDot0 * Dt;
+    m_Q.X = q1 + qDot1 * Dt;
+    m_Q.Y = q2 + qDot2 * Dt;
+    m_Q.Z = q3 + qDot3 * Dt;
+    m_Q.Normalize();
+}
+
+void MadgwickFilter::Reset()
+{
+    m_Q = Quaternion();
+}
+
+const Quaternion& MadgwickFilter::Orientation() const
+{
+    return m_Q;
+}
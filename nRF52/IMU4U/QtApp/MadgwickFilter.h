@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Quaternion.h"
+
+// Madgwick's gradient descent orientation filter (S. Madgwick, "An efficient orientation
+// filter for inertial and inertial/magnetic sensor arrays", 2010), IMU form.  Gyro rates
+// are integrated and the drift corrected towards the gravity vector seen by the
+// accelerometer.  Heading drifts slowly since the magnetometer isn't used; the FXOS8700's
+// mag isn't calibrated or aligned with the gyro's axes.
+class MadgwickFilter
+{
+    public:
+        static constexpr float DEFAULT_BETA = 0.1f;
+
+        // Beta trades gyro drift correction against accelerometer noise
+        explicit MadgwickFilter(float Beta = DEFAULT_BETA);
+
+        // Gyro in radians per second, accel in any unit, Dt in seconds
+        void Update(float GyroX, float GyroY, float GyroZ, float AccelX, float AccelY, float AccelZ, float Dt);
+        void Reset();
+
+        const Quaternion& Orientation() const;
+
+    private:
+        float      m_Beta;
+        Quaternion m_Q;
+};
@@ -1,236 +1,720 @@
 #include "NordicCentral.h"
-#include <string>
+#include "BluetoothDeviceLink.h"
+#include "IMU4UService.h"
 
 namespace
 {
-    const char*            DEVICE_NAME = "TMD_IMU4U";               // Name of the BLE device we want to connect to
-    constexpr int          BLE_SCAN_TIMEOUT_MS = 5000;              // Scan timeout in milliseconds
     constexpr int          TIMER_MS = 1000;                         // TimerEvent() called every TIMER_MS milliseconds
     constexpr unsigned int LED_TOGGLE_TIME_SEC  = 2;                // Toggle the LED this frequently
-    constexpr unsigned int NORDIC_BLINKY_SERVICE_UUID = 0x1523;     // Blinky service UUID
-    constexpr unsigned int NORDIC_BLINKY_BUTTON_CHAR_UUID = 0x1524; // Button characteristic UUID
-    constexpr unsigned int NORDIC_BLINKY_LED_CHAR_UUID = 0x1525;    // LED characteristic UUID
-    constexpr unsigned int NORDIC_BLINKY_IMU_CHAR_UUID = 0x1526;    // IMU characteristic UUID
+    constexpr int          RECORD_OFFSET_SIZE = 4;                  // Each record data notification starts with its packet type and stream offset
+    constexpr int          RECORD_HEADER_SIZE = 1 + RECORD_OFFSET_SIZE;
+    constexpr uint16_t     DOWNLOAD_DEVICE = 0;                     // Recordings are downloaded from this device
+    constexpr uint64_t     DOWNLOAD_TIMEOUT_NS = 3000000000;        // Ask again if a download has been quiet this long
+    constexpr uint64_t     MERGE_DELAY_NS = 100000000;              // Longest a quiet device holds up the others' samples
+    constexpr int          SYNC_REPLY_SIZE = 6;                     // Packet type, token and 32 bit time stamp
 }
 
-void NordicCentral::Start()
+NordicCentral::NordicCentral() : m_Merger(MAX_DEVICES, MERGE_DELAY_NS, DEVICE_RING_SIZE, SampleMerger::LATE_POLICY::EMIT)
 {
-    StartTimer();
-    StartDicoveryAgent();
+    m_HostClock.start();
 }
 
-bool NordicCentral::Connected()
+NordicCentral::~NordicCentral()
 {
-    return m_bConnected;
+    m_ReplaySource.Stop();
+    m_Thread.quit();
+    m_Thread.wait();
 }
 
-bool NordicCentral::ButtonPressed()
+void NordicCentral::Start(const QStringList& Patterns, int MaxDevices)
 {
-    return m_bButtonPressed;
+    m_StartNs = static_cast<uint64_t>(m_HostClock.nsecsElapsed());
+    StartThread();
+    QMetaObject::invokeMethod(this, [this, Patterns, MaxDevices]()
+    {
+        // Remembered devices don't need finding, so they're connected to by address first
+        QSet<QString> remembered;
+        for(const auto& entry : m_DeviceCache.Entries())
+        {
+            if(MaxDevices > 0 && remembered.size() >= MaxDevices)
+            {
+                break;
+            }
+            if(BluetoothScanner::Matches(Patterns, entry.Name, entry.Id))
+            {
+                remembered.insert(entry.Id);
+                AddBluetoothLink(entry.DeviceInfo());
+            }
+        }
+
+        // Each device is connected to as soon as it's found, without waiting for the scan
+        // or for the devices found before it
+        m_pScanner = new BluetoothScanner(this);
+        if(MaxDevices == 0 || remembered.size() < MaxDevices)
+        {
+            m_pScanner->Start(Patterns, MaxDevices == 0 ? 0 : MaxDevices - remembered.size(),
+                              [this](const QBluetoothDeviceInfo& Info) { AddBluetoothLink(Info); }, remembered, [this]() { Rescan(); });
+        }
+    });
 }
 
-NordicCentral::LED_STATE NordicCentral::LEDState()
+void NordicCentral::ForgetDevices()
 {
-    return m_LEDState;
+    m_DeviceCache.Clear();
 }
 
-const IMUData& NordicCentral::IMUData()
+void NordicCentral::StartSimulated(const SimulatedDeviceLink::Settings& Settings, int DeviceCount)
 {
-    return m_IMUData;
+    m_StartNs = static_cast<uint64_t>(m_HostClock.nsecsElapsed());
+    StartThread();
+    QMetaObject::invokeMethod(this, [this, Settings, DeviceCount]()
+    {
+        for(int i = 0; i < DeviceCount; ++i)
+        {
+            SimulatedDeviceLink::Settings settings = Settings;
+            settings.Seed += i;   // So they don't all lose the same packets
+            AddLink(QString("Simulated %1").arg(i), new SimulatedDeviceLink(settings, this));
+        }
+    });
 }
 
-void NordicCentral::StartTimer()
+// The links are created on m_Thread so their timers and sockets belong to it
+void NordicCentral::StartThread()
 {
-    connect(&m_timer, &QTimer::timeout, this, &NordicCentral::TimerEvent);
-    m_timer.start(TIMER_MS);
+    moveToThread(&m_Thread);
+    m_Thread.start();
+    QMetaObject::invokeMethod(this, [this]() { StartTimer(); });
+}
+
+NordicCentral::DeviceState* NordicCentral::AddDevice(const QString& Name)
+{
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    if(m_Devices.size() >= MAX_DEVICES)
+    {
+        return nullptr;
+    }
+
+    m_Devices.push_back(std::make_unique<DeviceState>());
+    DeviceState* pDevice = m_Devices.back().get();
+    pDevice->Id = static_cast<uint16_t>(m_Devices.size() - 1);
+    pDevice->Name = Name;
+
+    // Seeded differently, so devices that drop together don't retry together
+    pDevice->Supervisor = ConnectionSupervisor(static_cast<uint32_t>(m_HostClock.nsecsElapsed()) + pDevice->Id);
+    return pDevice;
+}
+
+// A replayed capture can hold devices we haven't seen yet
+NordicCentral::DeviceState* NordicCentral::FindDevice(uint16_t Id)
+{
+    if(Id >= MAX_DEVICES)
+    {
+        return nullptr;
+    }
+    while(m_Devices.size() <= Id)
+    {
+        AddDevice(QString("Replayed %1").arg(m_Devices.size()));
+    }
+    return m_Devices[Id].get();
 }
 
-void NordicCentral::StartDicoveryAgent()
+void NordicCentral::AddLink(const QString& Name, IDeviceLink* pLink)
 {
-    m_deviceDiscoveryAgent = std::make_unique<QBluetoothDeviceDiscoveryAgent>(this);
-    m_deviceDiscoveryAgent->setLowEnergyDiscoveryTimeout(BLE_SCAN_TIMEOUT_MS);
-    connect(m_deviceDiscoveryAgent.get(), &QBluetoothDeviceDiscoveryAgent::deviceDiscovered, this, &NordicCentral::DeviceDiscovered);
-    connect(m_deviceDiscoveryAgent.get(), static_cast<void (QBluetoothDeviceDiscoveryAgent::*)
-            (QBluetoothDeviceDiscoveryAgent::Error)>(&QBluetoothDeviceDiscoveryAgent::error), this, &NordicCentral::ScanError);
-    connect(m_deviceDiscoveryAgent.get(), &QBluetoothDeviceDiscoveryAgent::finished, this, &NordicCentral::ScanFinished);
-    connect(m_deviceDiscoveryAgent.get(), &QBluetoothDeviceDiscoveryAgent::canceled, this, &NordicCentral::ScanCancelled);
-    m_deviceDiscoveryAgent->start(QBluetoothDeviceDiscoveryAgent::DiscoveryMethod::LowEnergyMethod);
+    DeviceState* pDevice = AddDevice(Name);
+    if(!pDevice)
+    {
+        delete pLink;
+        return;
+    }
+
+    AttachLink(*pDevice, pLink);
 }
 
-void NordicCentral::CreateController()
+void NordicCentral::AttachLink(DeviceState& Device, IDeviceLink* pLink)
 {
-    // Make connections
-    //! [Connect-Signals-1]
-    m_controller = QLowEnergyController::createCentral(m_device, this);
-    //! [Connect-Signals-1]
-    m_controller->setRemoteAddressType(QLowEnergyController::PublicAddress);
+    Device.pLink = pLink;
 
-    //! [Connect-Signals-2]
-    connect(m_controller, &QLowEnergyController::serviceDiscovered, this, &NordicCentral::ServiceDiscovered);
-    connect(m_controller, &QLowEnergyController::discoveryFinished, this, &NordicCentral::ServiceScanDone);
-    connect(m_controller, &QLowEnergyController::connectionUpdated, this, &NordicCentral::ConnectionUpdated);
+    IDeviceLink::Callbacks callbacks;
+    callbacks.Connected = [this, &Device]() { LinkConnected(Device); };
+    callbacks.Disconnected = [this, &Device]() { LinkDisconnected(Device); };
+    callbacks.ConnectFailed = [this, &Device]() { LinkFailed(Device); };
+    callbacks.Notification = [this, &Device](uint16_t Characteristic, const QByteArray& Value) { NordicBlinkyCharChange(Device, Characteristic, Value); };
+    pLink->SetCallbacks(callbacks);
+    Device.Supervisor.Connecting();
+    pLink->Connect();
+}
+
+void NordicCentral::AddBluetoothLink(const QBluetoothDeviceInfo& Info)
+{
+    AddLink(BluetoothScanner::DeviceId(Info), new BluetoothDeviceLink(Info, m_DeviceCache, this));
+}
 
-    connect(m_controller, static_cast<void (QLowEnergyController::*)(QLowEnergyController::Error)>(&QLowEnergyController::error),
-            this, [](QLowEnergyController::Error)
+// Scans for the remembered devices that couldn't be reached, giving each the link made
+// from what the scan finds.  Only one scan runs at a time, so any that fail during this
+// one are left for the next.
+void NordicCentral::Rescan()
+{
+    if(m_Rescan.isEmpty() || m_pScanner->Scanning())
     {
-        // For debugging
-    });
+        return;
+    }
 
-    connect(m_controller, &QLowEnergyController::connected, this, [this]()
+    QStringList ids;
+    ids.swap(m_Rescan);
+    m_pScanner->Start(ids, ids.size(), [this](const QBluetoothDeviceInfo& Info)
     {
-        m_bConnected = true;
-        m_controller->discoverServices();
+        for(const auto& pDevice : m_Devices)
+        {
+            if(!pDevice->pLink && pDevice->Name == BluetoothScanner::DeviceId(Info))
+            {
+                AttachLink(*pDevice, new BluetoothDeviceLink(Info, m_DeviceCache, this));
+            }
+        }
+    }, QSet<QString>(), [this, ids]()
+    {
+        // Those it didn't find are looked for again later
+        for(const auto& pDevice : m_Devices)
+        {
+            if(!pDevice->pLink && ids.contains(pDevice->Name))
+            {
+                ScheduleReconnect(*pDevice);
+            }
+        }
+        Rescan();
     });
+}
+
+bool NordicCentral::StartReplay(const QString& FileName, double Speed, std::function<void()> OnFinished)
+{
+    StartThread();
+    m_bReplayFinished = false;
 
-    connect(m_controller, &QLowEnergyController::disconnected, this, [this]()
+    // Everything is timed as when it was captured, whatever the replay speed
+    auto onPayload = [this](uint64_t TimeNs, uint16_t Device, uint16_t Characteristic, const uint8_t* pPayload, size_t Size)
     {
-        m_bConnected = false;
-    });
+        DeviceState* pDevice = FindDevice(Device);
+        if(pDevice)
+        {
+            PayloadReceived(*pDevice, Characteristic, QByteArray::fromRawData(reinterpret_cast<const char*>(pPayload), static_cast<int>(Size)), TimeNs);
+        }
+    };
+    auto onFinished = [this, OnFinished]()
+    {
+        m_bReplayFinished = true;
+        emit SamplesArrived();   // The rest of the merge can go now
+        if(OnFinished)
+        {
+            OnFinished();
+        }
+    };
+    return m_ReplaySource.Start(FileName.toStdString(), Speed, onPayload, onFinished);
+}
+
+bool NordicCentral::CaptureTo(const QString& FileName)
+{
+    return m_CaptureWriter.Open(FileName.toStdString());
+}
+
+
+bool NordicCentral::ArchiveTo(const QString& FileName)
+{
+    return m_ArchiveWriter.Open(FileName.toStdString());
+}
+
+bool NordicCentral::PublishTo(const QString& Name)
+{
+    return m_Publisher.Open(Name.toStdString());
+}
+
+bool NordicCentral::ServeOn(uint16_t Port, bool bLan)
+{
+    return m_Server.Open(Port, bLan);
+}
 
-    connect(m_controller, &QLowEnergyController::stateChanged, this, []()
+bool NordicCentral::Connected()
+{
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    for(const auto& pDevice : m_Devices)
     {
-        // For debugging
-    });
+        if(pDevice->bConnected)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-    // Connect
-    m_controller->connectToDevice();
-    //! [Connect-Signals-2]
+bool NordicCentral::ButtonPressed()
+{
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    for(const auto& pDevice : m_Devices)
+    {
+        if(pDevice->bButtonPressed)
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
-void NordicCentral::DeviceDiscovered(const QBluetoothDeviceInfo& Device)
+NordicCentral::LED_STATE NordicCentral::LEDState()
 {
-    std::string DeviceName = Device.name().toLocal8Bit().data();
-    if(DeviceName == std::string(DEVICE_NAME))
+    return m_LEDState;
+}
+
+size_t NordicCentral::ReadSamples(MergedSample* pSamples, size_t MaxCount)
+{
+    // Cleared first, so anything pushed from here on is signalled again
+    m_bSamplesSignalled = false;
+
+    // Nothing more is coming once a replay has finished, so there's no need to wait for it
+    return m_Merger.Pop(pSamples, MaxCount, m_bReplayFinished);
+}
+
+uint64_t NordicCentral::SamplesReceived()
+{
+    return m_SamplesReceived;
+}
+
+uint64_t NordicCentral::SamplesDropped()
+{
+    return m_SamplesDropped;
+}
+
+uint64_t NordicCentral::SamplesLate()
+{
+    return m_Merger.SamplesLate();
+}
+
+uint64_t NordicCentral::PacketsLost()
+{
+    uint64_t lost = 0;
+    for(const auto& device : Devices())
     {
-        m_device = Device;
-        m_deviceDiscoveryAgent->stop();
-        CreateController();
+        lost += device.PacketsLost;
     }
+    return lost;
 }
 
-void NordicCentral::ServiceDiscovered(const QBluetoothUuid &gatt)
+uint64_t NordicCentral::PacketsMalformed()
 {
-    if(gatt.data1 == NORDIC_BLINKY_SERVICE_UUID)
+    uint64_t malformed = 0;
+    for(const auto& device : Devices())
     {
-        m_gatt = gatt;
-        m_bGattFound = true;
+        malformed += device.PacketsMalformed;
     }
+    return malformed;
 }
 
-void NordicCentral::ServiceScanDone()
+std::vector<NordicCentral::DeviceStatus> NordicCentral::Devices()
 {
-    if(m_bGattFound)
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    std::vector<DeviceStatus> devices;
+    for(const auto& pDevice : m_Devices)
     {
-        m_service = m_controller->createServiceObject(m_gatt, this);
-        if(m_service)
+        DeviceStatus status;
+        status.Id = pDevice->Id;
+        status.Name = pDevice->Name;
+        status.bConnected = pDevice->bConnected;
+        status.SamplesReceived = pDevice->SamplesReceived;
+        status.SampleRate = pDevice->SampleRate;
+        status.PacketsLost = pDevice->PacketsLost;
+        status.PacketsMalformed = pDevice->PacketsMalformed;
+        status.bClockSynced = pDevice->bClockSynced;
+        status.ClockOffsetNs = pDevice->ClockOffsetNs;
+        status.ClockSkewPpm = pDevice->ClockSkewPpm;
+        status.ClockResidualNs = pDevice->ClockResidualNs;
+        status.FirstSampleMs = pDevice->FirstSampleMs;
+        status.bReconnecting = pDevice->bReconnecting;
+        status.ReconnectAttempts = pDevice->ReconnectAttempts;
+        status.Outages = pDevice->Outages;
+        status.LastOutageMs = pDevice->LastOutageMs;
+        status.TotalOutageMs = pDevice->TotalOutageMs;
+        status.SamplesLostInOutages = pDevice->SamplesLostInOutages;
+        devices.push_back(status);
+    }
+    return devices;
+}
+
+// The device links belong to m_Thread, so requests from the GUI are queued over to it
+
+void NordicCentral::StartRecording()
+{
+    QMetaObject::invokeMethod(this, [this]() { BroadcastControl(QByteArray(1, CONTROL_OP_RECORD_START)); });
+}
+
+void NordicCentral::StopRecording()
+{
+    QMetaObject::invokeMethod(this, [this]() { BroadcastControl(QByteArray(1, CONTROL_OP_RECORD_STOP)); });
+}
+
+void NordicCentral::EraseRecording()
+{
+    QMetaObject::invokeMethod(this, [this]() { BroadcastControl(QByteArray(1, CONTROL_OP_RECORD_ERASE)); });
+}
+
+void NordicCentral::DownloadRecording(const QString& FileName)
+{
+    if(QThread::currentThread() != &m_Thread)
+    {
+        QMetaObject::invokeMethod(this, [this, FileName]() { DownloadRecording(FileName); });
+        return;
+    }
+
+    m_DownloadFile.close();
+    m_DownloadFile.setFileName(FileName);
+    if(!m_DownloadFile.open(QIODevice::ReadWrite))
+    {
+        return;
+    }
+
+    // Whatever is already in the file was downloaded earlier, so carry on from there
+    m_DownloadOffset = m_DownloadFile.size();
+    m_DownloadFile.seek(m_DownloadOffset);
+    m_bDownloading = true;
+    RequestDownload();
+}
+
+bool NordicCentral::Downloading()
+{
+    return m_bDownloading;
+}
+
+qint64 NordicCentral::DownloadedBytes()
+{
+    return m_DownloadOffset;
+}
+
+// Captured along with the notifications, so a replay can pair sync requests with replies
+void NordicCentral::WriteControl(DeviceState& Device, const QByteArray& Command)
+{
+    if(Device.bConnected)
+    {
+        if(m_CaptureWriter.IsOpen())
         {
-            connect(m_service, &QLowEnergyService::stateChanged, this, &NordicCentral::ServiceStateChanged);
-            connect(m_service, &QLowEnergyService::characteristicChanged, this, &NordicCentral::NordicBlinkyCharChange);
-            connect(m_service, &QLowEnergyService::descriptorWritten, this, &NordicCentral::ConfirmedDescriptorWrite);
-            m_service->discoverDetails();
+            m_CaptureWriter.Write(static_cast<uint64_t>(m_HostClock.nsecsElapsed()), Device.Id, NORDIC_BLINKY_CONTROL_CHAR_UUID,
+                                  reinterpret_cast<const uint8_t*>(Command.constData()), Command.size());
         }
+        Device.pLink->Write(NORDIC_BLINKY_CONTROL_CHAR_UUID, Command);
     }
 }
 
-void NordicCentral::ConnectionUpdated()
+void NordicCentral::BroadcastControl(const QByteArray& Command)
 {
-    // For debugging
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    for(const auto& pDevice : m_Devices)
+    {
+        WriteControl(*pDevice, Command);
+    }
 }
 
-void NordicCentral::SetError(const QString&)
+void NordicCentral::RequestSync(DeviceState& Device)
 {
-    // For debugging
+    if(!Device.bConnected)
+    {
+        return;
+    }
+
+    // A new token each time, so a late reply to an earlier request isn't taken for this one
+    QByteArray command(1, CONTROL_OP_SYNC);
+    command.append(static_cast<char>(Device.SyncToken + 1));
+    SyncSent(Device, static_cast<uint8_t>(command.at(1)), static_cast<uint64_t>(m_HostClock.nsecsElapsed()));
+    WriteControl(Device, command);
 }
 
-void NordicCentral::SetInfo(const QString&)
+void NordicCentral::SyncSent(DeviceState& Device, uint8_t Token, uint64_t HostNs)
 {
-    // For debugging
+    Device.SyncToken = Token;
+    Device.SyncSentNs = HostNs;
+    Device.bSyncPending = true;
 }
 
-void NordicCentral::TimerEvent()
+void NordicCentral::SyncReceived(DeviceState& Device, const QByteArray& value, uint64_t HostNs)
 {
-    if(m_bGotDescriptors && m_timerCounter % LED_TOGGLE_TIME_SEC == 0)
+    if(value.size() < SYNC_REPLY_SIZE)
     {
-        m_LEDState = (m_LEDState == LED_STATE::OFF ? LED_STATE::ON : LED_STATE::OFF);
-        m_service->writeCharacteristic(m_LEDChar, QByteArray(1, static_cast<int8_t>(m_LEDState)));
+        return;
     }
 
-    ++m_timerCounter;
+    const auto* pBytes = reinterpret_cast<const uint8_t*>(value.constData());
+    if(!Device.bSyncPending || pBytes[1] != Device.SyncToken)
+    {
+        return;
+    }
+    Device.bSyncPending = false;
+
+    uint32_t ticks = pBytes[2] | (pBytes[3] << 8) | (pBytes[4] << 16) | (static_cast<uint32_t>(pBytes[5]) << 24);
+    Device.Clock.AddRoundTrip(Device.SyncSentNs, HostNs, ticks);
+    Device.ClockOffsetNs = Device.Clock.OffsetNs();
+    Device.ClockSkewPpm = Device.Clock.SkewPpm();
+    Device.ClockResidualNs = Device.Clock.ResidualNs();
+    Device.bClockSynced = Device.Clock.Valid();
 }
 
-void NordicCentral::ScanError(QBluetoothDeviceDiscoveryAgent::Error)
+void NordicCentral::RequestDownload()
 {
-    // For debugging
+    m_DownloadRequested = m_DownloadOffset;
+    m_DownloadActivityNs = static_cast<uint64_t>(m_HostClock.nsecsElapsed());
+
+    QByteArray command(1, CONTROL_OP_DOWNLOAD_START);
+    for(int i = 0; i < RECORD_OFFSET_SIZE; ++i)
+    {
+        command.append(static_cast<char>((m_DownloadOffset >> (8 * i)) & 0xFF));
+    }
+
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    if(m_Devices.size() > DOWNLOAD_DEVICE)
+    {
+        WriteControl(*m_Devices[DOWNLOAD_DEVICE], command);
+    }
+}
+
+void NordicCentral::RecordDataReceived(const QByteArray& value)
+{
+    if(!m_bDownloading || value.size() < RECORD_HEADER_SIZE || value.at(0) != static_cast<char>(PACKET_TYPE::RECORD))
+    {
+        return;
+    }
+
+    const auto* pBytes = reinterpret_cast<const uint8_t*>(value.constData());
+    qint64 offset = pBytes[1] | (pBytes[2] << 8) | (pBytes[3] << 16) | (static_cast<uint32_t>(pBytes[4]) << 24);
+    if(offset != m_DownloadOffset)
+    {
+        // Left over from an earlier request, or a gap.  Notifications arrive in order, so
+        // once the data asked for has started arriving, anything still in flight from
+        // before is behind us and a gap is a real one.  Until then the rest of the old
+        // stream is ignored rather than each piece asking again.
+        if(offset > m_DownloadOffset && m_DownloadRequested != m_DownloadOffset)
+        {
+            RequestDownload();
+        }
+        return;
+    }
+
+    if(value.size() == RECORD_HEADER_SIZE)
+    {
+        // End of the recording
+        m_DownloadFile.close();
+        m_bDownloading = false;
+        emit DownloadChanged();
+        return;
+    }
+
+    m_DownloadFile.write(value.constData() + RECORD_HEADER_SIZE, value.size() - RECORD_HEADER_SIZE);
+    m_DownloadOffset += value.size() - RECORD_HEADER_SIZE;
+    m_DownloadActivityNs = static_cast<uint64_t>(m_HostClock.nsecsElapsed());
+    emit DownloadChanged();
 }
 
-void NordicCentral::ScanFinished()
+void NordicCentral::StreamDataReceived(DeviceState& Device, const QByteArray& value, uint64_t HostNs)
 {
-    // For debugging
+    size_t count = Device.Decoder.Decode(reinterpret_cast<const uint8_t*>(value.constData()), value.size(), m_StreamSamples);
+    Device.PacketsLost = Device.Decoder.PacketsLost();
+    Device.PacketsMalformed = Device.Decoder.PacketsMalformed();
+
+    if(m_ArchiveWriter.IsOpen())
+    {
+        m_ArchiveWriter.Append(Device.Id, m_StreamSamples, count);
+    }
+    if(count > 0)
+    {
+        Device.Clock.AddArrival(m_StreamSamples[count - 1].GyroTime, HostNs);
+        if(Device.FirstSampleMs < 0.0)
+        {
+            Device.FirstSampleMs = (HostNs - m_StartNs) / 1e6;
+        }
+    }
+    for(size_t i = 0; i < count; ++i)
+    {
+        m_StreamTimes[i] = Device.Clock.Valid() ? Device.Clock.ToHostNs(m_StreamSamples[i].GyroTime) : HostNs;
+        if(!m_Merger.Push(Device.Id, m_StreamTimes[i], m_StreamSamples[i]))
+        {
+            ++m_SamplesDropped;
+        }
+    }
+    if(Device.Supervisor.SamplesArrived(m_StreamSamples, count, HostNs))
+    {
+        UpdateOutageStats(Device);
+    }
+    m_Publisher.Publish(Device.Id, m_StreamSamples, m_StreamTimes, count);
+    m_Server.Publish(Device.Id, m_StreamSamples, m_StreamTimes, count);
+    Device.SamplesReceived += count;
+    m_SamplesReceived += count;
+
+    if(count > 0 && !m_bSamplesSignalled.exchange(true))
+    {
+        emit SamplesArrived();
+    }
 }
 
-void NordicCentral::ScanCancelled()
+void NordicCentral::StartTimer()
 {
-    // For debugging
+    connect(&m_timer, &QTimer::timeout, this, &NordicCentral::TimerEvent);
+    m_timer.start(TIMER_MS);
+    m_RateTimer.start();
 }
 
-void NordicCentral::ServiceStateChanged(QLowEnergyService::ServiceState s)
+
+void NordicCentral::TimerEvent()
 {
-    switch (s)
+    bool bToggleLED = m_timerCounter % LED_TOGGLE_TIME_SEC == 0;
+    if(bToggleLED)
+    {
+        m_LEDState = (m_LEDState == LED_STATE::OFF ? LED_STATE::ON : LED_STATE::OFF);
+        emit LEDStateChanged();
+    }
+
+    // The request, or the data it started, was lost
+    if(m_bDownloading && static_cast<uint64_t>(m_HostClock.nsecsElapsed()) - m_DownloadActivityNs > DOWNLOAD_TIMEOUT_NS)
+    {
+        RequestDownload();
+    }
+
+    double seconds = m_RateTimer.restart() / 1000.0;
+    std::lock_guard<std::mutex> lock(m_DevicesMutex);
+    for(const auto& pDevice : m_Devices)
     {
-        case QLowEnergyService::DiscoveringServices:
-            // For debugging
-            break;
-        case QLowEnergyService::ServiceDiscovered:
+        if(bToggleLED && pDevice->bConnected)
         {
-            auto chars = m_service->characteristics();
-            for(int i = 0; i < chars.size(); ++i)
-            {
-                if(chars[i].isValid())
-                {
-                    if(chars[i].uuid().data1 == NORDIC_BLINKY_BUTTON_CHAR_UUID)
-                    {
-                        auto NotificationDesc = chars[i].descriptor(QBluetoothUuid::ClientCharacteristicConfiguration);
-                        m_service->writeDescriptor(NotificationDesc, QByteArray::fromHex("0100"));
-                    }
-                    else if(chars[i].uuid().data1 == NORDIC_BLINKY_LED_CHAR_UUID)
-                    {
-                        m_LEDChar = chars[i];
-                    }
-                    else if(chars[i].uuid().data1 == NORDIC_BLINKY_IMU_CHAR_UUID)
-                    {
-                        auto NotificationDesc = chars[i].descriptor(QBluetoothUuid::ClientCharacteristicConfiguration);
-                        m_service->writeDescriptor(NotificationDesc, QByteArray::fromHex("0100"));
-                    }
-                }
-            }
-            m_bGotDescriptors = true;
-            break;
+            pDevice->pLink->Write(NORDIC_BLINKY_LED_CHAR_UUID, QByteArray(1, static_cast<int8_t>(m_LEDState.load())));
         }
-        case QLowEnergyService::InvalidService:
-            // For debugging
-            break;
-        case QLowEnergyService::LocalService:
-            // For debugging
-            break;
-        case QLowEnergyService::DiscoveryRequired:
-            // For debugging
-            break;
+        RequestSync(*pDevice);
+
+        uint64_t samples = pDevice->SamplesReceived;
+        pDevice->SampleRate = seconds > 0.0 ? (samples - pDevice->RateSamples) / seconds : 0.0;
+        pDevice->RateSamples = samples;
     }
+
+    ++m_timerCounter;
+    emit StatsChanged();
 }
 
-void NordicCentral::NordicBlinkyCharChange(const QLowEnergyCharacteristic &c, const QByteArray &value)
+// The device forgets its subscriptions when disconnected, so this is the same whether
+// it's the first connection or a reconnection
+void NordicCentral::LinkConnected(DeviceState& Device)
 {
-    if(c.uuid().data1 == NORDIC_BLINKY_BUTTON_CHAR_UUID)
+    Device.Supervisor.Connected(static_cast<uint64_t>(m_HostClock.nsecsElapsed()));
+    Device.bEverConnected = true;
+    UpdateOutageStats(Device);
+
+    Device.bConnected = true;
+    Device.Decoder.Reset();
+    Device.bSyncPending = false;
+    Device.pLink->Subscribe(NORDIC_BLINKY_BUTTON_CHAR_UUID);
+    Device.pLink->Subscribe(NORDIC_BLINKY_IMU_CHAR_UUID);
+    Device.pLink->Subscribe(NORDIC_BLINKY_RECORD_CHAR_UUID);
+    Device.pLink->Write(NORDIC_BLINKY_LED_CHAR_UUID, QByteArray(1, static_cast<int8_t>(m_LEDState.load())));
+    RequestSync(Device);
+
+    // Pick up an interrupted download where it left off
+    if(m_bDownloading && Device.Id == DOWNLOAD_DEVICE)
     {
-        m_bButtonPressed = value.at(0) == 1;
+        RequestDownload();
     }
-    else if(c.uuid().data1 == NORDIC_BLINKY_IMU_CHAR_UUID)
+    emit ConnectionChanged();
+}
+
+void NordicCentral::LinkDisconnected(DeviceState& Device)
+{
+    Device.bConnected = false;
+    ScheduleReconnect(Device);
+    emit ConnectionChanged();
+}
+
+// A device that's never connected may not be where its link thinks, and if it was
+// remembered the link has forgotten it, so it's scanned for afresh.  Otherwise its link
+// is tried again.
+void NordicCentral::LinkFailed(DeviceState& Device)
+{
+    if(!Device.bEverConnected)
     {
-        m_IMUData = *(reinterpret_cast<const struct IMUData*>(value.constData()));
+        // Deleted once it's finished calling us
+        IDeviceLink* pLink = Device.pLink;
+        QMetaObject::invokeMethod(this, [pLink]() { delete pLink; }, Qt::QueuedConnection);
+        Device.pLink = nullptr;
     }
+    ScheduleReconnect(Device);
+    emit ConnectionChanged();
 }
 
-void NordicCentral::ConfirmedDescriptorWrite(const QLowEnergyDescriptor&, const QByteArray&)
+void NordicCentral::ScheduleReconnect(DeviceState& Device)
 {
-    // For debugging
+    int delayMs = Device.Supervisor.Lost(static_cast<uint64_t>(m_HostClock.nsecsElapsed()));
+    UpdateOutageStats(Device);
+    QTimer::singleShot(delayMs, this, [this, &Device]() { Reconnect(Device); });
+}
+
+void NordicCentral::Reconnect(DeviceState& Device)
+{
+    if(Device.pLink)
+    {
+        Device.Supervisor.Connecting();
+        UpdateOutageStats(Device);
+        Device.pLink->Connect();
+    }
+    else
+    {
+        m_Rescan.append(Device.Name);
+        Rescan();
+    }
+}
+
+// Copied out for the GUI thread
+void NordicCentral::UpdateOutageStats(DeviceState& Device)
+{
+    const ConnectionSupervisor& supervisor = Device.Supervisor;
+    Device.bReconnecting = supervisor.State() == ConnectionSupervisor::STATE::WAITING ||
+                           (supervisor.State() == ConnectionSupervisor::STATE::CONNECTING && Device.bEverConnected);
+    Device.ReconnectAttempts = supervisor.Attempts();
+    Device.Outages = supervisor.Outages();
+    Device.LastOutageMs = supervisor.LastOutageNs() / 1e6;
+    Device.TotalOutageMs = supervisor.TotalOutageNs() / 1e6;
+    Device.SamplesLostInOutages = supervisor.SamplesLost();
+}
+
+void NordicCentral::NordicBlinkyCharChange(DeviceState& Device, uint16_t Characteristic, const QByteArray &value)
+{
+    uint64_t now = static_cast<uint64_t>(m_HostClock.nsecsElapsed());
+    if(m_CaptureWriter.IsOpen())
+    {
+        m_CaptureWriter.Write(now, Device.Id, Characteristic, reinterpret_cast<const uint8_t*>(value.constData()), value.size());
+    }
+    PayloadReceived(Device, Characteristic, value, now);
+}
+
+// Everything the devices send comes through here, whether live or replayed.  HostNs is
+// when it arrived.
+void NordicCentral::PayloadReceived(DeviceState& Device, uint16_t Characteristic, const QByteArray& value, uint64_t HostNs)
+{
+    if(Characteristic == NORDIC_BLINKY_BUTTON_CHAR_UUID)
+    {
+        bool bPressed = !value.isEmpty() && value.at(0) == 1;
+        if(Device.bButtonPressed.exchange(bPressed) != bPressed)
+        {
+            emit ButtonChanged();
+        }
+    }
+    else if(Characteristic == NORDIC_BLINKY_IMU_CHAR_UUID)
+    {
+        if(!value.isEmpty() && value.at(0) == static_cast<char>(PACKET_TYPE::SYNC))
+        {
+            SyncReceived(Device, value, HostNs);
+        }
+        else
+        {
+            StreamDataReceived(Device, value, HostNs);
+        }
+    }
+    else if(Characteristic == NORDIC_BLINKY_CONTROL_CHAR_UUID)
+    {
+        // Only in a replay, where our own sync requests were captured
+        if(value.size() >= 2 && value.at(0) == CONTROL_OP_SYNC)
+        {
+            SyncSent(Device, static_cast<uint8_t>(value.at(1)), HostNs);
+        }
+    }
+    else if(Characteristic == NORDIC_BLINKY_RECORD_CHAR_UUID && Device.Id == DOWNLOAD_DEVICE)
+    {
+        RecordDataReceived(value);
+    }
 }
@@ -1,80 +1,251 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
-#include <QLowEnergyController>
-#include <QBluetoothDeviceDiscoveryAgent>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
 #include <QTimer>
+#include "BluetoothScanner.h"
+#include "CaptureFile.h"
+#include "ClockEstimator.h"
+#include "ConnectionSupervisor.h"
+#include "DeviceCache.h"
+#include "IDeviceLink.h"
+#include "IMUData.h"
+#include "ReplaySource.h"
+#include "SampleArchive.h"
+#include "SampleMerger.h"
+#include "SamplePublisher.h"
+#include "SampleServer.h"
+#include "SimulatedDeviceLink.h"
+#include "StreamDecoder.h"
 
 
-typedef struct ThreeDimData
+// Finds IMU4Us, connects to them and decodes what they send.  All the work with the
+// device links happens on a thread of its own, so decoding keeps up however busy the GUI is.  Every
+// decoded sample goes through a SampleMerger, tagged with its device's ID, for the GUI to
+// pick up in time order with ReadSamples(); the rest of the public functions are safe to
+// call from the GUI thread.
+//
+// Rather than being polled, it signals when there's something new.  The signals come
+// from the decode or replay thread, so connections to GUI objects are queued, and carry
+// nothing: receivers read the current state with the accessors.  SamplesArrived() is
+// only sent once until ReadSamples() is next called, however many packets come in.
+//
+// Devices get IDs from 0 in the order they're found, and each has its own link and
+// stream decoder.  Recording commands go to every device, downloads come from device 0.
+//
+// Bluetooth devices connected to before are remembered in a DeviceCache, and connected
+// to straight away by address the next time they match, with the scan left to find any
+// others.  If a remembered one can't be reached it's scanned for like a new one.
+//
+// Each device's ConnectionSupervisor keeps it connected: a dropped connection or failed
+// attempt is retried after a backoff, for as long as it takes.  Once back, the device is
+// subscribed to again, given the LED state and a clock sync, and any download carries
+// on.  Outages are counted, with an estimate of the samples missed in them.
+//
+// Once a second every device is sent a clock sync request, and its ClockEstimator turns
+// the replies into a mapping from its time stamps to the host's clock.  That's what
+// samples are merged by; until a device's first reply its samples go by when they
+// arrived instead.
+//
+// Instead of real devices the payloads can come from a capture file, in which case
+// they go through the same decoding on the replay thread.
+class NordicCentral : public QObject
 {
-    int16_t X;
-    int16_t Y;
-    int16_t Z;
-} ThreeDimData;
+    Q_OBJECT
 
-typedef struct IMUData
-{
-    ThreeDimData Mag;
-    ThreeDimData Accel;
-    ThreeDimData Gyro;
-    uint8_t MagStatus;
-    uint8_t AccelStatus;
-    uint8_t GyroStatus;
-    uint8_t ErrorStatus;
-} IMUData;
+    public:
+        static constexpr size_t MAX_DEVICES = 32;
+        static constexpr size_t SAMPLE_RING_SIZE = 16384;   // Most samples ReadSamples() can have waiting
+        static constexpr size_t DEVICE_RING_SIZE = 4096;    // Samples each device can have waiting in the merge
 
+        struct DeviceStatus
+        {
+            uint16_t Id = 0;
+            QString  Name;              // Its address, or which simulated device it is
+            bool     bConnected = false;
+            uint64_t SamplesReceived = 0;
+            double   SampleRate = 0.0;  // Samples per second, over the last second
+            uint64_t PacketsLost = 0;
+            uint64_t PacketsMalformed = 0;
+            bool     bClockSynced = false;   // See ClockEstimator.h for the rest
+            double   ClockOffsetNs = 0.0;
+            double   ClockSkewPpm = 0.0;
+            double   ClockResidualNs = 0.0;
+            double   FirstSampleMs = -1.0;   // From starting to its first sample, -1 until then
+            bool     bReconnecting = false;
+            uint32_t ReconnectAttempts = 0;  // Failed in a row
+            uint32_t Outages = 0;
+            double   LastOutageMs = 0.0;
+            double   TotalOutageMs = 0.0;
+            uint64_t SamplesLostInOutages = 0;   // Estimated
+        };
 
-class NordicCentral : public QObject
-{
-    public:
         enum class LED_STATE
         {
             OFF = 0,
             ON  = 1
         };
 
-        NordicCentral() = default;
-        ~NordicCentral() = default;
+        NordicCentral();
+        ~NordicCentral();
+
+        // Connects over Bluetooth to every device whose address or name matches one of
+        // Patterns (see BluetoothScanner.h), up to MaxDevices of them (0 for no limit)
+        void Start(const QStringList& Patterns, int MaxDevices);
+
+        // Forgets every remembered device, so Start() scans for them all again
+        void ForgetDevices();
+
+        // Connects to simulated devices instead (see SimulatedDeviceLink.h)
+        void StartSimulated(const SimulatedDeviceLink::Settings& Settings, int DeviceCount);
+
+        // Replays a capture instead of connecting to a device.  Speed is as for
+        // ReplaySource::Start().  OnFinished is called on the replay thread.
+        bool StartReplay(const QString& FileName, double Speed, std::function<void()> OnFinished = nullptr);
 
-        void Start();
-        bool Connected();
-        bool ButtonPressed();
-        const IMUData& IMUData();
+        // Saves every notification from the devices to FileName, for replaying later.
+        // Call before Start() or StartSimulated().
+        bool CaptureTo(const QString& FileName);
+
+        // Saves every decoded sample to a SampleArchive.  Call before starting.
+        bool ArchiveTo(const QString& FileName);
+
+        // Publishes every decoded sample to POSIX shared memory under Name (e.g. "/IMU4U")
+        // for other processes to read with SampleSubscriber.  Call before starting.
+        bool PublishTo(const QString& Name);
+
+        // Streams every decoded sample to TCP clients on Port, from this host only unless
+        // bLan (see SampleServer.h).  Call before starting.
+        bool ServeOn(uint16_t Port, bool bLan);
+
+        bool Connected();       // To any device
+        bool ButtonPressed();   // On any device
         LED_STATE LEDState();
 
+        // Copies up to MaxCount decoded samples to pSamples in time order, returning how
+        // many were copied.  Times are host nanoseconds.  Only call from one thread.
+        size_t ReadSamples(MergedSample* pSamples, size_t MaxCount);
+        uint64_t SamplesReceived();
+        uint64_t SamplesDropped();   // Decoded but the GUI hadn't made room for them
+        uint64_t SamplesLate();      // Passed on out of order by the merge
+        uint64_t PacketsLost();
+        uint64_t PacketsMalformed();
+        std::vector<DeviceStatus> Devices();
+
+        // Control of the on-device flash recording.  Downloads append to the given file,
+        // so downloading to a partially downloaded file resumes where it left off.
+        void StartRecording();
+        void StopRecording();
+        void EraseRecording();
+        void DownloadRecording(const QString& FileName);
+        bool Downloading();
+        qint64 DownloadedBytes();
+
+    signals:
+        void SamplesArrived();      // There may be samples for ReadSamples()
+        void ConnectionChanged();   // A device connected or disconnected
+        void ButtonChanged();
+        void LEDStateChanged();
+        void DownloadChanged();     // More downloaded, or the download finished
+        void StatsChanged();        // Once a second, with new sample rates and clock estimates
+
     private:
+        // Everything about one device.  Only its atomics are touched from other threads.
+        struct DeviceState
+        {
+            uint16_t              Id = 0;
+            QString               Name;
+            IDeviceLink*          pLink = nullptr;   // A child of ours, so it lives on m_Thread too
+            StreamDecoder         Decoder;
+            std::atomic<bool>     bConnected{false};
+            std::atomic<bool>     bButtonPressed{false};
+            std::atomic<uint64_t> SamplesReceived{0};
+            std::atomic<uint64_t> PacketsLost{0};
+            std::atomic<uint64_t> PacketsMalformed{0};
+            std::atomic<double>   SampleRate{0.0};
+            uint64_t              RateSamples = 0;   // SamplesReceived when SampleRate was last measured
+            ClockEstimator        Clock;
+            uint8_t               SyncToken = 0;     // Of the latest request
+            uint64_t              SyncSentNs = 0;
+            bool                  bSyncPending = false;
+            std::atomic<bool>     bClockSynced{false};
+            std::atomic<double>   ClockOffsetNs{0.0};
+            std::atomic<double>   ClockSkewPpm{0.0};
+            std::atomic<double>   ClockResidualNs{0.0};
+            std::atomic<double>   FirstSampleMs{-1.0};
+            ConnectionSupervisor  Supervisor;
+            bool                  bEverConnected = false;
+            std::atomic<bool>     bReconnecting{false};
+            std::atomic<uint32_t> ReconnectAttempts{0};
+            std::atomic<uint32_t> Outages{0};
+            std::atomic<double>   LastOutageMs{0.0};
+            std::atomic<double>   TotalOutageMs{0.0};
+            std::atomic<uint64_t> SamplesLostInOutages{0};
+        };
+
+        void StartThread();
+        DeviceState* AddDevice(const QString& Name);   // Null once there are MAX_DEVICES
+        DeviceState* FindDevice(uint16_t Id);
+        void AddLink(const QString& Name, IDeviceLink* pLink);
+        void AttachLink(DeviceState& Device, IDeviceLink* pLink);
+        void AddBluetoothLink(const QBluetoothDeviceInfo& Info);
+        void Rescan();
         void StartTimer();
-        void StartDicoveryAgent();
-        void CreateController();
-        void DeviceDiscovered(const QBluetoothDeviceInfo& Device);
-        void ServiceDiscovered(const QBluetoothUuid &gatt);
-        void ServiceScanDone();
-        void ConnectionUpdated();
-        void SetError(const QString&);
-        void SetInfo(const QString&);
+        void LinkConnected(DeviceState& Device);
+        void LinkDisconnected(DeviceState& Device);
+        void LinkFailed(DeviceState& Device);
+        void ScheduleReconnect(DeviceState& Device);
+        void Reconnect(DeviceState& Device);
+        void UpdateOutageStats(DeviceState& Device);
         void TimerEvent();
-        void ScanError(QBluetoothDeviceDiscoveryAgent::Error);
-        void ScanFinished();
-        void ScanCancelled();
-        void ServiceStateChanged(QLowEnergyService::ServiceState s);
-        void NordicBlinkyCharChange(const QLowEnergyCharacteristic &c, const QByteArray &value);
-        void ConfirmedDescriptorWrite(const QLowEnergyDescriptor&, const QByteArray&);
-
-        QBluetoothDeviceInfo                            m_device;
-        std::unique_ptr<QBluetoothDeviceDiscoveryAgent> m_deviceDiscoveryAgent = nullptr;
-        QLowEnergyController*                           m_controller = nullptr;
-        QBluetoothUuid                                  m_gatt;
-        QLowEnergyCharacteristic                        m_LEDChar;
-        QLowEnergyCharacteristic                        m_IMUChar;
-        QLowEnergyService*                              m_service = nullptr;
-        QTimer                                          m_timer;
+        void NordicBlinkyCharChange(DeviceState& Device, uint16_t Characteristic, const QByteArray &value);
+        void PayloadReceived(DeviceState& Device, uint16_t Characteristic, const QByteArray& value, uint64_t HostNs);
+        void WriteControl(DeviceState& Device, const QByteArray& Command);
+        void BroadcastControl(const QByteArray& Command);
+        void RequestSync(DeviceState& Device);
+        void SyncSent(DeviceState& Device, uint8_t Token, uint64_t HostNs);
+        void SyncReceived(DeviceState& Device, const QByteArray& value, uint64_t HostNs);
+        void RequestDownload();
+        void RecordDataReceived(const QByteArray& value);
+        void StreamDataReceived(DeviceState& Device, const QByteArray& value, uint64_t HostNs);
+
+        // Devices are only added by the thread that decodes (m_Thread, or the replay
+        // thread), which can read the list without locking.  Everyone else locks.
+        std::vector<std::unique_ptr<DeviceState>>       m_Devices;
+        std::mutex                                      m_DevicesMutex;
+        BluetoothScanner*                               m_pScanner = nullptr;
+        DeviceCache                                     m_DeviceCache;
+        QStringList                                     m_Rescan;       // IDs of remembered devices that couldn't be reached
+        uint64_t                                        m_StartNs = 0;  // On m_HostClock, for FirstSampleMs
+        QThread                                         m_Thread;
+        QTimer                                          m_timer{this};  // Parented so it moves to m_Thread with us
         uint32_t                                        m_timerCounter = 0;
-        bool                                            m_bConnected = false;
-        bool                                            m_bGattFound = false;
-        bool                                            m_bGotDescriptors = false;
-        bool                                            m_bButtonPressed = false;
-        LED_STATE                                       m_LEDState = LED_STATE::OFF;
-        struct IMUData                                  m_IMUData;
+        QElapsedTimer                                   m_RateTimer;
+        QElapsedTimer                                   m_HostClock;    // What everything is timed by when live
+        std::atomic<LED_STATE>                          m_LEDState{LED_STATE::OFF};
+        IMUSample                                       m_StreamSamples[StreamDecoder::MAX_PACKET_SAMPLES];
+        uint64_t                                        m_StreamTimes[StreamDecoder::MAX_PACKET_SAMPLES];
+        SampleMerger                                    m_Merger;
+        std::atomic<bool>                               m_bReplayFinished{false};   // So the merge can be drained
+        std::atomic<bool>                               m_bSamplesSignalled{false}; // Since the last ReadSamples()
+        std::atomic<uint64_t>                           m_SamplesReceived{0};
+        std::atomic<uint64_t>                           m_SamplesDropped{0};
+        QFile                                           m_DownloadFile{this};
+        std::atomic<qint64>                             m_DownloadOffset{0};
+        std::atomic<bool>                               m_bDownloading{false};
+        qint64                                          m_DownloadRequested = -1;  // Offset last asked for
+        uint64_t                                        m_DownloadActivityNs = 0;  // On m_HostClock, when data last arrived or was asked for
+        CaptureWriter                                   m_CaptureWriter;
+        ReplaySource                                    m_ReplaySource;
+        SampleArchiveWriter                             m_ArchiveWriter;
+        SamplePublisher                                 m_Publisher;
+        SampleServer                                    m_Server;
 };
@@ -0,0 +1,272 @@
+#include "ProcessingStages.h"
+#include <algorithm>
+
+namespace
+{
+    constexpr float RADIANS_PER_DEGREE = 3.14159265358979323846f / 180.0f;
+
+    // value = Matrix * ((raw - Offset) * Scale), as UnitConverter does it
+    void Calibrate(const SensorCalibration& Calibration, const float* pRaw, float* pOut)
+    {
+        float scaled[3];
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            scaled[axis] = (pRaw[axis] - Calibration.Offset[axis]) * Calibration.Scale[axis];
+        }
+        for(int row = 0; row < 3; ++row)
+        {
+            const float* pRow = &Calibration.Matrix[row * 3];
+            pOut[row] = pRow[0] * scaled[0] + pRow[1] * scaled[1] + pRow[2] * scaled[2];
+        }
+    }
+}
+
+DecoderStage::DecoderStage(size_t DeviceCount) : Stage("Decoder", 64), m_Decoders(DeviceCount)
+{
+}
+
+uint64_t DecoderStage::PacketsLost() const
+{
+    return m_PacketsLost;
+}
+
+uint64_t DecoderStage::PacketsMalformed() const
+{
+    return m_PacketsMalformed;
+}
+
+void DecoderStage::Process(const DevicePacket* pPackets, size_t Count)
+{
+    uint64_t lost = 0;
+    uint64_t malformed = 0;
+    for(size_t i = 0; i < Count; ++i)
+    {
+        const DevicePacket& packet = pPackets[i];
+        if(packet.Device >= m_Decoders.size() || packet.Size == 0 || packet.Bytes[0] != static_cast<uint8_t>(PACKET_TYPE::SAMPLES))
+        {
+            continue;
+        }
+
+        StreamDecoder& decoder = m_Decoders[packet.Device];
+        size_t count = decoder.Decode(packet.Bytes, packet.Size, m_Samples);
+        for(size_t s = 0; s < count; ++s)
+        {
+            MergedSample sample;
+            sample.Time = packet.TimeNs;
+            sample.Device = packet.Device;
+            sample.Sample = m_Samples[s];
+            Emit(sample);
+        }
+    }
+    for(const StreamDecoder& decoder : m_Decoders)
+    {
+        lost += decoder.PacketsLost();
+        malformed += decoder.PacketsMalformed();
+    }
+    m_PacketsLost = lost;
+    m_PacketsMalformed = malformed;
+}
+
+RecorderStage::RecorderStage(SampleArchiveWriter& Writer) : Stage("Recorder"), m_Writer(Writer)
+{
+    m_Run.reserve(DEFAULT_BATCH);
+}
+
+void RecorderStage::Process(const MergedSample* pSamples, size_t Count)
+{
+    size_t start = 0;
+    while(start < Count)
+    {
+        uint16_t device = pSamples[start].Device;
+        m_Run.clear();
+        size_t end = start;
+        while(end < Count && pSamples[end].Device == device)
+        {
+            m_Run.push_back(pSamples[end].Sample);
+            ++end;
+        }
+        m_Writer.Append(device, m_Run.data(), m_Run.size());
+        start = end;
+    }
+}
+
+ResamplerStage::ResamplerStage(size_t DeviceCount, double RateHz) :
+    Stage("Resampler"), m_Resamplers(DeviceCount, SensorResampler(RateHz)), m_Restarts(DeviceCount),
+    m_bRestartPending(DeviceCount, false)
+{
+}
+
+void ResamplerStage::Process(const MergedSample* pSamples, size_t Count)
+{
+    for(size_t i = 0; i < Count; ++i)
+    {
+        uint16_t device = pSamples[i].Device;
+        if(device >= m_Resamplers.size())
+        {
+            continue;
+        }
+
+        SensorResampler& resampler = m_Resamplers[device];
+        size_t count = resampler.Add(pSamples[i].Sample, m_Frames, sizeof(m_Frames) / sizeof(m_Frames[0]));
+
+        // The sample that restarts a resampler seldom makes a frame itself, so the restart
+        // goes with whichever frame comes next
+        if(resampler.Restarts() != m_Restarts[device])
+        {
+            m_Restarts[device] = resampler.Restarts();
+            m_bRestartPending[device] = true;
+        }
+        for(size_t f = 0; f < count; ++f)
+        {
+            DeviceFrame frame;
+            frame.Device = device;
+            frame.bRestart = m_bRestartPending[device];
+            frame.Frame = m_Frames[f];
+            m_bRestartPending[device] = false;
+            Emit(frame);
+        }
+    }
+}
+
+CalibrationStage::CalibrationStage(size_t DeviceCount) : Stage("Calibration"), m_Calibrations(DeviceCount, DefaultCalibration())
+{
+}
+
+void CalibrationStage::SetCalibration(uint16_t Device, const DeviceCalibration& Calibration)
+{
+    m_Calibrations[Device] = Calibration;
+}
+
+void CalibrationStage::Process(const DeviceFrame* pFrames, size_t Count)
+{
+    for(size_t i = 0; i < Count; ++i)
+    {
+        const DeviceFrame& in = pFrames[i];
+        const DeviceCalibration& calibration = m_Calibrations[in.Device];
+        CalibratedFrame out;
+        out.Device = in.Device;
+        out.bRestart = in.bRestart;
+        out.Time = in.Frame.Time;
+        Calibrate(calibration.Accel, in.Frame.Accel, out.Accel);
+        Calibrate(calibration.Mag, in.Frame.Mag, out.Mag);
+        Calibrate(calibration.Gyro, in.Frame.Gyro, out.Gyro);
+        Emit(out);
+    }
+}
+
+FusionStage::FusionStage(size_t DeviceCount, double RateHz) :
+    Stage("Fusion"), m_Fusion(DeviceCount), m_Dt(static_cast<float>(1.0 / RateHz)), m_Steps(DeviceCount)
+{
+    for(auto& steps : m_Steps)
+    {
+        steps.reserve(DEFAULT_BATCH);
+    }
+}
+
+void FusionStage::Process(const CalibratedFrame* pFrames, size_t Count)
+{
+    size_t steps = 0;
+    for(size_t i = 0; i < Count; ++i)
+    {
+        std::vector<CalibratedFrame>& frames = m_Steps[pFrames[i].Device];
+        frames.push_back(pFrames[i]);
+        steps = std::max(steps, frames.size());
+    }
+
+    for(size_t step = 0; step < steps; ++step)
+    {
+        for(size_t device = 0; device < m_Steps.size(); ++device)
+        {
+            if(step < m_Steps[device].size())
+            {
+                const CalibratedFrame& frame = m_Steps[device][step];
+                if(frame.bRestart)
+                {
+                    m_Fusion.Reset(device);
+                }
+                m_Fusion.SetInput(device, frame.Gyro[0] * RADIANS_PER_DEGREE, frame.Gyro[1] * RADIANS_PER_DEGREE,
+                                  frame.Gyro[2] * RADIANS_PER_DEGREE, frame.Accel[0], frame.Accel[1], frame.Accel[2], m_Dt);
+            }
+        }
+        m_Fusion.Step();
+
+        for(size_t device = 0; device < m_Steps.size(); ++device)
+        {
+            if(step < m_Steps[device].size())
+            {
+                DeviceOrientation orientation;
+                orientation.Device = static_cast<uint16_t>(device);
+                orientation.Time = m_Steps[device][step].Time;
+                orientation.Orientation = m_Fusion.Orientation(device);
+                Emit(orientation);
+            }
+        }
+    }
+
+    for(auto& frames : m_Steps)
+    {
+        frames.clear();
+    }
+}
+
+OrientationSink::OrientationSink(size_t DeviceCount, std::function<void()> OnUpdated) :
+    Stage("Orientation"), m_OnUpdated(std::move(OnUpdated)), m_Latest(DeviceCount), m_bHave(DeviceCount, false)
+{
+}
+
+bool OrientationSink::Latest(uint16_t Device, Quaternion& Orientation)
+{
+    m_bSignalled = false;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if(Device >= m_Latest.size() || !m_bHave[Device])
+    {
+        return false;
+    }
+    Orientation = m_Latest[Device];
+    return true;
+}
+
+void OrientationSink::Process(const DeviceOrientation* pOrientations, size_t Count)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for(size_t i = 0; i < Count; ++i)
+        {
+            const DeviceOrientation& orientation = pOrientations[i];
+            if(orientation.Device < m_Latest.size())
+            {
+                m_Latest[orientation.Device] = orientation.Orientation;
+                m_bHave[orientation.Device] = true;
+            }
+        }
+    }
+    if(m_OnUpdated && !m_bSignalled.exchange(true))
+    {
+        m_OnUpdated();
+    }
+}
+
+SpectrumSink::SpectrumSink(SpectrumAnalyzer& Analyzer, uint16_t Device) : Stage("Spectrum"), m_Analyzer(Analyzer), m_Device(Device)
+{
+    m_Frames.reserve(DEFAULT_BATCH);
+}
+
+void SpectrumSink::Process(const DeviceFrame* pFrames, size_t Count)
+{
+    m_Frames.clear();
+    for(size_t i = 0; i < Count; ++i)
+    {
+        if(pFrames[i].Device != m_Device)
+        {
+            continue;
+        }
+        if(pFrames[i].bRestart)
+        {
+            m_Analyzer.Add(m_Frames.data(), m_Frames.size());
+            m_Frames.clear();
+            m_Analyzer.Restart();
+        }
+        m_Frames.push_back(pFrames[i].Frame);
+    }
+    m_Analyzer.Add(m_Frames.data(), m_Frames.size());
+}
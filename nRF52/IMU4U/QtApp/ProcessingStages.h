@@ -0,0 +1,184 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "FusionEngine.h"
+#include "IMUData.h"
+#include "Quaternion.h"
+#include "SampleArchive.h"
+#include "SampleMerger.h"
+#include "SensorResampler.h"
+#include "SpectrumAnalyzer.h"
+#include "StageGraph.h"
+#include "StreamDecoder.h"
+#include "UnitConverter.h"
+
+// The host's processing as StageGraph stages, from what a device sends to what's drawn:
+//
+//   DevicePacket -> DecoderStage -> MergedSample -> ResamplerStage -> DeviceFrame
+//     -> CalibrationStage -> CalibratedFrame -> FusionStage -> DeviceOrientation
+//     -> OrientationSink
+//
+// with RecorderStage taking decoded samples and SpectrumSink resampled frames alongside.
+// Devices are numbered from 0 to the DeviceCount each stage is made with.
+
+// A notification from a device's stream characteristic, as it arrived
+struct DevicePacket
+{
+    static constexpr size_t MAX_SIZE = 244;   // The payload of a 247 byte ATT MTU
+
+    uint64_t TimeNs = 0;
+    uint16_t Device = 0;
+    uint16_t Size = 0;
+    uint8_t  Bytes[MAX_SIZE];
+};
+
+// One device's accel, mag and gyro lined up in time, in the sensors' own units
+struct DeviceFrame
+{
+    uint16_t       Device = 0;
+    bool           bRestart = false;   // The first after a gap (see SensorResampler::MAX_GAP_S)
+    ResampledFrame Frame;
+};
+
+// A DeviceFrame in g, microtesla and degrees per second
+struct CalibratedFrame
+{
+    uint16_t Device = 0;
+    bool     bRestart = false;
+    uint32_t Time = 0;
+    float    Accel[3] = {};
+    float    Mag[3] = {};
+    float    Gyro[3] = {};
+};
+
+struct DeviceOrientation
+{
+    uint16_t   Device = 0;
+    uint32_t   Time = 0;
+    Quaternion Orientation;
+};
+
+// Decodes each device's packets with a StreamDecoder of its own.  Every sample from a
+// packet gets the time the packet arrived; anything that isn't a stream packet is ignored.
+class DecoderStage : public Stage<DevicePacket, MergedSample>
+{
+    public:
+        explicit DecoderStage(size_t DeviceCount);
+
+        uint64_t PacketsLost() const;
+        uint64_t PacketsMalformed() const;
+
+    protected:
+        void Process(const DevicePacket* pPackets, size_t Count) override;
+
+    private:
+        std::vector<StreamDecoder> m_Decoders;
+        IMUSample                  m_Samples[StreamDecoder::MAX_PACKET_SAMPLES];
+        std::atomic<uint64_t>      m_PacketsLost{0};
+        std::atomic<uint64_t>      m_PacketsMalformed{0};
+};
+
+// Appends decoded samples to a SampleArchiveWriter, which should already be open.  Runs of
+// samples from the same device go in together.
+class RecorderStage : public Sink<MergedSample>
+{
+    public:
+        explicit RecorderStage(SampleArchiveWriter& Writer);
+
+    protected:
+        void Process(const MergedSample* pSamples, size_t Count) override;
+
+    private:
+        SampleArchiveWriter&   m_Writer;
+        std::vector<IMUSample> m_Run;
+};
+
+// Puts each device's samples on a regular grid with a SensorResampler of its own
+class ResamplerStage : public Stage<MergedSample, DeviceFrame>
+{
+    public:
+        ResamplerStage(size_t DeviceCount, double RateHz);
+
+    protected:
+        void Process(const MergedSample* pSamples, size_t Count) override;
+
+    private:
+        std::vector<SensorResampler> m_Resamplers;
+        std::vector<uint64_t>        m_Restarts;
+        std::vector<bool>            m_bRestartPending;   // Not yet marked on a frame
+        ResampledFrame               m_Frames[64];   // Room for whatever one sample makes available
+};
+
+// Turns frames into physical units.  Each device has DefaultCalibration() until told
+// otherwise, which has to be before anything is pushed into the graph.
+class CalibrationStage : public Stage<DeviceFrame, CalibratedFrame>
+{
+    public:
+        explicit CalibrationStage(size_t DeviceCount);
+
+        void SetCalibration(uint16_t Device, const DeviceCalibration& Calibration);
+
+    protected:
+        void Process(const DeviceFrame* pFrames, size_t Count) override;
+
+    private:
+        std::vector<DeviceCalibration> m_Calibrations;
+};
+
+// Every device's orientation from its frames, the devices stepped together through a
+// FusionEngine: one step per frame of the device with the most in a batch, the others
+// sitting out the later steps.  A restart starts the device's filter afresh too.
+class FusionStage : public Stage<CalibratedFrame, DeviceOrientation>
+{
+    public:
+        FusionStage(size_t DeviceCount, double RateHz);
+
+    protected:
+        void Process(const CalibratedFrame* pFrames, size_t Count) override;
+
+    private:
+        FusionEngine                              m_Fusion;
+        float                                     m_Dt;
+        std::vector<std::vector<CalibratedFrame>> m_Steps;   // Each device's frames in the batch
+};
+
+// Keeps each device's latest orientation for the GUI to draw.  OnUpdated is called from
+// the graph's threads when there's a new one, only once until Latest() is next called.
+class OrientationSink : public Sink<DeviceOrientation>
+{
+    public:
+        OrientationSink(size_t DeviceCount, std::function<void()> OnUpdated = nullptr);
+
+        // False until Device has an orientation
+        bool Latest(uint16_t Device, Quaternion& Orientation);
+
+    protected:
+        void Process(const DeviceOrientation* pOrientations, size_t Count) override;
+
+    private:
+        std::function<void()>   m_OnUpdated;
+        std::mutex              m_Mutex;
+        std::vector<Quaternion> m_Latest;
+        std::vector<bool>       m_bHave;
+        std::atomic<bool>       m_bSignalled{false};
+};
+
+// Hands one device's frames to a SpectrumAnalyzer, restarting it after a gap
+class SpectrumSink : public Sink<DeviceFrame>
+{
+    public:
+        SpectrumSink(SpectrumAnalyzer& Analyzer, uint16_t Device);
+
+    protected:
+        void Process(const DeviceFrame* pFrames, size_t Count) override;
+
+    private:
+        SpectrumAnalyzer&           m_Analyzer;
+        uint16_t                    m_Device;
+        std::vector<ResampledFrame> m_Frames;
+};
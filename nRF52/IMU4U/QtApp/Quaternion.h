@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cmath>
+
+// Unit quaternion for orientations, W being the scalar part
+struct Quaternion
+{
+    float W = 1.0f;
+    float X = 0.0f;
+    float Y = 0.0f;
+    float Z = 0.0f;
+
+    void Normalize()
+    {
+        float norm = std::sqrt(W * W + X * X + Y * Y + Z * Z);
+        if(norm > 0.0f)
+        {
+            W /= norm;
+            X /= norm;
+            Y /= norm;
+            Z /= norm;
+        }
+    }
+};
@@ -0,0 +1,203 @@
+#include "RealFFT.h"
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr double TWO_PI = 6.28318530717958647692;
+
+    void PassScalar(const RealFFT::Pass& Pass, const float* pTwiddles, const float* pInReal, const float* pInImag,
+                    float* pOutReal, float* pOutImag)
+    {
+#define V                float
+#define WIDTH            1
+#define LOAD(p)          (*(p))
+#define STORE(p, v)      (*(p) = (v))
+#define SET1(f)          (f)
+#define ADD(a, b)        ((a) + (b))
+#define SUB(a, b)        ((a) - (b))
+#define MUL(a, b)        ((a) * (b))
+#include "FFTKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+    }
+
+#ifdef SIMD_X86
+    SIMD_TARGET("sse2")
+    void PassSSE2(const RealFFT::Pass& Pass, const float* pTwiddles, const float* pInReal, const float* pInImag,
+                  float* pOutReal, float* pOutImag)
+    {
+#define V                __m128
+#define WIDTH            4
+#define LOAD(p)          _mm_loadu_ps(p)
+#define STORE(p, v)      _mm_storeu_ps((p), (v))
+#define SET1(f)          _mm_set1_ps(f)
+#define ADD(a, b)        _mm_add_ps((a), (b))
+#define SUB(a, b)        _mm_sub_ps((a), (b))
+#define MUL(a, b)        _mm_mul_ps((a), (b))
+#include "FFTKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+    }
+
+    SIMD_TARGET("avx2")
+    void PassAVX2(const RealFFT::Pass& Pass, const float* pTwiddles, const float* pInReal, const float* pInImag,
+                  float* pOutReal, float* pOutImag)
+    {
+#define V                __m256
+#define WIDTH            8
+#define LOAD(p)          _mm256_loadu_ps(p)
+#define STORE(p, v)      _mm256_storeu_ps((p), (v))
+#define SET1(f)          _mm256_set1_ps(f)
+#define ADD(a, b)        _mm256_add_ps((a), (b))
+#define SUB(a, b)        _mm256_sub_ps((a), (b))
+#define MUL(a, b)        _mm256_mul_ps((a), (b))
+#include "FFTKernel.inl"
+#undef V
+#undef WIDTH
+#undef LOAD
+#undef STORE
+#undef SET1
+#undef ADD
+#undef SUB
+#undef MUL
+    }
+#endif
+}
+
+RealFFT::RealFFT(size_t Size, SIMD_LEVEL Level) :
+    m_Size(Size), m_Half(Size / 2), m_Level(SimdSupported(Level) ? Level : SIMD_LEVEL::SCALAR),
+    m_SplitCos(m_Half + 1), m_SplitSin(m_Half + 1), m_Buffers(4 * m_Half)
+{
+    assert(Size >= 8 && (Size & (Size - 1)) == 0);
+
+    // Radix-4 passes while they divide what's left, then radix-2 for a lone factor of two
+    size_t length = m_Half;
+    size_t stride = 1;
+    while(length > 1)
+    {
+        Pass pass;
+        pass.Radix = length % 4 == 0 ? 4 : 2;
+        pass.Length = length;
+        pass.Stride = stride;
+        pass.Twiddles = m_Twiddles.size();
+        if(pass.Radix == 4)
+        {
+            const size_t m = length / 4;
+            m_Twiddles.resize(m_Twiddles.size() + 6 * m);
+            float* pTwiddles = m_Twiddles.data() + pass.Twiddles;
+            for(size_t p = 0; p < m; ++p)
+            {
+                for(size_t k = 1; k <= 3; ++k)
+                {
+                    double angle = -TWO_PI * static_cast<double>(k * p) / static_cast<double>(length);
+                    pTwiddles[(2 * k - 2) * m + p] = static_cast<float>(std::cos(angle));
+                    pTwiddles[(2 * k - 1) * m + p] = static_cast<float>(std::sin(angle));
+                }
+            }
+        }
+        m_Passes.push_back(pass);
+        length /= pass.Radix;
+        stride *= pass.Radix;
+    }
+
+    for(size_t k = 0; k <= m_Half; ++k)
+    {
+        double angle = TWO_PI * static_cast<double>(k) / static_cast<double>(m_Size);
+        m_SplitCos[k] = static_cast<float>(std::cos(angle));
+        m_SplitSin[k] = static_cast<float>(std::sin(angle));
+    }
+}
+
+size_t RealFFT::Size() const
+{
+    return m_Size;
+}
+
+size_t RealFFT::Bins() const
+{
+    return m_Half + 1;
+}
+
+SIMD_LEVEL RealFFT::Level() const
+{
+    return m_Level;
+}
+
+void RealFFT::Forward(const float* pInput, float* pReal, float* pImag)
+{
+    float* pInReal = m_Buffers.data();
+    float* pInImag = pInReal + m_Half;
+    float* pOutReal = pInImag + m_Half;
+    float* pOutImag = pOutReal + m_Half;
+
+    for(size_t n = 0; n < m_Half; ++n)
+    {
+        pInReal[n] = pInput[2 * n];
+        pInImag[n] = pInput[2 * n + 1];
+    }
+
+    for(const Pass& pass : m_Passes)
+    {
+        // The first passes have strides too short for the widest kernel
+        const float* pTwiddles = m_Twiddles.data() + pass.Twiddles;
+#ifdef SIMD_X86
+        if(m_Level == SIMD_LEVEL::AVX2 && pass.Stride >= 8)
+        {
+            PassAVX2(pass, pTwiddles, pInReal, pInImag, pOutReal, pOutImag);
+        }
+        else if(m_Level != SIMD_LEVEL::SCALAR && pass.Stride >= 4)
+        {
+            PassSSE2(pass, pTwiddles, pInReal, pInImag, pOutReal, pOutImag);
+        }
+        else
+#endif
+        {
+            PassScalar(pass, pTwiddles, pInReal, pInImag, pOutReal, pOutImag);
+        }
+        std::swap(pInReal, pOutReal);
+        std::swap(pInImag, pOutImag);
+    }
+
+    // Z, in pInReal and pInImag, is the transform of the even samples plus i times the
+    // odd ones.  Each bin of the real transform is
+    //   X[k] = E[k] + e^(-2 pi i k / Size) O[k]
+    // where E[k] = (Z[k] + conj Z[Half - k]) / 2 is the even samples' transform and
+    // O[k] = -i (Z[k] - conj Z[Half - k]) / 2 the odd ones'.
+    pReal[0] = pInReal[0] + pInImag[0];
+    pImag[0] = 0.0f;
+    pReal[m_Half] = pInReal[0] - pInImag[0];
+    pImag[m_Half] = 0.0f;
+    for(size_t k = 1; k < m_Half; ++k)
+    {
+        const float ar = pInReal[k];
+        const float ai = pInImag[k];
+        const float br = pInReal[m_Half - k];
+        const float bi = pInImag[m_Half - k];
+        const float evenReal = 0.5f * (ar + br);
+        const float evenImag = 0.5f * (ai - bi);
+        const float oddReal = 0.5f * (ai + bi);
+        const float oddImag = -0.5f * (ar - br);
+        const float c = m_SplitCos[k];
+        const float s = m_SplitSin[k];
+        pReal[k] = evenReal + c * oddReal + s * oddImag;
+        pImag[k] = evenImag + c * oddImag - s * oddReal;
+    }
+}
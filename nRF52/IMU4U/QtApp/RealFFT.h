@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "SimdSupport.h"
+
+// Fourier transform of a block of real samples, for spectra.  The Size real samples are
+// treated as Size / 2 complex ones, even samples the real parts and odd the imaginary,
+// put through a complex FFT of half the size, then untangled into the Size / 2 + 1 bins
+// of the real transform.
+//
+// The complex FFT is a Stockham radix-4 one (with a radix-2 pass at the end when the size
+// is an odd power of two), which writes each pass to the other of two buffers so nothing
+// ever needs reordering.  Real and imaginary parts are kept in arrays of their own, so a
+// pass works through eight butterflies per instruction with AVX2 or four with SSE2 once
+// its stride is that wide, which is all but the first pass or two.  Twiddles are worked
+// out up front.  Nothing is allocated after construction, but one RealFFT can only be
+// used by one thread at a time.
+class RealFFT
+{
+    public:
+        // Size is a power of two, at least 8.  Level falls back to SCALAR if the CPU can't
+        // run it.
+        explicit RealFFT(size_t Size, SIMD_LEVEL Level = BestSimdLevel());
+
+        size_t Size() const;
+        size_t Bins() const;   // Size / 2 + 1, from 0 up to half the sample rate
+        SIMD_LEVEL Level() const;
+
+        // Writes Bins() values to each of pReal and pImag, unscaled (bin 0 is the sum of
+        // the input)
+        void Forward(const float* pInput, float* pReal, float* pImag);
+
+        // One pass of the complex FFT, with its twiddles in m_Twiddles
+        struct Pass
+        {
+            size_t Radix;     // 4, or 2 for the last pass
+            size_t Length;    // Of the sub-transforms it splits
+            size_t Stride;    // Between their elements
+            size_t Twiddles;  // Offset of its first in m_Twiddles, as W1 real, W1 imaginary, W2..., W3..., each Length / 4 long
+        };
+
+    private:
+        size_t             m_Size;
+        size_t             m_Half;        // Points in the complex FFT
+        SIMD_LEVEL         m_Level;
+        std::vector<Pass>  m_Passes;
+        std::vector<float> m_Twiddles;
+        std::vector<float> m_SplitCos;    // For untangling bin k, k from 0 to m_Half
+        std::vector<float> m_SplitSin;
+        std::vector<float> m_Buffers;     // Real then imaginary for two buffers of m_Half
+};
@@ -0,0 +1,78 @@
+#include "ReplaySource.h"
+#include <chrono>
+
+ReplaySource::~ReplaySource()
+{
+    Stop();
+}
+
+bool ReplaySource::Start(const std::string& FileName, double Speed, PayloadCallback OnPayload, FinishedCallback OnFinished)
+{
+    Stop();
+    if(!m_Reader.Open(FileName))
+    {
+        return false;
+    }
+
+    m_OnPayload = std::move(OnPayload);
+    m_OnFinished = std::move(OnFinished);
+    m_PayloadsReplayed = 0;
+    m_bStop = false;
+    m_bRunning = true;
+    m_Thread = std::thread(&ReplaySource::Run, this, Speed);
+    return true;
+}
+
+void ReplaySource::Stop()
+{
+    m_bStop = true;
+    if(m_Thread.joinable())
+    {
+        m_Thread.join();
+    }
+    m_Reader.Close();
+}
+
+bool ReplaySource::Running() const
+{
+    return m_bRunning;
+}
+
+uint64_t ReplaySource::PayloadsReplayed() const
+{
+    return m_PayloadsReplayed;
+}
+
+void ReplaySource::Run(double Speed)
+{
+    using Clock = std::chrono::steady_clock;
+
+    CaptureRecord record;
+    Clock::time_point start = Clock::now();
+    bool bHaveFirst = false;
+    uint64_t firstTimeNs = 0;
+
+    while(!m_bStop && m_Reader.Read(record))
+    {
+        if(!bHaveFirst)
+        {
+            firstTimeNs = record.TimeNs;
+            bHaveFirst = true;
+        }
+
+        if(Speed > 0.0)
+        {
+            auto due = start + std::chrono::nanoseconds(static_cast<int64_t>((record.TimeNs - firstTimeNs) / Speed));
+            std::this_thread::sleep_until(due);
+        }
+
+        m_OnPayload(record.TimeNs, record.Device, record.Characteristic, record.Payload.data(), record.Payload.size());
+        ++m_PayloadsReplayed;
+    }
+
+    m_bRunning = false;
+    if(!m_bStop && m_OnFinished)
+    {
+        m_OnFinished();
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include "CaptureFile.h"
+
+// Plays a capture file back on a thread of its own, handing each payload to a callback
+// at the time it originally arrived, scaled by the replay speed.
+class ReplaySource
+{
+    public:
+        static constexpr double MAX_SPEED = 0.0;   // Don't wait between payloads at all
+
+        // TimeNs is when the payload was captured (see CaptureFile.h)
+        using PayloadCallback = std::function<void(uint64_t TimeNs, uint16_t Device, uint16_t Characteristic, const uint8_t* pPayload, size_t Size)>;
+        using FinishedCallback = std::function<void()>;
+
+        ReplaySource() = default;
+        ~ReplaySource();
+
+        // Speed is a multiple of real time, e.g. 1.0 for as captured or 10.0 for ten
+        // times faster, or MAX_SPEED.  The callbacks are called on the replay thread.
+        // Returns false if the file can't be read.
+        bool Start(const std::string& FileName, double Speed, PayloadCallback OnPayload, FinishedCallback OnFinished = nullptr);
+        void Stop();
+
+        bool Running() const;
+        uint64_t PayloadsReplayed() const;
+
+    private:
+        void Run(double Speed);
+
+        CaptureReader         m_Reader;
+        std::thread           m_Thread;
+        PayloadCallback       m_OnPayload;
+        FinishedCallback      m_OnFinished;
+        std::atomic<bool>     m_bStop{false};
+        std::atomic<bool>     m_bRunning{false};
+        std::atomic<uint64_t> m_PayloadsReplayed{0};
+};
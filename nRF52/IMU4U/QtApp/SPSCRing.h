@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Fixed size ring buffer for handing items from one producer thread to one consumer
+// thread without locking.  Push() fails rather than overwrite when the ring is full, so
+// the producer can count what it had to drop.
+template<typename T>
+class SPSCRing
+{
+    public:
+        static constexpr size_t CACHE_LINE_SIZE = 64;
+
+        // Capacity is rounded up to a power of two
+        explicit SPSCRing(size_t Capacity) : m_Items(RoundUpToPowerOfTwo(Capacity)), m_Mask(m_Items.size() - 1)
+        {
+        }
+
+        SPSCRing(const SPSCRing&) = delete;
+        SPSCRing& operator=(const SPSCRing&) = delete;
+
+        // Producer only
+        bool Push(const T& Item)
+        {
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            if(head - m_TailCache == m_Items.size())
+            {
+                m_TailCache = m_Tail.load(std::memory_order_acquire);
+                if(head - m_TailCache == m_Items.size())
+                {
+                    return false;
+                }
+            }
+
+            m_Items[head & m_Mask] = Item;
+            m_Head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only.  Copies up to MaxCount of the oldest items to pItems and returns
+        // how many were copied.
+        size_t Pop(T* pItems, size_t MaxCount)
+        {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            size_t available = m_Head.load(std::memory_order_acquire) - tail;
+            size_t count = available < MaxCount ? available : MaxCount;
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                pItems[i] = m_Items[(tail + i) & m_Mask];
+            }
+
+            m_Tail.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        // Consumer only.  The oldest item, left in the ring, or null if it's empty.
+        const T* Peek() const
+        {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            if(m_Head.load(std::memory_order_acquire) == tail)
+            {
+                return nullptr;
+            }
+            return &m_Items[tail & m_Mask];
+        }
+
+        // Consumer only.  Removes the item Peek() returned.
+        void Discard()
+        {
+            m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        // Only a snapshot when the other side is running
+        size_t Size() const
+        {
+            return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+        }
+
+        size_t Capacity() const
+        {
+            return m_Items.size();
+        }
+
+    private:
+        static size_t RoundUpToPowerOfTwo(size_t Value)
+        {
+            size_t result = 1;
+            while(result < Value)
+            {
+                result <<= 1;
+            }
+            return result;
+        }
+
+        std::vector<T>                           m_Items;
+        const size_t                             m_Mask;
+
+        // Written by the producer.  m_TailCache saves it reading the consumer's cache line
+        // on every push.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_Head{0};
+        size_t                                   m_TailCache = 0;
+
+        // Written by the consumer
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_Tail{0};
+};
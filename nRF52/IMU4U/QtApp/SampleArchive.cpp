@@ -0,0 +1,713 @@
+#include "SampleArchive.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    uint32_t g_CRCTable[256];
+
+    struct CRCTableInit
+    {
+        CRCTableInit()
+        {
+            for(uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for(int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                }
+                g_CRCTable[i] = crc;
+            }
+        }
+    } g_CRCTableInit;
+
+    void PutLittleEndian(uint8_t* pBytes, uint64_t Value, size_t Size)
+    {
+        for(size_t i = 0; i < Size; ++i)
+        {
+            pBytes[i] = static_cast<uint8_t>(Value >> (8 * i));
+        }
+    }
+
+    uint64_t GetLittleEndian(const uint8_t* pBytes, size_t Size)
+    {
+        uint64_t value = 0;
+        for(size_t i = 0; i < Size; ++i)
+        {
+            value |= static_cast<uint64_t>(pBytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    uint64_t ZigZag(int64_t Value)
+    {
+        return (static_cast<uint64_t>(Value) << 1) ^ static_cast<uint64_t>(Value >> 63);
+    }
+
+    int64_t UnZigZag(uint64_t Value)
+    {
+        return static_cast<int64_t>(Value >> 1) ^ -static_cast<int64_t>(Value & 1);
+    }
+
+    void PutVarint(std::vector<uint8_t>& Buffer, uint64_t Value)
+    {
+        while(Value >= 0x80)
+        {
+            Buffer.push_back(static_cast<uint8_t>(Value | 0x80));
+            Value >>= 7;
+        }
+        Buffer.push_back(static_cast<uint8_t>(Value));
+    }
+
+    bool GetVarint(const uint8_t*& pBytes, const uint8_t* pEnd, uint64_t& Value)
+    {
+        Value = 0;
+        for(int shift = 0; shift < 64 && pBytes < pEnd; shift += 7)
+        {
+            uint8_t byte = *pBytes++;
+            Value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int BitWidth(uint64_t Value)
+    {
+        int width = 0;
+        while(Value != 0)
+        {
+            ++width;
+            Value >>= 1;
+        }
+        return width;
+    }
+
+    // One column's value for a sample.  Column 0 is the extended gyro time, column 1 the
+    // accel/mag time relative to it.
+    int64_t ColumnValue(const IMUSample& Sample, uint64_t Time, size_t Column)
+    {
+        const IMUData& data = Sample.Data;
+        switch(Column)
+        {
+            case 0:  return static_cast<int64_t>(Time);
+            case 1:  return static_cast<int32_t>(Sample.AccelMagTime - Sample.GyroTime);
+            case 2:  return data.Mag.X;
+            case 3:  return data.Mag.Y;
+            case 4:  return data.Mag.Z;
+            case 5:  return data.Accel.X;
+            case 6:  return data.Accel.Y;
+            case 7:  return data.Accel.Z;
+            case 8:  return data.Gyro.X;
+            case 9:  return data.Gyro.Y;
+            case 10: return data.Gyro.Z;
+            case 11: return data.MagStatus;
+            case 12: return data.AccelStatus;
+            case 13: return data.GyroStatus;
+            default: return data.ErrorStatus;
+        }
+    }
+
+    void SetColumnValue(IMUSample& Sample, uint64_t& Time, size_t Column, int64_t Value)
+    {
+        IMUData& data = Sample.Data;
+        switch(Column)
+        {
+            case 0:
+                Time = static_cast<uint64_t>(Value);
+                Sample.GyroTime = static_cast<uint32_t>(Time);
+                break;
+            case 1:  Sample.AccelMagTime = Sample.GyroTime + static_cast<uint32_t>(Value); break;
+            case 2:  data.Mag.X = static_cast<int16_t>(Value); break;
+            case 3:  data.Mag.Y = static_cast<int16_t>(Value); break;
+            case 4:  data.Mag.Z = static_cast<int16_t>(Value); break;
+            case 5:  data.Accel.X = static_cast<int16_t>(Value); break;
+            case 6:  data.Accel.Y = static_cast<int16_t>(Value); break;
+            case 7:  data.Accel.Z = static_cast<int16_t>(Value); break;
+            case 8:  data.Gyro.X = static_cast<int16_t>(Value); break;
+            case 9:  data.Gyro.Y = static_cast<int16_t>(Value); break;
+            case 10: data.Gyro.Z = static_cast<int16_t>(Value); break;
+            case 11: data.MagStatus = static_cast<uint8_t>(Value); break;
+            case 12: data.AccelStatus = static_cast<uint8_t>(Value); break;
+            case 13: data.GyroStatus = static_cast<uint8_t>(Value); break;
+            default: data.ErrorStatus = static_cast<uint8_t>(Value); break;
+        }
+    }
+
+    void EncodeColumn(const std::vector<IMUSample>& Samples, const std::vector<uint64_t>& Times, size_t Column,
+                      std::vector<uint8_t>& Buffer)
+    {
+        size_t count = Samples.size();
+        int64_t first = ColumnValue(Samples[0], Times[0], Column);
+        PutVarint(Buffer, ZigZag(first));
+        if(count < 2)
+        {
+            return;
+        }
+
+        // Wrapping arithmetic, so the deltas of any column fit in 64 bits
+        int64_t minDelta = INT64_MAX;
+        uint64_t previous = static_cast<uint64_t>(first);
+        for(size_t i = 1; i < count; ++i)
+        {
+            uint64_t value = static_cast<uint64_t>(ColumnValue(Samples[i], Times[i], Column));
+            minDelta = std::min(minDelta, static_cast<int64_t>(value - previous));
+            previous = value;
+        }
+
+        uint64_t maxOffset = 0;
+        previous = static_cast<uint64_t>(first);
+        for(size_t i = 1; i < count; ++i)
+        {
+            uint64_t value = static_cast<uint64_t>(ColumnValue(Samples[i], Times[i], Column));
+            maxOffset = std::max(maxOffset, value - previous - static_cast<uint64_t>(minDelta));
+            previous = value;
+        }
+        int width = BitWidth(maxOffset);
+
+        PutVarint(Buffer, ZigZag(minDelta));
+        Buffer.push_back(static_cast<uint8_t>(width));
+        if(width == 0)
+        {
+            return;
+        }
+
+        uint64_t bits = 0;
+        int bitCount = 0;
+        previous = static_cast<uint64_t>(first);
+        for(size_t i = 1; i < count; ++i)
+        {
+            uint64_t value = static_cast<uint64_t>(ColumnValue(Samples[i], Times[i], Column));
+            uint64_t offset = value - previous - static_cast<uint64_t>(minDelta);
+            previous = value;
+
+            // At most 32 bits at a time, so the accumulator can't overflow
+            for(int written = 0; written < width; written += 32)
+            {
+                int part = std::min(32, width - written);
+                bits |= ((offset >> written) & ((1ull << part) - 1)) << bitCount;
+                bitCount += part;
+                while(bitCount >= 8)
+                {
+                    Buffer.push_back(static_cast<uint8_t>(bits));
+                    bits >>= 8;
+                    bitCount -= 8;
+                }
+            }
+        }
+        if(bitCount > 0)
+        {
+            Buffer.push_back(static_cast<uint8_t>(bits));
+        }
+    }
+
+    bool DecodeColumn(const uint8_t*& pBytes, const uint8_t* pEnd, size_t Column, std::vector<IMUSample>& Samples,
+                      std::vector<uint64_t>& Times)
+    {
+        size_t count = Samples.size();
+        uint64_t zigzag;
+        if(!GetVarint(pBytes, pEnd, zigzag))
+        {
+            return false;
+        }
+        uint64_t value = static_cast<uint64_t>(UnZigZag(zigzag));
+        SetColumnValue(Samples[0], Times[0], Column, static_cast<int64_t>(value));
+        if(count < 2)
+        {
+            return true;
+        }
+
+        if(!GetVarint(pBytes, pEnd, zigzag) || pBytes >= pEnd)
+        {
+            return false;
+        }
+        uint64_t minDelta = static_cast<uint64_t>(UnZigZag(zigzag));
+        int width = *pBytes++;
+        if(width > 64 || static_cast<size_t>(pEnd - pBytes) < ((count - 1) * width + 7) / 8)
+        {
+            return false;
+        }
+
+        uint64_t bits = 0;
+        int bitCount = 0;
+        for(size_t i = 1; i < count; ++i)
+        {
+            uint64_t offset = 0;
+            for(int read = 0; read < width; read += 32)
+            {
+                int part = std::min(32, width - read);
+                while(bitCount < part)
+                {
+                    bits |= static_cast<uint64_t>(*pBytes++) << bitCount;
+                    bitCount += 8;
+                }
+                offset |= (bits & ((1ull << part) - 1)) << read;
+                bits >>= part;
+                bitCount -= part;
+            }
+
+            value += minDelta + offset;
+            SetColumnValue(Samples[i], Times[i], Column, static_cast<int64_t>(value));
+        }
+        return true;
+    }
+}
+
+uint32_t SampleArchive::CRC32(const uint8_t* pData, size_t Size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for(size_t i = 0; i < Size; ++i)
+    {
+        crc = g_CRCTable[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+SampleArchiveWriter::~SampleArchiveWriter()
+{
+    Close();
+}
+
+bool SampleArchiveWriter::Open(const std::string& FileName)
+{
+    Close();
+    m_pFile = std::fopen(FileName.c_str(), "wb");
+    if(m_pFile == nullptr)
+    {
+        return false;
+    }
+
+    m_Devices.clear();
+    m_Index.clear();
+    m_Offset = 0;
+    m_SamplesWritten = 0;
+    m_bFailed = false;
+    m_bClosing = false;
+
+    uint8_t header[SampleArchive::FILE_HEADER_SIZE] = {};
+    std::memcpy(header, SampleArchive::FILE_MAGIC, sizeof(SampleArchive::FILE_MAGIC));
+    PutLittleEndian(&header[8], SampleArchive::VERSION, 2);
+    WriteBytes(header, sizeof(header));
+
+    m_Thread = std::thread(&SampleArchiveWriter::WriterThread, this);
+    return true;
+}
+
+bool SampleArchiveWriter::IsOpen() const
+{
+    return m_pFile != nullptr;
+}
+
+void SampleArchiveWriter::Append(uint16_t Device, const IMUSample* pSamples, size_t Count)
+{
+    DeviceState& device = m_Devices[Device];
+    device.Pending.Device = Device;
+
+    for(size_t i = 0; i < Count; ++i)
+    {
+        // Carry on from the last time stamp, however many times the 32 bit one has wrapped
+        uint64_t time = pSamples[i].GyroTime;
+        if(device.bHaveTime)
+        {
+            time = device.LastTime + static_cast<uint32_t>(pSamples[i].GyroTime - static_cast<uint32_t>(device.LastTime));
+        }
+        device.LastTime = time;
+        device.bHaveTime = true;
+
+        device.Pending.Samples.push_back(pSamples[i]);
+        device.Pending.Times.push_back(time);
+        if(device.Pending.Samples.size() == SampleArchive::CHUNK_SAMPLES)
+        {
+            Enqueue(device.Pending);
+        }
+    }
+}
+
+void SampleArchiveWriter::Enqueue(Chunk& Pending)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_QueueChanged.wait(lock, [this]() { return m_Queue.size() < MAX_QUEUED_CHUNKS; });
+
+    uint16_t device = Pending.Device;
+    m_Queue.push_back(std::move(Pending));
+    Pending = Chunk();
+    Pending.Device = device;
+    Pending.Samples.reserve(SampleArchive::CHUNK_SAMPLES);
+    Pending.Times.reserve(SampleArchive::CHUNK_SAMPLES);
+    m_QueueChanged.notify_all();
+}
+
+bool SampleArchiveWriter::Close()
+{
+    if(m_pFile == nullptr)
+    {
+        return false;
+    }
+
+    for(auto& device : m_Devices)
+    {
+        if(!device.second.Pending.Samples.empty())
+        {
+            Enqueue(device.second.Pending);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bClosing = true;
+    }
+    m_QueueChanged.notify_all();
+    m_Thread.join();
+
+    std::vector<uint8_t> index(m_Index.size() * SampleArchive::INDEX_ENTRY_SIZE);
+    for(size_t i = 0; i < m_Index.size(); ++i)
+    {
+        uint8_t* pEntry = &index[i * SampleArchive::INDEX_ENTRY_SIZE];
+        PutLittleEndian(&pEntry[0], m_Index[i].Offset, 8);
+        PutLittleEndian(&pEntry[8], m_Index[i].Size, 4);
+        PutLittleEndian(&pEntry[12], m_Index[i].Device, 2);
+        PutLittleEndian(&pEntry[14], m_Index[i].Count, 2);
+        PutLittleEndian(&pEntry[16], m_Index[i].FirstTime, 8);
+        PutLittleEndian(&pEntry[24], m_Index[i].LastTime, 8);
+    }
+
+    uint8_t footer[SampleArchive::FOOTER_SIZE];
+    PutLittleEndian(&footer[0], m_Index.size(), 4);
+    PutLittleEndian(&footer[4], SampleArchive::CRC32(index.data(), index.size()), 4);
+    PutLittleEndian(&footer[8], m_Offset, 8);
+    std::memcpy(&footer[16], SampleArchive::INDEX_MAGIC, sizeof(SampleArchive::INDEX_MAGIC));
+
+    WriteBytes(index.data(), index.size());
+    WriteBytes(footer, sizeof(footer));
+    bool bOK = !m_bFailed && std::fclose(m_pFile) == 0;
+    m_pFile = nullptr;
+    return bOK;
+}
+
+uint64_t SampleArchiveWriter::SamplesWritten() const
+{
+    return m_SamplesWritten;
+}
+
+uint64_t SampleArchiveWriter::BytesWritten() const
+{
+    return m_Offset;
+}
+
+void SampleArchiveWriter::WriterThread()
+{
+    for(;;)
+    {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_QueueChanged.wait(lock, [this]() { return !m_Queue.empty() || m_bClosing; });
+            if(m_Queue.empty())
+            {
+                return;
+            }
+            chunk = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+        m_QueueChanged.notify_all();
+
+        WriteChunk(chunk);
+    }
+}
+
+void SampleArchiveWriter::WriteChunk(const Chunk& Chunk)
+{
+    m_Buffer.assign(SampleArchive::CHUNK_HEADER_SIZE, 0);
+    for(size_t column = 0; column < SampleArchive::COLUMN_COUNT; ++column)
+    {
+        EncodeColumn(Chunk.Samples, Chunk.Times, column, m_Buffer);
+    }
+
+    size_t payloadSize = m_Buffer.size() - SampleArchive::CHUNK_HEADER_SIZE;
+    PutLittleEndian(&m_Buffer[0], SampleArchive::CHUNK_MAGIC, 4);
+    PutLittleEndian(&m_Buffer[4], Chunk.Device, 2);
+    PutLittleEndian(&m_Buffer[6], Chunk.Samples.size(), 2);
+    PutLittleEndian(&m_Buffer[8], payloadSize, 4);
+    PutLittleEndian(&m_Buffer[12], SampleArchive::CRC32(&m_Buffer[SampleArchive::CHUNK_HEADER_SIZE], payloadSize), 4);
+
+    ArchiveChunkInfo info;
+    info.Offset = m_Offset;
+    info.Size = static_cast<uint32_t>(m_Buffer.size());
+    info.Device = Chunk.Device;
+    info.Count = static_cast<uint16_t>(Chunk.Samples.size());
+    info.FirstTime = Chunk.Times.front();
+    info.LastTime = Chunk.Times.back();
+    m_Index.push_back(info);
+
+    WriteBytes(m_Buffer.data(), m_Buffer.size());
+    m_SamplesWritten += Chunk.Samples.size();
+}
+
+bool SampleArchiveWriter::WriteBytes(const void* pData, size_t Size)
+{
+    if(std::fwrite(pData, 1, Size, m_pFile) != Size)
+    {
+        m_bFailed = true;
+        return false;
+    }
+    m_Offset += Size;
+    return true;
+}
+
+SampleArchiveReader::~SampleArchiveReader()
+{
+    Close();
+}
+
+bool SampleArchiveReader::Open(const std::string& FileName)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(FileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_hFile = file;
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    m_hMapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    m_pData = m_hMapping ? static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    m_Size = static_cast<size_t>(size.QuadPart);
+#else
+    int file = open(FileName.c_str(), O_RDONLY);
+    if(file < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if(fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        void* pData = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+        if(pData != MAP_FAILED)
+        {
+            m_pData = static_cast<const uint8_t*>(pData);
+            m_Size = static_cast<size_t>(status.st_size);
+        }
+    }
+    close(file);
+#endif
+    if(m_pData == nullptr || m_Size < SampleArchive::FILE_HEADER_SIZE ||
+       std::memcmp(m_pData, SampleArchive::FILE_MAGIC, sizeof(SampleArchive::FILE_MAGIC)) != 0 ||
+       GetLittleEndian(&m_pData[8], 2) != SampleArchive::VERSION)
+    {
+        Close();
+        return false;
+    }
+
+    // Without a sound index, as when the writer never got to close the file, the chunks
+    // that made it to disk are still found by their headers
+    m_bRecovered = !ReadIndex();
+    if(m_bRecovered)
+    {
+        ScanChunks();
+    }
+
+    std::stable_sort(m_Chunks.begin(), m_Chunks.end(), [](const ArchiveChunkInfo& a, const ArchiveChunkInfo& b)
+    {
+        return a.Device != b.Device ? a.Device < b.Device : a.FirstTime < b.FirstTime;
+    });
+    return true;
+}
+
+bool SampleArchiveReader::ReadIndex()
+{
+    if(m_Size < SampleArchive::FILE_HEADER_SIZE + SampleArchive::FOOTER_SIZE)
+    {
+        return false;
+    }
+
+    const uint8_t* pFooter = &m_pData[m_Size - SampleArchive::FOOTER_SIZE];
+    uint64_t count = GetLittleEndian(&pFooter[0], 4);
+    uint32_t crc = static_cast<uint32_t>(GetLittleEndian(&pFooter[4], 4));
+    uint64_t indexOffset = GetLittleEndian(&pFooter[8], 8);
+    uint64_t indexEnd = m_Size - SampleArchive::FOOTER_SIZE;
+
+    // Checked without adding, so a corrupt footer can't wrap round to a match
+    if(std::memcmp(&pFooter[16], SampleArchive::INDEX_MAGIC, sizeof(SampleArchive::INDEX_MAGIC)) != 0 ||
+       indexOffset > indexEnd || count > (indexEnd - indexOffset) / SampleArchive::INDEX_ENTRY_SIZE ||
+       indexOffset + count * SampleArchive::INDEX_ENTRY_SIZE != indexEnd ||
+       SampleArchive::CRC32(&m_pData[indexOffset], count * SampleArchive::INDEX_ENTRY_SIZE) != crc)
+    {
+        return false;
+    }
+
+    m_Chunks.resize(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        const uint8_t* pEntry = &m_pData[indexOffset + i * SampleArchive::INDEX_ENTRY_SIZE];
+        m_Chunks[i].Offset = GetLittleEndian(&pEntry[0], 8);
+        m_Chunks[i].Size = static_cast<uint32_t>(GetLittleEndian(&pEntry[8], 4));
+        m_Chunks[i].Device = static_cast<uint16_t>(GetLittleEndian(&pEntry[12], 2));
+        m_Chunks[i].Count = static_cast<uint16_t>(GetLittleEndian(&pEntry[14], 2));
+        m_Chunks[i].FirstTime = GetLittleEndian(&pEntry[16], 8);
+        m_Chunks[i].LastTime = GetLittleEndian(&pEntry[24], 8);
+        if(m_Chunks[i].Offset > indexOffset || m_Chunks[i].Size > indexOffset - m_Chunks[i].Offset)
+        {
+            m_Chunks.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SampleArchiveReader::ScanChunks()
+{
+    m_Chunks.clear();
+    std::vector<IMUSample> samples;
+    std::vector<uint64_t> times;
+    size_t offset = SampleArchive::FILE_HEADER_SIZE;
+    while(m_Size - offset >= SampleArchive::CHUNK_HEADER_SIZE)
+    {
+        const uint8_t* pChunk = &m_pData[offset];
+        uint64_t payloadSize = GetLittleEndian(&pChunk[8], 4);
+        if(GetLittleEndian(&pChunk[0], 4) != SampleArchive::CHUNK_MAGIC ||
+           payloadSize > m_Size - offset - SampleArchive::CHUNK_HEADER_SIZE)
+        {
+            break;
+        }
+
+        ArchiveChunkInfo info;
+        info.Offset = offset;
+        info.Size = static_cast<uint32_t>(SampleArchive::CHUNK_HEADER_SIZE + payloadSize);
+        info.Device = static_cast<uint16_t>(GetLittleEndian(&pChunk[4], 2));
+        info.Count = static_cast<uint16_t>(GetLittleEndian(&pChunk[6], 2));
+        m_Chunks.push_back(info);
+
+        // Decoding checks the CRC and gives the time range the index would have held.
+        // Chunks are written whole and in order, so the first bad one is where the file
+        // was cut off.
+        if(!ReadChunk(m_Chunks.size() - 1, samples, &times))
+        {
+            m_Chunks.pop_back();
+            break;
+        }
+        m_Chunks.back().FirstTime = times.front();
+        m_Chunks.back().LastTime = times.back();
+        offset += info.Size;
+    }
+}
+
+void SampleArchiveReader::Close()
+{
+#ifdef _WIN32
+    if(m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+    }
+    if(m_hMapping != nullptr)
+    {
+        CloseHandle(m_hMapping);
+    }
+    if(m_hFile != nullptr)
+    {
+        CloseHandle(m_hFile);
+    }
+    m_hMapping = nullptr;
+    m_hFile = nullptr;
+#else
+    if(m_pData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_pData), m_Size);
+    }
+#endif
+    m_pData = nullptr;
+    m_Size = 0;
+    m_Chunks.clear();
+    m_bRecovered = false;
+}
+
+bool SampleArchiveReader::Recovered() const
+{
+    return m_bRecovered;
+}
+
+const std::vector<ArchiveChunkInfo>& SampleArchiveReader::Chunks() const
+{
+    return m_Chunks;
+}
+
+std::vector<uint16_t> SampleArchiveReader::Devices() const
+{
+    std::vector<uint16_t> devices;
+    for(const auto& chunk : m_Chunks)
+    {
+        if(devices.empty() || devices.back() != chunk.Device)
+        {
+            devices.push_back(chunk.Device);
+        }
+    }
+    return devices;
+}
+
+long SampleArchiveReader::FindChunk(uint16_t Device, uint64_t Time) const
+{
+    // The first of the device's chunks that ends at or after Time
+    auto it = std::lower_bound(m_Chunks.begin(), m_Chunks.end(), std::make_pair(Device, Time),
+                               [](const ArchiveChunkInfo& Chunk, const std::pair<uint16_t, uint64_t>& Key)
+    {
+        return Chunk.Device != Key.first ? Chunk.Device < Key.first : Chunk.LastTime < Key.second;
+    });
+
+    if(it == m_Chunks.end() || it->Device != Device)
+    {
+        return -1;
+    }
+    return static_cast<long>(it - m_Chunks.begin());
+}
+
+bool SampleArchiveReader::ReadChunk(size_t Index, std::vector<IMUSample>& Samples, std::vector<uint64_t>* pTimes) const
+{
+    const ArchiveChunkInfo& info = m_Chunks[Index];
+    const uint8_t* pChunk = &m_pData[info.Offset];
+    size_t payloadSize = static_cast<size_t>(GetLittleEndian(&pChunk[8], 4));
+    if(GetLittleEndian(&pChunk[0], 4) != SampleArchive::CHUNK_MAGIC || info.Count == 0 ||
+       SampleArchive::CHUNK_HEADER_SIZE + payloadSize != info.Size)
+    {
+        return false;
+    }
+
+    const uint8_t* pBytes = &pChunk[SampleArchive::CHUNK_HEADER_SIZE];
+    const uint8_t* pEnd = pBytes + payloadSize;
+    if(SampleArchive::CRC32(pBytes, payloadSize) != GetLittleEndian(&pChunk[12], 4))
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> times;
+    std::vector<uint64_t>& timesOut = pTimes != nullptr ? *pTimes : times;
+    Samples.resize(info.Count);
+    timesOut.resize(info.Count);
+
+    // Column 1 is relative to the gyro time decoded in column 0
+    for(size_t column = 0; column < SampleArchive::COLUMN_COUNT; ++column)
+    {
+        if(!DecodeColumn(pBytes, pEnd, column, Samples, timesOut))
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "IMUData.h"
+
+// Long recordings of decoded samples from any number of devices.  Samples are stored in
+// chunks of up to CHUNK_SAMPLES from one device, each field in a column of its own:
+// delta encoded, then bit packed at the narrowest width that holds every delta less the
+// smallest.  Sample times are extended to 64 bits per device so they never wrap, which
+// lets a footer index of every chunk's time range find any moment with a binary search.
+//
+// File layout, everything little endian:
+//   File header:  FILE_MAGIC, uint16 VERSION, uint16 reserved
+//   Chunks:       CHUNK_MAGIC, uint16 device, uint16 sample count, uint32 payload size,
+//                 uint32 CRC-32 of the payload, then the payload's COLUMN_COUNT columns
+//   Index:        One INDEX_ENTRY_SIZE entry per chunk (see ArchiveChunkInfo)
+//   Footer:       uint32 chunk count, uint32 CRC-32 of the index, uint64 index offset,
+//                 INDEX_MAGIC
+// Each column is the first value as a zigzag varint, then (with more than one sample)
+// the smallest following delta as a zigzag varint, a uint8 bit width and the remaining
+// deltas less the smallest packed least significant bit first.
+namespace SampleArchive
+{
+    constexpr char     FILE_MAGIC[8] = { 'I', 'M', 'U', '4', 'U', 'A', 'R', 'C' };
+    constexpr char     INDEX_MAGIC[8] = { 'I', 'M', 'U', '4', 'U', 'I', 'D', 'X' };
+    constexpr uint32_t CHUNK_MAGIC = 0x4B4E4843;   // "CHNK"
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t   FILE_HEADER_SIZE = 12;
+    constexpr size_t   CHUNK_HEADER_SIZE = 16;
+    constexpr size_t   INDEX_ENTRY_SIZE = 32;
+    constexpr size_t   FOOTER_SIZE = 24;
+    constexpr size_t   COLUMN_COUNT = 15;
+    constexpr size_t   CHUNK_SAMPLES = 4096;
+
+    uint32_t CRC32(const uint8_t* pData, size_t Size);
+}
+
+struct ArchiveChunkInfo
+{
+    uint64_t Offset = 0;     // Of the chunk header
+    uint32_t Size = 0;       // Header and payload
+    uint16_t Device = 0;
+    uint16_t Count = 0;
+    uint64_t FirstTime = 0;  // Extended device time stamps of the first and last sample
+    uint64_t LastTime = 0;
+};
+
+// Writing happens on a thread of its own.  Append() only copies the samples, and blocks
+// if MAX_QUEUED_CHUNKS full chunks are already waiting, so memory use stays bounded
+// however far the disk falls behind.
+class SampleArchiveWriter
+{
+    public:
+        static constexpr size_t MAX_QUEUED_CHUNKS = 8;
+
+        SampleArchiveWriter() = default;
+        ~SampleArchiveWriter();
+
+        bool Open(const std::string& FileName);
+
+        // Samples from each device must be in time order.  Only call from one thread.
+        void Append(uint16_t Device, const IMUSample* pSamples, size_t Count);
+
+        // Writes out what's left and the index.  Returns false if anything failed to write.
+        bool Close();
+        bool IsOpen() const;
+
+        uint64_t SamplesWritten() const;
+        uint64_t BytesWritten() const;
+
+    private:
+        struct Chunk
+        {
+            uint16_t               Device = 0;
+            std::vector<IMUSample> Samples;
+            std::vector<uint64_t>  Times;
+        };
+
+        struct DeviceState
+        {
+            Chunk    Pending;
+            uint64_t LastTime = 0;
+            bool     bHaveTime = false;
+        };
+
+        void Enqueue(Chunk& Pending);
+        void WriterThread();
+        void WriteChunk(const Chunk& Chunk);
+        bool WriteBytes(const void* pData, size_t Size);
+
+        std::FILE*                      m_pFile = nullptr;
+        std::map<uint16_t, DeviceState> m_Devices;
+        std::deque<Chunk>               m_Queue;
+        std::mutex                      m_Mutex;
+        std::condition_variable         m_QueueChanged;
+        std::thread                     m_Thread;
+        bool                            m_bClosing = false;
+
+        // Only touched by the writer thread until it's joined
+        std::vector<uint8_t>            m_Buffer;
+        std::vector<ArchiveChunkInfo>   m_Index;
+        uint64_t                        m_Offset = 0;
+        uint64_t                        m_SamplesWritten = 0;
+        bool                            m_bFailed = false;
+};
+
+// Reads an archive by mapping it into memory.  Everything is const once it's open, so
+// chunks can be decoded from several threads at once.
+class SampleArchiveReader
+{
+    public:
+        SampleArchiveReader() = default;
+        ~SampleArchiveReader();
+        SampleArchiveReader(const SampleArchiveReader&) = delete;
+        SampleArchiveReader& operator=(const SampleArchiveReader&) = delete;
+
+        // Fails if the file isn't an archive.  An archive with a missing or damaged index,
+        // as one cut off before the writer closed it, is opened from its chunk headers
+        // instead, up to the first chunk that's incomplete or fails its CRC.
+        bool Open(const std::string& FileName);
+        void Close();
+
+        // Whether Open had to find the chunks without the index
+        bool Recovered() const;
+
+        // Sorted by device, then time
+        const std::vector<ArchiveChunkInfo>& Chunks() const;
+        std::vector<uint16_t> Devices() const;
+
+        // Index into Chunks() of the chunk holding Device's first sample at or after
+        // Time, or -1 if there isn't one.  A binary search of the index.
+        long FindChunk(uint16_t Device, uint64_t Time) const;
+
+        // Decodes a chunk into Samples, and their extended time stamps into pTimes if
+        // given.  The vectors are reused.  Returns false if the chunk's CRC is wrong.
+        bool ReadChunk(size_t Index, std::vector<IMUSample>& Samples, std::vector<uint64_t>* pTimes = nullptr) const;
+
+    private:
+        bool ReadIndex();
+        void ScanChunks();
+
+        const uint8_t*                m_pData = nullptr;
+        size_t                        m_Size = 0;
+#ifdef _WIN32
+        void*                         m_hFile = nullptr;
+        void*                         m_hMapping = nullptr;
+#endif
+        std::vector<ArchiveChunkInfo> m_Chunks;
+        bool                          m_bRecovered = false;
+};
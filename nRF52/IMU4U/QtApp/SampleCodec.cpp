@@ -0,0 +1,135 @@
+#include "SampleCodec.h"
+#include <cstring>
+
+namespace
+{
+    constexpr int FIELD_COUNT = 15;      // Two time stamps, nine axes and four status bytes
+    constexpr size_t MAX_VARINT_SIZE = 5;
+
+    uint32_t ZigZagEncode(int32_t Value)
+    {
+        return (static_cast<uint32_t>(Value) << 1) ^ static_cast<uint32_t>(Value >> 31);
+    }
+
+    int32_t ZigZagDecode(uint32_t Value)
+    {
+        return static_cast<int32_t>(Value >> 1) ^ -static_cast<int32_t>(Value & 1);
+    }
+
+    size_t WriteVarInt(uint8_t* pBuffer, uint32_t Value)
+    {
+        size_t length = 0;
+        while(Value >= 0x80)
+        {
+            pBuffer[length++] = static_cast<uint8_t>(Value | 0x80);
+            Value >>= 7;
+        }
+        pBuffer[length++] = static_cast<uint8_t>(Value);
+        return length;
+    }
+
+    size_t ReadVarInt(const uint8_t* pBuffer, size_t BufferSize, uint32_t& Value)
+    {
+        uint32_t value = 0;
+        for(size_t i = 0; i < BufferSize && i < MAX_VARINT_SIZE; ++i)
+        {
+            value |= static_cast<uint32_t>(pBuffer[i] & 0x7F) << (7 * i);
+            if((pBuffer[i] & 0x80) == 0)
+            {
+                Value = value;
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    // The sample's fields as deltas from Previous, in the order they're encoded
+    void Deltas(const IMUSample& Sample, const IMUSample& Previous, int32_t* pDeltas)
+    {
+        pDeltas[0]  = static_cast<int32_t>(Sample.AccelMagTime - Previous.AccelMagTime);
+        pDeltas[1]  = static_cast<int32_t>(Sample.GyroTime - Previous.GyroTime);
+        pDeltas[2]  = Sample.Data.Mag.X - Previous.Data.Mag.X;
+        pDeltas[3]  = Sample.Data.Mag.Y - Previous.Data.Mag.Y;
+        pDeltas[4]  = Sample.Data.Mag.Z - Previous.Data.Mag.Z;
+        pDeltas[5]  = Sample.Data.Accel.X - Previous.Data.Accel.X;
+        pDeltas[6]  = Sample.Data.Accel.Y - Previous.Data.Accel.Y;
+        pDeltas[7]  = Sample.Data.Accel.Z - Previous.Data.Accel.Z;
+        pDeltas[8]  = Sample.Data.Gyro.X - Previous.Data.Gyro.X;
+        pDeltas[9]  = Sample.Data.Gyro.Y - Previous.Data.Gyro.Y;
+        pDeltas[10] = Sample.Data.Gyro.Z - Previous.Data.Gyro.Z;
+        pDeltas[11] = Sample.Data.MagStatus - Previous.Data.MagStatus;
+        pDeltas[12] = Sample.Data.AccelStatus - Previous.Data.AccelStatus;
+        pDeltas[13] = Sample.Data.GyroStatus - Previous.Data.GyroStatus;
+        pDeltas[14] = Sample.Data.ErrorStatus - Previous.Data.ErrorStatus;
+    }
+}
+
+void SampleCodec::Reset()
+{
+    m_Previous = {};
+}
+
+size_t SampleCodec::Encode(const IMUSample& Sample, uint8_t* pBuffer, size_t BufferSize)
+{
+    int32_t deltas[FIELD_COUNT];
+    uint8_t encoded[MAX_SAMPLE_SIZE];
+    size_t length = 0;
+
+    Deltas(Sample, m_Previous, deltas);
+    for(int i = 0; i < FIELD_COUNT; ++i)
+    {
+        length += WriteVarInt(&encoded[length], ZigZagEncode(deltas[i]));
+    }
+
+    if(length > BufferSize)
+    {
+        return 0;
+    }
+
+    std::memcpy(pBuffer, encoded, length);
+    m_Previous = Sample;
+    return length;
+}
+
+size_t SampleCodec::Decode(const uint8_t* pBuffer, size_t BufferSize, IMUSample& Sample)
+{
+    int32_t deltas[FIELD_COUNT];
+    size_t offset = 0;
+
+    for(int i = 0; i < FIELD_COUNT; ++i)
+    {
+        uint32_t value;
+        size_t length = ReadVarInt(&pBuffer[offset], BufferSize - offset, value);
+        if(length == 0)
+        {
+            return 0;
+        }
+        deltas[i] = ZigZagDecode(value);
+        offset += length;
+    }
+
+    const IMUSample& prev = m_Previous;
+    IMUSample sample;
+
+    sample.AccelMagTime = prev.AccelMagTime + static_cast<uint32_t>(deltas[0]);
+    sample.GyroTime     = prev.GyroTime + static_cast<uint32_t>(deltas[1]);
+
+    sample.Data.Mag.X   = static_cast<int16_t>(prev.Data.Mag.X + deltas[2]);
+    sample.Data.Mag.Y   = static_cast<int16_t>(prev.Data.Mag.Y + deltas[3]);
+    sample.Data.Mag.Z   = static_cast<int16_t>(prev.Data.Mag.Z + deltas[4]);
+    sample.Data.Accel.X = static_cast<int16_t>(prev.Data.Accel.X + deltas[5]);
+    sample.Data.Accel.Y = static_cast<int16_t>(prev.Data.Accel.Y + deltas[6]);
+    sample.Data.Accel.Z = static_cast<int16_t>(prev.Data.Accel.Z + deltas[7]);
+    sample.Data.Gyro.X  = static_cast<int16_t>(prev.Data.Gyro.X + deltas[8]);
+    sample.Data.Gyro.Y  = static_cast<int16_t>(prev.Data.Gyro.Y + deltas[9]);
+    sample.Data.Gyro.Z  = static_cast<int16_t>(prev.Data.Gyro.Z + deltas[10]);
+
+    sample.Data.MagStatus   = static_cast<uint8_t>(prev.Data.MagStatus + deltas[11]);
+    sample.Data.AccelStatus = static_cast<uint8_t>(prev.Data.AccelStatus + deltas[12]);
+    sample.Data.GyroStatus  = static_cast<uint8_t>(prev.Data.GyroStatus + deltas[13]);
+    sample.Data.ErrorStatus = static_cast<uint8_t>(prev.Data.ErrorStatus + deltas[14]);
+
+    m_Previous = sample;
+    Sample = sample;
+    return offset;
+}
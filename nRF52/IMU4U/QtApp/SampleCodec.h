@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "IMUData.h"
+
+// The host side of Firmware/SampleCodec.c.  Each field of a sample is stored as the
+// zigzag encoded difference from the previous sample, written as a variable length
+// integer.  The byte format must match the firmware's exactly.
+class SampleCodec
+{
+    public:
+        static constexpr size_t MAX_SAMPLE_SIZE = 45;
+
+        // Call before each independently decodable block or packet
+        void Reset();
+
+        // Returns the number of bytes written, or zero if the sample doesn't fit (in
+        // which case the codec's state is left untouched)
+        size_t Encode(const IMUSample& Sample, uint8_t* pBuffer, size_t BufferSize);
+
+        // Returns the number of bytes consumed, or zero if the buffer doesn't hold a
+        // complete sample
+        size_t Decode(const uint8_t* pBuffer, size_t BufferSize, IMUSample& Sample);
+
+    private:
+        IMUSample m_Previous = {};
+};
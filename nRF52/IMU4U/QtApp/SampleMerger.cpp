@@ -0,0 +1,146 @@
+#include "SampleMerger.h"
+#include <algorithm>
+#include <functional>
+
+SampleMerger::SampleMerger(size_t DeviceCount, uint64_t MaxDelay, size_t RingSize, LATE_POLICY LatePolicy) :
+    m_MaxDelay(MaxDelay), m_LatePolicy(LatePolicy), m_bInHeap(DeviceCount, false)
+{
+    for(size_t i = 0; i < DeviceCount; ++i)
+    {
+        m_Inputs.push_back(std::make_unique<Input>(RingSize));
+    }
+    m_Heap.reserve(DeviceCount);
+}
+
+bool SampleMerger::Push(uint16_t Device, uint64_t Time, const IMUSample& Sample)
+{
+    Input& input = *m_Inputs[Device];
+    if(!input.Ring.Push(TimedSample{Time, Sample}))
+    {
+        return false;
+    }
+
+    // Published after the sample, so the consumer finds everything up to LatestTime in
+    // the ring
+    if(!input.bPushed.load(std::memory_order_relaxed) || Time > input.LatestTime.load(std::memory_order_relaxed))
+    {
+        input.LatestTime.store(Time, std::memory_order_release);
+    }
+    input.bPushed.store(true, std::memory_order_release);
+    return true;
+}
+
+size_t SampleMerger::Pop(MergedSample* pSamples, size_t MaxCount, bool bDrain)
+{
+    uint64_t watermark = UpdateWatermark(bDrain);
+    for(uint16_t device = 0; device < m_Inputs.size(); ++device)
+    {
+        if(!m_bInHeap[device])
+        {
+            AddToHeap(device);
+        }
+    }
+
+    size_t count = 0;
+    while(count < MaxCount && !m_Heap.empty() && m_Heap.front().first <= watermark)
+    {
+        std::pop_heap(m_Heap.begin(), m_Heap.end(), std::greater<HeapEntry>());
+        uint16_t device = m_Heap.back().second;
+        m_Heap.pop_back();
+        m_bInHeap[device] = false;
+
+        Input& input = *m_Inputs[device];
+        const TimedSample* pNext = input.Ring.Peek();
+        bool bLate = m_bAnyOut && pNext->Time < m_LastTimeOut;
+        if(bLate)
+        {
+            ++m_SamplesLate;
+        }
+
+        if(bLate && m_LatePolicy == LATE_POLICY::DROP)
+        {
+            ++m_LateDropped;
+        }
+        else
+        {
+            MergedSample& sample = pSamples[count++];
+            sample.Time = pNext->Time;
+            sample.Device = device;
+            sample.bLate = bLate;
+            sample.Sample = pNext->Sample;
+            if(!bLate)
+            {
+                m_LastTimeOut = pNext->Time;
+                m_bAnyOut = true;
+            }
+        }
+
+        input.Ring.Discard();
+        AddToHeap(device);
+    }
+    return count;
+}
+
+size_t SampleMerger::DeviceCount() const
+{
+    return m_Inputs.size();
+}
+
+uint64_t SampleMerger::Watermark() const
+{
+    return m_Watermark;
+}
+
+uint64_t SampleMerger::SamplesLate() const
+{
+    return m_SamplesLate;
+}
+
+uint64_t SampleMerger::SamplesDropped() const
+{
+    return m_LateDropped;
+}
+
+// Read before looking in the rings, so every sample up to the watermark is already there
+uint64_t SampleMerger::UpdateWatermark(bool bDrain)
+{
+    if(bDrain)
+    {
+        return UINT64_MAX;
+    }
+
+    uint64_t earliest = UINT64_MAX;
+    uint64_t latest = 0;
+    for(const auto& pInput : m_Inputs)
+    {
+        if(!pInput->bPushed.load(std::memory_order_acquire))
+        {
+            continue;
+        }
+        uint64_t time = pInput->LatestTime.load(std::memory_order_acquire);
+        earliest = std::min(earliest, time);
+        latest = std::max(latest, time);
+    }
+
+    uint64_t watermark = earliest != UINT64_MAX ? earliest : 0;
+    if(latest > m_MaxDelay)
+    {
+        watermark = std::max(watermark, latest - m_MaxDelay);
+    }
+
+    // Never goes back, even if a device's clock does
+    watermark = std::max(watermark, m_Watermark.load(std::memory_order_relaxed));
+    m_Watermark.store(watermark, std::memory_order_relaxed);
+    return watermark;
+}
+
+void SampleMerger::AddToHeap(uint16_t Device)
+{
+    const TimedSample* pNext = m_Inputs[Device]->Ring.Peek();
+    if(pNext)
+    {
+        m_Heap.emplace_back(pNext->Time, Device);
+        std::push_heap(m_Heap.begin(), m_Heap.end(), std::greater<HeapEntry>());
+        m_bInHeap[Device] = true;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "IMUData.h"
+#include "SPSCRing.h"
+
+// A sample from one of several devices, on a time base they all share
+struct MergedSample
+{
+    uint64_t  Time = 0;
+    uint16_t  Device = 0;
+    bool      bLate = false;   // Arrived after later samples had already gone out
+    IMUSample Sample;
+};
+
+// Merges the sample streams of several devices into one in time order, as they arrive.
+// Each device has an SPSC ring of its own to push into from its own thread, and one
+// consumer thread pops the merged stream.
+//
+// A sample only goes out once every device that has pushed anything has pushed one at
+// least as late, so it can't be overtaken.  Devices that haven't pushed yet aren't waited
+// for, so there can be more inputs than devices in use.  A device that falls silent would hold everything up, so samples are
+// also let go once they're MaxDelay older than the latest pushed by any device; this
+// bounds the delay through the merge.  Anything pushed later than that is older than
+// what's already gone out, and is either dropped or passed on marked late.
+//
+// Steady state work allocates nothing: the rings and the heap of each device's oldest
+// sample are sized up front.
+class SampleMerger
+{
+    public:
+        enum class LATE_POLICY
+        {
+            DROP,
+            EMIT    // Passed on out of order, with bLate set
+        };
+
+        // Times are in whatever unit the caller likes (nanoseconds, say), as is MaxDelay
+        SampleMerger(size_t DeviceCount, uint64_t MaxDelay, size_t RingSize, LATE_POLICY LatePolicy = LATE_POLICY::DROP);
+
+        // Only call from Device's producer thread.  Times from each device should rise.
+        // Returns false, and leaves the sample out, if Device's ring is full.
+        bool Push(uint16_t Device, uint64_t Time, const IMUSample& Sample);
+
+        // Only call from the consumer thread.  Copies up to MaxCount merged samples to
+        // pSamples, returning how many.  With bDrain, everything pushed so far goes out
+        // without waiting for the other devices, e.g. at the end of a replay.
+        size_t Pop(MergedSample* pSamples, size_t MaxCount, bool bDrain = false);
+
+        size_t DeviceCount() const;
+        uint64_t Watermark() const;   // Samples up to this time have gone out
+        uint64_t SamplesLate() const;
+        uint64_t SamplesDropped() const;   // Late samples left out with LATE_POLICY::DROP
+
+    private:
+        struct TimedSample
+        {
+            uint64_t  Time;
+            IMUSample Sample;
+        };
+
+        // Written by its producer
+        struct Input
+        {
+            explicit Input(size_t RingSize) : Ring(RingSize)
+            {
+            }
+
+            SPSCRing<TimedSample>  Ring;
+            std::atomic<uint64_t>  LatestTime{0};
+            std::atomic<bool>      bPushed{false};
+        };
+
+        using HeapEntry = std::pair<uint64_t, uint16_t>;   // Time and device of the oldest sample in a ring
+
+        uint64_t UpdateWatermark(bool bDrain);
+        void AddToHeap(uint16_t Device);
+
+        std::vector<std::unique_ptr<Input>> m_Inputs;
+        uint64_t                            m_MaxDelay;
+        LATE_POLICY                         m_LatePolicy;
+
+        // Only touched by the consumer
+        std::vector<HeapEntry>              m_Heap;         // Min heap, capacity reserved for every device
+        std::vector<bool>                   m_bInHeap;
+        uint64_t                            m_LastTimeOut = 0;
+        bool                                m_bAnyOut = false;
+        std::atomic<uint64_t>               m_Watermark{0};
+        std::atomic<uint64_t>               m_SamplesLate{0};
+        std::atomic<uint64_t>               m_LateDropped{0};
+};
@@ -0,0 +1,121 @@
+#include "SamplePublisher.h"
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SHARED_MEMORY 1
+#endif
+
+SamplePublisher::~SamplePublisher()
+{
+    Close();
+}
+
+bool SamplePublisher::Open(const std::string& Name, size_t Capacity)
+{
+    Close();
+#ifdef SHARED_MEMORY
+    uint64_t capacity = 1;
+    while(capacity < Capacity)
+    {
+        capacity <<= 1;
+    }
+    size_t size = sizeof(SharedRingHeader) + capacity * sizeof(SharedRingSlot);
+
+    // A fresh object rather than truncating the old one under its subscribers' feet
+    shm_unlink(Name.c_str());
+    int fd = shm_open(Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    if(ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        shm_unlink(Name.c_str());
+        return false;
+    }
+    void* pMapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(pMapping == MAP_FAILED)
+    {
+        shm_unlink(Name.c_str());
+        return false;
+    }
+
+    // The new object is all zeros, which is every slot empty
+    m_Name = Name;
+    m_pMapping = pMapping;
+    m_MappingSize = size;
+    m_pHeader = new(pMapping) SharedRingHeader;
+    m_pSlots = reinterpret_cast<SharedRingSlot*>(static_cast<uint8_t*>(pMapping) + sizeof(SharedRingHeader));
+    m_Mask = capacity - 1;
+    m_Head = 0;
+    m_pHeader->Version = SharedRing::VERSION;
+    m_pHeader->SlotSize = sizeof(SharedRingSlot);
+    m_pHeader->Capacity = capacity;
+    m_pHeader->Head.store(0, std::memory_order_relaxed);
+    m_pHeader->bOpen.store(1, std::memory_order_relaxed);
+
+    // Subscribers check the magic first, so it goes in last
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(m_pHeader->Magic, SharedRing::MAGIC, sizeof(SharedRing::MAGIC));
+    return true;
+#else
+    (void)Name;
+    (void)Capacity;
+    return false;
+#endif
+}
+
+void SamplePublisher::Close()
+{
+#ifdef SHARED_MEMORY
+    if(m_pMapping)
+    {
+        m_pHeader->bOpen.store(0, std::memory_order_release);
+        munmap(m_pMapping, m_MappingSize);
+        shm_unlink(m_Name.c_str());
+    }
+#endif
+    m_pMapping = nullptr;
+    m_pHeader = nullptr;
+    m_pSlots = nullptr;
+}
+
+bool SamplePublisher::IsOpen() const
+{
+    return m_pMapping != nullptr;
+}
+
+void SamplePublisher::Publish(uint16_t Device, const IMUSample* pSamples, const uint64_t* pTimes, size_t Count)
+{
+    if(!m_pMapping)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < Count; ++i)
+    {
+        uint64_t n = m_Head + i;
+        SharedRingSlot& slot = m_pSlots[n & m_Mask];
+
+        // Marked as being written before any of the sample changes
+        slot.Sequence.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.Sample.Time = pTimes[i];
+        slot.Sample.Device = Device;
+        slot.Sample.Sample = pSamples[i];
+        slot.Sequence.store(2 * n + 2, std::memory_order_release);
+    }
+    m_Head += Count;
+    m_pHeader->Head.store(m_Head, std::memory_order_release);
+}
+
+uint64_t SamplePublisher::Published() const
+{
+    return m_Head;
+}
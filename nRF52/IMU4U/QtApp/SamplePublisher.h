@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "SharedSampleRing.h"
+
+// Writes decoded samples into a POSIX shared memory ring for other processes on this host
+// to read with SampleSubscriber (see SharedSampleRing.h).  Only one thread may publish at
+// a time.  Open() fails where there's no POSIX shared memory, e.g. Windows.
+class SamplePublisher
+{
+    public:
+        SamplePublisher() = default;
+        ~SamplePublisher();
+
+        SamplePublisher(const SamplePublisher&) = delete;
+        SamplePublisher& operator=(const SamplePublisher&) = delete;
+
+        // Name is a shared memory object name such as "/IMU4U".  Whatever had the name
+        // before is unlinked, so subscribers still mapping it see it closed and carry on
+        // safely until they reopen.  Capacity is rounded up to a power of two.
+        bool Open(const std::string& Name, size_t Capacity = SharedRing::DEFAULT_CAPACITY);
+        void Close();   // Marks the ring closed and unlinks it
+        bool IsOpen() const;
+
+        // Count samples from Device, pTimes[i] being pSamples[i]'s time.  Subscribers see
+        // the whole block at once.
+        void Publish(uint16_t Device, const IMUSample* pSamples, const uint64_t* pTimes, size_t Count);
+
+        uint64_t Published() const;
+
+    private:
+        std::string       m_Name;
+        void*             m_pMapping = nullptr;
+        size_t            m_MappingSize = 0;
+        SharedRingHeader* m_pHeader = nullptr;
+        SharedRingSlot*   m_pSlots = nullptr;
+        uint64_t          m_Mask = 0;
+        uint64_t          m_Head = 0;
+};
@@ -0,0 +1,376 @@
+#include "SampleServer.h"
+#include <cerrno>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define POSIX_SOCKETS 1
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0   // macOS, where SO_NOSIGPIPE is set on each socket instead
+#endif
+
+namespace
+{
+    void Put16(uint8_t* p, uint16_t Value)
+    {
+        p[0] = static_cast<uint8_t>(Value);
+        p[1] = static_cast<uint8_t>(Value >> 8);
+    }
+
+    void Put32(uint8_t* p, uint32_t Value)
+    {
+        Put16(p, static_cast<uint16_t>(Value));
+        Put16(p + 2, static_cast<uint16_t>(Value >> 16));
+    }
+
+    void Put64(uint8_t* p, uint64_t Value)
+    {
+        Put32(p, static_cast<uint32_t>(Value));
+        Put32(p + 4, static_cast<uint32_t>(Value >> 32));
+    }
+
+    uint8_t* PutAxes(uint8_t* p, const ThreeDimData& Axes)
+    {
+        Put16(p, static_cast<uint16_t>(Axes.X));
+        Put16(p + 2, static_cast<uint16_t>(Axes.Y));
+        Put16(p + 4, static_cast<uint16_t>(Axes.Z));
+        return p + 6;
+    }
+}
+
+SampleServer::SampleServer() : m_Ring(RING_SIZE), m_Batch(SampleStream::MAX_FRAME_SAMPLES)
+{
+}
+
+SampleServer::~SampleServer()
+{
+    Close();
+}
+
+bool SampleServer::Open(uint16_t Port, bool bLan, size_t QueueFrames)
+{
+    Close();
+#ifdef POSIX_SOCKETS
+    int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(listenSocket < 0)
+    {
+        return false;
+    }
+    int one = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(Port);
+    address.sin_addr.s_addr = htonl(bLan ? INADDR_ANY : INADDR_LOOPBACK);
+    socklen_t addressSize = sizeof(address);
+    int fds[2];
+    if(bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenSocket, SOMAXCONN) != 0 ||
+       getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &addressSize) != 0 || pipe(fds) != 0)
+    {
+        close(listenSocket);
+        return false;
+    }
+    fcntl(listenSocket, F_SETFL, O_NONBLOCK);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    m_ListenSocket = listenSocket;
+    m_WakeRead = fds[0];
+    m_WakeWrite = fds[1];
+    m_Port = ntohs(address.sin_port);
+    m_QueueFrames = QueueFrames > 0 ? QueueFrames : 1;
+    m_bStop = false;
+    m_Thread = std::thread(&SampleServer::ServerThread, this);
+    return true;
+#else
+    (void)Port;
+    (void)bLan;
+    (void)QueueFrames;
+    return false;
+#endif
+}
+
+void SampleServer::Close()
+{
+#ifdef POSIX_SOCKETS
+    if(m_Thread.joinable())
+    {
+        m_bStop = true;
+        Wake();
+        m_Thread.join();
+    }
+    for(auto& pClient : m_Clients)
+    {
+        close(pClient->Socket);
+    }
+    m_Clients.clear();
+    m_ClientCount = 0;
+    for(int* pSocket : { &m_ListenSocket, &m_WakeRead, &m_WakeWrite })
+    {
+        if(*pSocket >= 0)
+        {
+            close(*pSocket);
+            *pSocket = -1;
+        }
+    }
+#endif
+}
+
+bool SampleServer::IsOpen() const
+{
+    return m_ListenSocket >= 0;
+}
+
+uint16_t SampleServer::Port() const
+{
+    return m_Port;
+}
+
+void SampleServer::Publish(uint16_t Device, const IMUSample* pSamples, const uint64_t* pTimes, size_t Count)
+{
+    if(m_ListenSocket < 0)
+    {
+        return;
+    }
+
+    MergedSample sample;
+    sample.Device = Device;
+    for(size_t i = 0; i < Count; ++i)
+    {
+        sample.Time = pTimes[i];
+        sample.Sample = pSamples[i];
+        if(!m_Ring.Push(sample))
+        {
+            ++m_SamplesDropped;
+        }
+    }
+    if(Count > 0 && !m_bWakePending.exchange(true))
+    {
+        Wake();
+    }
+}
+
+size_t SampleServer::Clients() const
+{
+    return m_ClientCount;
+}
+
+uint64_t SampleServer::FramesSent() const
+{
+    return m_FramesSent;
+}
+
+uint64_t SampleServer::FramesDropped() const
+{
+    return m_FramesDropped;
+}
+
+uint64_t SampleServer::SamplesDropped() const
+{
+    return m_SamplesDropped;
+}
+
+void SampleServer::ServerThread()
+{
+#ifdef POSIX_SOCKETS
+    std::vector<pollfd> fds;
+    while(!m_bStop)
+    {
+        // The listening socket and wake pipe first, then a client per entry
+        fds.clear();
+        fds.push_back({ m_ListenSocket, POLLIN, 0 });
+        fds.push_back({ m_WakeRead, POLLIN, 0 });
+        for(const auto& pClient : m_Clients)
+        {
+            fds.push_back({ pClient->Socket, static_cast<short>(POLLIN | (pClient->Queue.empty() ? 0 : POLLOUT)), 0 });
+        }
+        if(poll(fds.data(), fds.size(), -1) < 0)
+        {
+            continue;
+        }
+
+        if(fds[1].revents & POLLIN)
+        {
+            uint8_t drain[64];
+            while(read(m_WakeRead, drain, sizeof(drain)) > 0)
+            {
+            }
+        }
+
+        // Cleared before popping, so anything published from here on wakes us again
+        m_bWakePending.exchange(false);
+        size_t count;
+        while((count = m_Ring.Pop(m_Batch.data(), m_Batch.size())) > 0)
+        {
+            Frame frame = BuildFrame(count);
+            for(auto& pClient : m_Clients)
+            {
+                Enqueue(*pClient, frame);
+            }
+        }
+
+        // Only the clients polled above have entries in fds; new ones wait for next time
+        size_t polled = m_Clients.size();
+        if(fds[0].revents & POLLIN)
+        {
+            Accept();
+        }
+
+        size_t kept = 0;
+        for(size_t i = 0; i < m_Clients.size(); ++i)
+        {
+            Client& client = *m_Clients[i];
+            bool bKeep = true;
+            if(i < polled)
+            {
+                short events = fds[i + 2].revents;
+                if(events & POLLIN)
+                {
+                    // Clients have nothing to say, so this is just noticing them close
+                    uint8_t discard[256];
+                    ssize_t size = recv(client.Socket, discard, sizeof(discard), 0);
+                    bKeep = size > 0 || (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+                }
+                bKeep = bKeep && !(events & (POLLERR | POLLHUP | POLLNVAL));
+            }
+            bKeep = bKeep && Send(client);
+
+            if(bKeep)
+            {
+                std::swap(m_Clients[kept++], m_Clients[i]);
+            }
+            else
+            {
+                close(client.Socket);
+            }
+        }
+        m_Clients.resize(kept);
+        m_ClientCount = kept;
+    }
+#endif
+}
+
+void SampleServer::Accept()
+{
+#ifdef POSIX_SOCKETS
+    int socket;
+    while((socket = accept(m_ListenSocket, nullptr, nullptr)) >= 0)
+    {
+        int one = 1;
+        int sendBufferSize = SEND_BUFFER_SIZE;
+        fcntl(socket, F_SETFL, O_NONBLOCK);
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setsockopt(socket, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize));
+#ifdef SO_NOSIGPIPE
+        setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+
+        // Always fits in a new connection's send buffer
+        uint8_t greeting[SampleStream::GREETING_SIZE];
+        std::memcpy(greeting, SampleStream::MAGIC, sizeof(SampleStream::MAGIC));
+        Put16(greeting + sizeof(SampleStream::MAGIC), SampleStream::VERSION);
+        if(send(socket, greeting, sizeof(greeting), MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(greeting)))
+        {
+            close(socket);
+            continue;
+        }
+
+        auto pClient = std::make_unique<Client>();
+        pClient->Socket = socket;
+        m_Clients.push_back(std::move(pClient));
+    }
+    m_ClientCount = m_Clients.size();
+#endif
+}
+
+SampleServer::Frame SampleServer::BuildFrame(size_t Count)
+{
+    auto pFrame = std::make_shared<std::vector<uint8_t>>(SampleStream::FRAME_HEADER_SIZE + Count * SampleStream::SAMPLE_SIZE);
+    uint8_t* p = pFrame->data();
+    Put32(p, static_cast<uint32_t>(pFrame->size() - sizeof(uint32_t)));
+    Put32(p + 4, m_FrameNumber++);
+    Put16(p + 8, static_cast<uint16_t>(Count));
+    Put16(p + 10, 0);
+    p += SampleStream::FRAME_HEADER_SIZE;
+
+    for(size_t i = 0; i < Count; ++i)
+    {
+        const MergedSample& sample = m_Batch[i];
+        const IMUData& data = sample.Sample.Data;
+        Put64(p, sample.Time);
+        Put16(p + 8, sample.Device);
+        Put32(p + 10, sample.Sample.AccelMagTime);
+        Put32(p + 14, sample.Sample.GyroTime);
+        p = PutAxes(p + 18, data.Mag);
+        p = PutAxes(p, data.Accel);
+        p = PutAxes(p, data.Gyro);
+        p[0] = data.MagStatus;
+        p[1] = data.AccelStatus;
+        p[2] = data.GyroStatus;
+        p[3] = data.ErrorStatus;
+        p += 4;
+    }
+    return pFrame;
+}
+
+void SampleServer::Enqueue(Client& Client, const Frame& Frame)
+{
+    if(Client.Queue.size() >= m_QueueFrames)
+    {
+        // Oldest first, but not one that's part way out or the stream would be garbled
+        auto oldest = Client.Queue.begin() + (Client.Sent > 0 ? 1 : 0);
+        if(oldest != Client.Queue.end())
+        {
+            Client.Queue.erase(oldest);
+            ++m_FramesDropped;
+        }
+    }
+    Client.Queue.push_back(Frame);
+}
+
+bool SampleServer::Send(Client& Client)
+{
+#ifdef POSIX_SOCKETS
+    while(!Client.Queue.empty())
+    {
+        const std::vector<uint8_t>& frame = *Client.Queue.front();
+        ssize_t sent = send(Client.Socket, frame.data() + Client.Sent, frame.size() - Client.Sent, MSG_NOSIGNAL);
+        if(sent < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+
+        Client.Sent += static_cast<size_t>(sent);
+        if(Client.Sent < frame.size())
+        {
+            return true;
+        }
+        Client.Queue.pop_front();
+        Client.Sent = 0;
+        ++m_FramesSent;
+    }
+#else
+    (void)Client;
+#endif
+    return true;
+}
+
+void SampleServer::Wake()
+{
+#ifdef POSIX_SOCKETS
+    uint8_t byte = 0;
+    if(write(m_WakeWrite, &byte, 1) < 0)
+    {
+        // The pipe's full, so a wake up is already waiting
+    }
+#endif
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "IMUData.h"
+#include "SPSCRing.h"
+#include "SampleMerger.h"
+
+// Streams decoded samples over TCP to any number of clients, e.g. remote dashboards.
+// Clients get the MAGIC and VERSION, then frames of samples, everything little endian:
+//   Frame header:  uint32 size of the rest of the frame, uint32 frame number (from 0, so
+//                  clients can count what they missed), uint16 sample count, uint16 reserved
+//   Each sample:   uint64 host nanoseconds, uint16 device, uint32 accel/mag and uint32 gyro
+//                  time stamps, int16 mag, accel and gyro X, Y and Z, then the four status
+//                  bytes (see IMUData.h)
+//
+// Publish() only pushes to a ring and never blocks, so it's safe on the decode thread.
+// A thread of the server's own batches whatever has been published into frames and
+// queues each frame for every client.  A client's queue holds at most QueueFrames; when a
+// client can't keep up its oldest unsent frames are dropped, so slow clients only lose
+// data of their own and what they do get is never more than a queue old.  Open() fails where there are no POSIX sockets, e.g. Windows.
+namespace SampleStream
+{
+    constexpr char     MAGIC[8] = { 'I', 'M', 'U', '4', 'U', 'S', 'R', 'V' };
+    constexpr uint16_t VERSION = 1;
+    constexpr size_t   GREETING_SIZE = sizeof(MAGIC) + 2;
+    constexpr size_t   FRAME_HEADER_SIZE = 12;
+    constexpr size_t   SAMPLE_SIZE = 40;
+    constexpr size_t   MAX_FRAME_SAMPLES = 256;
+}
+
+class SampleServer
+{
+    public:
+        static constexpr size_t RING_SIZE = 16384;            // Samples published but not yet framed
+        static constexpr size_t DEFAULT_QUEUE_FRAMES = 256;
+        static constexpr int    SEND_BUFFER_SIZE = 65536;     // Kept small, so it's the queues that back up
+
+        SampleServer();
+        ~SampleServer();
+
+        SampleServer(const SampleServer&) = delete;
+        SampleServer& operator=(const SampleServer&) = delete;
+
+        // Listens on Port (0 for any free one, see Port()), on 127.0.0.1 only unless bLan
+        bool Open(uint16_t Port, bool bLan = false, size_t QueueFrames = DEFAULT_QUEUE_FRAMES);
+        void Close();
+        bool IsOpen() const;
+        uint16_t Port() const;
+
+        // Only call from one thread.  pTimes[i] is pSamples[i]'s time.
+        void Publish(uint16_t Device, const IMUSample* pSamples, const uint64_t* pTimes, size_t Count);
+
+        size_t Clients() const;
+        uint64_t FramesSent() const;       // Summed over clients
+        uint64_t FramesDropped() const;    // Summed over clients
+        uint64_t SamplesDropped() const;   // Published faster than the server thread could take them
+
+    private:
+        using Frame = std::shared_ptr<const std::vector<uint8_t>>;
+
+        struct Client
+        {
+            int               Socket = -1;
+            std::deque<Frame> Queue;
+            size_t            Sent = 0;    // Bytes of Queue.front() already sent
+        };
+
+        void ServerThread();
+        void Accept();
+        Frame BuildFrame(size_t Count);
+        void Enqueue(Client& Client, const Frame& Frame);
+        bool Send(Client& Client);   // False if the client has gone
+        void Wake();
+
+        int                                  m_ListenSocket = -1;
+        int                                  m_WakeRead = -1;
+        int                                  m_WakeWrite = -1;
+        uint16_t                             m_Port = 0;
+        size_t                               m_QueueFrames = DEFAULT_QUEUE_FRAMES;
+        std::thread                          m_Thread;
+        std::atomic<bool>                    m_bStop{false};
+        std::atomic<bool>                    m_bWakePending{false};   // Saves a write to the wake pipe per Publish()
+        SPSCRing<MergedSample>               m_Ring;
+        std::vector<MergedSample>            m_Batch;                 // Server thread only, as are the rest
+        std::vector<std::unique_ptr<Client>> m_Clients;
+        uint32_t                             m_FrameNumber = 0;
+        std::atomic<size_t>                  m_ClientCount{0};
+        std::atomic<uint64_t>                m_FramesSent{0};
+        std::atomic<uint64_t>                m_FramesDropped{0};
+        std::atomic<uint64_t>                m_SamplesDropped{0};
+};
@@ -0,0 +1,144 @@
+#include "SampleSubscriber.h"
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SHARED_MEMORY 1
+#endif
+
+SampleSubscriber::~SampleSubscriber()
+{
+    Close();
+}
+
+bool SampleSubscriber::Open(const std::string& Name)
+{
+    Close();
+#ifdef SHARED_MEMORY
+    int fd = shm_open(Name.c_str(), O_RDONLY, 0);
+    if(fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if(fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(SharedRingHeader))
+    {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(status.st_size);
+    void* pMapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(pMapping == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const auto* pHeader = static_cast<const SharedRingHeader*>(pMapping);
+    bool bValid = std::memcmp(pHeader->Magic, SharedRing::MAGIC, sizeof(SharedRing::MAGIC)) == 0;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bValid = bValid && pHeader->Version == SharedRing::VERSION && pHeader->SlotSize == sizeof(SharedRingSlot) &&
+             pHeader->Capacity > 0 && sizeof(SharedRingHeader) + pHeader->Capacity * sizeof(SharedRingSlot) <= size;
+    if(!bValid)
+    {
+        munmap(pMapping, size);
+        return false;
+    }
+
+    m_pMapping = pMapping;
+    m_MappingSize = size;
+    m_pHeader = pHeader;
+    m_pSlots = reinterpret_cast<const SharedRingSlot*>(static_cast<const uint8_t*>(pMapping) + sizeof(SharedRingHeader));
+    m_Capacity = pHeader->Capacity;
+    m_Next = pHeader->Head.load(std::memory_order_acquire);
+    m_SamplesRead = 0;
+    m_SamplesMissed = 0;
+    return true;
+#else
+    (void)Name;
+    return false;
+#endif
+}
+
+void SampleSubscriber::Close()
+{
+#ifdef SHARED_MEMORY
+    if(m_pMapping)
+    {
+        munmap(m_pMapping, m_MappingSize);
+    }
+#endif
+    m_pMapping = nullptr;
+    m_pHeader = nullptr;
+    m_pSlots = nullptr;
+}
+
+bool SampleSubscriber::IsOpen() const
+{
+    return m_pMapping != nullptr;
+}
+
+size_t SampleSubscriber::Read(SharedSample* pSamples, size_t MaxCount)
+{
+    if(!m_pMapping)
+    {
+        return 0;
+    }
+
+    size_t count = 0;
+    uint64_t head = m_pHeader->Head.load(std::memory_order_acquire);
+    while(count < MaxCount && m_Next < head)
+    {
+        // Lapped, so skip to the oldest sample still there
+        if(head - m_Next > m_Capacity)
+        {
+            m_SamplesMissed += head - m_Capacity - m_Next;
+            m_Next = head - m_Capacity;
+        }
+
+        const SharedRingSlot& slot = m_pSlots[m_Next % m_Capacity];
+        uint64_t sequence = slot.Sequence.load(std::memory_order_acquire);
+        if(sequence == 2 * m_Next + 2)
+        {
+            pSamples[count] = slot.Sample;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.Sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                ++count;
+                ++m_Next;
+                continue;
+            }
+        }
+
+        // Overwritten before or while we copied it, so the publisher has lapped us since
+        // head was read
+        head = m_pHeader->Head.load(std::memory_order_acquire);
+        if(head - m_Next <= m_Capacity)
+        {
+            // Only a sample the publisher is part way through; the rest of the block
+            // shows up in head once it's done
+            ++m_SamplesMissed;
+            ++m_Next;
+        }
+    }
+    m_SamplesRead += count;
+    return count;
+}
+
+bool SampleSubscriber::PublisherOpen() const
+{
+    return m_pHeader && m_pHeader->bOpen.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t SampleSubscriber::SamplesRead() const
+{
+    return m_SamplesRead;
+}
+
+uint64_t SampleSubscriber::SamplesMissed() const
+{
+    return m_SamplesMissed;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "SharedSampleRing.h"
+
+// Reads the samples a SamplePublisher in another process writes to shared memory (see
+// SharedSampleRing.h).  Reading takes no locks and never holds the publisher up; any
+// number of subscribers can read the same ring, each at its own pace.  Each subscriber
+// object should only be used from one thread.
+class SampleSubscriber
+{
+    public:
+        SampleSubscriber() = default;
+        ~SampleSubscriber();
+
+        SampleSubscriber(const SampleSubscriber&) = delete;
+        SampleSubscriber& operator=(const SampleSubscriber&) = delete;
+
+        // Fails if nothing is published under Name or it's from an incompatible build.
+        // Reading starts with the next sample published.
+        bool Open(const std::string& Name);
+        void Close();
+        bool IsOpen() const;
+
+        // Copies up to MaxCount of the samples published since the last call to pSamples,
+        // oldest first, and returns how many.  Never waits; returns 0 if there's nothing new.
+        size_t Read(SharedSample* pSamples, size_t MaxCount);
+
+        // False once the publisher has closed, after which nothing more will come and
+        // Open() again picks up a new publisher under the same name
+        bool PublisherOpen() const;
+
+        uint64_t SamplesRead() const;
+        uint64_t SamplesMissed() const;   // Overwritten before we got to them
+
+    private:
+        void*                   m_pMapping = nullptr;
+        size_t                  m_MappingSize = 0;
+        const SharedRingHeader* m_pHeader = nullptr;
+        const SharedRingSlot*   m_pSlots = nullptr;
+        uint64_t                m_Capacity = 0;
+        uint64_t                m_Next = 0;   // The next sample to read
+        uint64_t                m_SamplesRead = 0;
+        uint64_t                m_SamplesMissed = 0;
+};
@@ -0,0 +1,231 @@
+#include "SensorResampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SENSOR_RESAMPLER_SSE 1
+#endif
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;   // Device time stamp rate (see IMUData.h)
+
+    // pOut = w0 * p0 + w1 * p1 + w2 * p2 + w3 * p3, over Lanes floats.  Everything is
+    // 16 byte aligned and Lanes a multiple of four.
+    void Blend(const float* p0, const float* p1, const float* p2, const float* p3, const float* pWeights, float* pOut, size_t Lanes)
+    {
+#ifdef SENSOR_RESAMPLER_SSE
+        __m128 w0 = _mm_set1_ps(pWeights[0]);
+        __m128 w1 = _mm_set1_ps(pWeights[1]);
+        __m128 w2 = _mm_set1_ps(pWeights[2]);
+        __m128 w3 = _mm_set1_ps(pWeights[3]);
+        for(size_t lane = 0; lane < Lanes; lane += 4)
+        {
+            __m128 sum = _mm_mul_ps(w0, _mm_load_ps(p0 + lane));
+            sum = _mm_add_ps(sum, _mm_mul_ps(w1, _mm_load_ps(p1 + lane)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(w2, _mm_load_ps(p2 + lane)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(w3, _mm_load_ps(p3 + lane)));
+            _mm_store_ps(pOut + lane, sum);
+        }
+#else
+        for(size_t lane = 0; lane < Lanes; ++lane)
+        {
+            pOut[lane] = pWeights[0] * p0[lane] + pWeights[1] * p1[lane] + pWeights[2] * p2[lane] + pWeights[3] * p3[lane];
+        }
+#endif
+    }
+}
+
+void SensorResampler::Stream::Clear()
+{
+    Count = 0;
+    Next = 0;
+}
+
+bool SensorResampler::Stream::Add(int64_t Time, const float* pValues)
+{
+    if(Count > 0 && Time <= Newest())
+    {
+        return false;
+    }
+
+    Times[Next] = Time;
+    std::memcpy(Readings[Next], pValues, sizeof(Readings[Next]));
+    Next = (Next + 1) & (HISTORY - 1);
+    Count = std::min(Count + 1, HISTORY);
+    return true;
+}
+
+int64_t SensorResampler::Stream::Time(size_t Index) const
+{
+    return Times[(Next - Count + Index) & (HISTORY - 1)];
+}
+
+const float* SensorResampler::Stream::Values(size_t Index) const
+{
+    return Readings[(Next - Count + Index) & (HISTORY - 1)];
+}
+
+int64_t SensorResampler::Stream::Newest() const
+{
+    return Time(Count - 1);
+}
+
+SensorResampler::SensorResampler(double RateHz, INTERPOLATION Interpolation) : m_PeriodTicks(TICKS_PER_SECOND / RateHz),
+                                                                               m_Interpolation(Interpolation)
+{
+}
+
+void SensorResampler::Reset()
+{
+    m_AccelMag.Clear();
+    m_Gyro.Clear();
+    m_bHaveTicks = false;
+    m_bHaveGrid = false;
+}
+
+size_t SensorResampler::Add(const IMUSample& Sample, ResampledFrame* pFrames, size_t MaxFrames)
+{
+    const int64_t maxGap = static_cast<int64_t>(MAX_GAP_S * TICKS_PER_SECOND);
+    int64_t accelMagTime = Extend(Sample.AccelMagTime);
+    int64_t gyroTime = Extend(Sample.GyroTime);
+    if((m_AccelMag.Count > 0 && std::abs(accelMagTime - m_AccelMag.Newest()) > maxGap) ||
+       (m_Gyro.Count > 0 && std::abs(gyroTime - m_Gyro.Newest()) > maxGap))
+    {
+        Reset();
+        ++m_Restarts;
+        accelMagTime = Extend(Sample.AccelMagTime);
+        gyroTime = Extend(Sample.GyroTime);
+    }
+
+    const IMUData& data = Sample.Data;
+    alignas(16) float accelMag[LANES] = { static_cast<float>(data.Accel.X), static_cast<float>(data.Accel.Y), static_cast<float>(data.Accel.Z),
+                                          static_cast<float>(data.Mag.X), static_cast<float>(data.Mag.Y), static_cast<float>(data.Mag.Z) };
+    alignas(16) float gyro[LANES] = { static_cast<float>(data.Gyro.X), static_cast<float>(data.Gyro.Y), static_cast<float>(data.Gyro.Z) };
+    m_AccelMag.Add(accelMagTime, accelMag);
+    m_Gyro.Add(gyroTime, gyro);
+
+    if(!m_bHaveGrid)
+    {
+        // Frames start once both sensors have been read, on a multiple of the period
+        double start = static_cast<double>(std::max(m_AccelMag.Time(0), m_Gyro.Time(0)));
+        m_NextTime = std::ceil(start / m_PeriodTicks) * m_PeriodTicks;
+        m_bHaveGrid = true;
+    }
+
+    double ready = static_cast<double>(std::min(Ready(m_AccelMag), Ready(m_Gyro)));
+    size_t count = 0;
+    while(count < MaxFrames && m_NextTime <= ready)
+    {
+        Interpolate(m_AccelMag, m_NextTime, accelMag);
+        Interpolate(m_Gyro, m_NextTime, gyro);
+
+        ResampledFrame& frame = pFrames[count++];
+        frame.Time = static_cast<uint32_t>(std::llround(m_NextTime));
+        std::memcpy(frame.Accel, &accelMag[0], sizeof(frame.Accel));
+        std::memcpy(frame.Mag, &accelMag[3], sizeof(frame.Mag));
+        std::memcpy(frame.Gyro, &gyro[0], sizeof(frame.Gyro));
+        m_NextTime += m_PeriodTicks;
+    }
+    m_FramesOut += count;
+    return count;
+}
+
+double SensorResampler::RateHz() const
+{
+    return TICKS_PER_SECOND / m_PeriodTicks;
+}
+
+uint64_t SensorResampler::FramesOut() const
+{
+    return m_FramesOut;
+}
+
+uint64_t SensorResampler::Restarts() const
+{
+    return m_Restarts;
+}
+
+// Time stamps are taken to be within half a wrap of the latest one seen
+int64_t SensorResampler::Extend(uint32_t Ticks)
+{
+    if(!m_bHaveTicks)
+    {
+        m_LastTicks = Ticks;
+        m_LastExtended = Ticks;
+        m_bHaveTicks = true;
+    }
+
+    int64_t extended = m_LastExtended + static_cast<int32_t>(Ticks - m_LastTicks);
+    if(extended > m_LastExtended)
+    {
+        m_LastTicks = Ticks;
+        m_LastExtended = extended;
+    }
+    return extended;
+}
+
+int64_t SensorResampler::Ready(const Stream& Stream) const
+{
+    if(m_Interpolation == INTERPOLATION::CUBIC)
+    {
+        return Stream.Count >= 2 ? Stream.Time(Stream.Count - 2) : INT64_MIN;
+    }
+    return Stream.Newest();
+}
+
+void SensorResampler::Interpolate(const Stream& Stream, double Time, float* pOut) const
+{
+    // The reading at or before Time, searching back from the newest since that's where
+    // frames usually fall
+    size_t i = Stream.Count;
+    while(i > 0 && static_cast<double>(Stream.Time(i - 1)) > Time)
+    {
+        --i;
+    }
+
+    // Outside the history, so the nearest reading is as good as it gets
+    if(i == 0 || i == Stream.Count)
+    {
+        std::memcpy(pOut, Stream.Values(i == 0 ? 0 : Stream.Count - 1), LANES * sizeof(float));
+        return;
+    }
+
+    size_t i1 = i - 1;
+    size_t i2 = i;
+    size_t i0 = i1 > 0 ? i1 - 1 : i1;
+    size_t i3 = i2 + 1 < Stream.Count ? i2 + 1 : i2;
+    double t1 = static_cast<double>(Stream.Time(i1));
+    double t2 = static_cast<double>(Stream.Time(i2));
+    double u = (Time - t1) / (t2 - t1);
+
+    float weights[4];
+    if(m_Interpolation == INTERPOLATION::CUBIC)
+    {
+        // Hermite basis, with the tangents at p1 and p2 from the readings either side of
+        // each, scaled to this segment
+        double a = (t2 - t1) / (t2 - static_cast<double>(Stream.Time(i0)));
+        double b = (t2 - t1) / (static_cast<double>(Stream.Time(i3)) - t1);
+        double u2 = u * u;
+        double u3 = u2 * u;
+        double h00 = 2.0 * u3 - 3.0 * u2 + 1.0;
+        double h10 = u3 - 2.0 * u2 + u;
+        double h01 = -2.0 * u3 + 3.0 * u2;
+        double h11 = u3 - u2;
+        weights[0] = static_cast<float>(-h10 * a);
+        weights[1] = static_cast<float>(h00 - h11 * b);
+        weights[2] = static_cast<float>(h01 + h10 * a);
+        weights[3] = static_cast<float>(h11 * b);
+    }
+    else
+    {
+        weights[0] = 0.0f;
+        weights[1] = static_cast<float>(1.0 - u);
+        weights[2] = static_cast<float>(u);
+        weights[3] = 0.0f;
+    }
+
+    Blend(Stream.Values(i0), Stream.Values(i1), Stream.Values(i2), Stream.Values(i3), weights, pOut, LANES);
+}
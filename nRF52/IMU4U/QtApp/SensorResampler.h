@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "IMUData.h"
+
+// Accel, mag and gyro at one instant, still in the sensors' own units
+struct ResampledFrame
+{
+    uint32_t Time = 0;   // Device time stamp (see IMUData.h)
+    float    Accel[3] = {};
+    float    Mag[3] = {};
+    float    Gyro[3] = {};
+};
+
+// Interpolates one device's samples onto a regular grid of times, so accel, mag and gyro
+// all describe the same instant.  The FXOS8700 (accel and mag) and FXAS21002C (gyro) are
+// read on their own interrupts at their own rates, and an IMUSample holds whatever each
+// sensor last gave along with when, so the two halves of it are from different times and
+// either can repeat.
+//
+// Each sensor keeps a short history of distinct readings.  A frame goes out once both
+// sensors have readings far enough past its time to interpolate it: the next reading for
+// linear, the one after that for cubic, which is a Hermite spline with its tangents taken
+// from the neighbouring readings.  Each frame is a weighted sum of four readings, done
+// across every channel at once with SSE where there is any.
+//
+// Nothing is allocated after construction.
+class SensorResampler
+{
+    public:
+        enum class INTERPOLATION
+        {
+            LINEAR,
+            CUBIC
+        };
+
+        static constexpr double MAX_GAP_S = 1.0;   // Readings further apart than this (e.g. the sensors powered down) start afresh
+
+        SensorResampler(double RateHz, INTERPOLATION Interpolation = INTERPOLATION::LINEAR);
+
+        void Reset();
+
+        // Writes up to MaxFrames of the frames Sample makes available to pFrames, returning
+        // how many.  Any that don't fit go out on the next call.
+        size_t Add(const IMUSample& Sample, ResampledFrame* pFrames, size_t MaxFrames);
+
+        double RateHz() const;
+        uint64_t FramesOut() const;
+        uint64_t Restarts() const;   // Gaps longer than MAX_GAP_S
+
+    private:
+        static constexpr size_t HISTORY = 16;   // Readings kept per sensor, a power of two
+        static constexpr size_t LANES = 8;      // Channels per reading, padded to two SSE registers
+
+        // One sensor's recent readings, oldest first in a ring
+        struct Stream
+        {
+            alignas(16) float Readings[HISTORY][LANES];
+            int64_t  Times[HISTORY];
+            size_t   Count = 0;
+            size_t   Next = 0;   // Where the next reading goes
+
+            void Clear();
+            bool Add(int64_t Time, const float* pValues);   // False if it's no newer than the last
+            int64_t Time(size_t Index) const;               // Index 0 is the oldest
+            const float* Values(size_t Index) const;
+            int64_t Newest() const;
+        };
+
+        int64_t Extend(uint32_t Ticks);
+        int64_t Ready(const Stream& Stream) const;    // Latest time Stream can be interpolated at
+        void Interpolate(const Stream& Stream, double Time, float* pOut) const;
+
+        double        m_PeriodTicks;
+        INTERPOLATION m_Interpolation;
+        Stream        m_AccelMag;   // Lanes 0-2 accel, 3-5 mag
+        Stream        m_Gyro;       // Lanes 0-2
+
+        // Time stamps extended past 32 bits
+        bool          m_bHaveTicks = false;
+        uint32_t      m_LastTicks = 0;
+        int64_t       m_LastExtended = 0;
+
+        bool          m_bHaveGrid = false;
+        double        m_NextTime = 0.0;   // Extended ticks of the next frame
+        uint64_t      m_FramesOut = 0;
+        uint64_t      m_Restarts = 0;
+};
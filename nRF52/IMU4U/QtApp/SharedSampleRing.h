@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "IMUData.h"
+
+// The POSIX shared memory ring SamplePublisher writes decoded samples into, for any number
+// of SampleSubscribers in other processes to read at once.  A SharedRingHeader is followed
+// by Capacity SharedRingSlots, sample n going in slot n % Capacity.
+//
+// The publisher never waits for readers: it overwrites the oldest samples regardless, and
+// a reader that falls more than Capacity behind loses what was overwritten.  Each slot's
+// Sequence says which sample it holds, so a reader can tell whether what it copied out was
+// overwritten while it was copying.
+namespace SharedRing
+{
+    constexpr char     MAGIC[8] = { 'I', 'M', 'U', '4', 'U', 'S', 'H', 'M' };
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t   CACHE_LINE_SIZE = 64;
+    constexpr size_t   DEFAULT_CAPACITY = 65536;   // About ten seconds of 32 devices at 200Hz
+}
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Atomics in shared memory have to be lock free");
+
+struct SharedSample
+{
+    uint64_t  Time;     // Host nanoseconds, as for NordicCentral::ReadSamples()
+    uint16_t  Device;
+    IMUSample Sample;
+};
+
+struct SharedRingHeader
+{
+    char                  Magic[8];
+    uint32_t              Version;
+    uint32_t              SlotSize;   // sizeof(SharedRingSlot), to catch mismatched builds
+    uint64_t              Capacity;   // A power of two
+    std::atomic<uint32_t> bOpen;      // Cleared when the publisher closes
+
+    // Samples published so far
+    alignas(SharedRing::CACHE_LINE_SIZE) std::atomic<uint64_t> Head;
+};
+
+struct alignas(SharedRing::CACHE_LINE_SIZE) SharedRingSlot
+{
+    std::atomic<uint64_t> Sequence;   // 2n + 1 while sample n is being written, 2n + 2 once it's there
+    SharedSample          Sample;
+};
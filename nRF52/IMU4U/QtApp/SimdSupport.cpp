@@ -0,0 +1,53 @@
+#include "SimdSupport.h"
+
+#if defined(SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+bool SimdSupported(SIMD_LEVEL Level)
+{
+    if(Level == SIMD_LEVEL::SCALAR)
+    {
+        return true;
+    }
+#if defined(SIMD_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    if(Level == SIMD_LEVEL::SSE2)
+    {
+        return (info[3] & (1 << 26)) != 0;
+    }
+
+    // AVX2 also needs the OS to save the YMM registers
+    bool bOSSavesYMM = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return bOSSavesYMM && (info[1] & (1 << 5)) != 0;
+#elif defined(SIMD_X86)
+    return Level == SIMD_LEVEL::SSE2 ? __builtin_cpu_supports("sse2") != 0 : __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+}
+
+SIMD_LEVEL BestSimdLevel()
+{
+    if(SimdSupported(SIMD_LEVEL::AVX2))
+    {
+        return SIMD_LEVEL::AVX2;
+    }
+    return SimdSupported(SIMD_LEVEL::SSE2) ? SIMD_LEVEL::SSE2 : SIMD_LEVEL::SCALAR;
+}
+
+const char* SimdName(SIMD_LEVEL Level)
+{
+    switch(Level)
+    {
+        case SIMD_LEVEL::SSE2:
+            return "SSE2";
+        case SIMD_LEVEL::AVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
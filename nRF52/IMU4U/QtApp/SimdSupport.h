@@ -0,0 +1,26 @@
+#pragma once
+
+// Which SIMD instruction sets the CPU running us has, for code that picks a kernel at run
+// time rather than needing it at build time
+
+enum class SIMD_LEVEL
+{
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+bool SimdSupported(SIMD_LEVEL Level);
+SIMD_LEVEL BestSimdLevel();
+const char* SimdName(SIMD_LEVEL Level);
+
+// Kernels for a level are built with SIMD_TARGET so the compiler lets them use its
+// instructions without the rest of the program needing them
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SIMD_X86 1
+#if defined(_MSC_VER) && !defined(__clang__)
+#define SIMD_TARGET(Features)
+#else
+#define SIMD_TARGET(Features) __attribute__((target(Features)))
+#endif
+#endif
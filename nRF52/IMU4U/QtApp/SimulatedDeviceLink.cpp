@@ -0,0 +1,212 @@
+#include "SimulatedDeviceLink.h"
+#include "IMU4UService.h"
+#include "StreamDecoder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;   // Device time stamp rate (see IMUData.h)
+    constexpr double TWO_PI = 6.28318530717958647692;
+    constexpr double ONE_G_IN_LSB = 16384.0;
+    constexpr double WOBBLE_HZ = 0.5;              // How fast the simulated device rocks back and forth
+    constexpr double WOBBLE_RADIANS = 0.5;
+    constexpr double GYRO_LSB_PER_RADIAN_PER_S = 128.0 * 180.0 / 3.14159265358979323846;
+    constexpr int    RECORD_OFFSET_SIZE = 4;       // Download requests and record chunks carry a stream offset
+}
+
+SimulatedDeviceLink::SimulatedDeviceLink(const Settings& Settings, QObject* pParent) : QObject(pParent), m_Settings(Settings),
+                                                                                    m_Random(Settings.Seed)
+{
+    m_Timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_Timer, &QTimer::timeout, this, &SimulatedDeviceLink::ConnectionEvent);
+}
+
+void SimulatedDeviceLink::SetCallbacks(const Callbacks& Callbacks)
+{
+    m_Callbacks = Callbacks;
+}
+
+void SimulatedDeviceLink::Connect()
+{
+    // Found straight away, unless it's in an outage.  The device's clock keeps running
+    // across reconnections.
+    QTimer::singleShot(0, this, [this]()
+    {
+        if(!m_Clock.isValid())
+        {
+            m_Clock.start();
+        }
+        qint64 now = m_Clock.nsecsElapsed();
+        if(now < m_OutageEndNs)
+        {
+            if(m_Callbacks.ConnectFailed)
+            {
+                m_Callbacks.ConnectFailed();
+            }
+            return;
+        }
+
+        m_NextOutageNs = now + static_cast<qint64>(m_Settings.OutageEverySec * 1e9);
+        m_Timer.start(m_Settings.ConnectionIntervalMs);
+        if(m_Callbacks.Connected)
+        {
+            m_Callbacks.Connected();
+        }
+    });
+}
+
+void SimulatedDeviceLink::Subscribe(uint16_t Characteristic)
+{
+    if(Characteristic == NORDIC_BLINKY_IMU_CHAR_UUID && !m_bStreaming)
+    {
+        // Like the firmware, only sample while someone is listening
+        m_bStreaming = true;
+        m_NextSample = static_cast<uint64_t>(m_Clock.nsecsElapsed() * 1e-9 * m_Settings.SampleRateHz);
+    }
+}
+
+void SimulatedDeviceLink::Write(uint16_t Characteristic, const QByteArray& Value)
+{
+    if(Characteristic == NORDIC_BLINKY_CONTROL_CHAR_UUID && Value.size() >= 1 + RECORD_OFFSET_SIZE &&
+       Value.at(0) == CONTROL_OP_DOWNLOAD_START)
+    {
+        // Nothing recorded, so the first chunk is the end of the recording
+        QByteArray end(1, static_cast<char>(PACKET_TYPE::RECORD));
+        end.append(Value.mid(1, RECORD_OFFSET_SIZE));
+        Notify(NORDIC_BLINKY_RECORD_CHAR_UUID, end);
+    }
+    else if(Characteristic == NORDIC_BLINKY_CONTROL_CHAR_UUID && Value.size() >= 2 && Value.at(0) == CONTROL_OP_SYNC)
+    {
+        // Stamped now, then queued behind the samples like the firmware's reply
+        qint64 now = m_Clock.nsecsElapsed();
+        uint32_t ticks = static_cast<uint32_t>(now * 1e-9 * TICKS_PER_SECOND);
+        QByteArray reply(1, static_cast<char>(PACKET_TYPE::SYNC));
+        reply.append(Value.at(1));
+        for(int i = 0; i < 4; ++i)
+        {
+            reply.append(static_cast<char>((ticks >> (8 * i)) & 0xFF));
+        }
+        m_Packets.push_back({ m_Packets.empty() ? now : std::max(now, m_Packets.back().DeliveryTimeNs), reply });
+    }
+}
+
+IMUSample SimulatedDeviceLink::MakeSample(uint64_t Index)
+{
+    double t = Index / m_Settings.SampleRateHz;
+    double angle = WOBBLE_RADIANS * std::sin(TWO_PI * WOBBLE_HZ * t);
+    double rate = WOBBLE_RADIANS * TWO_PI * WOBBLE_HZ * std::cos(TWO_PI * WOBBLE_HZ * t);
+
+    // Rocking about the X axis
+    IMUSample sample = {};
+    sample.GyroTime = static_cast<uint32_t>(t * TICKS_PER_SECOND);
+    sample.AccelMagTime = sample.GyroTime;
+    sample.Data.Accel.Y = static_cast<int16_t>(ONE_G_IN_LSB * std::sin(angle));
+    sample.Data.Accel.Z = static_cast<int16_t>(ONE_G_IN_LSB * std::cos(angle));
+    sample.Data.Gyro.X = static_cast<int16_t>(rate * GYRO_LSB_PER_RADIAN_PER_S);
+    sample.Data.Mag.X = 300;
+    sample.Data.Mag.Y = static_cast<int16_t>(-400 * std::sin(angle));
+    sample.Data.Mag.Z = static_cast<int16_t>(-400 * std::cos(angle));
+    return sample;
+}
+
+void SimulatedDeviceLink::PackSamples(qint64 NowNs)
+{
+    size_t next = 0;
+    while(next < m_Samples.size())
+    {
+        QByteArray packet(static_cast<int>(m_Settings.MaxPacketSize), 0);
+        auto* pBytes = reinterpret_cast<uint8_t*>(packet.data());
+        size_t size = StreamDecoder::HEADER_SIZE;
+        size_t count = 0;
+
+        m_Codec.Reset();
+        while(next < m_Samples.size() && count < StreamDecoder::MAX_PACKET_SAMPLES)
+        {
+            size_t length = m_Codec.Encode(m_Samples[next], &pBytes[size], m_Settings.MaxPacketSize - size);
+            if(length == 0)
+            {
+                break;
+            }
+            size += length;
+            ++count;
+            ++next;
+        }
+        if(count == 0)
+        {
+            // Packets too small for even one sample
+            m_Samples.clear();
+            return;
+        }
+
+        pBytes[0] = static_cast<uint8_t>(PACKET_TYPE::SAMPLES);
+        pBytes[1] = static_cast<uint8_t>(count);
+        pBytes[2] = static_cast<uint8_t>(m_Sequence & 0xFF);
+        pBytes[3] = static_cast<uint8_t>(m_Sequence >> 8);
+        ++m_Sequence;
+        packet.resize(static_cast<int>(size));
+
+        if(m_Uniform(m_Random) < m_Settings.LossProbability)
+        {
+            continue;
+        }
+
+        // Held back packets still arrive in order, as they would over the air
+        qint64 delivery = NowNs + static_cast<qint64>(m_Uniform(m_Random) * m_Settings.JitterMs * 1e6);
+        if(!m_Packets.empty() && delivery < m_Packets.back().DeliveryTimeNs)
+        {
+            delivery = m_Packets.back().DeliveryTimeNs;
+        }
+        m_Packets.push_back({ delivery, packet });
+    }
+    m_Samples.clear();
+}
+
+void SimulatedDeviceLink::ConnectionEvent()
+{
+    qint64 now = m_Clock.nsecsElapsed();
+    if(m_Settings.OutageEverySec > 0.0 && now >= m_NextOutageNs)
+    {
+        Disconnect(now);
+        return;
+    }
+
+    if(m_bStreaming)
+    {
+        uint64_t due = static_cast<uint64_t>(now * 1e-9 * m_Settings.SampleRateHz);
+        for(; m_NextSample < due; ++m_NextSample)
+        {
+            m_Samples.push_back(MakeSample(m_NextSample));
+        }
+        PackSamples(now);
+    }
+
+    while(!m_Packets.empty() && m_Packets.front().DeliveryTimeNs <= now)
+    {
+        Notify(NORDIC_BLINKY_IMU_CHAR_UUID, m_Packets.front().Payload);
+        m_Packets.pop_front();
+    }
+}
+
+// Like the firmware, it stops sampling until it's subscribed to again, and whatever
+// hadn't been delivered is lost
+void SimulatedDeviceLink::Disconnect(qint64 NowNs)
+{
+    m_Timer.stop();
+    m_bStreaming = false;
+    m_Samples.clear();
+    m_Packets.clear();
+    m_OutageEndNs = NowNs + static_cast<qint64>(m_Settings.OutageMs * 1e6);
+    if(m_Callbacks.Disconnected)
+    {
+        m_Callbacks.Disconnected();
+    }
+}
+
+void SimulatedDeviceLink::Notify(uint16_t Characteristic, const QByteArray& Value)
+{
+    if(m_Callbacks.Notification)
+    {
+        m_Callbacks.Notification(Characteristic, Value);
+    }
+}
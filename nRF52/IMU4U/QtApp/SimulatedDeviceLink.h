@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <random>
+#include <vector>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "IDeviceLink.h"
+#include "IMUData.h"
+#include "SampleCodec.h"
+
+// IDeviceLink to a made up IMU4U, for running the host without a radio.  Samples of a
+// slowly wobbling device are generated at the configured rate and packed into stream
+// packets exactly as the firmware does, then delivered once per connection interval.
+// Packets can be lost or held back to exercise the receiving end, and the connection
+// can drop now and then and refuse to come back for a while.  Downloads find an empty
+// recording, and clock sync requests are answered.
+class SimulatedDeviceLink : public QObject, public IDeviceLink
+{
+    public:
+        struct Settings
+        {
+            double   SampleRateHz = 100.0;
+            int      ConnectionIntervalMs = 15;
+            size_t   MaxPacketSize = 244;      // The payload of a 247 byte ATT MTU
+            double   LossProbability = 0.0;    // Chance of each packet going missing
+            double   JitterMs = 0.0;           // Packets are held back by up to this long
+            double   OutageEverySec = 0.0;     // The connection drops this often, 0 for never,
+            double   OutageMs = 0.0;           // and can't be made again for this long
+            uint32_t Seed = 1;
+        };
+
+        explicit SimulatedDeviceLink(const Settings& Settings, QObject* pParent = nullptr);
+
+        void SetCallbacks(const Callbacks& Callbacks) override;
+        void Connect() override;
+        void Subscribe(uint16_t Characteristic) override;
+        void Write(uint16_t Characteristic, const QByteArray& Value) override;
+
+    private:
+        struct PendingPacket
+        {
+            qint64     DeliveryTimeNs;
+            QByteArray Payload;
+        };
+
+        void ConnectionEvent();
+        void Disconnect(qint64 NowNs);
+        IMUSample MakeSample(uint64_t Index);
+        void PackSamples(qint64 NowNs);
+        void Notify(uint16_t Characteristic, const QByteArray& Value);
+
+        Settings                          m_Settings;
+        Callbacks                         m_Callbacks;
+        QTimer                            m_Timer{this};
+        QElapsedTimer                     m_Clock;
+        bool                              m_bStreaming = false;
+        qint64                            m_NextOutageNs = 0;
+        qint64                            m_OutageEndNs = 0;
+        uint64_t                          m_NextSample = 0;
+        std::vector<IMUSample>            m_Samples;       // Generated but not yet packed
+        std::deque<PendingPacket>         m_Packets;       // Packed but not yet delivered
+        uint16_t                          m_Sequence = 0;
+        SampleCodec                       m_Codec;
+        std::mt19937                      m_Random;
+        std::uniform_real_distribution<double> m_Uniform{0.0, 1.0};
+};
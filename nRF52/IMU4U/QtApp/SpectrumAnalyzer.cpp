@@ -0,0 +1,249 @@
+#include "SpectrumAnalyzer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double TWO_PI = 6.28318530717958647692;
+    constexpr float  FULL_SCALE = 32768.0f;
+    constexpr float  SILENCE_DB = -200.0f;   // What a bin with nothing in it comes out as
+    constexpr size_t BATCH_SIZE = 256;       // Frames taken from the ring at a time
+    constexpr size_t FIRST_PEAK_BIN = 2;     // Below this is the window's spread of the DC level
+
+    // Where each channel comes from in a ResampledFrame
+    const float& Channel(const ResampledFrame& Frame, size_t Index)
+    {
+        size_t axis = Index % 3;
+        return Index < 3 ? Frame.Accel[axis] : (Index < 6 ? Frame.Gyro[axis] : Frame.Mag[axis]);
+    }
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(const Settings& Settings, SIMD_LEVEL Level) :
+    m_Settings(Settings), m_FFT(Settings.Size, Level), m_Ring(RING_SIZE), m_History(CHANNEL_COUNT * Settings.Size),
+    m_Window(Settings.Size), m_Windowed(Settings.Size), m_Real(m_FFT.Bins()), m_Imag(m_FFT.Bins()), m_Batch(BATCH_SIZE)
+{
+    m_Settings.Hop = std::max<size_t>(1, m_Settings.Hop);
+    m_Settings.Peaks = m_Settings.Peaks < MAX_PEAKS ? m_Settings.Peaks : MAX_PEAKS;
+
+    // Periodic Hann, so the windows of a hop of Size / 2 or less add up to a constant
+    float sum = 0.0f;
+    for(size_t i = 0; i < m_Settings.Size; ++i)
+    {
+        m_Window[i] = static_cast<float>(0.5 - 0.5 * std::cos(TWO_PI * i / m_Settings.Size));
+        sum += m_Window[i];
+    }
+    m_FullScale = FULL_SCALE * sum / 2.0f;
+
+    for(Spectrum* pSpectrum : { &m_Working, &m_Result })
+    {
+        pSpectrum->Bins = m_FFT.Bins();
+        pSpectrum->BinHz = BinHz();
+        pSpectrum->LevelsDb.assign(CHANNEL_COUNT * m_FFT.Bins(), SILENCE_DB);
+    }
+
+    m_Thread = std::thread(&SpectrumAnalyzer::WorkerThread, this);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_bStop = true;
+    }
+    m_Wake.notify_one();
+    m_Thread.join();
+}
+
+bool SpectrumAnalyzer::Add(const ResampledFrame* pFrames, size_t Count)
+{
+    size_t dropped = 0;
+    for(size_t i = 0; i < Count; ++i)
+    {
+        if(!m_Ring.Push(pFrames[i]))
+        {
+            ++dropped;
+        }
+    }
+    if(Count > dropped)
+    {
+        // Taking the lock means the worker is either waiting or yet to check the ring
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+        }
+        m_Wake.notify_one();
+    }
+    m_FramesDropped += dropped;
+    return dropped == 0;
+}
+
+void SpectrumAnalyzer::Restart()
+{
+    m_bRestart = true;
+}
+
+bool SpectrumAnalyzer::Latest(Spectrum& Out)
+{
+    std::lock_guard<std::mutex> lock(m_ResultMutex);
+    if(m_Result.Sequence == Out.Sequence)
+    {
+        return false;
+    }
+    Out = m_Result;
+    return true;
+}
+
+size_t SpectrumAnalyzer::Bins() const
+{
+    return m_FFT.Bins();
+}
+
+double SpectrumAnalyzer::BinHz() const
+{
+    return m_Settings.RateHz / m_Settings.Size;
+}
+
+SIMD_LEVEL SpectrumAnalyzer::Level() const
+{
+    return m_FFT.Level();
+}
+
+uint64_t SpectrumAnalyzer::SpectraDone() const
+{
+    return m_SpectraDone;
+}
+
+uint64_t SpectrumAnalyzer::FramesDropped() const
+{
+    return m_FramesDropped;
+}
+
+void SpectrumAnalyzer::WorkerThread()
+{
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_WakeMutex);
+            m_Wake.wait(lock, [this]() { return m_bStop || m_Ring.Peek() != nullptr; });
+            if(m_bStop)
+            {
+                return;
+            }
+        }
+
+        if(m_bRestart.exchange(false))
+        {
+            m_FramesIn = 0;
+            m_SinceSpectrum = 0;
+        }
+
+        size_t count;
+        while((count = m_Ring.Pop(m_Batch.data(), m_Batch.size())) > 0)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                AddFrame(m_Batch[i]);
+            }
+        }
+    }
+}
+
+void SpectrumAnalyzer::AddFrame(const ResampledFrame& Frame)
+{
+    for(size_t channel = 0; channel < CHANNEL_COUNT; ++channel)
+    {
+        m_History[channel * m_Settings.Size + m_Position] = Channel(Frame, channel);
+    }
+    m_Position = (m_Position + 1) % m_Settings.Size;
+    ++m_FramesIn;
+
+    if(++m_SinceSpectrum >= m_Settings.Hop && m_FramesIn >= m_Settings.Size)
+    {
+        m_SinceSpectrum = 0;
+        Analyze();
+    }
+}
+
+void SpectrumAnalyzer::Analyze()
+{
+    const size_t size = m_Settings.Size;
+    const size_t bins = m_FFT.Bins();
+    for(size_t channel = 0; channel < CHANNEL_COUNT; ++channel)
+    {
+        // Oldest first, starting from where the next frame would go
+        const float* pHistory = &m_History[channel * size];
+        size_t older = size - m_Position;
+        for(size_t i = 0; i < older; ++i)
+        {
+            m_Windowed[i] = pHistory[m_Position + i] * m_Window[i];
+        }
+        for(size_t i = older; i < size; ++i)
+        {
+            m_Windowed[i] = pHistory[i - older] * m_Window[i];
+        }
+
+        m_FFT.Forward(m_Windowed.data(), m_Real.data(), m_Imag.data());
+
+        float* pLevels = &m_Working.LevelsDb[channel * bins];
+        for(size_t bin = 0; bin < bins; ++bin)
+        {
+            float magnitude = std::sqrt(m_Real[bin] * m_Real[bin] + m_Imag[bin] * m_Imag[bin]) / m_FullScale;
+            pLevels[bin] = magnitude > 0.0f ? std::max(SILENCE_DB, 20.0f * std::log10(magnitude)) : SILENCE_DB;
+        }
+        FindPeaks(channel);
+    }
+
+    ++m_Working.Sequence;
+    {
+        std::lock_guard<std::mutex> lock(m_ResultMutex);
+        m_Result.Sequence = m_Working.Sequence;
+        std::copy(m_Working.LevelsDb.begin(), m_Working.LevelsDb.end(), m_Result.LevelsDb.begin());
+        std::copy(&m_Working.Peaks[0][0], &m_Working.Peaks[0][0] + CHANNEL_COUNT * MAX_PEAKS, &m_Result.Peaks[0][0]);
+        std::copy(m_Working.PeakCounts, m_Working.PeakCounts + CHANNEL_COUNT, m_Result.PeakCounts);
+    }
+    ++m_SpectraDone;
+}
+
+// The loudest local maxima, each moved to the top of the parabola through it and its
+// neighbours
+void SpectrumAnalyzer::FindPeaks(size_t Channel)
+{
+    const size_t bins = m_FFT.Bins();
+    const float* pLevels = &m_Working.LevelsDb[Channel * bins];
+    Peak* pPeaks = m_Working.Peaks[Channel];
+    size_t& count = m_Working.PeakCounts[Channel];
+    count = 0;
+    if(m_Settings.Peaks == 0)
+    {
+        return;
+    }
+
+    for(size_t bin = FIRST_PEAK_BIN; bin + 1 < bins; ++bin)
+    {
+        float level = pLevels[bin];
+        if(level < m_Settings.PeakFloorDb || level <= pLevels[bin - 1] || level < pLevels[bin + 1])
+        {
+            continue;
+        }
+        if(count == m_Settings.Peaks && level <= pPeaks[count - 1].LevelDb)
+        {
+            continue;
+        }
+
+        float left = pLevels[bin - 1];
+        float right = pLevels[bin + 1];
+        float curvature = left - 2.0f * level + right;
+        float offset = curvature < 0.0f ? 0.5f * (left - right) / curvature : 0.0f;
+        Peak peak;
+        peak.FrequencyHz = static_cast<float>((bin + offset) * BinHz());
+        peak.LevelDb = level - 0.25f * (left - right) * offset;
+
+        // Insertion into the short list, loudest first
+        size_t slot = count < m_Settings.Peaks ? count++ : count - 1;
+        while(slot > 0 && pPeaks[slot - 1].LevelDb < peak.LevelDb)
+        {
+            pPeaks[slot] = pPeaks[slot - 1];
+            --slot;
+        }
+        pPeaks[slot] = peak;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "RealFFT.h"
+#include "SPSCRing.h"
+#include "SensorResampler.h"
+
+// Vibration spectra of one device's nine axes, worked out on a thread of its own.  Frames
+// from a SensorResampler go in, so every axis is on the same regular grid.  Each Hop frames
+// the last Size of every axis are Hann windowed and put through a RealFFT, giving levels in
+// dB of the sensor's full scale for each bin from 0 up to half the frame rate, and the
+// strongest peaks of each axis, their frequencies refined between bins by fitting a
+// parabola through the levels either side.
+//
+// Add() only copies frames into a ring for the worker, and drops what doesn't fit rather
+// than wait.  The newest spectrum is kept for Latest() to copy out.  Nothing is allocated
+// after construction other than by the callers of Latest().
+class SpectrumAnalyzer
+{
+    public:
+        static constexpr size_t CHANNEL_COUNT = 9;   // Accel, gyro, mag, X Y Z of each, as in StripChartWidget
+        static constexpr size_t MAX_PEAKS = 4;
+
+        struct Settings
+        {
+            size_t Size = 512;       // Frames per spectrum, a power of two
+            size_t Hop = 64;         // Frames between spectra
+            double RateHz = 100.0;   // Of the frames
+            size_t Peaks = 3;        // Per axis, up to MAX_PEAKS
+            float  PeakFloorDb = -90.0f;   // Quieter peaks aren't reported
+        };
+
+        struct Peak
+        {
+            float FrequencyHz = 0.0f;
+            float LevelDb = 0.0f;
+        };
+
+        struct Spectrum
+        {
+            uint64_t           Sequence = 0;   // Counts up from 1, 0 until there's been one
+            size_t             Bins = 0;
+            double             BinHz = 0.0;
+            std::vector<float> LevelsDb;       // Bins for each channel in turn
+            Peak               Peaks[CHANNEL_COUNT][MAX_PEAKS];
+            size_t             PeakCounts[CHANNEL_COUNT] = {};   // Strongest first
+        };
+
+        explicit SpectrumAnalyzer(const Settings& Settings, SIMD_LEVEL Level = BestSimdLevel());
+        ~SpectrumAnalyzer();
+        SpectrumAnalyzer(const SpectrumAnalyzer&) = delete;
+        SpectrumAnalyzer& operator=(const SpectrumAnalyzer&) = delete;
+
+        // Only call from one thread.  Returns false if some frames were dropped.
+        bool Add(const ResampledFrame* pFrames, size_t Count);
+
+        // Forgets the frames so far, e.g. after a gap in them
+        void Restart();
+
+        // Copies the newest spectrum to Out if it's newer than Out already is
+        bool Latest(Spectrum& Out);
+
+        size_t Bins() const;
+        double BinHz() const;
+        SIMD_LEVEL Level() const;
+        uint64_t SpectraDone() const;
+        uint64_t FramesDropped() const;
+
+    private:
+        static constexpr size_t RING_SIZE = 4096;   // Frames waiting for the worker
+
+        void WorkerThread();
+        void AddFrame(const ResampledFrame& Frame);
+        void Analyze();
+        void FindPeaks(size_t Channel);
+
+        Settings                     m_Settings;
+        RealFFT                      m_FFT;
+        SPSCRing<ResampledFrame>     m_Ring;
+        std::mutex                   m_WakeMutex;
+        std::condition_variable      m_Wake;
+        std::thread                  m_Thread;
+        bool                         m_bStop = false;
+        std::atomic<bool>            m_bRestart{false};
+        std::atomic<uint64_t>        m_SpectraDone{0};
+        std::atomic<uint64_t>        m_FramesDropped{0};
+
+        // Only touched by the worker
+        std::vector<float>           m_History;     // CHANNEL_COUNT rings of Size frames
+        size_t                       m_Position = 0;
+        uint64_t                     m_FramesIn = 0;
+        size_t                       m_SinceSpectrum = 0;
+        std::vector<float>           m_Window;
+        float                        m_FullScale = 0.0f;      // Magnitude of a full scale sine's bin, through m_Window
+        std::vector<float>           m_Windowed;
+        std::vector<float>           m_Real;
+        std::vector<float>           m_Imag;
+        Spectrum                     m_Working;
+        std::vector<ResampledFrame>  m_Batch;
+
+        std::mutex                   m_ResultMutex;
+        Spectrum                     m_Result;
+};
@@ -0,0 +1,141 @@
+#include "StageGraph.h"
+#include <chrono>
+
+StageNode::StageNode(std::string Name) : m_Name(std::move(Name))
+{
+}
+
+const std::string& StageNode::Name() const
+{
+    return m_Name;
+}
+
+uint64_t StageNode::NowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// There's room in our queue again
+void StageNode::WakeUpstream()
+{
+    if(m_pUpstream != nullptr)
+    {
+        m_pGraph->Schedule(*m_pUpstream);
+    }
+}
+
+void StageNode::WakeDownstream()
+{
+    for(StageNode* pNode : m_Downstream)
+    {
+        m_pGraph->Schedule(*pNode);
+    }
+}
+
+void StageNode::Record(size_t ItemsIn, size_t ItemsOut, uint64_t StartNs, uint64_t EndNs)
+{
+    m_ItemsIn.fetch_add(ItemsIn, std::memory_order_relaxed);
+    m_ItemsOut.fetch_add(ItemsOut, std::memory_order_relaxed);
+    m_Runs.fetch_add(1, std::memory_order_relaxed);
+    m_BusyNs.fetch_add(EndNs - StartNs, std::memory_order_relaxed);
+}
+
+void StageNode::RecordLatency(uint64_t LatencyNs)
+{
+    m_LatencyNs.fetch_add(LatencyNs, std::memory_order_relaxed);
+    uint64_t worst = m_MaxLatencyNs.load(std::memory_order_relaxed);
+    while(LatencyNs > worst && !m_MaxLatencyNs.compare_exchange_weak(worst, LatencyNs, std::memory_order_relaxed))
+    {
+    }
+}
+
+void StageNode::RecordStall()
+{
+    m_Stalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t StageNode::Queued() const
+{
+    return 0;
+}
+
+size_t StageNode::QueueSize() const
+{
+    return 0;
+}
+
+StageGraph::StageGraph(size_t ThreadCount) : m_Pool(ThreadCount)
+{
+}
+
+StageGraph::~StageGraph()
+{
+    m_Pool.Wait();
+}
+
+void StageGraph::Wait()
+{
+    m_Pool.Wait();
+}
+
+std::vector<StageStats> StageGraph::Stats()
+{
+    std::vector<StageStats> stats;
+    for(const auto& pNode : m_Nodes)
+    {
+        const StageNode& node = *pNode;
+        StageStats s;
+        s.Name = node.Name();
+        s.ItemsIn = node.m_ItemsIn.load(std::memory_order_relaxed);
+        s.ItemsOut = node.m_ItemsOut.load(std::memory_order_relaxed);
+        s.Runs = node.m_Runs.load(std::memory_order_relaxed);
+        s.Stalls = node.m_Stalls.load(std::memory_order_relaxed);
+        uint64_t busyNs = node.m_BusyNs.load(std::memory_order_relaxed);
+        s.BusyMs = busyNs / 1e6;
+        s.ItemsPerBusySecond = busyNs > 0 ? s.ItemsIn * 1e9 / busyNs : 0.0;
+        s.MeanLatencyMs = s.ItemsIn > 0 ? node.m_LatencyNs.load(std::memory_order_relaxed) / 1e6 / s.ItemsIn : 0.0;
+        s.MaxLatencyMs = pNode->m_MaxLatencyNs.exchange(0, std::memory_order_relaxed) / 1e6;
+        s.Queued = node.Queued();
+        s.QueueSize = node.QueueSize();
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+size_t StageGraph::ThreadCount() const
+{
+    return m_Pool.ThreadCount();
+}
+
+void StageGraph::Schedule(StageNode& Node)
+{
+    Node.m_bWoken.store(true);
+    if(!Node.m_bScheduled.exchange(true))
+    {
+        m_Pool.Submit([this, &Node]() { Run(Node); });
+    }
+}
+
+// The node is only looked at by whichever thread holds m_bScheduled, so Ready() is
+// checked before letting go of it.  A wake that came while it was held gave up, which
+// m_bWoken (an exchange, to see what was queued before the wake) says to look again for.
+void StageGraph::Run(StageNode& Node)
+{
+    Node.m_bWoken.exchange(false);
+    if(Node.Ready())
+    {
+        Node.Run();
+        if(Node.Ready())
+        {
+            m_Pool.Submit([this, &Node]() { Run(Node); });
+            return;
+        }
+    }
+
+    Node.m_bScheduled.store(false);
+    if(Node.m_bWoken.exchange(false) && !Node.m_bScheduled.exchange(true))
+    {
+        m_Pool.Submit([this, &Node]() { Run(Node); });
+    }
+}
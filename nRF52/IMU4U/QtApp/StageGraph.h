@@ -0,0 +1,461 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "SPSCRing.h"
+#include "WorkStealingPool.h"
+
+class StageGraph;
+
+// What one stage of a StageGraph has done so far
+struct StageStats
+{
+    std::string Name;
+    uint64_t    ItemsIn = 0;
+    uint64_t    ItemsOut = 0;
+    uint64_t    Runs = 0;              // Batches
+    uint64_t    Stalls = 0;            // Times a queue downstream was too full to take its output
+    double      BusyMs = 0.0;          // Processing, on whichever thread
+    double      ItemsPerBusySecond = 0.0;   // What it could keep up with given a core to itself
+    double      MeanLatencyMs = 0.0;   // From an item being queued for it to the end of its batch
+    double      MaxLatencyMs = 0.0;    // The worst since Stats() was last called
+    size_t      Queued = 0;            // Waiting for it now
+    size_t      QueueSize = 0;
+};
+
+// The untyped part of a stage, which the graph schedules and measures
+class StageNode
+{
+    public:
+        explicit StageNode(std::string Name);
+        virtual ~StageNode() = default;
+        StageNode(const StageNode&) = delete;
+        StageNode& operator=(const StageNode&) = delete;
+
+        const std::string& Name() const;
+
+    protected:
+        static uint64_t NowNs();
+
+        void WakeUpstream();
+        void WakeDownstream();
+        void Record(size_t ItemsIn, size_t ItemsOut, uint64_t StartNs, uint64_t EndNs);
+        void RecordLatency(uint64_t LatencyNs);
+        void RecordStall();
+
+    private:
+        friend class StageGraph;
+
+        // One batch.  Never called on two threads at once.
+        virtual void Run() = 0;
+
+        // Whether Run() has anything to do
+        virtual bool Ready() const = 0;
+
+        virtual size_t Queued() const;
+        virtual size_t QueueSize() const;
+
+        std::string             m_Name;
+        StageGraph*             m_pGraph = nullptr;
+        StageNode*              m_pUpstream = nullptr;
+        std::vector<StageNode*> m_Downstream;
+        std::atomic<bool>       m_bScheduled{false};   // Submitted to the pool and not yet finished
+        std::atomic<bool>       m_bWoken{false};       // Since its current run started
+
+        std::atomic<uint64_t>   m_ItemsIn{0};
+        std::atomic<uint64_t>   m_ItemsOut{0};
+        std::atomic<uint64_t>   m_Runs{0};
+        std::atomic<uint64_t>   m_Stalls{0};
+        std::atomic<uint64_t>   m_BusyNs{0};
+        std::atomic<uint64_t>   m_LatencyNs{0};         // Summed over every item
+        std::atomic<uint64_t>   m_MaxLatencyNs{0};
+};
+
+// An item waiting in the queue between two stages, with when it was queued
+template<typename T>
+struct StageItem
+{
+    T        Item;
+    uint64_t QueuedNs;
+};
+
+// Where a stage's output goes: every downstream stage's queue.  What a batch emits is held
+// here until all of them have taken it.
+template<typename T>
+class StageOutput
+{
+    public:
+        void AddTarget(SPSCRing<StageItem<T>>* pQueue)
+        {
+            m_Targets.push_back(pQueue);
+            m_Taken.push_back(0);
+        }
+
+        void Emit(const T& Item)
+        {
+            m_Pending.push_back(Item);
+        }
+
+        bool Pending() const
+        {
+            return !m_Pending.empty();
+        }
+
+        size_t PendingCount() const
+        {
+            return m_Pending.size();
+        }
+
+        // Whether every target that still has pending items to take has room for one
+        bool Room() const
+        {
+            for(size_t i = 0; i < m_Targets.size(); ++i)
+            {
+                if(m_Taken[i] < m_Pending.size() && m_Targets[i]->Size() == m_Targets[i]->Capacity())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Pushes as much of what's pending as the targets have room for.  Returns true if
+        // anything was pushed; Pending() is false once all of it has been.
+        bool Flush(uint64_t NowNs)
+        {
+            bool bPushed = false;
+            bool bDone = true;
+            for(size_t i = 0; i < m_Targets.size(); ++i)
+            {
+                while(m_Taken[i] < m_Pending.size() && m_Targets[i]->Push(StageItem<T>{ m_Pending[m_Taken[i]], NowNs }))
+                {
+                    ++m_Taken[i];
+                    bPushed = true;
+                }
+                bDone = bDone && m_Taken[i] == m_Pending.size();
+            }
+            if(bDone)
+            {
+                m_Pending.clear();
+                std::fill(m_Taken.begin(), m_Taken.end(), 0);
+            }
+            return bPushed;
+        }
+
+        // For a producer outside the graph, all or nothing
+        bool TryPush(const T& Item, uint64_t NowNs)
+        {
+            for(auto* pTarget : m_Targets)
+            {
+                if(pTarget->Size() == pTarget->Capacity())
+                {
+                    return false;
+                }
+            }
+            for(auto* pTarget : m_Targets)
+            {
+                pTarget->Push(StageItem<T>{ Item, NowNs });
+            }
+            return true;
+        }
+
+    private:
+        std::vector<SPSCRing<StageItem<T>>*> m_Targets;
+        std::vector<size_t>                  m_Taken;     // Of m_Pending, by each target
+        std::vector<T>                       m_Pending;
+};
+
+// Where items come into a graph from outside it, e.g. the GUI thread.  Only push from one
+// thread.
+template<typename Out>
+class Source : public StageNode
+{
+    public:
+        using Output = Out;
+
+        explicit Source(std::string Name) : StageNode(std::move(Name))
+        {
+        }
+
+        // Returns how many of the items went in, in order, stopping at the first that a
+        // downstream queue had no room for
+        size_t Push(const Out* pItems, size_t Count)
+        {
+            uint64_t now = NowNs();
+            size_t pushed = 0;
+            while(pushed < Count && m_Output.TryPush(pItems[pushed], now))
+            {
+                ++pushed;
+            }
+            if(pushed < Count)
+            {
+                RecordStall();
+            }
+            if(pushed > 0)
+            {
+                Record(pushed, pushed, now, now);
+                WakeDownstream();
+            }
+            return pushed;
+        }
+
+    private:
+        friend class StageGraph;
+
+        void Run() override
+        {
+        }
+
+        bool Ready() const override
+        {
+            return false;
+        }
+
+        StageOutput<Out> m_Output;
+};
+
+// A stage's input queue and the batch taken from it, shared by stages with and without
+// outputs
+template<typename In>
+class InputStage : public StageNode
+{
+    public:
+        using Input = In;
+
+    protected:
+        InputStage(std::string Name, size_t MaxBatch) : StageNode(std::move(Name)), m_Items(MaxBatch), m_Taken(MaxBatch)
+        {
+        }
+
+        // Takes the next batch into m_Items, returning how many
+        size_t Take()
+        {
+            size_t count = m_pQueue ? m_pQueue->Pop(m_Taken.data(), m_Taken.size()) : 0;
+            for(size_t i = 0; i < count; ++i)
+            {
+                m_Items[i] = m_Taken[i].Item;
+            }
+            if(count > 0)
+            {
+                WakeUpstream();
+            }
+            return count;
+        }
+
+        void Processed(size_t Count, uint64_t EndNs)
+        {
+            for(size_t i = 0; i < Count; ++i)
+            {
+                RecordLatency(EndNs - m_Taken[i].QueuedNs);
+            }
+        }
+
+        bool InputWaiting() const
+        {
+            return m_pQueue && m_pQueue->Size() > 0;
+        }
+
+        std::vector<In> m_Items;
+
+    private:
+        friend class StageGraph;
+
+        size_t Queued() const override
+        {
+            return m_pQueue ? m_pQueue->Size() : 0;
+        }
+
+        size_t QueueSize() const override
+        {
+            return m_pQueue ? m_pQueue->Capacity() : 0;
+        }
+
+        std::unique_ptr<SPSCRing<StageItem<In>>> m_pQueue;
+        std::vector<StageItem<In>>               m_Taken;
+};
+
+// One step of the processing.  A stage takes up to MaxBatch of its inputs at a time, in
+// the order they were queued, and Process() hands on whatever it makes of them with Emit().
+// It never runs on two threads at once, so it can keep state without locking.  A stage
+// whose output queues are full stops taking input until they've been emptied, so a slow
+// stage holds up the ones before it instead of memory growing.
+template<typename In, typename Out>
+class Stage : public InputStage<In>
+{
+    public:
+        using Output = Out;
+
+        static constexpr size_t DEFAULT_BATCH = 256;
+
+        explicit Stage(std::string Name, size_t MaxBatch = DEFAULT_BATCH) : InputStage<In>(std::move(Name), MaxBatch)
+        {
+        }
+
+    protected:
+        virtual void Process(const In* pItems, size_t Count) = 0;
+
+        void Emit(const Out& Item)
+        {
+            m_Output.Emit(Item);
+        }
+
+    private:
+        friend class StageGraph;
+
+        void Run() override
+        {
+            uint64_t start = this->NowNs();
+            if(m_Output.Pending())
+            {
+                // Still handing on the last batch
+                if(m_Output.Flush(start))
+                {
+                    this->WakeDownstream();
+                }
+                if(m_Output.Pending())
+                {
+                    this->RecordStall();
+                    return;
+                }
+            }
+
+            size_t count = this->Take();
+            if(count == 0)
+            {
+                return;
+            }
+            Process(this->m_Items.data(), count);
+            uint64_t end = this->NowNs();
+            this->Processed(count, end);
+            size_t emitted = m_Output.PendingCount();
+            if(m_Output.Flush(end))
+            {
+                this->WakeDownstream();
+            }
+            if(m_Output.Pending())
+            {
+                this->RecordStall();
+            }
+            this->Record(count, emitted, start, end);
+        }
+
+        bool Ready() const override
+        {
+            return m_Output.Pending() ? m_Output.Room() : this->InputWaiting();
+        }
+
+        StageOutput<Out> m_Output;
+};
+
+// A stage at the end of the graph, which outputs nothing
+template<typename In>
+class Stage<In, void> : public InputStage<In>
+{
+    public:
+        using Output = void;
+
+        static constexpr size_t DEFAULT_BATCH = 256;
+
+        explicit Stage(std::string Name, size_t MaxBatch = DEFAULT_BATCH) : InputStage<In>(std::move(Name), MaxBatch)
+        {
+        }
+
+    protected:
+        virtual void Process(const In* pItems, size_t Count) = 0;
+
+    private:
+        void Run() override
+        {
+            uint64_t start = this->NowNs();
+            size_t count = this->Take();
+            if(count == 0)
+            {
+                return;
+            }
+            Process(this->m_Items.data(), count);
+            uint64_t end = this->NowNs();
+            this->Processed(count, end);
+            this->Record(count, 0, start, end);
+        }
+
+        bool Ready() const override
+        {
+            return this->InputWaiting();
+        }
+};
+
+template<typename In>
+using Sink = Stage<In, void>;
+
+// Stages connected by bounded queues, run on a thread pool.  Each stage declares the type
+// it takes and the type it emits, and only stages whose types match can be connected.  A
+// stage has one input but its output can go to any number of stages, each getting a copy.
+//
+// A stage is submitted to the pool when something is queued for it, runs one batch, and
+// is submitted again if there's more, so stages take turns on the pool's threads and
+// several can run at once.  Build the graph (Add() and Connect()) before pushing anything
+// into its sources.
+//
+// Stats() says how much each stage has done, how long it spent doing it and how long
+// items waited for it, which shows where a bottleneck is: its throughput is close to the
+// rate coming in, its latency grows, and the stages before it stall.
+class StageGraph
+{
+    public:
+        static constexpr size_t DEFAULT_QUEUE_SIZE = 4096;
+
+        // Zero means one thread per core
+        explicit StageGraph(size_t ThreadCount = 0);
+
+        // Waits for what's been pushed to go through first
+        ~StageGraph();
+
+        StageGraph(const StageGraph&) = delete;
+        StageGraph& operator=(const StageGraph&) = delete;
+
+        template<typename Node, typename... Args>
+        Node& Add(Args&&... Arguments)
+        {
+            m_Nodes.push_back(std::make_unique<Node>(std::forward<Args>(Arguments)...));
+            m_Nodes.back()->m_pGraph = this;
+            return static_cast<Node&>(*m_Nodes.back());
+        }
+
+        // Sends everything Upstream emits to Downstream, through a queue of QueueSize
+        template<typename From, typename To>
+        void Connect(From& Upstream, To& Downstream, size_t QueueSize = DEFAULT_QUEUE_SIZE)
+        {
+            static_assert(std::is_same<typename From::Output, typename To::Input>::value,
+                          "A stage can only take the type the stage before it emits");
+            assert(Upstream.m_pGraph == this && Downstream.m_pGraph == this && !Downstream.m_pQueue);
+            Downstream.m_pQueue = std::make_unique<SPSCRing<StageItem<typename To::Input>>>(QueueSize);
+            Upstream.m_Output.AddTarget(Downstream.m_pQueue.get());
+            Upstream.m_Downstream.push_back(&Downstream);
+            Downstream.m_pUpstream = &Upstream;
+        }
+
+        // Returns once nothing pushed so far is still being worked on
+        void Wait();
+
+        // In the order the stages were added
+        std::vector<StageStats> Stats();
+
+        size_t ThreadCount() const;
+
+    private:
+        friend class StageNode;
+
+        void Schedule(StageNode& Node);
+        void Run(StageNode& Node);
+
+        std::vector<std::unique_ptr<StageNode>> m_Nodes;
+        WorkStealingPool                        m_Pool;   // After m_Nodes, so its threads are gone before the stages are
+};
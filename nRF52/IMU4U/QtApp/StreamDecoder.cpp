@@ -0,0 +1,56 @@
+#include "StreamDecoder.h"
+
+size_t StreamDecoder::Decode(const uint8_t* pPacket, size_t Size, IMUSample* pSamples)
+{
+    if(Size < HEADER_SIZE || pPacket[0] != static_cast<uint8_t>(PACKET_TYPE::SAMPLES))
+    {
+        ++m_PacketsMalformed;
+        return 0;
+    }
+
+    size_t count = pPacket[1];
+    uint16_t sequence = static_cast<uint16_t>(pPacket[2] | (pPacket[3] << 8));
+
+    m_Codec.Reset();
+    size_t offset = HEADER_SIZE;
+    for(size_t i = 0; i < count; ++i)
+    {
+        size_t length = m_Codec.Decode(&pPacket[offset], Size - offset, pSamples[i]);
+        if(length == 0)
+        {
+            ++m_PacketsMalformed;
+            return 0;
+        }
+        offset += length;
+    }
+
+    if(m_bHaveSequence)
+    {
+        m_PacketsLost += static_cast<uint16_t>(sequence - m_NextSequence);
+    }
+    m_NextSequence = static_cast<uint16_t>(sequence + 1);
+    m_bHaveSequence = true;
+    ++m_PacketsDecoded;
+
+    return count;
+}
+
+void StreamDecoder::Reset()
+{
+    m_bHaveSequence = false;
+}
+
+uint64_t StreamDecoder::PacketsDecoded() const
+{
+    return m_PacketsDecoded;
+}
+
+uint64_t StreamDecoder::PacketsLost() const
+{
+    return m_PacketsLost;
+}
+
+uint64_t StreamDecoder::PacketsMalformed() const
+{
+    return m_PacketsMalformed;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "IMUData.h"
+#include "SampleCodec.h"
+
+// Packet types, the first byte of everything IMU4U sends (see Firmware/Transport.h)
+enum class PACKET_TYPE : uint8_t
+{
+    SAMPLES = 0x01,
+    RECORD  = 0x02,
+    SYNC    = 0x03    // Reply to CONTROL_OP_SYNC: token, then the 32 bit time stamp it arrived at
+};
+
+// Decodes the stream packets built by Firmware/StreamEncoder.c:
+//   Byte 0:    PACKET_TYPE::SAMPLES
+//   Byte 1:    Number of samples
+//   Byte 2-3:  Little endian sequence number
+//   Byte 4-n:  Samples encoded with SampleCodec, reset for every packet
+class StreamDecoder
+{
+    public:
+        static constexpr size_t HEADER_SIZE = 4;
+        static constexpr size_t MAX_PACKET_SAMPLES = 255;
+
+        // Decodes one packet into pSamples, which must have room for MAX_PACKET_SAMPLES.
+        // Returns the number of samples decoded, zero for a malformed packet.
+        size_t Decode(const uint8_t* pPacket, size_t Size, IMUSample* pSamples);
+
+        // Forget the sequence number, e.g. after reconnecting
+        void Reset();
+
+        uint64_t PacketsDecoded() const;
+        uint64_t PacketsLost() const;       // Going by gaps in the sequence numbers
+        uint64_t PacketsMalformed() const;
+
+    private:
+        SampleCodec m_Codec;
+        uint16_t    m_NextSequence = 0;
+        bool        m_bHaveSequence = false;
+        uint64_t    m_PacketsDecoded = 0;
+        uint64_t    m_PacketsLost = 0;
+        uint64_t    m_PacketsMalformed = 0;
+};
@@ -0,0 +1,163 @@
+#include "StripChartWidget.h"
+
+namespace
+{
+    constexpr float FULL_SCALE = 32768.0f;
+
+    const char* VERTEX_SHADER =
+        "#version 330 core\n"
+        "layout(location = 0) in float value;\n"
+        "uniform int newest;\n"
+        "uniform float span;\n"
+        "void main()\n"
+        "{\n"
+        "    float x = 1.0 - 2.0 * float(newest - gl_VertexID) / span;\n"
+        "    gl_Position = vec4(x, value, 0.0, 1.0);\n"
+        "}\n";
+
+    const char* FRAGMENT_SHADER =
+        "#version 330 core\n"
+        "uniform vec3 colour;\n"
+        "out vec4 fragmentColour;\n"
+        "void main()\n"
+        "{\n"
+        "    fragmentColour = vec4(colour, 1.0);\n"
+        "}\n";
+
+    const float AXIS_COLOURS[3][3] = { { 0.90f, 0.30f, 0.30f }, { 0.30f, 0.85f, 0.30f }, { 0.35f, 0.55f, 1.00f } };
+
+    const ThreeDimData& Group(const IMUData& Data, int Index)
+    {
+        return Index == 0 ? Data.Accel : (Index == 1 ? Data.Gyro : Data.Mag);
+    }
+}
+
+StripChartWidget::StripChartWidget(QWidget *parent) : QOpenGLWidget(parent), m_VertexBuffer(QOpenGLBuffer::VertexBuffer),
+                                                      m_History(CHANNEL_COUNT * HISTORY_SIZE)
+{
+    setFixedSize(580, 300);
+}
+
+StripChartWidget::~StripChartWidget()
+{
+    makeCurrent();
+    m_VAO.destroy();
+    m_VertexBuffer.destroy();
+    doneCurrent();
+}
+
+void StripChartWidget::AddSamples(const IMUSample* pSamples, size_t Count)
+{
+    for(size_t i = 0; i < Count; ++i)
+    {
+        size_t position = (m_SamplesAdded + i) % HISTORY_SIZE;
+        for(int group = 0; group < GROUP_COUNT; ++group)
+        {
+            const ThreeDimData& axes = Group(pSamples[i].Data, group);
+            m_History[(group * 3 + 0) * HISTORY_SIZE + position] = axes.X / FULL_SCALE;
+            m_History[(group * 3 + 1) * HISTORY_SIZE + position] = axes.Y / FULL_SCALE;
+            m_History[(group * 3 + 2) * HISTORY_SIZE + position] = axes.Z / FULL_SCALE;
+        }
+    }
+    m_SamplesAdded += Count;
+    if(Count > 0)
+    {
+        update();
+    }
+}
+
+void StripChartWidget::initializeGL()
+{
+    initializeOpenGLFunctions();
+
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Vertex, VERTEX_SHADER);
+    m_Program.addShaderFromSourceCode(QOpenGLShader::Fragment, FRAGMENT_SHADER);
+    m_Program.link();
+    m_NewestLocation = m_Program.uniformLocation("newest");
+    m_SpanLocation = m_Program.uniformLocation("span");
+    m_ColourLocation = m_Program.uniformLocation("colour");
+
+    m_VAO.create();
+    m_VAO.bind();
+    m_VertexBuffer.create();
+    m_VertexBuffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+    m_VertexBuffer.bind();
+    m_VertexBuffer.allocate(static_cast<int>(CHANNEL_COUNT * 2 * HISTORY_SIZE * sizeof(float)));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(float), nullptr);
+    m_VAO.release();
+    m_VertexBuffer.release();
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // Whatever was added before there was a context still needs uploading
+    m_SamplesUploaded = m_SamplesAdded > HISTORY_SIZE ? m_SamplesAdded - HISTORY_SIZE : 0;
+}
+
+// Copies Count values starting at ring Position to both copies of the channel's history
+void StripChartWidget::Upload(int Channel, size_t Position, size_t Count)
+{
+    const float* pValues = &m_History[Channel * HISTORY_SIZE + Position];
+    int size = static_cast<int>(Count * sizeof(float));
+    m_VertexBuffer.write(static_cast<int>((Channel * 2 * HISTORY_SIZE + Position) * sizeof(float)), pValues, size);
+    m_VertexBuffer.write(static_cast<int>((Channel * 2 * HISTORY_SIZE + HISTORY_SIZE + Position) * sizeof(float)), pValues, size);
+}
+
+void StripChartWidget::paintGL()
+{
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    m_VertexBuffer.bind();
+
+    // Only the newest HISTORY_SIZE samples are still in the ring
+    if(m_SamplesAdded - m_SamplesUploaded > HISTORY_SIZE)
+    {
+        m_SamplesUploaded = m_SamplesAdded - HISTORY_SIZE;
+    }
+    while(m_SamplesUploaded < m_SamplesAdded)
+    {
+        size_t position = m_SamplesUploaded % HISTORY_SIZE;
+        size_t count = static_cast<size_t>(m_SamplesAdded - m_SamplesUploaded);
+        if(count > HISTORY_SIZE - position)
+        {
+            count = HISTORY_SIZE - position;
+        }
+
+        for(int channel = 0; channel < CHANNEL_COUNT; ++channel)
+        {
+            Upload(channel, position, count);
+        }
+        m_SamplesUploaded += count;
+    }
+
+    size_t count = m_SamplesAdded < HISTORY_SIZE ? static_cast<size_t>(m_SamplesAdded) : HISTORY_SIZE;
+    if(count < 2)
+    {
+        m_VertexBuffer.release();
+        return;
+    }
+    size_t oldest = (m_SamplesAdded - count) % HISTORY_SIZE;
+
+    m_Program.bind();
+    m_Program.setUniformValue(m_SpanLocation, static_cast<float>(HISTORY_SIZE - 1));
+    m_VAO.bind();
+
+    int pixelWidth = static_cast<int>(width() * devicePixelRatioF());
+    int groupHeight = static_cast<int>(height() * devicePixelRatioF()) / GROUP_COUNT;
+    for(int group = 0; group < GROUP_COUNT; ++group)
+    {
+        // Accel at the top
+        glViewport(0, (GROUP_COUNT - 1 - group) * groupHeight, pixelWidth, groupHeight);
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            int first = static_cast<int>((group * 3 + axis) * 2 * HISTORY_SIZE + oldest);
+            m_Program.setUniformValue(m_NewestLocation, first + static_cast<int>(count) - 1);
+            m_Program.setUniformValue(m_ColourLocation, AXIS_COLOURS[axis][0], AXIS_COLOURS[axis][1], AXIS_COLOURS[axis][2]);
+            glDrawArrays(GL_LINE_STRIP, first, static_cast<GLsizei>(count));
+        }
+    }
+
+    m_VAO.release();
+    m_Program.release();
+    m_VertexBuffer.release();
+}
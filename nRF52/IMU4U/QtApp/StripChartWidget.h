@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLWidget>
+#include "IMUData.h"
+
+// Scrolling plots of the last HISTORY_SIZE samples of all nine axes, accel, gyro and
+// mag stacked top to bottom.  Each axis has its own stretch of one GPU buffer holding
+// its history twice over, so the visible window is always one contiguous range and
+// each axis is drawn with a single glDrawArrays.  Only the samples that arrived since
+// the last frame are uploaded, and nothing is redrawn until some have.  Values are
+// plotted against the full int16 range.
+class StripChartWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+    public:
+        static constexpr int    CHANNEL_COUNT = 9;
+        static constexpr int    GROUP_COUNT = 3;       // Accel, gyro, mag
+        static constexpr size_t HISTORY_SIZE = 5000;   // 5 seconds at 1kHz
+
+        StripChartWidget(QWidget *parent);
+        ~StripChartWidget();
+
+        void AddSamples(const IMUSample* pSamples, size_t Count);
+
+    protected:
+        void initializeGL() override;
+        void paintGL() override;
+
+    private:
+        void Upload(int Channel, size_t Position, size_t Count);
+
+        QOpenGLShaderProgram     m_Program;
+        QOpenGLBuffer            m_VertexBuffer;
+        QOpenGLVertexArrayObject m_VAO;
+        int                      m_NewestLocation = -1;
+        int                      m_SpanLocation = -1;
+        int                      m_ColourLocation = -1;
+        std::vector<float>       m_History;            // CHANNEL_COUNT rings of HISTORY_SIZE, as plotted
+        uint64_t                 m_SamplesAdded = 0;
+        uint64_t                 m_SamplesUploaded = 0;
+};
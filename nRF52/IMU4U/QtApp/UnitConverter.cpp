@@ -0,0 +1,161 @@
+#include "UnitConverter.h"
+#include <cstdint>
+#include <cstring>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr float ONE_G_IN_LSB = 16384.0f;         // FXOS8700 at +/-2g (see datasheet)
+    constexpr float MICRO_TESLA_PER_LSB = 0.1f;      // FXOS8700 magnetometer (see datasheet)
+    constexpr float DEGREES_PER_LSB = 0.0078125f;    // FXAS21002C at +/-250 degrees/s (see datasheet)
+
+    void ConvertScalar(const uint8_t* pRaw, size_t Stride, size_t Count, const SensorCalibration& C, float* pX, float* pY, float* pZ)
+    {
+        for(size_t i = 0; i < Count; ++i)
+        {
+            ThreeDimData raw;
+            std::memcpy(&raw, pRaw + i * Stride, sizeof(raw));
+            float x = (static_cast<float>(raw.X) - C.Offset[0]) * C.Scale[0];
+            float y = (static_cast<float>(raw.Y) - C.Offset[1]) * C.Scale[1];
+            float z = (static_cast<float>(raw.Z) - C.Offset[2]) * C.Scale[2];
+            pX[i] = C.Matrix[0] * x + C.Matrix[1] * y + C.Matrix[2] * z;
+            pY[i] = C.Matrix[3] * x + C.Matrix[4] * y + C.Matrix[5] * z;
+            pZ[i] = C.Matrix[6] * x + C.Matrix[7] * y + C.Matrix[8] * z;
+        }
+    }
+
+#ifdef SIMD_X86
+    // Each reading is picked up as two 32 bit words, X and Y from its start and Y and Z
+    // from two bytes in, and the halves sign extended out of them
+    SIMD_TARGET("sse2")
+    void ConvertSSE2(const uint8_t* pRaw, size_t Stride, size_t Count, const SensorCalibration& C, float* pX, float* pY, float* pZ)
+    {
+        const __m128 offsetX = _mm_set1_ps(C.Offset[0]), offsetY = _mm_set1_ps(C.Offset[1]), offsetZ = _mm_set1_ps(C.Offset[2]);
+        const __m128 scaleX = _mm_set1_ps(C.Scale[0]), scaleY = _mm_set1_ps(C.Scale[1]), scaleZ = _mm_set1_ps(C.Scale[2]);
+        __m128 m[9];
+        for(int j = 0; j < 9; ++j)
+        {
+            m[j] = _mm_set1_ps(C.Matrix[j]);
+        }
+
+        size_t i = 0;
+        for(; i + 4 <= Count; i += 4)
+        {
+            int32_t xy[4];
+            int32_t yz[4];
+            for(int k = 0; k < 4; ++k)
+            {
+                std::memcpy(&xy[k], pRaw + (i + k) * Stride, sizeof(int32_t));
+                std::memcpy(&yz[k], pRaw + (i + k) * Stride + sizeof(int16_t), sizeof(int32_t));
+            }
+            __m128i wordsXY = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xy));
+            __m128i wordsYZ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yz));
+
+            __m128 x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(wordsXY, 16), 16));
+            __m128 y = _mm_cvtepi32_ps(_mm_srai_epi32(wordsXY, 16));
+            __m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(wordsYZ, 16));
+            x = _mm_mul_ps(_mm_sub_ps(x, offsetX), scaleX);
+            y = _mm_mul_ps(_mm_sub_ps(y, offsetY), scaleY);
+            z = _mm_mul_ps(_mm_sub_ps(z, offsetZ), scaleZ);
+
+            _mm_storeu_ps(pX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], x), _mm_mul_ps(m[1], y)), _mm_mul_ps(m[2], z)));
+            _mm_storeu_ps(pY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], x), _mm_mul_ps(m[4], y)), _mm_mul_ps(m[5], z)));
+            _mm_storeu_ps(pZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[6], x), _mm_mul_ps(m[7], y)), _mm_mul_ps(m[8], z)));
+        }
+        ConvertScalar(pRaw + i * Stride, Stride, Count - i, C, pX + i, pY + i, pZ + i);
+    }
+
+    // As ConvertSSE2(), with the words gathered eight at a time
+    SIMD_TARGET("avx2")
+    void ConvertAVX2(const uint8_t* pRaw, size_t Stride, size_t Count, const SensorCalibration& C, float* pX, float* pY, float* pZ)
+    {
+        const __m256 offsetX = _mm256_set1_ps(C.Offset[0]), offsetY = _mm256_set1_ps(C.Offset[1]), offsetZ = _mm256_set1_ps(C.Offset[2]);
+        const __m256 scaleX = _mm256_set1_ps(C.Scale[0]), scaleY = _mm256_set1_ps(C.Scale[1]), scaleZ = _mm256_set1_ps(C.Scale[2]);
+        __m256 m[9];
+        for(int j = 0; j < 9; ++j)
+        {
+            m[j] = _mm256_set1_ps(C.Matrix[j]);
+        }
+        const int stride = static_cast<int>(Stride);
+        const __m256i offsets = _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride, 4 * stride, 5 * stride, 6 * stride, 7 * stride);
+
+        size_t i = 0;
+        for(; i + 8 <= Count; i += 8)
+        {
+            const uint8_t* pBase = pRaw + i * Stride;
+            __m256i wordsXY = _mm256_i32gather_epi32(reinterpret_cast<const int*>(pBase), offsets, 1);
+            __m256i wordsYZ = _mm256_i32gather_epi32(reinterpret_cast<const int*>(pBase + sizeof(int16_t)), offsets, 1);
+
+            __m256 x = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(wordsXY, 16), 16));
+            __m256 y = _mm256_cvtepi32_ps(_mm256_srai_epi32(wordsXY, 16));
+            __m256 z = _mm256_cvtepi32_ps(_mm256_srai_epi32(wordsYZ, 16));
+            x = _mm256_mul_ps(_mm256_sub_ps(x, offsetX), scaleX);
+            y = _mm256_mul_ps(_mm256_sub_ps(y, offsetY), scaleY);
+            z = _mm256_mul_ps(_mm256_sub_ps(z, offsetZ), scaleZ);
+
+            _mm256_storeu_ps(pX + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[0], x), _mm256_mul_ps(m[1], y)), _mm256_mul_ps(m[2], z)));
+            _mm256_storeu_ps(pY + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[3], x), _mm256_mul_ps(m[4], y)), _mm256_mul_ps(m[5], z)));
+            _mm256_storeu_ps(pZ + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[6], x), _mm256_mul_ps(m[7], y)), _mm256_mul_ps(m[8], z)));
+        }
+        ConvertScalar(pRaw + i * Stride, Stride, Count - i, C, pX + i, pY + i, pZ + i);
+    }
+#endif
+}
+
+DeviceCalibration DefaultCalibration()
+{
+    DeviceCalibration calibration;
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        calibration.Accel.Scale[axis] = 1.0f / ONE_G_IN_LSB;
+        calibration.Mag.Scale[axis] = MICRO_TESLA_PER_LSB;
+        calibration.Gyro.Scale[axis] = DEGREES_PER_LSB;
+    }
+    return calibration;
+}
+
+UnitConverter::UnitConverter() : m_Kernel(BestSimdLevel())
+{
+}
+
+UnitConverter::UnitConverter(KERNEL Kernel) : m_Kernel(Supported(Kernel) ? Kernel : KERNEL::SCALAR)
+{
+}
+
+bool UnitConverter::Supported(KERNEL Kernel)
+{
+    return SimdSupported(Kernel);
+}
+
+const char* UnitConverter::Name(KERNEL Kernel)
+{
+    return SimdName(Kernel);
+}
+
+UnitConverter::KERNEL UnitConverter::Kernel() const
+{
+    return m_Kernel;
+}
+
+void UnitConverter::Convert(const ThreeDimData* pRaw, size_t Stride, size_t Count, const SensorCalibration& Calibration,
+                            float* pX, float* pY, float* pZ) const
+{
+    const auto* pBytes = reinterpret_cast<const uint8_t*>(pRaw);
+    switch(m_Kernel)
+    {
+#ifdef SIMD_X86
+        case KERNEL::AVX2:
+            ConvertAVX2(pBytes, Stride, Count, Calibration, pX, pY, pZ);
+            break;
+        case KERNEL::SSE2:
+            ConvertSSE2(pBytes, Stride, Count, Calibration, pX, pY, pZ);
+            break;
+#endif
+        default:
+            ConvertScalar(pBytes, Stride, Count, Calibration, pX, pY, pZ);
+            break;
+    }
+}
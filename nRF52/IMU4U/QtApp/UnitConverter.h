@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include "IMUData.h"
+#include "SimdSupport.h"
+
+// How to turn one sensor's raw counts into physical units:
+//   value = Matrix * ((raw - Offset) * Scale)
+// Offset is the zero error in counts, Scale the datasheet sensitivity, and Matrix (row
+// major) takes out misalignment, cross axis sensitivity or soft iron distortion.
+struct SensorCalibration
+{
+    float Offset[3] = { 0.0f, 0.0f, 0.0f };
+    float Scale[3] = { 1.0f, 1.0f, 1.0f };
+    float Matrix[9] = { 1.0f, 0.0f, 0.0f,
+                        0.0f, 1.0f, 0.0f,
+                        0.0f, 0.0f, 1.0f };
+};
+
+// A device's three sensors, to g, microtesla and degrees per second
+struct DeviceCalibration
+{
+    SensorCalibration Accel;
+    SensorCalibration Mag;
+    SensorCalibration Gyro;
+};
+
+// Datasheet sensitivities for the ranges the firmware sets, with no offsets or matrices
+DeviceCalibration DefaultCalibration();
+
+// Converts blocks of raw readings to physical units, writing each axis to an array of its
+// own.  The work is done eight or four readings at a time with AVX2 or SSE2, whichever is
+// the best the CPU running us has, and one at a time elsewhere.  Every kernel does the
+// same operations in the same order, so they agree unless the compiler fuses the scalar
+// multiplies and adds.
+class UnitConverter
+{
+    public:
+        using KERNEL = SIMD_LEVEL;
+
+        UnitConverter();                        // Picks the best kernel
+        explicit UnitConverter(KERNEL Kernel);  // Falls back to SCALAR if the CPU can't run Kernel
+
+        static bool Supported(KERNEL Kernel);
+        static const char* Name(KERNEL Kernel);
+        KERNEL Kernel() const;
+
+        // Converts Count readings, each Stride bytes after the last so they can be picked
+        // out of larger structures, e.g. &pSamples->Data.Gyro with sizeof(IMUSample).
+        void Convert(const ThreeDimData* pRaw, size_t Stride, size_t Count, const SensorCalibration& Calibration,
+                     float* pX, float* pY, float* pZ) const;
+
+    private:
+        KERNEL m_Kernel;
+};
@@ -1,21 +1,57 @@
 #include "Window.h"
+#include <algorithm>
 #include <QFontDatabase>
 
 namespace
 {
-    constexpr double ONE_G_IN_LSB = 16384.0;      // Conversion from accelerometer int value to gravitational unit (See datasheet)
-    constexpr double MICRO_TESLA_PER_LSB = 0.001; // Conversion from magmometer int value to tesla unit (See datasheet)
-    constexpr double DEGREES_PER_LSB = 0.0078125; // Conversion from gyro int value to degrees per second (See datasheet)
-    constexpr int    TIMER_MS = 100;              // TimerHandler() called every TIMER_MS milliseconds
+    constexpr double FILTER_RATE_HZ = 100.0;      // Fusion is stepped at this rate, whatever the sensors' own rates
+    constexpr size_t GRAPH_THREADS = 2;           // Enough for the stages to overlap without taking the GUI's core
+    constexpr int    REFRESH_MS = 16;             // Refresh() runs at most once every REFRESH_MS milliseconds, once per frame
+    const char*      RECORDING_FILE_NAME = "IMU4U_Recording.bin"; // On-device recordings are downloaded to this file
+    constexpr uint16_t SHOWN_DEVICE = 0;          // The device whose orientation and sensors are drawn
+    constexpr size_t SPECTRUM_SIZE = 256;         // Frames per spectrum, 2.56s at FILTER_RATE_HZ
+    constexpr size_t SPECTRUM_HOP = 32;           // Frames between spectra
+
+    // Where each sensor's axes go in Window::m_Units
+    constexpr int    ACCEL_UNITS = 0;
+    constexpr int    MAG_UNITS = 3;
+    constexpr int    GYRO_UNITS = 6;
+
+    SpectrumAnalyzer::Settings SpectrumSettings()
+    {
+        SpectrumAnalyzer::Settings settings;
+        settings.Size = SPECTRUM_SIZE;
+        settings.Hop = SPECTRUM_HOP;
+        settings.RateHz = FILTER_RATE_HZ;
+        settings.Peaks = 1;
+        return settings;
+    }
 }
 
-Window::Window(NordicCentral& nordicCentral) : m_GLWidget(this), m_NordicCentral(nordicCentral)
+Window::Window(NordicCentral& nordicCentral) : m_RecordButton("Record"), m_StopButton("Stop"), m_DownloadButton("Download"),
+                                               m_GLWidget(this), m_StripChart(this), m_NordicCentral(nordicCentral),
+                                               m_Samples(NordicCentral::SAMPLE_RING_SIZE), m_Calibration(DefaultCalibration()),
+                                               m_Spectrum(SpectrumSettings()), m_Graph(GRAPH_THREADS)
 {
-    setFixedSize(600,420);
+    BuildGraph();
+
+    m_ShownSamples.reserve(NordicCentral::SAMPLE_RING_SIZE);
+    for(auto& units : m_Units)
+    {
+        units.resize(NordicCentral::SAMPLE_RING_SIZE);
+    }
+    setFixedSize(600,840);
     setWindowFlags(Qt::Window);
 
     m_positionLabels.setAlignment(Qt::AlignTop);
-    dataLayout.addWidget(&m_positionLabels, 0, 0);
+    dataLayout.addWidget(&m_positionLabels, 0, 0, 1, 3);
+    dataLayout.addWidget(&m_RecordButton, 1, 0);
+    dataLayout.addWidget(&m_StopButton, 1, 1);
+    dataLayout.addWidget(&m_DownloadButton, 1, 2);
+
+    connect(&m_RecordButton, &QPushButton::clicked, this, [this]() { m_NordicCentral.StartRecording(); });
+    connect(&m_StopButton, &QPushButton::clicked, this, [this]() { m_NordicCentral.StopRecording(); });
+    connect(&m_DownloadButton, &QPushButton::clicked, this, [this]() { m_NordicCentral.DownloadRecording(RECORDING_FILE_NAME); });
 
     QFont myFont;
     myFont.setFamily("Consolas");
@@ -25,49 +61,223 @@ Window::Window(NordicCentral& nordicCentral) : m_GLWidget(this), m_NordicCentral
 
     m_MainLayout.addWidget(&m_GLWidget, 0, 0);
     m_MainLayout.addLayout(&dataLayout, 0, 1);
+    m_MainLayout.addWidget(&m_StripChart, 1, 0, 1, 2);
     setLayout(&m_MainLayout);
 
-    connect(&m_Timer, &QTimer::timeout, this, &Window::TimerHandler);
-    connect(&m_Timer, &QTimer::timeout, &m_GLWidget, &GLWidget::Animate);
-    m_Timer.start(TIMER_MS);
+    // Refreshed when there's something new to show, rather than polling for it
+    m_RefreshTimer.setSingleShot(true);
+    connect(&m_RefreshTimer, &QTimer::timeout, this, &Window::Refresh);
+    for(auto signal : { &NordicCentral::SamplesArrived, &NordicCentral::ConnectionChanged, &NordicCentral::ButtonChanged,
+                        &NordicCentral::LEDStateChanged, &NordicCentral::DownloadChanged, &NordicCentral::StatsChanged })
+    {
+        connect(&m_NordicCentral, signal, this, &Window::ScheduleRefresh);
+    }
+    m_SinceRefresh.start();
+    ScheduleRefresh();
+}
 
-    m_NordicCentral.Start();
+// However many changes come in, they're shown together at the next frame
+void Window::ScheduleRefresh()
+{
+    if(!m_RefreshTimer.isActive())
+    {
+        m_RefreshTimer.start(std::max<qint64>(0, REFRESH_MS - m_SinceRefresh.elapsed()));
+    }
 }
 
-void Window::TimerHandler()
+void Window::Refresh()
 {
-    static int counter = 0;
+    m_SinceRefresh.restart();
 
-    auto IMUData = m_NordicCentral.IMUData();
+    // Take everything decoded since the last frame in one go, and come back next frame if
+    // there could be more
+    size_t count = m_NordicCentral.ReadSamples(m_Samples.data(), m_Samples.size());
+    if(count == m_Samples.size())
+    {
+        ScheduleRefresh();
+    }
+    m_GraphDropped += count - m_pGraphInput->Push(m_Samples.data(), count);
+    m_ShownSamples.clear();
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(m_Samples[i].Device == SHOWN_DEVICE)
+        {
+            m_ShownSamples.push_back(m_Samples[i].Sample);
+        }
+    }
+    if(!m_ShownSamples.empty())
+    {
+        m_StripChart.AddSamples(m_ShownSamples.data(), m_ShownSamples.size());
+        m_LatestIMUData = m_ShownSamples.back().Data;
+        m_SamplesRendered += m_ShownSamples.size();
+        ConvertShownSamples();
+    }
+
+    // The orientations of what was pushed come back a little later, and ask for another
+    // refresh when they do
+    Quaternion orientation;
+    if(m_pOrientations->Latest(SHOWN_DEVICE, orientation))
+    {
+        m_GLWidget.SetOrientation(orientation);
+    }
+
+    // Spectra come from their own thread every SPECTRUM_HOP frames, which samples arriving
+    // are enough to check for
+    if(m_Spectrum.Latest(m_LatestSpectrum))
+    {
+        m_GLWidget.AddSpectrum(m_LatestSpectrum);
+    }
+    const auto& IMUData = m_LatestIMUData;
+
+    QString devices;
+    for(const auto& device : m_NordicCentral.Devices())
+    {
+        devices += QString("\n%1 %2\n%3/s %4 lost").arg(device.Id).arg(device.Name).arg(device.SampleRate, 0, 'f', 1)
+                                                 .arg(static_cast<qulonglong>(device.PacketsLost));
+        if(device.FirstSampleMs >= 0.0)
+        {
+            devices += QString("\nFirst sample %1ms").arg(device.FirstSampleMs, 0, 'f', 0);
+        }
+        if(device.bReconnecting)
+        {
+            devices += QString("\nReconnecting, %1 failed").arg(device.ReconnectAttempts);
+        }
+        if(device.Outages > 0)
+        {
+            devices += QString("\n%1 outages %2s, last %3s\n~%4 samples missed").arg(device.Outages).arg(device.TotalOutageMs / 1e3, 0, 'f', 1)
+                                                                              .arg(device.LastOutageMs / 1e3, 0, 'f', 1)
+                                                                              .arg(static_cast<qulonglong>(device.SamplesLostInOutages));
+        }
+        if(device.bClockSynced)
+        {
+            devices += QString("\nClock %1ms %2ppm ±%3ms").arg(device.ClockOffsetNs / 1e6, 0, 'f', 1).arg(device.ClockSkewPpm, 0, 'f', 1)
+                                                       .arg(device.ClockResidualNs / 1e6, 0, 'f', 1);
+        }
+        else
+        {
+            devices += "\nClock not synced";
+        }
+    }
 
     QString str;
     str.sprintf("Connected: %s\n\n"
                 "Accel\nX:% 2.2fg\nY:% 2.2fg\nZ:% 2.2fg\nx:% 6d\ny:% 6d\nz:% 6d\n\n"
                 "Gyro\nX:% *.2f°/s\nY:% *.2f°/s\nZ:% *.2f°/s\nx:% *d\ny:% *d\nz:% *d\n\n"
-                "Mag\nX:% 2.2fmT\nY:% 2.2fmT\nZ:% 2.2fmT\nx:% 6d\ny:% 6d\nz:% 6d\n\n"
-                "LED:%s\nButton:%s\nError:%d\nTimer:%d",
+                "Mag\nX:% *.1fµT\nY:% *.1fµT\nZ:% *.1fµT\nx:% 6d\ny:% 6d\nz:% 6d\n\n"
+                "LED:%s\nButton:%s\nError:%d\nRefreshes:%llu\nDownload:%s %lld bytes\n\n"
+                "Samples\nReceived:%llu\nRendered:%llu\nDropped:%llu\nLate:%llu\n\nFrame:%.1fms",
                 m_NordicCentral.Connected() ? "Yes" : "No",
-                IMUData.Accel.X / ONE_G_IN_LSB,
-                IMUData.Accel.Y / ONE_G_IN_LSB,
-                IMUData.Accel.Z / ONE_G_IN_LSB,
+                m_LatestUnits[ACCEL_UNITS],
+                m_LatestUnits[ACCEL_UNITS + 1],
+                m_LatestUnits[ACCEL_UNITS + 2],
                 IMUData.Accel.X,
                 IMUData.Accel.Y,
                 IMUData.Accel.Z,
-                6, IMUData.Gyro.X * DEGREES_PER_LSB,
-                6, IMUData.Gyro.Y * DEGREES_PER_LSB,
-                6, IMUData.Gyro.Z * DEGREES_PER_LSB,
+                6, m_LatestUnits[GYRO_UNITS],
+                6, m_LatestUnits[GYRO_UNITS + 1],
+                6, m_LatestUnits[GYRO_UNITS + 2],
                 6, IMUData.Gyro.X,
                 6, IMUData.Gyro.Y,
                 6, IMUData.Gyro.Z,
-                IMUData.Accel.X * MICRO_TESLA_PER_LSB,
-                IMUData.Accel.Y * MICRO_TESLA_PER_LSB,
-                IMUData.Accel.Z * MICRO_TESLA_PER_LSB,
-                IMUData.Accel.X,
-                IMUData.Accel.Y,
-                IMUData.Accel.Z,
+                6, m_LatestUnits[MAG_UNITS],
+                6, m_LatestUnits[MAG_UNITS + 1],
+                6, m_LatestUnits[MAG_UNITS + 2],
+                IMUData.Mag.X,
+                IMUData.Mag.Y,
+                IMUData.Mag.Z,
                 m_NordicCentral.LEDState() == NordicCentral::LED_STATE::ON ? "On" : "Off",
-                m_NordicCentral.ButtonPressed() ? "Down" : "Up", 0, counter);
+                m_NordicCentral.ButtonPressed() ? "Down" : "Up", 0, static_cast<unsigned long long>(m_Refreshes),
+                m_NordicCentral.Downloading() ? "Active" : "Idle", m_NordicCentral.DownloadedBytes(),
+                static_cast<unsigned long long>(m_NordicCentral.SamplesReceived()),
+                static_cast<unsigned long long>(m_SamplesRendered),
+                static_cast<unsigned long long>(m_NordicCentral.SamplesDropped()),
+                static_cast<unsigned long long>(m_NordicCentral.SamplesLate()),
+                m_GLWidget.FrameTimeMs());
 
-    m_positionLabels.setText(str);
-    ++counter;
+    // The loudest peak of each group's axes
+    QString vibration = QString("\n\nVibration 0-%1Hz").arg(FILTER_RATE_HZ / 2.0, 0, 'f', 0);
+    const char* groupNames[GLWidget::GROUP_COUNT] = { "Accel", "Gyro", "Mag" };
+    for(int group = 0; group < GLWidget::GROUP_COUNT; ++group)
+    {
+        const SpectrumAnalyzer::Peak* pLoudest = nullptr;
+        char axisName = 'X';
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            size_t channel = group * 3 + axis;
+            if(m_LatestSpectrum.PeakCounts[channel] > 0 &&
+               (pLoudest == nullptr || m_LatestSpectrum.Peaks[channel][0].LevelDb > pLoudest->LevelDb))
+            {
+                pLoudest = &m_LatestSpectrum.Peaks[channel][0];
+                axisName = static_cast<char>('X' + axis);
+            }
+        }
+        vibration += pLoudest != nullptr ? QString("\n%1 %2:%3Hz %4dB").arg(groupNames[group]).arg(axisName)
+                                                                      .arg(pLoudest->FrequencyHz, 0, 'f', 2).arg(pLoudest->LevelDb, 0, 'f', 0)
+                                         : QString("\n%1 -").arg(groupNames[group]);
+    }
+
+    m_positionLabels.setText(str + vibration + GraphStats() + "\n\nDevices" + devices);
+    ++m_Refreshes;
+}
+
+// The whole frame's worth in one go, though only the latest is shown for now
+void Window::ConvertShownSamples()
+{
+    const IMUSample* pSamples = m_ShownSamples.data();
+    size_t count = m_ShownSamples.size();
+    m_Converter.Convert(&pSamples->Data.Accel, sizeof(IMUSample), count, m_Calibration.Accel,
+                        m_Units[ACCEL_UNITS].data(), m_Units[ACCEL_UNITS + 1].data(), m_Units[ACCEL_UNITS + 2].data());
+    m_Converter.Convert(&pSamples->Data.Mag, sizeof(IMUSample), count, m_Calibration.Mag,
+                        m_Units[MAG_UNITS].data(), m_Units[MAG_UNITS + 1].data(), m_Units[MAG_UNITS + 2].data());
+    m_Converter.Convert(&pSamples->Data.Gyro, sizeof(IMUSample), count, m_Calibration.Gyro,
+                        m_Units[GYRO_UNITS].data(), m_Units[GYRO_UNITS + 1].data(), m_Units[GYRO_UNITS + 2].data());
+    for(size_t axis = 0; axis < m_Units.size(); ++axis)
+    {
+        m_LatestUnits[axis] = m_Units[axis][count - 1];
+    }
+}
+
+// Merged samples are resampled onto a grid shared by accel, mag and gyro, calibrated and
+// fused into orientations for m_GLWidget, with the shown device's resampled frames going
+// to m_Spectrum as well
+void Window::BuildGraph()
+{
+    const size_t devices = NordicCentral::MAX_DEVICES;
+    auto& input = m_Graph.Add<Source<MergedSample>>("Input");
+    auto& resampler = m_Graph.Add<ResamplerStage>(devices, FILTER_RATE_HZ);
+    auto& calibration = m_Graph.Add<CalibrationStage>(devices);
+    auto& fusion = m_Graph.Add<FusionStage>(devices, FILTER_RATE_HZ);
+    auto& orientations = m_Graph.Add<OrientationSink>(devices, [this]()
+    {
+        QMetaObject::invokeMethod(this, [this]() { ScheduleRefresh(); }, Qt::QueuedConnection);
+    });
+    auto& spectrum = m_Graph.Add<SpectrumSink>(m_Spectrum, SHOWN_DEVICE);
+
+    m_Graph.Connect(input, resampler, NordicCentral::SAMPLE_RING_SIZE);
+    m_Graph.Connect(resampler, calibration);
+    m_Graph.Connect(calibration, fusion);
+    m_Graph.Connect(fusion, orientations);
+    m_Graph.Connect(resampler, spectrum);
+
+    m_pGraphInput = &input;
+    m_pOrientations = &orientations;
+}
+
+// Each stage's throughput on a core of its own, and how long samples wait for it
+QString Window::GraphStats()
+{
+    QString stats = QString("\n\nStages, %1 dropped").arg(static_cast<qulonglong>(m_GraphDropped));
+    for(const StageStats& stage : m_Graph.Stats())
+    {
+        if(stage.Runs > 0 && stage.QueueSize > 0)
+        {
+            stats += QString("\n%1 %2k/s %3ms").arg(QString::fromStdString(stage.Name)).arg(stage.ItemsPerBusySecond / 1e3, 0, 'f', 0)
+                                                .arg(stage.MeanLatencyMs, 0, 'f', 2);
+            if(stage.Stalls > 0)
+            {
+                stats += QString(" %1 stalls").arg(static_cast<qulonglong>(stage.Stalls));
+            }
+        }
+    }
+    return stats;
 }
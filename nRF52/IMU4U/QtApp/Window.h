@@ -1,11 +1,19 @@
 #pragma once
 
 #include <QWidget>
+#include <QElapsedTimer>
 #include <QGridLayout>
 #include <QLabel>
+#include <QPushButton>
 #include <QTimer>
+#include <array>
+#include <vector>
 #include "GLWidget.h"
 #include "NordicCentral.h"
+#include "ProcessingStages.h"
+#include "SpectrumAnalyzer.h"
+#include "StripChartWidget.h"
+#include "UnitConverter.h"
 
 class Window : public QWidget
 {
@@ -15,13 +23,41 @@ class Window : public QWidget
         Window(NordicCentral&);
 
     private:
-        void TimerHandler();
+        void ScheduleRefresh();
+        void Refresh();
+        void BuildGraph();
+        void ConvertShownSamples();
+        QString GraphStats();
 
         QLabel m_positionLabels;
+        QPushButton m_RecordButton;
+        QPushButton m_StopButton;
+        QPushButton m_DownloadButton;
         QGridLayout dataLayout;
         GLWidget m_GLWidget;
+        StripChartWidget m_StripChart;
         QGridLayout m_MainLayout;
-        QTimer m_Timer;
+        QTimer m_RefreshTimer;                   // Single shot, for the refresh asked for since the last
+        QElapsedTimer m_SinceRefresh;
+        uint64_t m_Refreshes = 0;
 
         NordicCentral& m_NordicCentral;
+        std::vector<MergedSample> m_Samples;     // Samples picked up from m_NordicCentral this frame
+        std::vector<IMUSample> m_ShownSamples;   // The ones from the device being shown
+        IMUData m_LatestIMUData{};
+        UnitConverter m_Converter;
+        DeviceCalibration m_Calibration;         // For the device being shown
+        std::array<std::vector<float>, 9> m_Units;   // m_ShownSamples in physical units, one array per axis
+        std::array<float, 9> m_LatestUnits{};
+        uint64_t m_SamplesRendered = 0;
+        SpectrumAnalyzer m_Spectrum;             // Of the device being shown, from its resampled frames
+        SpectrumAnalyzer::Spectrum m_LatestSpectrum;
+
+        // Every device's samples go through this to become orientations and spectra (see
+        // BuildGraph()).  Declared after m_Spectrum, which one of its stages feeds, so it's
+        // destroyed first.
+        StageGraph m_Graph;
+        Source<MergedSample>* m_pGraphInput = nullptr;
+        OrientationSink* m_pOrientations = nullptr;
+        uint64_t m_GraphDropped = 0;             // Samples the graph had no room for
 };
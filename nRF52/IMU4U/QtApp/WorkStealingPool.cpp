@@ -0,0 +1,118 @@
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(size_t ThreadCount)
+{
+    if(ThreadCount == 0)
+    {
+        ThreadCount = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    }
+
+    for(size_t i = 0; i < ThreadCount; ++i)
+    {
+        m_Queues.push_back(std::make_unique<Queue>());
+    }
+    for(size_t i = 0; i < ThreadCount; ++i)
+    {
+        m_Threads.emplace_back(&WorkStealingPool::Worker, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+    m_WorkQueued.notify_all();
+    for(auto& thread : m_Threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::Submit(Task Task)
+{
+    Queue& queue = *m_Queues[m_NextQueue++ % m_Queues.size()];
+    ++m_Unfinished;
+    {
+        // Counted first, and under the lock, so a waiting worker can't miss it
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        ++m_Queued;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Tasks.push_back(std::move(Task));
+    }
+    m_WorkQueued.notify_one();
+}
+
+void WorkStealingPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_AllDone.wait(lock, [this]() { return m_Unfinished == 0; });
+}
+
+size_t WorkStealingPool::ThreadCount() const
+{
+    return m_Threads.size();
+}
+
+uint64_t WorkStealingPool::TasksStolen() const
+{
+    return m_TasksStolen;
+}
+
+bool WorkStealingPool::TakeTask(size_t Index, Task& Task)
+{
+    {
+        Queue& own = *m_Queues[Index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if(!own.Tasks.empty())
+        {
+            Task = std::move(own.Tasks.back());
+            own.Tasks.pop_back();
+            return true;
+        }
+    }
+
+    for(size_t i = 1; i < m_Queues.size(); ++i)
+    {
+        Queue& victim = *m_Queues[(Index + i) % m_Queues.size()];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if(!victim.Tasks.empty())
+        {
+            Task = std::move(victim.Tasks.front());
+            victim.Tasks.pop_front();
+            ++m_TasksStolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Worker(size_t Index)
+{
+    for(;;)
+    {
+        Task task;
+        if(TakeTask(Index, task))
+        {
+            --m_Queued;
+            task();
+
+            if(--m_Unfinished == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_AllDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_WorkQueued.wait(lock, [this]() { return m_Queued > 0 || m_bStop; });
+        if(m_bStop && m_Queued == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where each worker has its own task queue.  Submitted tasks are dealt out
+// round robin; a worker takes its newest task first (still warm in its cache) and once
+// its queue is empty steals the oldest task from another worker's queue, so uneven
+// tasks still keep every core busy.
+class WorkStealingPool
+{
+    public:
+        using Task = std::function<void()>;
+
+        // Zero means one thread per core
+        explicit WorkStealingPool(size_t ThreadCount = 0);
+        ~WorkStealingPool();
+        WorkStealingPool(const WorkStealingPool&) = delete;
+        WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+        void Submit(Task Task);
+
+        // Returns once every submitted task has finished
+        void Wait();
+
+        size_t ThreadCount() const;
+        uint64_t TasksStolen() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex       Mutex;
+            std::deque<Task> Tasks;
+        };
+
+        void Worker(size_t Index);
+        bool TakeTask(size_t Index, Task& Task);
+
+        std::vector<std::unique_ptr<Queue>> m_Queues;
+        std::vector<std::thread>            m_Threads;
+        std::mutex                          m_Mutex;
+        std::condition_variable             m_WorkQueued;
+        std::condition_variable             m_AllDone;
+        std::atomic<size_t>                 m_Queued{0};       // Submitted but not yet taken
+        std::atomic<size_t>                 m_Unfinished{0};   // Submitted but not yet finished
+        std::atomic<size_t>                 m_NextQueue{0};
+        std::atomic<uint64_t>               m_TasksStolen{0};
+        bool                                m_bStop = false;
+};
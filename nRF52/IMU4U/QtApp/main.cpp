@@ -1,16 +1,142 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QSurfaceFormat>
+#include <QTextStream>
 
+#include "IMU4UService.h"
 #include "NordicCentral.h"
 #include "Window.h"
 
 int main(int argc, char *argv[])
 {
+    // GLWidget draws with the core profile, synced to the display
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    format.setSwapInterval(1);
+    QSurfaceFormat::setDefaultFormat(format);
+
     QApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption replayOption("replay", "Replay a capture file instead of connecting to a device.", "file");
+    QCommandLineOption speedOption("speed", "Replay speed as a multiple of real time, or \"max\".", "speed", "1");
+    QCommandLineOption captureOption("capture", "Save everything the device sends to a capture file.", "file");
+    QCommandLineOption archiveOption("archive", "Save every decoded sample to a sample archive.", "file");
+    QCommandLineOption publishOption("publish", "Publish every decoded sample to shared memory for other processes "
+                                     "(see SampleSubscriber.h).", "name", "/IMU4U");
+    QCommandLineOption serveOption("serve", "Stream every decoded sample to TCP clients on this port (see SampleServer.h).", "port");
+    QCommandLineOption serveLanOption("serve-lan", "Accept --serve clients from other hosts, not just this one.");
+    QCommandLineOption quitOption("quit-after-replay", "Print the stream counters and quit once the replay has finished.");
+    QCommandLineOption simulateOption("simulate", "Connect to a simulated device instead of a real one.");
+    QCommandLineOption simRateOption("sim-rate", "Simulated sample rate in Hz.", "hz", "100");
+    QCommandLineOption simLossOption("sim-loss", "Chance of each simulated packet being lost, 0 to 1.", "probability", "0");
+    QCommandLineOption simJitterOption("sim-jitter", "Hold simulated packets back by up to this long.", "ms", "0");
+    QCommandLineOption simOutageEveryOption("sim-outage-every", "Drop each simulated connection this often.", "seconds", "0");
+    QCommandLineOption simOutageOption("sim-outage", "Keep dropped simulated devices out of reach for this long.", "ms", "0");
+    QCommandLineOption deviceOption("device", "Connect to devices with this address or name, * and ? match anything. "
+                                    "Can be given more than once.", "pattern", DEVICE_NAME);
+    QCommandLineOption devicesOption("devices", "How many devices to connect to (0 for every match), or to simulate.", "count", "1");
+    QCommandLineOption forgetOption("forget-devices", "Scan for every device, rather than connecting straight to those connected to before.");
+    parser.addOptions({ replayOption, speedOption, captureOption, archiveOption, publishOption, serveOption, serveLanOption, quitOption,
+                        simulateOption, simRateOption, simLossOption, simJitterOption, simOutageEveryOption, simOutageOption, deviceOption,
+                        devicesOption, forgetOption });
+    parser.process(app);
+
     NordicCentral nordicCentral;
 
     Window window(nordicCentral);
     window.show();
 
+    if(parser.isSet(archiveOption) && !nordicCentral.ArchiveTo(parser.value(archiveOption)))
+    {
+        QTextStream(stderr) << "Can't write " << parser.value(archiveOption) << endl;
+        return 1;
+    }
+
+    if(parser.isSet(publishOption) && !nordicCentral.PublishTo(parser.value(publishOption)))
+    {
+        QTextStream(stderr) << "Can't publish to " << parser.value(publishOption) << endl;
+        return 1;
+    }
+
+    if(parser.isSet(serveOption) && !nordicCentral.ServeOn(parser.value(serveOption).toUShort(), parser.isSet(serveLanOption)))
+    {
+        QTextStream(stderr) << "Can't listen on port " << parser.value(serveOption) << endl;
+        return 1;
+    }
+
+    if(parser.isSet(replayOption))
+    {
+        double speed = ReplaySource::MAX_SPEED;
+        if(parser.value(speedOption) != "max")
+        {
+            bool bOk = false;
+            speed = parser.value(speedOption).toDouble(&bOk);
+            if(!bOk || !(speed > 0.0))
+            {
+                QTextStream(stderr) << "--speed must be a multiple of real time above 0, or max, not " << parser.value(speedOption) << endl;
+                return 1;
+            }
+        }
+        std::function<void()> onFinished;
+        if(parser.isSet(quitOption))
+        {
+            onFinished = [&app, &nordicCentral]()
+            {
+                QMetaObject::invokeMethod(&app, [&nordicCentral]()
+                {
+                    QTextStream out(stdout);
+                    out << "Samples received: " << nordicCentral.SamplesReceived()
+                        << " dropped: " << nordicCentral.SamplesDropped()
+                        << " packets lost: " << nordicCentral.PacketsLost()
+                        << " malformed: " << nordicCentral.PacketsMalformed() << endl;
+                    for(const auto& device : nordicCentral.Devices())
+                    {
+                        out << "Device " << device.Id << " samples: " << device.SamplesReceived
+                            << " packets lost: " << device.PacketsLost
+                            << " malformed: " << device.PacketsMalformed << endl;
+                    }
+                    QApplication::quit();
+                });
+            };
+        }
+
+        if(!nordicCentral.StartReplay(parser.value(replayOption), speed, onFinished))
+        {
+            QTextStream(stderr) << "Can't read " << parser.value(replayOption) << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        if(parser.isSet(captureOption) && !nordicCentral.CaptureTo(parser.value(captureOption)))
+        {
+            QTextStream(stderr) << "Can't write " << parser.value(captureOption) << endl;
+            return 1;
+        }
+
+        if(parser.isSet(simulateOption))
+        {
+            SimulatedDeviceLink::Settings settings;
+            settings.SampleRateHz = parser.value(simRateOption).toDouble();
+            settings.LossProbability = parser.value(simLossOption).toDouble();
+            settings.JitterMs = parser.value(simJitterOption).toDouble();
+            settings.OutageEverySec = parser.value(simOutageEveryOption).toDouble();
+            settings.OutageMs = parser.value(simOutageOption).toDouble();
+            nordicCentral.StartSimulated(settings, parser.value(devicesOption).toInt());
+        }
+        else
+        {
+            if(parser.isSet(forgetOption))
+            {
+                nordicCentral.ForgetDevices();
+            }
+            nordicCentral.Start(parser.values(deviceOption), parser.value(devicesOption).toInt());
+        }
+    }
+
     return app.exec();
 }
@@ -0,0 +1,15 @@
+# Write throughput and random seek latency of SampleArchive (see QtApp/SampleArchive.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SampleArchive.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SampleArchive.cpp
+
+unix:LIBS  += -lpthread
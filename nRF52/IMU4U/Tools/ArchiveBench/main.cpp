@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "SampleArchive.h"
+
+// Writes a synthetic recording, reads it all back to check it, checks that a copy cut
+// off part way through still opens with every whole chunk before the cut, then times
+// random seeks:
+//   ArchiveBench [file] [devices] [minutes] [rate Hz] [seeks]
+// Exits with 1 if anything read back doesn't match what was written.
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;
+    constexpr size_t APPEND_BATCH = 16;            // Roughly a packet's worth at a time, as NordicCentral appends
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::duration Duration)
+    {
+        return std::chrono::duration<double>(Duration).count();
+    }
+
+    // A device turning slowly with some sensor noise, so the columns compress like real data
+    IMUSample MakeSample(uint64_t Index, uint16_t Device, double RateHz, std::mt19937& Random)
+    {
+        std::normal_distribution<double> noise(0.0, 8.0);
+        double t = Index / RateHz;
+        double angle = 0.5 * std::sin(0.3 * t + Device);
+
+        IMUSample sample = {};
+        sample.GyroTime = static_cast<uint32_t>(static_cast<uint64_t>(t * TICKS_PER_SECOND));
+        sample.AccelMagTime = sample.GyroTime + 3;
+        sample.Data.Accel.X = static_cast<int16_t>(noise(Random));
+        sample.Data.Accel.Y = static_cast<int16_t>(16384 * std::sin(angle) + noise(Random));
+        sample.Data.Accel.Z = static_cast<int16_t>(16384 * std::cos(angle) + noise(Random));
+        sample.Data.Gyro.X = static_cast<int16_t>(1000 * std::cos(0.3 * t + Device) + noise(Random));
+        sample.Data.Gyro.Y = static_cast<int16_t>(noise(Random));
+        sample.Data.Gyro.Z = static_cast<int16_t>(noise(Random));
+        sample.Data.Mag.X = static_cast<int16_t>(300 + noise(Random));
+        sample.Data.Mag.Y = static_cast<int16_t>(-400 * std::sin(angle) + noise(Random));
+        sample.Data.Mag.Z = static_cast<int16_t>(-400 * std::cos(angle) + noise(Random));
+        return sample;
+    }
+
+    // Every chunk must decode to the next of its device's generated samples.  Returns the
+    // index of the first that doesn't, or the chunk count if they all do.
+    size_t CheckChunks(const SampleArchiveReader& Reader, const std::vector<std::vector<IMUSample>>& Generated)
+    {
+        std::vector<IMUSample> samples;
+        std::vector<uint64_t> positions(Generated.size(), 0);
+        for(size_t i = 0; i < Reader.Chunks().size(); ++i)
+        {
+            uint16_t device = Reader.Chunks()[i].Device;
+            if(device >= Generated.size() || !Reader.ReadChunk(i, samples) ||
+               samples.size() > Generated[device].size() - positions[device] ||
+               !std::equal(samples.begin(), samples.end(), Generated[device].begin() + positions[device],
+                           [](const IMUSample& a, const IMUSample& b) { return std::memcmp(&a, &b, sizeof(a)) == 0; }))
+            {
+                return i;
+            }
+            positions[device] += samples.size();
+        }
+        return Reader.Chunks().size();
+    }
+
+    // A copy of the first Size bytes of a file, as a crash part way through writing it leaves
+    bool CopyStart(const std::string& From, const std::string& To, uint64_t Size)
+    {
+        std::FILE* pFrom = std::fopen(From.c_str(), "rb");
+        std::FILE* pTo = std::fopen(To.c_str(), "wb");
+        bool bOK = pFrom != nullptr && pTo != nullptr;
+        std::vector<char> buffer(1 << 16);
+        while(bOK && Size > 0)
+        {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(buffer.size(), Size));
+            bOK = std::fread(buffer.data(), 1, length, pFrom) == length && std::fwrite(buffer.data(), 1, length, pTo) == length;
+            Size -= length;
+        }
+        if(pFrom != nullptr)
+        {
+            std::fclose(pFrom);
+        }
+        if(pTo != nullptr)
+        {
+            bOK = std::fclose(pTo) == 0 && bOK;
+        }
+        return bOK;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string fileName = argc > 1 ? argv[1] : "ArchiveBench.imu4u";
+    int devices = argc > 2 ? std::atoi(argv[2]) : 4;
+    double minutes = argc > 3 ? std::atof(argv[3]) : 10.0;
+    double rateHz = argc > 4 ? std::atof(argv[4]) : 1000.0;
+    int seeks = argc > 5 ? std::atoi(argv[5]) : 10000;
+
+    uint64_t samplesPerDevice = static_cast<uint64_t>(minutes * 60.0 * rateHz);
+    std::mt19937 random(1);
+
+    // Generate up front so only the archive is timed
+    std::vector<std::vector<IMUSample>> generated(devices);
+    for(int device = 0; device < devices; ++device)
+    {
+        generated[device].reserve(samplesPerDevice);
+        for(uint64_t i = 0; i < samplesPerDevice; ++i)
+        {
+            generated[device].push_back(MakeSample(i, static_cast<uint16_t>(device), rateHz, random));
+        }
+    }
+
+    SampleArchiveWriter writer;
+    if(!writer.Open(fileName))
+    {
+        std::fprintf(stderr, "Can't write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    Clock::time_point start = Clock::now();
+    for(uint64_t i = 0; i < samplesPerDevice; i += APPEND_BATCH)
+    {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(APPEND_BATCH, samplesPerDevice - i));
+        for(int device = 0; device < devices; ++device)
+        {
+            writer.Append(static_cast<uint16_t>(device), &generated[device][i], count);
+        }
+    }
+    bool bWritten = writer.Close();
+    double writeSeconds = Seconds(Clock::now() - start);
+
+    uint64_t totalSamples = samplesPerDevice * devices;
+    double rawBytes = static_cast<double>(totalSamples * sizeof(IMUSample));
+    std::printf("Wrote %llu samples (%d devices, %.1f minutes at %.0f Hz) in %.3f s%s\n",
+                static_cast<unsigned long long>(totalSamples), devices, minutes, rateHz, writeSeconds, bWritten ? "" : " WITH ERRORS");
+    std::printf("  %.1f M samples/s, %.1f MB/s of samples, %.1f MB on disk (%.1f%% of raw)\n",
+                totalSamples / writeSeconds / 1e6, rawBytes / writeSeconds / 1e6,
+                writer.BytesWritten() / 1e6, 100.0 * writer.BytesWritten() / rawBytes);
+
+    SampleArchiveReader reader;
+    if(!reader.Open(fileName))
+    {
+        std::fprintf(stderr, "Can't read %s\n", fileName.c_str());
+        return 1;
+    }
+
+    // Everything must come back exactly as it went in
+    start = Clock::now();
+    size_t badChunk = CheckChunks(reader, generated);
+    if(badChunk < reader.Chunks().size() || reader.Recovered())
+    {
+        std::fprintf(stderr, "Chunk %zu doesn't match what was written\n", badChunk);
+        return 1;
+    }
+    double readSeconds = Seconds(Clock::now() - start);
+    std::printf("Read and verified %zu chunks in %.3f s, %.1f M samples/s\n",
+                reader.Chunks().size(), readSeconds, totalSamples / readSeconds / 1e6);
+
+    // Cut a copy off two thirds of the way through, most likely part way into a chunk
+    std::string cutName = fileName + ".cut";
+    uint64_t cutSize = writer.BytesWritten() * 2 / 3;
+    size_t wholeChunks = 0;
+    for(const auto& chunk : reader.Chunks())
+    {
+        wholeChunks += chunk.Offset + chunk.Size <= cutSize;
+    }
+    SampleArchiveReader cutReader;
+    bool bRecovered = CopyStart(fileName, cutName, cutSize) && cutReader.Open(cutName) && cutReader.Recovered() &&
+                      cutReader.Chunks().size() == wholeChunks && CheckChunks(cutReader, generated) == wholeChunks;
+    cutReader.Close();
+    std::remove(cutName.c_str());
+    if(!bRecovered)
+    {
+        std::fprintf(stderr, "A copy cut off at %llu bytes didn't open with its %zu whole chunks\n",
+                     static_cast<unsigned long long>(cutSize), wholeChunks);
+        return 1;
+    }
+    std::printf("Recovered all %zu whole chunks of a copy cut off at %.1f MB, without its index\n", wholeChunks, cutSize / 1e6);
+
+    std::vector<IMUSample> samples;
+    // Seek to random moments: find the chunk, decode it, find the sample
+    uint64_t lastTime = static_cast<uint64_t>((samplesPerDevice - 1) / rateHz * TICKS_PER_SECOND);
+    std::uniform_int_distribution<int> pickDevice(0, devices - 1);
+    std::uniform_int_distribution<uint64_t> pickTime(0, lastTime);
+    std::vector<uint64_t> times;
+    std::vector<double> latencies;
+    latencies.reserve(seeks);
+    for(int i = 0; i < seeks; ++i)
+    {
+        uint16_t device = static_cast<uint16_t>(pickDevice(random));
+        uint64_t time = pickTime(random);
+
+        Clock::time_point seekStart = Clock::now();
+        long chunk = reader.FindChunk(device, time);
+        if(chunk < 0 || !reader.ReadChunk(static_cast<size_t>(chunk), samples, &times))
+        {
+            std::fprintf(stderr, "Seek to device %u time %llu failed\n", device, static_cast<unsigned long long>(time));
+            return 1;
+        }
+        auto found = std::lower_bound(times.begin(), times.end(), time);
+        latencies.push_back(Seconds(Clock::now() - seekStart) * 1e6);
+
+        if(found == times.end())
+        {
+            std::fprintf(stderr, "Seek to device %u time %llu landed in the wrong chunk\n", device, static_cast<unsigned long long>(time));
+            return 1;
+        }
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0.0;
+    for(double latency : latencies)
+    {
+        total += latency;
+    }
+    std::printf("%d random seeks over %zu chunks: mean %.1f us, median %.1f us, 99th percentile %.1f us\n",
+                seeks, reader.Chunks().size(), total / seeks, latencies[seeks / 2], latencies[seeks * 99 / 100]);
+    return 0;
+}
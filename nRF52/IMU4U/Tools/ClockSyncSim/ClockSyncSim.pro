@@ -0,0 +1,12 @@
+# Checks ClockEstimator (see QtApp/ClockEstimator.h) against a simulated drifting device
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/ClockEstimator.h
+SOURCES     = main.cpp \
+              $$APP_DIR/ClockEstimator.cpp
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include "ClockEstimator.h"
+
+// Runs ClockEstimator against a simulated IMU4U whose crystal is off by a fixed amount
+// plus a slow swing, as with temperature, and whose time stamps wrap during the run:
+//   ClockSyncSim [minutes] [skew ppm] [swing ppm] [connection interval ms] [max RMS error ms] [max skew error ppm]
+// Requests and replies only cross the link at connection events, with some scheduling
+// jitter on the host, the odd long delay from a retransmission and syncs sent on a timer
+// that isn't in step with the events.  The error is how far
+// the estimated host time of each sample is from when it was really taken.  Exits with
+// 1 if the RMS error is over its limit, or if the skew estimated at the end is further
+// from the device's than its limit.
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;
+    constexpr double TWO_PI = 6.28318530717958647692;
+    constexpr double SAMPLE_RATE_HZ = 100.0;
+    constexpr double SYNC_INTERVAL_S = 1.0;
+    constexpr double SYNC_TIMER_SLACK = 0.05;      // A coarse QTimer, as NordicCentral's is, fires within 5%
+    constexpr double SWING_PERIOD_S = 600.0;
+    constexpr double HOST_JITTER_MEAN_S = 0.001;
+    constexpr double RETRANSMIT_PROBABILITY = 0.05;
+    constexpr double WARM_UP_S = 10.0;
+    constexpr double SKEW_WARM_UP_S = 300.0;       // The skew is followed over minutes
+    constexpr uint32_t FIRST_TICKS = 0xFFF00000;   // Wraps about 30 s in
+
+    struct Device
+    {
+        double SkewPpm;
+        double SwingPpm;
+
+        // Device seconds elapsed at host time t: the integral of 1 + skew
+        double Seconds(double t) const
+        {
+            double swing = SwingPpm * SWING_PERIOD_S / TWO_PI * (1.0 - std::cos(TWO_PI * t / SWING_PERIOD_S));
+            return t + (SkewPpm * t + swing) * 1e-6;
+        }
+
+        // As ClockEstimator::SkewPpm() has it, at host time t
+        double HostSkewPpm(double t) const
+        {
+            double deviceSkew = SkewPpm + SwingPpm * std::sin(TWO_PI * t / SWING_PERIOD_S);
+            return -deviceSkew / (1.0 + deviceSkew * 1e-6);
+        }
+
+        uint32_t Ticks(double t) const
+        {
+            return FIRST_TICKS + static_cast<uint32_t>(static_cast<uint64_t>(Seconds(t) * TICKS_PER_SECOND));
+        }
+    };
+
+    uint64_t Ns(double Seconds)
+    {
+        return static_cast<uint64_t>(Seconds * 1e9);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double minutes = argc > 1 ? std::atof(argv[1]) : 60.0;
+    double skewPpm = argc > 2 ? std::atof(argv[2]) : 40.0;
+    double swingPpm = argc > 3 ? std::atof(argv[3]) : 10.0;
+    double intervalS = (argc > 4 ? std::atof(argv[4]) : 15.0) / 1000.0;
+    double maxRmsMs = argc > 5 ? std::atof(argv[5]) : 2.0;
+    double maxSkewErrorPpm = argc > 6 ? std::atof(argv[6]) : 4.0;
+
+    Device device{skewPpm, swingPpm};
+    ClockEstimator estimator;
+    std::mt19937 random(1);
+    std::exponential_distribution<double> jitter(1.0 / HOST_JITTER_MEAN_S);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // The next connection event at or after t
+    auto NextEvent = [intervalS](double t) { return std::ceil(t / intervalS) * intervalS; };
+    auto LinkDelay = [&]() { return uniform(random) < RETRANSMIT_PROBABILITY ? intervalS * (1 + static_cast<int>(uniform(random) * 4)) : 0.0; };
+
+    double duration = minutes * 60.0;
+    double nextSync = 0.5;
+    double nextSample = 0.0;
+    double sumSquared = 0.0;
+    double maxError = 0.0;
+    uint64_t errors = 0;
+    uint64_t skipped = 0;
+    double skewSumSquared = 0.0;
+    double maxSkewError = 0.0;
+    uint64_t skewErrors = 0;
+
+    // Step through connection events, delivering whatever was waiting for each
+    for(double event = intervalS; event < duration; event += intervalS)
+    {
+        if(nextSync < event)
+        {
+            double sent = nextSync;
+            double stamped = NextEvent(sent + jitter(random)) + LinkDelay();
+            double received = NextEvent(stamped + 1e-6) + intervalS + LinkDelay() + jitter(random);
+            if(!estimator.AddRoundTrip(Ns(sent), Ns(received), device.Ticks(stamped)))
+            {
+                ++skipped;
+            }
+            nextSync += SYNC_INTERVAL_S * (1.0 + SYNC_TIMER_SLACK * (2.0 * uniform(random) - 1.0));
+        }
+
+        if(estimator.Valid() && event > SKEW_WARM_UP_S)
+        {
+            double error = estimator.SkewPpm() - device.HostSkewPpm(event);
+            skewSumSquared += error * error;
+            maxSkewError = std::max(maxSkewError, std::fabs(error));
+            ++skewErrors;
+        }
+
+        double arrival = event + jitter(random);
+        uint32_t newest = 0;
+        bool bAnySamples = false;
+        for(; nextSample < event; nextSample += 1.0 / SAMPLE_RATE_HZ)
+        {
+            uint32_t ticks = device.Ticks(nextSample);
+            if(estimator.Valid() && nextSample > WARM_UP_S)
+            {
+                double error = (static_cast<double>(estimator.ToHostNs(ticks)) - nextSample * 1e9) / 1e6;
+                sumSquared += error * error;
+                maxError = std::max(maxError, std::fabs(error));
+                ++errors;
+            }
+            newest = ticks;
+            bAnySamples = true;
+        }
+        if(bAnySamples)
+        {
+            estimator.AddArrival(newest, Ns(arrival));
+        }
+    }
+
+    double rms = errors > 0 ? std::sqrt(sumSquared / errors) : 0.0;
+    double skewRms = skewErrors > 0 ? std::sqrt(skewSumSquared / skewErrors) : 0.0;
+    double finalSkewError = estimator.SkewPpm() - device.HostSkewPpm(duration);
+    std::printf("%.0f minutes, device %.1f ppm fast swinging by %.1f ppm, %.1f ms connection interval\n",
+                minutes, skewPpm, swingPpm, intervalS * 1000.0);
+    std::printf("%llu round trips used, %llu skipped, %llu arrival corrections\n",
+                static_cast<unsigned long long>(estimator.RoundTrips()), static_cast<unsigned long long>(skipped),
+                static_cast<unsigned long long>(estimator.ArrivalCorrections()));
+    std::printf("Skew at the end: estimated %.2f ppm, really %.2f ppm\n", estimator.SkewPpm(), device.HostSkewPpm(duration));
+    std::printf("Skew error after %.0f s: RMS %.2f ppm, max %.2f ppm\n", SKEW_WARM_UP_S, skewRms, maxSkewError);
+    std::printf("Residual %.3f ms\n", estimator.ResidualNs() / 1e6);
+    std::printf("Sample time error: RMS %.3f ms, max %.3f ms over %llu samples\n", rms, maxError, static_cast<unsigned long long>(errors));
+    return rms <= maxRmsMs && std::fabs(finalSkewError) <= maxSkewErrorPpm ? 0 : 1;
+}
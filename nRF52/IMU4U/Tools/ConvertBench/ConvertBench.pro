@@ -0,0 +1,15 @@
+# Agreement and throughput of UnitConverter's kernels (see QtApp/UnitConverter.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SimdSupport.h \
+              $$APP_DIR/UnitConverter.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SimdSupport.cpp \
+              $$APP_DIR/UnitConverter.cpp
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "UnitConverter.h"
+
+// Checks every UnitConverter kernel the CPU can run against the scalar one, then times
+// them converting all nine axes of a block of IMUSamples:
+//   ConvertBench [samples per block] [seconds per kernel]
+// The calibration has offsets and full matrices so none of the arithmetic is skipped.
+// Exits with 1 if any kernel disagrees with the scalar one by more than rounding, taken
+// relative to each axis's range.
+
+namespace
+{
+    constexpr float MAX_RELATIVE_ERROR = 1e-6f;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Converted
+    {
+        explicit Converted(size_t Count) : Values(9, std::vector<float>(Count))
+        {
+        }
+
+        std::vector<std::vector<float>> Values;   // Accel, mag and gyro, X, Y and Z of each
+    };
+
+    void ConvertAll(const UnitConverter& Converter, const std::vector<IMUSample>& Samples, const DeviceCalibration& Calibration, Converted& Out)
+    {
+        const IMUSample* p = Samples.data();
+        size_t count = Samples.size();
+        Converter.Convert(&p->Data.Accel, sizeof(IMUSample), count, Calibration.Accel, Out.Values[0].data(), Out.Values[1].data(), Out.Values[2].data());
+        Converter.Convert(&p->Data.Mag, sizeof(IMUSample), count, Calibration.Mag, Out.Values[3].data(), Out.Values[4].data(), Out.Values[5].data());
+        Converter.Convert(&p->Data.Gyro, sizeof(IMUSample), count, Calibration.Gyro, Out.Values[6].data(), Out.Values[7].data(), Out.Values[8].data());
+    }
+
+    SensorCalibration Skewed(const SensorCalibration& Base, std::mt19937& Random)
+    {
+        std::uniform_real_distribution<float> small(-0.05f, 0.05f);
+        std::uniform_real_distribution<float> offset(-200.0f, 200.0f);
+        SensorCalibration calibration = Base;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            calibration.Offset[axis] = offset(Random);
+        }
+        for(float& m : calibration.Matrix)
+        {
+            m += small(Random);
+        }
+        return calibration;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t blockSize = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> raw(INT16_MIN, INT16_MAX);
+    std::vector<IMUSample> samples(blockSize);
+    for(IMUSample& sample : samples)
+    {
+        ThreeDimData* sensors[] = { &sample.Data.Accel, &sample.Data.Mag, &sample.Data.Gyro };
+        for(ThreeDimData* pSensor : sensors)
+        {
+            pSensor->X = static_cast<int16_t>(raw(random));
+            pSensor->Y = static_cast<int16_t>(raw(random));
+            pSensor->Z = static_cast<int16_t>(raw(random));
+        }
+    }
+
+    DeviceCalibration calibration = DefaultCalibration();
+    calibration.Accel = Skewed(calibration.Accel, random);
+    calibration.Mag = Skewed(calibration.Mag, random);
+    calibration.Gyro = Skewed(calibration.Gyro, random);
+
+    Converted reference(blockSize);
+    ConvertAll(UnitConverter(UnitConverter::KERNEL::SCALAR), samples, calibration, reference);
+
+    std::printf("%zu samples per block, best kernel here %s\n", blockSize, UnitConverter::Name(UnitConverter().Kernel()));
+    bool bPassed = true;
+    double scalarRate = 0.0;
+    for(auto kernel : { UnitConverter::KERNEL::SCALAR, UnitConverter::KERNEL::SSE2, UnitConverter::KERNEL::AVX2 })
+    {
+        if(!UnitConverter::Supported(kernel))
+        {
+            std::printf("  %-7s not supported\n", UnitConverter::Name(kernel));
+            continue;
+        }
+
+        UnitConverter converter(kernel);
+        Converted out(blockSize);
+        ConvertAll(converter, samples, calibration, out);
+        float maxError = 0.0f;
+        for(size_t channel = 0; channel < out.Values.size(); ++channel)
+        {
+            // Relative to the channel's range, as values near zero come from cancellation
+            float range = 0.0f;
+            for(float value : reference.Values[channel])
+            {
+                range = std::max(range, std::fabs(value));
+            }
+            for(size_t i = 0; i < blockSize; ++i)
+            {
+                maxError = std::max(maxError, std::fabs(out.Values[channel][i] - reference.Values[channel][i]) / range);
+            }
+        }
+        bPassed = bPassed && maxError <= MAX_RELATIVE_ERROR;
+
+        uint64_t blocks = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        while(elapsed < seconds)
+        {
+            ConvertAll(converter, samples, calibration, out);
+            ++blocks;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        double rate = blocks * blockSize / elapsed;
+        if(kernel == UnitConverter::KERNEL::SCALAR)
+        {
+            scalarRate = rate;
+        }
+        std::printf("  %-7s %7.1f M samples/s (%.1fx scalar), max relative difference from scalar %.1e\n",
+                    UnitConverter::Name(kernel), rate / 1e6, rate / scalarRate, maxError);
+    }
+    return bPassed ? 0 : 1;
+}
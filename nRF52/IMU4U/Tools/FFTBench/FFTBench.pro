@@ -0,0 +1,22 @@
+# Accuracy and throughput of RealFFT's kernels, and a check of SpectrumAnalyzer's peaks (see QtApp/SpectrumAnalyzer.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/FFTKernel.inl \
+              $$APP_DIR/IMUData.h \
+              $$APP_DIR/RealFFT.h \
+              $$APP_DIR/SPSCRing.h \
+              $$APP_DIR/SensorResampler.h \
+              $$APP_DIR/SimdSupport.h \
+              $$APP_DIR/SpectrumAnalyzer.h
+SOURCES     = main.cpp \
+              $$APP_DIR/RealFFT.cpp \
+              $$APP_DIR/SimdSupport.cpp \
+              $$APP_DIR/SpectrumAnalyzer.cpp
+
+unix:LIBS  += -lpthread
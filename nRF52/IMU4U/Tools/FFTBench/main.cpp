@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "RealFFT.h"
+#include "SpectrumAnalyzer.h"
+
+// Checks RealFFT's kernels against a plain DFT at every size up to BENCH_SIZE, times each
+// on BENCH_SIZE points of all nine axes, then checks SpectrumAnalyzer finds the peaks of
+// some synthetic vibration:
+//   FFTBench [seconds per run]
+// Exits with 1 if any kernel is further from the DFT than rounding, or a peak is missed.
+
+namespace
+{
+    constexpr size_t BENCH_SIZE = 4096;
+    constexpr size_t AXES = 9;
+    constexpr double MAX_ERROR = 1e-5;           // Of any bin, relative to the largest
+    constexpr double TWO_PI = 6.28318530717958647692;
+
+    // Synthetic vibration for the analyzer check
+    constexpr double SYNTHETIC_RATE_HZ = 1000.0;
+    constexpr double TONE_HZ[2] = { 123.4, 310.0 };
+    constexpr float  TONE_AMPLITUDE[2] = { 4000.0f, 1000.0f };
+    constexpr float  MAX_PEAK_ERROR_BINS = 0.1f;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Largest difference of any bin from the DFT's, relative to the DFT's largest bin
+    double Error(RealFFT& FFT, const std::vector<float>& Input)
+    {
+        size_t size = FFT.Size();
+        size_t bins = FFT.Bins();
+        std::vector<float> real(bins), imag(bins);
+        FFT.Forward(Input.data(), real.data(), imag.data());
+
+        double largest = 0.0;
+        double worst = 0.0;
+        for(size_t k = 0; k < bins; ++k)
+        {
+            double dftReal = 0.0;
+            double dftImag = 0.0;
+            for(size_t n = 0; n < size; ++n)
+            {
+                double angle = -TWO_PI * static_cast<double>((k * n) % size) / size;
+                dftReal += Input[n] * std::cos(angle);
+                dftImag += Input[n] * std::sin(angle);
+            }
+            largest = std::max(largest, std::hypot(dftReal, dftImag));
+            worst = std::max(worst, std::hypot(real[k] - dftReal, imag[k] - dftImag));
+        }
+        return worst / largest;
+    }
+
+    // Spectra per second of every axis, running until Seconds have passed
+    double Rate(RealFFT& FFT, const std::vector<float>& Input, double Seconds)
+    {
+        std::vector<float> real(FFT.Bins()), imag(FFT.Bins());
+        uint64_t runs = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        while(elapsed < Seconds)
+        {
+            for(size_t axis = 0; axis < AXES; ++axis)
+            {
+                FFT.Forward(&Input[axis * FFT.Size()], real.data(), imag.data());
+            }
+            ++runs;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        return runs / elapsed;
+    }
+
+    // Two tones on accel X, the louder one on gyro Z, noise everywhere
+    bool CheckAnalyzer()
+    {
+        SpectrumAnalyzer::Settings settings;
+        settings.Size = 1024;
+        settings.Hop = 256;
+        settings.RateHz = SYNTHETIC_RATE_HZ;
+        SpectrumAnalyzer analyzer(settings);
+
+        std::mt19937 random(1);
+        std::normal_distribution<float> noise(0.0f, 5.0f);
+        std::vector<ResampledFrame> frames(4 * settings.Size);
+        for(size_t i = 0; i < frames.size(); ++i)
+        {
+            double t = i / SYNTHETIC_RATE_HZ;
+            float tones[2] = { TONE_AMPLITUDE[0] * static_cast<float>(std::sin(TWO_PI * TONE_HZ[0] * t)),
+                               TONE_AMPLITUDE[1] * static_cast<float>(std::sin(TWO_PI * TONE_HZ[1] * t)) };
+            ResampledFrame& frame = frames[i];
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                frame.Accel[axis] = noise(random);
+                frame.Gyro[axis] = noise(random);
+                frame.Mag[axis] = 300.0f + noise(random);
+            }
+            frame.Accel[0] += tones[0] + tones[1];
+            frame.Gyro[2] += tones[0];
+        }
+        analyzer.Add(frames.data(), frames.size());
+
+        SpectrumAnalyzer::Spectrum spectrum;
+        uint64_t expected = (frames.size() - settings.Size) / settings.Hop + 1;
+        Clock::time_point start = Clock::now();
+        while(analyzer.SpectraDone() < expected && Clock::now() - start < std::chrono::seconds(5))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if(!analyzer.Latest(spectrum))
+        {
+            std::printf("No spectrum from SpectrumAnalyzer\n");
+            return false;
+        }
+
+        struct Expected
+        {
+            size_t Channel;
+            size_t Peaks;
+        };
+        bool bOK = true;
+        for(const Expected& e : { Expected{ 0, 2 }, Expected{ 5, 1 } })
+        {
+            for(size_t peak = 0; peak < e.Peaks; ++peak)
+            {
+                const SpectrumAnalyzer::Peak& found = spectrum.Peaks[e.Channel][peak];
+                float errorBins = static_cast<float>(std::fabs(found.FrequencyHz - TONE_HZ[peak]) / spectrum.BinHz);
+                bool bFound = peak < spectrum.PeakCounts[e.Channel] && errorBins <= MAX_PEAK_ERROR_BINS;
+                std::printf("  Channel %zu expected %.1fHz, found %.2fHz at %.1fdB%s\n", e.Channel, TONE_HZ[peak],
+                            found.FrequencyHz, found.LevelDb, bFound ? "" : " MISSED");
+                bOK = bOK && bFound;
+            }
+        }
+        return bOK;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    std::vector<float> input(AXES * BENCH_SIZE);
+    for(float& v : input)
+    {
+        v = value(random);
+    }
+
+    std::printf("Best kernel here %s\n", SimdName(BestSimdLevel()));
+    std::printf("  Largest error relative to a DFT, size 8 to %zu:\n", BENCH_SIZE);
+    double worst = 0.0;
+    for(auto level : { SIMD_LEVEL::SCALAR, SIMD_LEVEL::SSE2, SIMD_LEVEL::AVX2 })
+    {
+        if(!SimdSupported(level))
+        {
+            continue;
+        }
+        double levelWorst = 0.0;
+        for(size_t size = 8; size <= BENCH_SIZE; size *= 2)
+        {
+            RealFFT fft(size, level);
+            levelWorst = std::max(levelWorst, Error(fft, std::vector<float>(input.begin(), input.begin() + size)));
+        }
+        std::printf("  %8s %.1e\n", SimdName(level), levelWorst);
+        worst = std::max(worst, levelWorst);
+    }
+
+    std::printf("  %zu points on %zu axes:\n", BENCH_SIZE, AXES);
+    std::printf("    kernel  spectra/s  Mpoints/s\n");
+    for(auto level : { SIMD_LEVEL::SCALAR, SIMD_LEVEL::SSE2, SIMD_LEVEL::AVX2 })
+    {
+        if(!SimdSupported(level))
+        {
+            std::printf("  %8s          -          -\n", SimdName(level));
+            continue;
+        }
+        RealFFT fft(BENCH_SIZE, level);
+        double rate = Rate(fft, input, seconds);
+        std::printf("  %8s %10.0f %10.1f\n", SimdName(level), rate, rate * AXES * BENCH_SIZE / 1e6);
+    }
+
+    std::printf("SpectrumAnalyzer peaks:\n");
+    bool bPeaksOK = CheckAnalyzer();
+
+    std::printf("Max error %.1e\n", worst);
+    return worst <= MAX_ERROR && bPeaksOK ? 0 : 1;
+}
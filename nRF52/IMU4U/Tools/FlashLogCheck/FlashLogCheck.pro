@@ -0,0 +1,12 @@
+# Checks the firmware's flash log against a RAM stand-in for flash (see Firmware/FlashLog.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+FIRMWARE_DIR = ../../Firmware
+INCLUDEPATH += $$FIRMWARE_DIR
+
+HEADERS     = $$FIRMWARE_DIR/FlashLog.h
+SOURCES     = main.cpp \
+              $$FIRMWARE_DIR/FlashLog.c
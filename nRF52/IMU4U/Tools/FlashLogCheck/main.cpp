@@ -0,0 +1,285 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "FlashLog.h"
+}
+
+// Runs the firmware's FlashLog (see Firmware/FlashLog.h) against a block of RAM that
+// behaves like the nRF52's flash: writes can only clear bits and must be word aligned,
+// and erasing sets a page back to 0xFF.  Checks, remounting as a reboot would between
+// steps:
+//   - Mounting an erased region, appending records and reading the stream back in
+//     pieces of any size, from any offset, as a resumed download does
+//   - A write torn part way through by losing power: the records before it survive and
+//     the log carries on from a fresh page
+//   - Filling the region until it's full
+//   - A log that starts where the erased one ended and wraps round to the region's
+//     first page
+//   FlashLogCheck [seed]
+// Exits with 1 if any check fails.
+
+namespace
+{
+    constexpr uint32_t START_ADDRESS = 0x40000;   // Not zero, so address arithmetic shows
+    constexpr uint32_t PAGE_SIZE = 4096;          // As on the nRF52
+    constexpr uint16_t PAGE_COUNT = 16;
+    constexpr uint32_t LOG_PAGE_MAGIC = 0x4C553449;   // As FlashLog.c writes
+
+    std::vector<uint8_t> gFlash(PAGE_SIZE * PAGE_COUNT, 0xFF);
+    long gTearAfter = -1;       // Bytes the next write gets through before the power goes, if not negative
+    bool gPowerLost = false;    // Until the next mount
+    bool gMisused = false;      // An operation FlashLog promises not to do
+
+    bool InRegion(uint32_t Address, uint32_t Length)
+    {
+        return Address >= START_ADDRESS && Address - START_ADDRESS <= gFlash.size() && Length <= gFlash.size() - (Address - START_ADDRESS);
+    }
+
+    bool Read(uint32_t Address, void* pData, uint32_t Length)
+    {
+        if(!InRegion(Address, Length))
+        {
+            gMisused = true;
+            return false;
+        }
+        std::memcpy(pData, &gFlash[Address - START_ADDRESS], Length);
+        return true;
+    }
+
+    bool Write(uint32_t Address, const void* pData, uint32_t Length)
+    {
+        if(!InRegion(Address, Length) || Address % 4 != 0 || Length % 4 != 0)
+        {
+            gMisused = true;
+            return false;
+        }
+        if(gPowerLost)
+        {
+            return false;
+        }
+
+        uint32_t length = Length;
+        if(gTearAfter >= 0 && static_cast<uint32_t>(gTearAfter) < Length)
+        {
+            length = static_cast<uint32_t>(gTearAfter);
+            gPowerLost = true;
+        }
+        gTearAfter = -1;
+
+        const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+        for(uint32_t i = 0; i < length; ++i)
+        {
+            gFlash[Address - START_ADDRESS + i] &= pBytes[i];
+        }
+        return !gPowerLost;
+    }
+
+    bool ErasePage(uint32_t Address)
+    {
+        if(!InRegion(Address, PAGE_SIZE) || (Address - START_ADDRESS) % PAGE_SIZE != 0)
+        {
+            gMisused = true;
+            return false;
+        }
+        if(gPowerLost)
+        {
+            return false;
+        }
+        std::memset(&gFlash[Address - START_ADDRESS], 0xFF, PAGE_SIZE);
+        return true;
+    }
+
+    const FlashLogOps OPS = { Read, Write, ErasePage };
+    const FlashLogConfig CONFIG = { &OPS, START_ADDRESS, PAGE_SIZE, PAGE_COUNT };
+
+    int gFailures = 0;
+
+    void Check(bool bOk, const char* pWhat)
+    {
+        std::printf("%-60s %s\n", pWhat, bOk ? "ok" : "FAILED");
+        if(!bOk)
+        {
+            ++gFailures;
+        }
+    }
+
+    // Pages holding the log, going by their headers' magic value
+    uint16_t LogPages()
+    {
+        uint16_t count = 0;
+        for(uint32_t page = 0; page < PAGE_COUNT; ++page)
+        {
+            const uint8_t* pHeader = &gFlash[page * PAGE_SIZE];
+            count += (pHeader[0] | pHeader[1] << 8 | pHeader[2] << 16 | static_cast<uint32_t>(pHeader[3]) << 24) == LOG_PAGE_MAGIC;
+        }
+        return count;
+    }
+
+    // As after a reset
+    bool Remount()
+    {
+        gPowerLost = false;
+        gTearAfter = -1;
+        return FlashLogMount(&CONFIG) == FLASH_LOG_OK;
+    }
+
+    std::vector<uint8_t> MakeRecord(std::mt19937& Random)
+    {
+        // Mostly small, sometimes the largest allowed
+        std::uniform_int_distribution<int> length(1, 160);
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::vector<uint8_t> record(Random() % 8 == 0 ? FLASH_LOG_MAX_RECORD_SIZE : length(Random));
+        for(auto& b : record)
+        {
+            b = static_cast<uint8_t>(byte(Random));
+        }
+        return record;
+    }
+
+    // The whole stream, read in pieces of Piece bytes
+    std::vector<uint8_t> ReadStream(uint32_t Piece)
+    {
+        std::vector<uint8_t> stream;
+        std::vector<uint8_t> buffer(Piece);
+        uint32_t copied;
+        while((copied = FlashLogReadStream(static_cast<uint32_t>(stream.size()), buffer.data(), Piece)) > 0)
+        {
+            stream.insert(stream.end(), buffer.begin(), buffer.begin() + copied);
+        }
+        return stream;
+    }
+
+    // Every record in the stream must be valid and they must be the ones expected, in order
+    bool StreamHolds(const std::vector<std::vector<uint8_t>>& Expected, uint32_t Piece = 4096)
+    {
+        std::vector<uint8_t> stream = ReadStream(Piece);
+        if(stream.size() != FlashLogStreamSize())
+        {
+            return false;
+        }
+
+        size_t offset = 0;
+        size_t index = 0;
+        while(offset < stream.size())
+        {
+            const uint8_t* pPayload = nullptr;
+            uint16_t length = 0;
+            bool bValid = false;
+            uint32_t size = FlashLogParseRecord(&stream[offset], static_cast<uint32_t>(stream.size() - offset), &pPayload, &length, &bValid);
+            if(size == 0 || !bValid || index >= Expected.size() || length != Expected[index].size() ||
+               std::memcmp(pPayload, Expected[index].data(), length) != 0)
+            {
+                return false;
+            }
+            offset += size;
+            ++index;
+        }
+        return index == Expected.size();
+    }
+
+    // Appends records until the log holds about Bytes more stream
+    bool AppendAbout(uint32_t Bytes, std::vector<std::vector<uint8_t>>& Records, std::mt19937& Random)
+    {
+        uint32_t target = FlashLogStreamSize() + Bytes;
+        while(FlashLogStreamSize() < target)
+        {
+            std::vector<uint8_t> record = MakeRecord(Random);
+            if(FlashLogAppend(record.data(), static_cast<uint16_t>(record.size())) != FLASH_LOG_OK)
+            {
+                return false;
+            }
+            Records.push_back(record);
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::mt19937 random(argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 1u);
+    std::vector<std::vector<uint8_t>> records;
+    const uint32_t pageData = PAGE_SIZE - FLASH_LOG_PAGE_HEADER_SIZE;
+
+    // Mount and append
+    Check(FlashLogMount(&CONFIG) == FLASH_LOG_OK, "Mount an erased region");
+    Check(FlashLogStreamSize() == 0 && FlashLogCapacity() == PAGE_COUNT * pageData, "Empty, with every page's data for capacity");
+    uint8_t byte = 0;
+    Check(FlashLogAppend(&byte, 0) == FLASH_LOG_INVALID_PARAM &&
+          FlashLogAppend(&byte, FLASH_LOG_MAX_RECORD_SIZE + 1) == FLASH_LOG_INVALID_PARAM, "Refuse records of no or too many bytes");
+    Check(AppendAbout(3 * pageData + 100, records, random), "Append records over four pages");
+    Check(StreamHolds(records), "Read them back");
+    Check(StreamHolds(records, 37) && StreamHolds(records, 1), "Read them back in odd sized pieces");
+
+    std::vector<uint8_t> stream = ReadStream(4096);
+    bool bResumes = true;
+    for(int i = 0; i < 200 && bResumes; ++i)
+    {
+        uint32_t offset = random() % static_cast<uint32_t>(stream.size());
+        uint32_t length = 1 + random() % 1500;
+        std::vector<uint8_t> piece(length);
+        uint32_t copied = FlashLogReadStream(offset, piece.data(), length);
+        uint32_t expected = std::min<uint32_t>(length, static_cast<uint32_t>(stream.size()) - offset);
+        bResumes = copied == expected && std::memcmp(piece.data(), &stream[offset], copied) == 0;
+    }
+    Check(bResumes, "Read from any offset, as a resumed download");
+    Check(FlashLogReadStream(static_cast<uint32_t>(stream.size()), &byte, 1) == 0, "Read nothing at the end of the stream");
+
+    Check(Remount() && StreamHolds(records), "Remount with the same records");
+
+    // Torn write, into the last page
+    uint32_t sizeBefore = FlashLogStreamSize();
+    uint16_t pagesBefore = LogPages();
+    std::vector<uint8_t> torn(100, 0x5A);
+    gTearAfter = 8;
+    Check(FlashLogAppend(torn.data(), static_cast<uint16_t>(torn.size())) == FLASH_LOG_IO_ERROR, "Lose power 8 bytes into a record");
+    Check(Remount() && FlashLogStreamSize() == sizeBefore && StreamHolds(records), "Remount with the records before it, not the torn one");
+    Check(AppendAbout(1, records, random) && LogPages() == pagesBefore + 1, "Append after it, on a fresh page");
+    Check(StreamHolds(records), "Read them all back");
+    Check(Remount() && StreamHolds(records), "Remount with them all");
+
+    // A tear inside a record's header, right at the start of a page's data
+    sizeBefore = FlashLogStreamSize();
+    gTearAfter = 0;
+    Check(FlashLogAppend(torn.data(), static_cast<uint16_t>(torn.size())) == FLASH_LOG_IO_ERROR, "Lose power before a record's first word");
+    Check(Remount() && FlashLogStreamSize() == sizeBefore && StreamHolds(records), "Remount unchanged");
+
+    // Full
+    enum FLASH_LOG_STATUS status = FLASH_LOG_OK;
+    while(status == FLASH_LOG_OK)
+    {
+        std::vector<uint8_t> record = MakeRecord(random);
+        status = FlashLogAppend(record.data(), static_cast<uint16_t>(record.size()));
+        if(status == FLASH_LOG_OK)
+        {
+            records.push_back(record);
+        }
+    }
+    Check(status == FLASH_LOG_FULL, "Fill the region");
+    Check(FlashLogStreamSize() <= FlashLogCapacity() && FlashLogStreamSize() > FlashLogCapacity() - 3 * pageData, "Use nearly all of it");
+    Check(Remount() && StreamHolds(records), "Remount full, with every record");
+    std::vector<uint8_t> largest(FLASH_LOG_MAX_RECORD_SIZE, 0xA5);
+    Check(FlashLogAppend(largest.data(), FLASH_LOG_MAX_RECORD_SIZE) == FLASH_LOG_FULL, "Still no room for the largest record after remounting");
+
+    // Wrap: a log ending at page 9, erased, and the next one starting at page 10
+    std::fill(gFlash.begin(), gFlash.end(), 0xFF);
+    records.clear();
+    Check(Remount() && AppendAbout(9 * pageData + 1, records, random), "Start again on ten pages");
+    Check(FlashLogErase() == FLASH_LOG_OK && FlashLogStreamSize() == 0 && StreamHolds({}), "Erase it");
+    records.clear();
+    Check(AppendAbout(9 * pageData + 1, records, random), "Append another ten pages' worth");
+    Check(LogPages() == 10 && gFlash[9 * PAGE_SIZE] == 0xFF && gFlash[10 * PAGE_SIZE] != 0xFF && gFlash[0] != 0xFF,
+          "Start at page 10 and wrap round to page 0");
+    Check(StreamHolds(records), "Read them back in order");
+    Check(Remount() && StreamHolds(records), "Remount in order, by sequence rather than page");
+    Check(AppendAbout(pageData, records, random) && Remount() && StreamHolds(records), "Append more after remounting, and remount again");
+
+    Check(!gMisused, "Only aligned writes and erases within the region");
+    std::printf("%s\n", gFailures == 0 ? "OK" : "FAILED");
+    return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,28 @@
+# Agreement and throughput of FusionEngine's kernels for 1 to 64 devices (see QtApp/FusionEngine.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/CaptureFile.h \
+              $$APP_DIR/FusionEngine.h \
+              $$APP_DIR/FusionKernel.inl \
+              $$APP_DIR/IMU4UService.h \
+              $$APP_DIR/IMUData.h \
+              $$APP_DIR/MadgwickFilter.h \
+              $$APP_DIR/Quaternion.h \
+              $$APP_DIR/SampleCodec.h \
+              $$APP_DIR/SimdSupport.h \
+              $$APP_DIR/StreamDecoder.h \
+              $$APP_DIR/UnitConverter.h
+SOURCES     = main.cpp \
+              $$APP_DIR/CaptureFile.cpp \
+              $$APP_DIR/FusionEngine.cpp \
+              $$APP_DIR/MadgwickFilter.cpp \
+              $$APP_DIR/SampleCodec.cpp \
+              $$APP_DIR/SimdSupport.cpp \
+              $$APP_DIR/StreamDecoder.cpp \
+              $$APP_DIR/UnitConverter.cpp
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+#include "CaptureFile.h"
+#include "FusionEngine.h"
+#include "IMU4UService.h"
+#include "MadgwickFilter.h"
+#include "StreamDecoder.h"
+#include "UnitConverter.h"
+
+// Runs FusionEngine with each kernel the CPU has against one MadgwickFilter per device,
+// for 1 to 64 devices, checking they end up with the same orientations and timing them:
+//   FusionBench [seconds per run] [capture file]
+// Without a capture the readings are synthetic, with some accel readings zeroed so the
+// lanes take both sides of the filter's branches.  With one, each device's recorded
+// readings are replayed, the capture's devices shared out among the lanes in turn.
+// Exits with 1 if any kernel's orientations differ from the filters' by more than rounding.
+
+namespace
+{
+    constexpr size_t MAX_DEVICES = 64;
+    constexpr size_t STEPS = 2048;              // Readings per device, replayed for as long as a run lasts
+    constexpr float MAX_DIFFERENCE = 1e-4f;     // In any quaternion component, after STEPS steps
+    constexpr float SYNTHETIC_DT = 0.01f;
+    constexpr float TICKS_PER_SECOND = 32768.0f;
+    constexpr float RADIANS_PER_DEGREE = 3.14159265f / 180.0f;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Reading
+    {
+        float Gyro[3];
+        float Accel[3];
+        float Dt;
+    };
+
+    // Readings[step * MAX_DEVICES + device]
+    using Readings = std::vector<Reading>;
+
+    Readings Synthetic()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> rate(-2.0f, 2.0f);
+        std::normal_distribution<float> noise(0.0f, 0.02f);
+        Readings readings(STEPS * MAX_DEVICES);
+        for(size_t device = 0; device < MAX_DEVICES; ++device)
+        {
+            float spin[3] = { rate(random), rate(random), rate(random) };
+            for(size_t step = 0; step < STEPS; ++step)
+            {
+                Reading& reading = readings[step * MAX_DEVICES + device];
+                float phase = static_cast<float>(step) * SYNTHETIC_DT;
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    reading.Gyro[axis] = spin[axis] * std::sin(phase * (axis + 1)) + noise(random);
+                }
+                bool bFreeFall = device % 5 == 0 && step % 97 == 0;
+                reading.Accel[0] = bFreeFall ? 0.0f : 0.1f * std::sin(phase) + noise(random);
+                reading.Accel[1] = bFreeFall ? 0.0f : 0.1f * std::cos(phase) + noise(random);
+                reading.Accel[2] = bFreeFall ? 0.0f : 1.0f + noise(random);
+                reading.Dt = SYNTHETIC_DT;
+            }
+        }
+        return readings;
+    }
+
+    bool Replayed(const char* pFileName, Readings& Out)
+    {
+        CaptureReader reader;
+        if(!reader.Open(pFileName))
+        {
+            std::fprintf(stderr, "Can't open %s\n", pFileName);
+            return false;
+        }
+
+        std::map<uint16_t, StreamDecoder> decoders;
+        std::map<uint16_t, std::vector<IMUSample>> devices;
+        IMUSample samples[StreamDecoder::MAX_PACKET_SAMPLES];
+        CaptureRecord record;
+        while(reader.Read(record))
+        {
+            if(record.Characteristic == NORDIC_BLINKY_IMU_CHAR_UUID &&
+               !record.Payload.empty() && record.Payload[0] != static_cast<uint8_t>(PACKET_TYPE::SYNC))
+            {
+                size_t count = decoders[record.Device].Decode(record.Payload.data(), record.Payload.size(), samples);
+                devices[record.Device].insert(devices[record.Device].end(), samples, samples + count);
+            }
+        }
+        if(devices.empty())
+        {
+            std::fprintf(stderr, "No samples in %s\n", pFileName);
+            return false;
+        }
+
+        // Each capture device's readings in units, gyro rates still in degrees per second
+        UnitConverter converter;
+        DeviceCalibration calibration = DefaultCalibration();
+        std::vector<std::vector<Reading>> converted;
+        for(const auto& device : devices)
+        {
+            const std::vector<IMUSample>& source = device.second;
+            size_t count = source.size();
+            std::vector<float> values[6];
+            for(std::vector<float>& v : values)
+            {
+                v.resize(count);
+            }
+            converter.Convert(&source[0].Data.Gyro, sizeof(IMUSample), count, calibration.Gyro, values[0].data(), values[1].data(), values[2].data());
+            converter.Convert(&source[0].Data.Accel, sizeof(IMUSample), count, calibration.Accel, values[3].data(), values[4].data(), values[5].data());
+
+            std::vector<Reading> readings(count);
+            for(size_t i = 0; i < count; ++i)
+            {
+                uint32_t ticks = i > 0 ? source[i].GyroTime - source[i - 1].GyroTime : 0;
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    readings[i].Gyro[axis] = values[axis][i] * RADIANS_PER_DEGREE;
+                    readings[i].Accel[axis] = values[3 + axis][i];
+                }
+                readings[i].Dt = ticks / TICKS_PER_SECOND;
+            }
+            converted.push_back(std::move(readings));
+        }
+
+        Out.resize(STEPS * MAX_DEVICES);
+        for(size_t device = 0; device < MAX_DEVICES; ++device)
+        {
+            const std::vector<Reading>& source = converted[device % converted.size()];
+            for(size_t step = 0; step < STEPS; ++step)
+            {
+                Out[step * MAX_DEVICES + device] = source[step % source.size()];
+            }
+        }
+        std::printf("%zu devices' samples from %s\n", converted.size(), pFileName);
+        return true;
+    }
+
+    void Run(FusionEngine& Engine, const Readings& In)
+    {
+        size_t devices = Engine.DeviceCount();
+        for(size_t step = 0; step < STEPS; ++step)
+        {
+            const Reading* pStep = &In[step * MAX_DEVICES];
+            for(size_t device = 0; device < devices; ++device)
+            {
+                const Reading& r = pStep[device];
+                Engine.SetInput(device, r.Gyro[0], r.Gyro[1], r.Gyro[2], r.Accel[0], r.Accel[1], r.Accel[2], r.Dt);
+            }
+            Engine.Step();
+        }
+    }
+
+    void Run(std::vector<MadgwickFilter>& Filters, const Readings& In)
+    {
+        for(size_t step = 0; step < STEPS; ++step)
+        {
+            const Reading* pStep = &In[step * MAX_DEVICES];
+            for(size_t device = 0; device < Filters.size(); ++device)
+            {
+                const Reading& r = pStep[device];
+                Filters[device].Update(r.Gyro[0], r.Gyro[1], r.Gyro[2], r.Accel[0], r.Accel[1], r.Accel[2], r.Dt);
+            }
+        }
+    }
+
+    // Device updates per second, running until Seconds have passed
+    template<typename Fusion>
+    double Rate(Fusion& Subject, size_t Devices, const Readings& In, double Seconds)
+    {
+        uint64_t runs = 0;
+        Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        while(elapsed < Seconds)
+        {
+            Run(Subject, In);
+            ++runs;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        return runs * STEPS * Devices / elapsed;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    Readings readings;
+    if(argc > 2)
+    {
+        if(!Replayed(argv[2], readings))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        readings = Synthetic();
+    }
+
+    std::printf("Best kernel here %s, millions of device updates per second:\n", SimdName(BestSimdLevel()));
+    std::printf("  devices  filters   scalar     sse2     avx2\n");
+    float worst = 0.0f;
+    for(size_t devices = 1; devices <= MAX_DEVICES; devices *= 2)
+    {
+        // Where the filters are after one pass, before timing moves them on
+        std::vector<MadgwickFilter> filters(devices);
+        Run(filters, readings);
+        std::vector<Quaternion> reference;
+        for(const MadgwickFilter& filter : filters)
+        {
+            reference.push_back(filter.Orientation());
+        }
+
+        std::printf("  %7zu %8.1f", devices, Rate(filters, devices, readings, seconds) / 1e6);
+        for(auto level : { SIMD_LEVEL::SCALAR, SIMD_LEVEL::SSE2, SIMD_LEVEL::AVX2 })
+        {
+            if(!SimdSupported(level))
+            {
+                std::printf("        -");
+                continue;
+            }
+
+            FusionEngine engine(devices, MadgwickFilter::DEFAULT_BETA, level);
+            Run(engine, readings);
+            for(size_t device = 0; device < devices; ++device)
+            {
+                Quaternion a = engine.Orientation(device);
+                const Quaternion& b = reference[device];
+                float difference = std::max({ std::fabs(a.W - b.W), std::fabs(a.X - b.X), std::fabs(a.Y - b.Y), std::fabs(a.Z - b.Z) });
+                worst = std::max(worst, difference);
+            }
+
+            std::printf(" %8.1f", Rate(engine, devices, readings, seconds) / 1e6);
+        }
+        std::printf("\n");
+    }
+    std::printf("Max difference from MadgwickFilter %.1e\n", worst);
+    return worst <= MAX_DIFFERENCE ? 0 : 1;
+}
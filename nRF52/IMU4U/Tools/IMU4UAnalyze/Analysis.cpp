@@ -0,0 +1,116 @@
+#include "Analysis.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double ONE_G_IN_LSB = 16384.0;     // See QtApp/Window.cpp
+    constexpr double STILL_ACCEL_TOLERANCE = 0.05;
+    constexpr double STILL_GYRO_LSB = 256.0;     // 2 degrees per second
+}
+
+void AxisStats::Add(int Value)
+{
+    ++Count;
+    double delta = Value - Mean;
+    Mean += delta / Count;
+    M2 += delta * (Value - Mean);
+    Min = std::min(Min, Value);
+    Max = std::max(Max, Value);
+}
+
+void AxisStats::Merge(const AxisStats& Other)
+{
+    if(Other.Count == 0)
+    {
+        return;
+    }
+
+    uint64_t count = Count + Other.Count;
+    double delta = Other.Mean - Mean;
+    Mean += delta * Other.Count / count;
+    M2 += Other.M2 + delta * delta * (static_cast<double>(Count) * Other.Count / count);
+    Count = count;
+    Min = std::min(Min, Other.Min);
+    Max = std::max(Max, Other.Max);
+}
+
+double AxisStats::Variance() const
+{
+    return Count > 1 ? M2 / (Count - 1) : 0.0;
+}
+
+void DeviceResult::Add(const IMUSample& Sample)
+{
+    const IMUData& data = Sample.Data;
+    const ThreeDimData* groups[3] = { &data.Accel, &data.Gyro, &data.Mag };
+    for(int group = 0; group < 3; ++group)
+    {
+        Axes[group * 3 + 0].Add(groups[group]->X);
+        Axes[group * 3 + 1].Add(groups[group]->Y);
+        Axes[group * 3 + 2].Add(groups[group]->Z);
+    }
+
+    // At rest when only gravity is felt and barely any rotation
+    double accel = std::sqrt(static_cast<double>(data.Accel.X) * data.Accel.X + static_cast<double>(data.Accel.Y) * data.Accel.Y +
+                             static_cast<double>(data.Accel.Z) * data.Accel.Z);
+    double gyro = std::sqrt(static_cast<double>(data.Gyro.X) * data.Gyro.X + static_cast<double>(data.Gyro.Y) * data.Gyro.Y +
+                            static_cast<double>(data.Gyro.Z) * data.Gyro.Z);
+    if(std::fabs(accel / ONE_G_IN_LSB - 1.0) < STILL_ACCEL_TOLERANCE && gyro < STILL_GYRO_LSB)
+    {
+        StillGyro[0].Add(data.Gyro.X);
+        StillGyro[1].Add(data.Gyro.Y);
+        StillGyro[2].Add(data.Gyro.Z);
+    }
+
+    if(data.ErrorStatus != 0)
+    {
+        ++Errors;
+    }
+}
+
+void DeviceResult::Merge(const DeviceResult& Next)
+{
+    for(int axis = 0; axis < AXIS_COUNT; ++axis)
+    {
+        Axes[axis].Merge(Next.Axes[axis]);
+    }
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        StillGyro[axis].Merge(Next.StillGyro[axis]);
+    }
+    Errors += Next.Errors;
+    Stream.Merge(Next.Stream);
+}
+
+void StreamResult::Merge(const StreamResult& Next)
+{
+    if(Next.bHaveSequence)
+    {
+        if(bHaveSequence)
+        {
+            Lost += static_cast<uint16_t>(Next.FirstSequence - LastSequence - 1);
+        }
+        else
+        {
+            FirstSequence = Next.FirstSequence;
+        }
+        LastSequence = Next.LastSequence;
+        bHaveSequence = true;
+    }
+
+    Packets += Next.Packets;
+    Malformed += Next.Malformed;
+    Lost += Next.Lost;
+}
+
+void ChunkResult::Merge(const ChunkResult& Next)
+{
+    for(const auto& device : Next.Devices)
+    {
+        Devices[device.first].Merge(device.second);
+    }
+    ChunksDropped += Next.ChunksDropped;
+    SamplesDropped += Next.SamplesDropped;
+    Seconds += Next.Seconds;
+}
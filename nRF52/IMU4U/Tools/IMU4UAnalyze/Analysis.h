@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include "IMUData.h"
+
+// Per chunk results and how to combine them.  Every Merge() is associative, so chunks
+// can be analysed in any order on any thread and their results folded together in
+// recording order afterwards.
+
+// Count, extremes, mean and variance of one axis.  Merging uses Chan et al.'s pairwise
+// update so the variance stays accurate however the chunks are grouped.
+struct AxisStats
+{
+    uint64_t Count = 0;
+    double   Mean = 0.0;
+    double   M2 = 0.0;     // Sum of squared differences from the mean
+    int      Min = INT32_MAX;
+    int      Max = INT32_MIN;
+
+    void Add(int Value);
+    void Merge(const AxisStats& Other);
+    double Variance() const;
+};
+
+enum AXIS
+{
+    AXIS_ACCEL_X, AXIS_ACCEL_Y, AXIS_ACCEL_Z,
+    AXIS_GYRO_X, AXIS_GYRO_Y, AXIS_GYRO_Z,
+    AXIS_MAG_X, AXIS_MAG_Y, AXIS_MAG_Z,
+    AXIS_COUNT
+};
+
+// Stream packet loss.  Lost packets inside a chunk come from its decoder, those between
+// chunks from the sequence numbers either side of the join.
+struct StreamResult
+{
+    uint64_t Packets = 0;
+    uint64_t Malformed = 0;
+    uint64_t Lost = 0;
+    bool     bHaveSequence = false;
+    uint16_t FirstSequence = 0;
+    uint16_t LastSequence = 0;
+
+    void Merge(const StreamResult& Next);   // Next must follow this in the recording
+};
+
+struct DeviceResult
+{
+    AxisStats    Axes[AXIS_COUNT];
+    AxisStats    StillGyro[3];   // Gyro readings while the device was at rest, for its bias
+    uint64_t     Errors = 0;     // Samples with an ErrorStatus
+    StreamResult Stream;         // Only for captures, archives hold decoded samples
+
+    void Add(const IMUSample& Sample);
+    void Merge(const DeviceResult& Next);   // Next must follow this in the recording
+};
+
+struct ChunkResult
+{
+    std::map<uint16_t, DeviceResult> Devices;
+    uint64_t                         ChunksDropped = 0;    // Archive chunks that couldn't be read
+    uint64_t                         SamplesDropped = 0;   // The samples they held, as the index says
+    double                           Seconds = 0.0;        // Spent analysing
+
+    void Merge(const ChunkResult& Next);
+};
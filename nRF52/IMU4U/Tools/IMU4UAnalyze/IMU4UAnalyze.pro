@@ -0,0 +1,26 @@
+# Parallel offline analysis of IMU4U recordings
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = Analysis.h \
+              $$APP_DIR/CaptureFile.h \
+              $$APP_DIR/IMU4UService.h \
+              $$APP_DIR/IMUData.h \
+              $$APP_DIR/SampleArchive.h \
+              $$APP_DIR/SampleCodec.h \
+              $$APP_DIR/StreamDecoder.h \
+              $$APP_DIR/WorkStealingPool.h
+SOURCES     = Analysis.cpp \
+              main.cpp \
+              $$APP_DIR/CaptureFile.cpp \
+              $$APP_DIR/SampleArchive.cpp \
+              $$APP_DIR/SampleCodec.cpp \
+              $$APP_DIR/StreamDecoder.cpp \
+              $$APP_DIR/WorkStealingPool.cpp
+
+unix:LIBS  += -lpthread
@@ -0,0 +1,367 @@
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Analysis.h"
+#include "CaptureFile.h"
+#include "IMU4UService.h"
+#include "SampleArchive.h"
+#include "StreamDecoder.h"
+#include "WorkStealingPool.h"
+
+// Statistics, gyro bias calibration and stream loss over recordings, using every core:
+//   IMU4UAnalyze [--threads N] [--scaling] file...
+// Files can be sample archives (--archive in the app) or notification captures
+// (--capture).  Archive chunks are analysed independently; captures are cut into
+// blocks of packets, each decoded with a StreamDecoder per device just as NordicCentral does.
+// --scaling runs everything again with 1, 2, 4... threads and reports the speed up.
+// Exits with 1 if a file can't be read, or if any archive chunk failed its CRC and was
+// left out of the results.
+
+namespace
+{
+    constexpr size_t CAPTURE_BLOCK_PACKETS = 2048;
+    constexpr size_t MAX_BLOCKS_IN_FLIGHT_PER_THREAD = 4;   // Bounds memory for long captures
+    constexpr double DEGREES_PER_LSB = 0.0078125;            // See QtApp/Window.cpp
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::duration Duration)
+    {
+        return std::chrono::duration<double>(Duration).count();
+    }
+
+    // Blocks the reader while too many capture blocks are waiting to be analysed
+    class InFlightLimit
+    {
+        public:
+            explicit InFlightLimit(size_t Limit) : m_Limit(Limit)
+            {
+            }
+
+            void Acquire()
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Changed.wait(lock, [this]() { return m_Count < m_Limit; });
+                ++m_Count;
+            }
+
+            void Release()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    --m_Count;
+                }
+                m_Changed.notify_one();
+            }
+
+        private:
+            std::mutex              m_Mutex;
+            std::condition_variable m_Changed;
+            size_t                  m_Limit;
+            size_t                  m_Count = 0;
+    };
+
+    bool IsArchive(const std::string& FileName)
+    {
+        char magic[sizeof(SampleArchive::FILE_MAGIC)] = {};
+        std::ifstream file(FileName, std::ios::binary);
+        file.read(magic, sizeof(magic));
+        return std::memcmp(magic, SampleArchive::FILE_MAGIC, sizeof(magic)) == 0;
+    }
+
+    // Results go into a slot per chunk so they can be merged in recording order
+    bool AnalyseArchive(const std::string& FileName, WorkStealingPool& Pool, std::vector<std::unique_ptr<ChunkResult>>& Results)
+    {
+        auto pReader = std::make_shared<SampleArchiveReader>();
+        if(!pReader->Open(FileName))
+        {
+            return false;
+        }
+        if(pReader->Recovered())
+        {
+            std::fprintf(stderr, "Warning: %s has no index, so it was probably cut off while recording. "
+                         "Analysing the %zu whole chunks before the cut.\n", FileName.c_str(), pReader->Chunks().size());
+        }
+
+        size_t first = Results.size();
+        Results.resize(first + pReader->Chunks().size());
+        for(size_t i = 0; i < pReader->Chunks().size(); ++i)
+        {
+            ChunkResult* pResult = (Results[first + i] = std::make_unique<ChunkResult>()).get();
+            Pool.Submit([pReader, i, pResult]()
+            {
+                Clock::time_point start = Clock::now();
+                std::vector<IMUSample> samples;
+                if(pReader->ReadChunk(i, samples))
+                {
+                    DeviceResult& device = pResult->Devices[pReader->Chunks()[i].Device];
+                    for(const auto& sample : samples)
+                    {
+                        device.Add(sample);
+                    }
+                }
+                else
+                {
+                    pResult->ChunksDropped = 1;
+                    pResult->SamplesDropped = pReader->Chunks()[i].Count;
+                }
+                pResult->Seconds = Seconds(Clock::now() - start);
+            });
+        }
+
+        // The reader must outlive the tasks, which hold a reference to it until they're done
+        Pool.Wait();
+        return true;
+    }
+
+    bool AnalyseCapture(const std::string& FileName, WorkStealingPool& Pool, std::vector<std::unique_ptr<ChunkResult>>& Results)
+    {
+        CaptureReader reader;
+        if(!reader.Open(FileName))
+        {
+            return false;
+        }
+
+        InFlightLimit limit(Pool.ThreadCount() * MAX_BLOCKS_IN_FLIGHT_PER_THREAD);
+        CaptureRecord record;
+        bool bMore = true;
+        while(bMore)
+        {
+            auto pBlock = std::make_shared<std::vector<CaptureRecord>>();
+            while(pBlock->size() < CAPTURE_BLOCK_PACKETS && (bMore = reader.Read(record)))
+            {
+                // Clock sync replies share the stream, but aren't samples
+                if(record.Characteristic == NORDIC_BLINKY_IMU_CHAR_UUID &&
+                   (record.Payload.empty() || record.Payload[0] != static_cast<uint8_t>(PACKET_TYPE::SYNC)))
+                {
+                    pBlock->push_back(record);
+                }
+            }
+            if(pBlock->empty())
+            {
+                break;
+            }
+
+            Results.push_back(std::make_unique<ChunkResult>());
+            ChunkResult* pResult = Results.back().get();
+            limit.Acquire();
+            Pool.Submit([pBlock, pResult, &limit]()
+            {
+                Clock::time_point start = Clock::now();
+                std::map<uint16_t, StreamDecoder> decoders;
+                IMUSample samples[StreamDecoder::MAX_PACKET_SAMPLES];
+
+                for(const auto& packet : *pBlock)
+                {
+                    StreamDecoder& decoder = decoders[packet.Device];
+                    DeviceResult& device = pResult->Devices[packet.Device];
+                    StreamResult& stream = device.Stream;
+                    const std::vector<uint8_t>& payload = packet.Payload;
+
+                    uint64_t malformed = decoder.PacketsMalformed();
+                    size_t count = decoder.Decode(payload.data(), payload.size(), samples);
+                    if(decoder.PacketsMalformed() != malformed)
+                    {
+                        continue;
+                    }
+
+                    uint16_t sequence = static_cast<uint16_t>(payload[2] | (payload[3] << 8));
+                    if(!stream.bHaveSequence)
+                    {
+                        stream.FirstSequence = sequence;
+                        stream.bHaveSequence = true;
+                    }
+                    stream.LastSequence = sequence;
+
+                    for(size_t i = 0; i < count; ++i)
+                    {
+                        device.Add(samples[i]);
+                    }
+                }
+                for(const auto& decoder : decoders)
+                {
+                    StreamResult& stream = pResult->Devices[decoder.first].Stream;
+                    stream.Packets = decoder.second.PacketsDecoded();
+                    stream.Lost = decoder.second.PacketsLost();
+                    stream.Malformed = decoder.second.PacketsMalformed();
+                }
+                pResult->Seconds = Seconds(Clock::now() - start);
+                limit.Release();
+            });
+        }
+
+        Pool.Wait();
+        return true;
+    }
+
+    bool Analyse(const std::vector<std::string>& FileNames, size_t Threads, ChunkResult& Total, double& WallSeconds, uint64_t& Steals)
+    {
+        WorkStealingPool pool(Threads);
+        Clock::time_point start = Clock::now();
+
+        Total = ChunkResult();
+        for(const auto& fileName : FileNames)
+        {
+            std::vector<std::unique_ptr<ChunkResult>> results;
+            bool bRead = IsArchive(fileName) ? AnalyseArchive(fileName, pool, results) : AnalyseCapture(fileName, pool, results);
+            if(!bRead)
+            {
+                std::fprintf(stderr, "Can't read %s\n", fileName.c_str());
+                return false;
+            }
+
+            ChunkResult file;
+            for(const auto& pResult : results)
+            {
+                file.Merge(*pResult);
+            }
+            if(file.ChunksDropped > 0)
+            {
+                std::fprintf(stderr, "Warning: %s: %llu chunks (%llu samples) are damaged and were left out\n", fileName.c_str(),
+                             static_cast<unsigned long long>(file.ChunksDropped), static_cast<unsigned long long>(file.SamplesDropped));
+            }
+
+            // Stream sequence numbers don't carry on from one file to the next
+            for(auto& device : file.Devices)
+            {
+                device.second.Stream.bHaveSequence = false;
+            }
+            Total.Merge(file);
+        }
+
+        WallSeconds = Seconds(Clock::now() - start);
+        Steals = pool.TasksStolen();
+        return true;
+    }
+
+    void Report(const ChunkResult& Total)
+    {
+        const char* axisNames[AXIS_COUNT] = { "Accel X", "Accel Y", "Accel Z", "Gyro X", "Gyro Y", "Gyro Z", "Mag X", "Mag Y", "Mag Z" };
+
+        for(const auto& device : Total.Devices)
+        {
+            const DeviceResult& result = device.second;
+            std::printf("Device %u: %llu samples, %llu with errors\n", device.first,
+                        static_cast<unsigned long long>(result.Axes[0].Count), static_cast<unsigned long long>(result.Errors));
+            std::printf("  %-8s %8s %8s %10s %10s\n", "Axis", "Min", "Max", "Mean", "Std dev");
+            for(int axis = 0; axis < AXIS_COUNT; ++axis)
+            {
+                const AxisStats& stats = result.Axes[axis];
+                std::printf("  %-8s %8d %8d %10.2f %10.2f\n", axisNames[axis], stats.Count ? stats.Min : 0, stats.Count ? stats.Max : 0,
+                            stats.Mean, std::sqrt(stats.Variance()));
+            }
+
+            if(result.StillGyro[0].Count > 0)
+            {
+                std::printf("  Gyro bias from %llu samples at rest: X %.3f Y %.3f Z %.3f degrees/s\n",
+                            static_cast<unsigned long long>(result.StillGyro[0].Count), result.StillGyro[0].Mean * DEGREES_PER_LSB,
+                            result.StillGyro[1].Mean * DEGREES_PER_LSB, result.StillGyro[2].Mean * DEGREES_PER_LSB);
+            }
+            else
+            {
+                std::printf("  Never at rest, no gyro bias\n");
+            }
+
+            const StreamResult& stream = result.Stream;
+            if(stream.Packets > 0 || stream.Malformed > 0)
+            {
+                std::printf("  Stream: %llu packets, %llu lost, %llu malformed\n", static_cast<unsigned long long>(stream.Packets),
+                            static_cast<unsigned long long>(stream.Lost), static_cast<unsigned long long>(stream.Malformed));
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* pUsage = "Usage: IMU4UAnalyze [--threads N] [--scaling] file...\n";
+    size_t threads = 0;
+    bool bScaling = false;
+    std::vector<std::string> fileNames;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--threads") == 0)
+        {
+            if(i + 1 == argc)
+            {
+                std::fprintf(stderr, "--threads needs a count\n%s", pUsage);
+                return 1;
+            }
+            threads = static_cast<size_t>(std::atoi(argv[++i]));
+        }
+        else if(std::strcmp(argv[i], "--scaling") == 0)
+        {
+            bScaling = true;
+        }
+        else if(std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0)
+        {
+            std::printf("%s", pUsage);
+            return 0;
+        }
+        else if(argv[i][0] == '-')
+        {
+            std::fprintf(stderr, "Unknown option %s\n%s", argv[i], pUsage);
+            return 1;
+        }
+        else
+        {
+            fileNames.push_back(argv[i]);
+        }
+    }
+
+    if(fileNames.empty())
+    {
+        std::fprintf(stderr, "%s", pUsage);
+        return 1;
+    }
+
+    ChunkResult total;
+    double wallSeconds = 0.0;
+    uint64_t steals = 0;
+    if(!Analyse(fileNames, threads, total, wallSeconds, steals))
+    {
+        return 1;
+    }
+
+    Report(total);
+    uint64_t samples = 0;
+    for(const auto& device : total.Devices)
+    {
+        samples += device.second.Axes[0].Count;
+    }
+    size_t threadsUsed = threads > 0 ? threads : WorkStealingPool(0).ThreadCount();
+    std::printf("%llu samples in %.3f s on %zu threads (%.1f M samples/s, %.2f s of work, %llu tasks stolen)\n",
+                static_cast<unsigned long long>(samples), wallSeconds, threadsUsed, samples / wallSeconds / 1e6, total.Seconds,
+                static_cast<unsigned long long>(steals));
+    if(total.ChunksDropped > 0)
+    {
+        std::printf("INCOMPLETE: %llu damaged chunks (%llu samples) are missing from these results\n",
+                    static_cast<unsigned long long>(total.ChunksDropped), static_cast<unsigned long long>(total.SamplesDropped));
+    }
+
+    if(bScaling)
+    {
+        double baseline = 0.0;
+        for(size_t count = 1; count <= threadsUsed; count *= 2)
+        {
+            ChunkResult result;
+            double seconds = 0.0;
+            Analyse(fileNames, count, result, seconds, steals);
+            if(count == 1)
+            {
+                baseline = seconds;
+            }
+            std::printf("  %2zu threads: %.3f s, %.2fx\n", count, seconds, baseline / seconds);
+        }
+    }
+    return total.ChunksDropped > 0 ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+# Throughput, latency and steady state allocations of SampleMerger (see QtApp/SampleMerger.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SampleMerger.h \
+              $$APP_DIR/SPSCRing.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SampleMerger.cpp
+
+unix:LIBS  += -lpthread
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+#include "SampleMerger.h"
+
+// Merges synthetic streams from many devices, each pushed from a thread of its own in
+// bursts the way notifications arrive, and checks what comes out is in time order:
+//   MergeBench [devices] [rate Hz] [seconds] [max delay ms] [--fast]
+// In real time, device 0 stalls for twice the max delay once a second so late samples
+// get exercised, and the latency through the merge is measured.  With --fast the
+// producers push as fast as the merge takes samples, for throughput.  Heap allocations
+// are counted once everything is running, and there shouldn't be any.
+
+namespace
+{
+    constexpr int    SAMPLES_PER_BURST = 8;      // Roughly a connection interval's worth at 1kHz
+    constexpr size_t RING_SIZE = 4096;
+    constexpr size_t POP_BATCH = 1024;
+    constexpr int    WARM_UP_MS = 500;
+    constexpr int    STALL_PERIOD_MS = 1000;
+
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<uint64_t> gAllocations{0};
+
+    uint64_t NowNs(Clock::time_point Start)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - Start).count());
+    }
+}
+
+void* operator new(size_t Size)
+{
+    ++gAllocations;
+    void* p = std::malloc(Size ? Size : 1);
+    if(!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    bool bFast = false;
+    std::vector<const char*> args;
+    for(int i = 1; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--fast") == 0)
+        {
+            bFast = true;
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    int devices = args.size() > 0 ? std::atoi(args[0]) : 16;
+    double rateHz = args.size() > 1 ? std::atof(args[1]) : 1000.0;
+    double seconds = args.size() > 2 ? std::atof(args[2]) : 5.0;
+    double maxDelayMs = args.size() > 3 ? std::atof(args[3]) : 20.0;
+
+    uint64_t periodNs = static_cast<uint64_t>(1e9 / rateHz);
+    uint64_t samplesPerDevice = static_cast<uint64_t>(seconds * rateHz);
+    uint64_t maxDelayNs = static_cast<uint64_t>(maxDelayMs * 1e6);
+    SampleMerger merger(devices, maxDelayNs, RING_SIZE, SampleMerger::LATE_POLICY::EMIT);
+
+    Clock::time_point start = Clock::now();
+    std::atomic<int> producersRunning{devices};
+    std::vector<std::thread> producers;
+    for(int device = 0; device < devices; ++device)
+    {
+        producers.emplace_back([&, device]()
+        {
+            std::mt19937 random(device);
+            std::uniform_int_distribution<uint64_t> phase(0, periodNs - 1);
+            uint64_t offset = phase(random);   // Devices don't sample in step
+            IMUSample sample = {};
+            sample.Data.Accel.X = static_cast<int16_t>(device);
+
+            for(uint64_t i = 0; i < samplesPerDevice; i += SAMPLES_PER_BURST)
+            {
+                uint64_t burstEnd = std::min(i + SAMPLES_PER_BURST, samplesPerDevice);
+                uint64_t lastTime = (burstEnd - 1) * periodNs + offset;
+                if(!bFast)
+                {
+                    // Delivered once the burst's last sample has been taken
+                    uint64_t deliverAt = lastTime;
+                    if(device == 0 && lastTime % (STALL_PERIOD_MS * 1000000ull) < 2 * maxDelayNs)
+                    {
+                        deliverAt = lastTime - lastTime % (STALL_PERIOD_MS * 1000000ull) + 2 * maxDelayNs;
+                    }
+                    std::this_thread::sleep_until(start + std::chrono::nanoseconds(deliverAt));
+                }
+
+                for(uint64_t j = i; j < burstEnd; ++j)
+                {
+                    sample.GyroTime = static_cast<uint32_t>(j);
+                    while(!merger.Push(static_cast<uint16_t>(device), j * periodNs + offset, sample))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+            --producersRunning;
+        });
+    }
+
+    static MergedSample merged[POP_BATCH];
+    uint64_t samplesOut = 0;
+    uint64_t outOfOrder = 0;
+    uint64_t lastTime = 0;
+    uint64_t allocationsAtWarmUp = 0;
+    bool bWarmedUp = false;
+    double maxLatencyMs = 0.0;
+    double totalLatencyMs = 0.0;
+
+    for(;;)
+    {
+        bool bFinished = producersRunning == 0;
+        size_t count = merger.Pop(merged, POP_BATCH, bFinished);
+        uint64_t now = NowNs(start);
+        for(size_t i = 0; i < count; ++i)
+        {
+            const MergedSample& sample = merged[i];
+            if(sample.bLate)
+            {
+                continue;
+            }
+            if(sample.Time < lastTime)
+            {
+                ++outOfOrder;
+            }
+            lastTime = sample.Time;
+
+            if(!bFast && now > sample.Time)
+            {
+                double latencyMs = (now - sample.Time) / 1e6;
+                maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+                totalLatencyMs += latencyMs;
+            }
+        }
+        samplesOut += count;
+
+        if(!bWarmedUp && now > WARM_UP_MS * 1000000ull)
+        {
+            bWarmedUp = true;
+            allocationsAtWarmUp = gAllocations;
+        }
+        if(bFinished && count == 0)
+        {
+            break;
+        }
+        if(!bFast && count == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    uint64_t steadyAllocations = bWarmedUp ? gAllocations - allocationsAtWarmUp : 0;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for(auto& producer : producers)
+    {
+        producer.join();
+    }
+
+    uint64_t expected = samplesPerDevice * devices;
+    std::printf("%d devices at %.0f Hz for %.1f s, %.0f ms max delay%s\n", devices, rateHz, seconds, maxDelayMs, bFast ? ", as fast as possible" : "");
+    std::printf("%llu of %llu samples out, %llu late, %llu dropped, %llu out of order\n",
+                static_cast<unsigned long long>(samplesOut), static_cast<unsigned long long>(expected),
+                static_cast<unsigned long long>(merger.SamplesLate()), static_cast<unsigned long long>(merger.SamplesDropped()),
+                static_cast<unsigned long long>(outOfOrder));
+    std::printf("%.2f M samples/s through the merge\n", samplesOut / elapsed / 1e6);
+    if(!bFast)
+    {
+        std::printf("Latency from sampling to merged: mean %.2f ms, max %.2f ms\n",
+                    totalLatencyMs / std::max<uint64_t>(samplesOut - merger.SamplesLate(), 1), maxLatencyMs);
+    }
+    std::printf("Heap allocations after warming up: %llu\n", static_cast<unsigned long long>(steadyAllocations));
+    return samplesOut == expected && outOfOrder == 0 && steadyAllocations == 0 ? 0 : 1;
+}
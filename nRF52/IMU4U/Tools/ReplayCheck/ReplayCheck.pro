@@ -0,0 +1,22 @@
+# Regression check of capture files and their replay, decoded back to the samples in them (see QtApp/ReplaySource.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/CaptureFile.h \
+              $$APP_DIR/IMU4UService.h \
+              $$APP_DIR/IMUData.h \
+              $$APP_DIR/ReplaySource.h \
+              $$APP_DIR/SampleCodec.h \
+              $$APP_DIR/StreamDecoder.h
+SOURCES     = main.cpp \
+              $$APP_DIR/CaptureFile.cpp \
+              $$APP_DIR/ReplaySource.cpp \
+              $$APP_DIR/SampleCodec.cpp \
+              $$APP_DIR/StreamDecoder.cpp
+
+unix:LIBS  += -lpthread
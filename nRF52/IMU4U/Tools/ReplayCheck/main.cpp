@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <random>
+#include <string>
+#include <vector>
+#include "CaptureFile.h"
+#include "IMU4UService.h"
+#include "ReplaySource.h"
+#include "SampleCodec.h"
+#include "StreamDecoder.h"
+
+// Regression check of capture and replay (see QtApp/ReplaySource.h).  Writes a fixture
+// capture of several devices streaming, with button presses and clock sync replies mixed
+// in, then replays it at max speed and at [speed] times real time:
+//   ReplayCheck [speed] [file]
+// Each replay must hand over every record unchanged, in order and never early, and its
+// stream packets must decode back to the samples they were made from.  A version 1 file
+// must read as all from device 0.  Exits with 1 if anything differs, or if the paced
+// replay falls more than MAX_LATE_MS behind.
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;
+    constexpr int DEVICES = 3;
+    constexpr double SECONDS = 2.0;
+    constexpr double SAMPLE_RATE_HZ = 200.0;
+    constexpr double CONNECTION_INTERVAL_S = 0.0075;
+    constexpr size_t PACKET_SIZE = 244;
+    constexpr double MAX_LATE_MS = 100.0;          // Generous, for a loaded machine
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Replayed
+    {
+        CaptureRecord Record;
+        double        AtS;   // Since the replay started
+    };
+
+    IMUSample MakeSample(uint64_t Index, int Device, std::mt19937& Random)
+    {
+        std::uniform_int_distribution<int> noise(-200, 200);
+        double t = Index / SAMPLE_RATE_HZ;
+
+        IMUSample sample = {};
+        sample.GyroTime = static_cast<uint32_t>(static_cast<uint64_t>(t * TICKS_PER_SECOND) + Device * 1000);
+        sample.AccelMagTime = sample.GyroTime + 5;
+        sample.Data.Accel.X = static_cast<int16_t>(noise(Random));
+        sample.Data.Accel.Y = static_cast<int16_t>(8000 * std::sin(t + Device) + noise(Random));
+        sample.Data.Accel.Z = static_cast<int16_t>(16000 + noise(Random));
+        sample.Data.Gyro.X = static_cast<int16_t>(noise(Random) * 50);
+        sample.Data.Gyro.Y = static_cast<int16_t>(noise(Random));
+        sample.Data.Gyro.Z = static_cast<int16_t>(-noise(Random));
+        sample.Data.Mag.X = static_cast<int16_t>(300 + noise(Random));
+        sample.Data.Mag.Y = static_cast<int16_t>(-400 + noise(Random));
+        sample.Data.Mag.Z = static_cast<int16_t>(noise(Random));
+        sample.Data.ErrorStatus = Index % 97 == 0 ? 1 : 0;
+        return sample;
+    }
+
+    bool SameSample(const IMUSample& A, const IMUSample& B)
+    {
+        auto SameAxes = [](const ThreeDimData& a, const ThreeDimData& b) { return a.X == b.X && a.Y == b.Y && a.Z == b.Z; };
+        return A.AccelMagTime == B.AccelMagTime && A.GyroTime == B.GyroTime &&
+               SameAxes(A.Data.Accel, B.Data.Accel) && SameAxes(A.Data.Mag, B.Data.Mag) && SameAxes(A.Data.Gyro, B.Data.Gyro) &&
+               A.Data.MagStatus == B.Data.MagStatus && A.Data.AccelStatus == B.Data.AccelStatus &&
+               A.Data.GyroStatus == B.Data.GyroStatus && A.Data.ErrorStatus == B.Data.ErrorStatus;
+    }
+
+    bool SameRecord(const CaptureRecord& A, const CaptureRecord& B)
+    {
+        return A.TimeNs == B.TimeNs && A.Device == B.Device && A.Characteristic == B.Characteristic && A.Payload == B.Payload;
+    }
+
+    // Stream packets as Firmware/StreamEncoder.c builds them, each device's sent at its
+    // connection events with whatever it has sampled since the last one, plus a button
+    // press and a sync reply from every device
+    void MakeFixture(std::vector<CaptureRecord>& Records, std::vector<std::vector<IMUSample>>& Samples)
+    {
+        std::mt19937 random(1);
+        SampleCodec codec;
+        std::vector<uint64_t> next(DEVICES, 0);
+        std::vector<uint16_t> sequence(DEVICES, 0);
+        Samples.assign(DEVICES, {});
+
+        uint64_t total = static_cast<uint64_t>(SECONDS * SAMPLE_RATE_HZ);
+        for(int device = 0; device < DEVICES; ++device)
+        {
+            for(uint64_t i = 0; i < total; ++i)
+            {
+                Samples[device].push_back(MakeSample(i, device, random));
+            }
+        }
+
+        for(double event = CONNECTION_INTERVAL_S; event < SECONDS + CONNECTION_INTERVAL_S; event += CONNECTION_INTERVAL_S)
+        {
+            for(int device = 0; device < DEVICES; ++device)
+            {
+                // Each device's events a little apart, as they share the radio
+                uint64_t timeNs = static_cast<uint64_t>((event + device * 0.001) * 1e9);
+                while(next[device] < total && next[device] / SAMPLE_RATE_HZ < event)
+                {
+                    CaptureRecord record;
+                    record.TimeNs = timeNs;
+                    record.Device = static_cast<uint16_t>(device);
+                    record.Characteristic = NORDIC_BLINKY_IMU_CHAR_UUID;
+                    record.Payload.assign(PACKET_SIZE, 0);
+                    size_t size = StreamDecoder::HEADER_SIZE;
+                    size_t count = 0;
+                    codec.Reset();
+                    while(next[device] < total && next[device] / SAMPLE_RATE_HZ < event && count < StreamDecoder::MAX_PACKET_SAMPLES)
+                    {
+                        size_t length = codec.Encode(Samples[device][next[device]], &record.Payload[size], PACKET_SIZE - size);
+                        if(length == 0)
+                        {
+                            break;
+                        }
+                        size += length;
+                        ++count;
+                        ++next[device];
+                    }
+                    record.Payload[0] = static_cast<uint8_t>(PACKET_TYPE::SAMPLES);
+                    record.Payload[1] = static_cast<uint8_t>(count);
+                    record.Payload[2] = static_cast<uint8_t>(sequence[device] & 0xFF);
+                    record.Payload[3] = static_cast<uint8_t>(sequence[device] >> 8);
+                    record.Payload.resize(size);
+                    ++sequence[device];
+                    Records.push_back(record);
+                }
+
+                if(std::fabs(event - 0.5 - device * 0.25) < CONNECTION_INTERVAL_S / 2)
+                {
+                    CaptureRecord button;
+                    button.TimeNs = timeNs;
+                    button.Device = static_cast<uint16_t>(device);
+                    button.Characteristic = NORDIC_BLINKY_BUTTON_CHAR_UUID;
+                    button.Payload = { 1 };
+                    Records.push_back(button);
+
+                    CaptureRecord sync;
+                    sync.TimeNs = timeNs;
+                    sync.Device = static_cast<uint16_t>(device);
+                    sync.Characteristic = NORDIC_BLINKY_IMU_CHAR_UUID;
+                    sync.Payload = { static_cast<uint8_t>(PACKET_TYPE::SYNC), static_cast<uint8_t>(device), 0x78, 0x56, 0x34, 0x12 };
+                    Records.push_back(sync);
+                }
+            }
+        }
+    }
+
+    bool Replay(const std::string& FileName, double Speed, std::vector<Replayed>& Out, double& Seconds)
+    {
+        Out.clear();
+        ReplaySource replay;
+        std::promise<void> finished;
+        Clock::time_point start = Clock::now();
+        auto OnPayload = [&Out, start](uint64_t TimeNs, uint16_t Device, uint16_t Characteristic, const uint8_t* pPayload, size_t Size)
+        {
+            Replayed replayed;
+            replayed.Record.TimeNs = TimeNs;
+            replayed.Record.Device = Device;
+            replayed.Record.Characteristic = Characteristic;
+            replayed.Record.Payload.assign(pPayload, pPayload + Size);
+            replayed.AtS = std::chrono::duration<double>(Clock::now() - start).count();
+            Out.push_back(std::move(replayed));
+        };
+        if(!replay.Start(FileName, Speed, OnPayload, [&finished]() { finished.set_value(); }))
+        {
+            return false;
+        }
+        finished.get_future().wait();
+        Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return true;
+    }
+
+    // Everything replayed as captured, and at Speed never early nor too late.  Returns the
+    // number of problems.
+    int CheckReplay(const char* pName, const std::vector<CaptureRecord>& Records, const std::vector<Replayed>& Replayed, double Speed)
+    {
+        int problems = 0;
+        if(Replayed.size() != Records.size())
+        {
+            std::printf("%s: %zu records replayed, %zu captured\n", pName, Replayed.size(), Records.size());
+            ++problems;
+        }
+
+        double worstLateMs = 0.0;
+        for(size_t i = 0; i < std::min(Replayed.size(), Records.size()); ++i)
+        {
+            if(!SameRecord(Replayed[i].Record, Records[i]))
+            {
+                std::printf("%s: record %zu differs\n", pName, i);
+                ++problems;
+                break;
+            }
+            if(Speed > 0.0)
+            {
+                double dueS = (Records[i].TimeNs - Records[0].TimeNs) / 1e9 / Speed;
+                worstLateMs = std::max(worstLateMs, (Replayed[i].AtS - dueS) * 1000.0);
+                if(Replayed[i].AtS < dueS)
+                {
+                    std::printf("%s: record %zu %.3fms early\n", pName, i, (dueS - Replayed[i].AtS) * 1000.0);
+                    ++problems;
+                    break;
+                }
+            }
+        }
+        if(Speed > 0.0)
+        {
+            std::printf("%s: worst %.3fms late\n", pName, worstLateMs);
+            if(worstLateMs > MAX_LATE_MS)
+            {
+                ++problems;
+            }
+        }
+        return problems;
+    }
+
+    // Decodes the stream packets per device as NordicCentral does, skipping sync replies
+    int CheckDecode(const std::vector<Replayed>& Replayed, const std::vector<std::vector<IMUSample>>& Samples)
+    {
+        int problems = 0;
+        std::vector<StreamDecoder> decoders(DEVICES);
+        std::vector<size_t> decoded(DEVICES, 0);
+        IMUSample buffer[StreamDecoder::MAX_PACKET_SAMPLES];
+        for(const auto& replayed : Replayed)
+        {
+            const CaptureRecord& record = replayed.Record;
+            if(record.Characteristic != NORDIC_BLINKY_IMU_CHAR_UUID || record.Payload.empty() ||
+               record.Payload[0] != static_cast<uint8_t>(PACKET_TYPE::SAMPLES))
+            {
+                continue;
+            }
+
+            size_t count = decoders[record.Device].Decode(record.Payload.data(), record.Payload.size(), buffer);
+            for(size_t i = 0; i < count; ++i)
+            {
+                size_t index = decoded[record.Device]++;
+                if(index >= Samples[record.Device].size() || !SameSample(buffer[i], Samples[record.Device][index]))
+                {
+                    std::printf("Device %u sample %zu decoded wrong\n", record.Device, index);
+                    return problems + 1;
+                }
+            }
+        }
+
+        for(int device = 0; device < DEVICES; ++device)
+        {
+            if(decoded[device] != Samples[device].size() || decoders[device].PacketsLost() != 0 || decoders[device].PacketsMalformed() != 0)
+            {
+                std::printf("Device %d: %zu of %zu samples decoded, %llu packets lost, %llu malformed\n", device, decoded[device],
+                            Samples[device].size(), static_cast<unsigned long long>(decoders[device].PacketsLost()),
+                            static_cast<unsigned long long>(decoders[device].PacketsMalformed()));
+                ++problems;
+            }
+        }
+        return problems;
+    }
+
+    // The same records written as a version 1 file, which has no device IDs
+    bool WriteVersion1(const std::string& FileName, const std::vector<CaptureRecord>& Records)
+    {
+        std::ofstream file(FileName, std::ios::binary | std::ios::trunc);
+        auto Put = [&file](uint64_t Value, size_t Size)
+        {
+            for(size_t i = 0; i < Size; ++i)
+            {
+                file.put(static_cast<char>(Value >> (8 * i)));
+            }
+        };
+        file.write(Capture::MAGIC, sizeof(Capture::MAGIC));
+        Put(1, 2);
+        for(const auto& record : Records)
+        {
+            Put(record.TimeNs, 8);
+            Put(record.Characteristic, 2);
+            Put(record.Payload.size(), 2);
+            file.write(reinterpret_cast<const char*>(record.Payload.data()), static_cast<std::streamsize>(record.Payload.size()));
+        }
+        return static_cast<bool>(file);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double speed = argc > 1 ? std::atof(argv[1]) : 4.0;
+    std::string fileName = argc > 2 ? argv[2] : "ReplayCheck.imu4ucap";
+    if(!(speed > 0.0))
+    {
+        std::fprintf(stderr, "Speed must be above 0\n");
+        return 1;
+    }
+
+    std::vector<CaptureRecord> records;
+    std::vector<std::vector<IMUSample>> samples;
+    MakeFixture(records, samples);
+
+    CaptureWriter writer;
+    bool bWritten = writer.Open(fileName);
+    for(const auto& record : records)
+    {
+        bWritten = bWritten && writer.Write(record.TimeNs, record.Device, record.Characteristic, record.Payload.data(), record.Payload.size());
+    }
+    writer.Close();
+    if(!bWritten)
+    {
+        std::fprintf(stderr, "Can't write %s\n", fileName.c_str());
+        std::remove(fileName.c_str());
+        return 1;
+    }
+    std::printf("Fixture: %zu records from %d devices over %.1fs, %zu samples each\n", records.size(), DEVICES, SECONDS, samples[0].size());
+
+    int problems = 0;
+    std::vector<Replayed> replayed;
+    double seconds = 0.0;
+    if(!Replay(fileName, ReplaySource::MAX_SPEED, replayed, seconds))
+    {
+        std::fprintf(stderr, "Can't read %s\n", fileName.c_str());
+        std::remove(fileName.c_str());
+        return 1;
+    }
+    std::printf("Max speed: %.3fs\n", seconds);
+    problems += CheckReplay("Max speed", records, replayed, ReplaySource::MAX_SPEED);
+    problems += CheckDecode(replayed, samples);
+
+    if(!Replay(fileName, speed, replayed, seconds))
+    {
+        std::fprintf(stderr, "Can't read %s\n", fileName.c_str());
+        std::remove(fileName.c_str());
+        return 1;
+    }
+    std::printf("%gx: %.3fs for %.3fs of capture\n", speed, seconds, (records.back().TimeNs - records.front().TimeNs) / 1e9);
+    problems += CheckReplay("Paced", records, replayed, speed);
+
+    // Version 1: the same, all from device 0
+    std::vector<CaptureRecord> version1 = records;
+    for(auto& record : version1)
+    {
+        record.Device = 0;
+    }
+    if(!WriteVersion1(fileName, records) || !Replay(fileName, ReplaySource::MAX_SPEED, replayed, seconds))
+    {
+        std::fprintf(stderr, "Can't write %s\n", fileName.c_str());
+        ++problems;
+    }
+    else
+    {
+        problems += CheckReplay("Version 1", version1, replayed, ReplaySource::MAX_SPEED);
+    }
+    std::remove(fileName.c_str());
+
+    std::printf("%s\n", problems == 0 ? "OK" : "FAILED");
+    return problems == 0 ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+# Accuracy, throughput and steady state allocations of SensorResampler (see QtApp/SensorResampler.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SensorResampler.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SensorResampler.cpp
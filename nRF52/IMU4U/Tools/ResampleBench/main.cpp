@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "SensorResampler.h"
+
+// Feeds SensorResampler a synthetic device whose accel/mag and gyro are read at different
+// rates and out of step, as the FXOS8700 and FXAS21002C are, with every sensor following
+// a known sine wave:
+//   ResampleBench [frame rate Hz] [gyro Hz] [accel/mag Hz] [seconds]
+// For linear and cubic interpolation it reports how far the frames are from the true
+// signals, against taking each IMUSample as if both halves were read at its gyro time,
+// then how fast frames are made.  Heap allocations while resampling are counted, and
+// there shouldn't be any.
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;
+    constexpr double TWO_PI = 6.28318530717958647692;
+    constexpr double SIGNAL_HZ = 3.0;
+    constexpr double AMPLITUDE_LSB = 4000.0;
+    constexpr double ACCEL_MAG_DELAY_S = 0.0013;   // The accel/mag isn't read in step with the gyro
+    constexpr uint32_t FIRST_TICKS = 0xFFFF0000;   // Wraps two seconds in
+    constexpr size_t MAX_FRAMES = 64;
+    constexpr int    THROUGHPUT_REPEATS = 20;
+
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic<uint64_t> gAllocations{0};
+
+    // Channel 0-2 accel, 3-5 mag, 6-8 gyro, each at its own phase
+    double Signal(int Channel, double Seconds)
+    {
+        return AMPLITUDE_LSB * std::sin(TWO_PI * SIGNAL_HZ * Seconds + Channel * 0.7);
+    }
+
+    double Seconds(uint32_t Ticks)
+    {
+        return static_cast<uint32_t>(Ticks - FIRST_TICKS) / TICKS_PER_SECOND;
+    }
+
+    int16_t Reading(int Channel, uint32_t Ticks)
+    {
+        return static_cast<int16_t>(std::lround(Signal(Channel, Seconds(Ticks))));
+    }
+
+    // What the firmware sends: a sample whenever either sensor has a new reading, holding
+    // the latest of both
+    std::vector<IMUSample> MakeSamples(double GyroHz, double AccelMagHz, double Duration)
+    {
+        std::vector<IMUSample> samples;
+        IMUSample sample = {};
+        uint64_t gyroIndex = 0;
+        uint64_t accelMagIndex = 0;
+        bool bHaveGyro = false;
+        bool bHaveAccelMag = false;
+        for(;;)
+        {
+            double gyroTime = gyroIndex / GyroHz;
+            double accelMagTime = accelMagIndex / AccelMagHz + ACCEL_MAG_DELAY_S;
+            double time = std::min(gyroTime, accelMagTime);
+            if(time > Duration)
+            {
+                break;
+            }
+
+            uint32_t ticks = FIRST_TICKS + static_cast<uint32_t>(time * TICKS_PER_SECOND);
+            if(gyroTime <= accelMagTime)
+            {
+                sample.GyroTime = ticks;
+                sample.Data.Gyro.X = Reading(6, ticks);
+                sample.Data.Gyro.Y = Reading(7, ticks);
+                sample.Data.Gyro.Z = Reading(8, ticks);
+                bHaveGyro = true;
+                ++gyroIndex;
+            }
+            else
+            {
+                sample.AccelMagTime = ticks;
+                sample.Data.Accel.X = Reading(0, ticks);
+                sample.Data.Accel.Y = Reading(1, ticks);
+                sample.Data.Accel.Z = Reading(2, ticks);
+                sample.Data.Mag.X = Reading(3, ticks);
+                sample.Data.Mag.Y = Reading(4, ticks);
+                sample.Data.Mag.Z = Reading(5, ticks);
+                bHaveAccelMag = true;
+                ++accelMagIndex;
+            }
+            if(bHaveGyro && bHaveAccelMag)
+            {
+                samples.push_back(sample);
+            }
+        }
+        return samples;
+    }
+
+    double FrameErrorSquared(const ResampledFrame& Frame)
+    {
+        double t = Seconds(Frame.Time);
+        double sum = 0.0;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            sum += std::pow(Frame.Accel[axis] - Signal(axis, t), 2);
+            sum += std::pow(Frame.Mag[axis] - Signal(3 + axis, t), 2);
+            sum += std::pow(Frame.Gyro[axis] - Signal(6 + axis, t), 2);
+        }
+        return sum;
+    }
+
+    // Everything in a sample taken to be from its gyro time, as without resampling
+    double SampleErrorSquared(const IMUSample& Sample)
+    {
+        double t = Seconds(Sample.GyroTime);
+        const IMUData& data = Sample.Data;
+        const int16_t values[9] = { data.Accel.X, data.Accel.Y, data.Accel.Z, data.Mag.X, data.Mag.Y, data.Mag.Z,
+                                    data.Gyro.X, data.Gyro.Y, data.Gyro.Z };
+        double sum = 0.0;
+        for(int channel = 0; channel < 9; ++channel)
+        {
+            sum += std::pow(values[channel] - Signal(channel, t), 2);
+        }
+        return sum;
+    }
+}
+
+void* operator new(size_t Size)
+{
+    ++gAllocations;
+    void* p = std::malloc(Size ? Size : 1);
+    if(!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    double frameHz = argc > 1 ? std::atof(argv[1]) : 200.0;
+    double gyroHz = argc > 2 ? std::atof(argv[2]) : 200.0;
+    double accelMagHz = argc > 3 ? std::atof(argv[3]) : 100.0;
+    double seconds = argc > 4 ? std::atof(argv[4]) : 60.0;
+
+    std::vector<IMUSample> samples = MakeSamples(gyroHz, accelMagHz, seconds);
+    std::printf("%zu samples: gyro at %.0f Hz, accel/mag at %.0f Hz, %.1f ms apart, resampled to %.0f Hz\n",
+                samples.size(), gyroHz, accelMagHz, ACCEL_MAG_DELAY_S * 1000.0, frameHz);
+
+    double sampleSquared = 0.0;
+    for(const IMUSample& sample : samples)
+    {
+        sampleSquared += SampleErrorSquared(sample);
+    }
+    std::printf("  %-10s RMS error %8.2f LSB over %zu samples\n", "None", std::sqrt(sampleSquared / (9.0 * samples.size())), samples.size());
+
+    static ResampledFrame frames[MAX_FRAMES];
+    bool bPassed = true;
+    for(auto interpolation : { SensorResampler::INTERPOLATION::LINEAR, SensorResampler::INTERPOLATION::CUBIC })
+    {
+        const char* name = interpolation == SensorResampler::INTERPOLATION::LINEAR ? "Linear" : "Cubic";
+
+        SensorResampler resampler(frameHz, interpolation);
+        double squared = 0.0;
+        uint64_t frameCount = 0;
+        for(const IMUSample& sample : samples)
+        {
+            size_t count = resampler.Add(sample, frames, MAX_FRAMES);
+            for(size_t i = 0; i < count; ++i)
+            {
+                squared += FrameErrorSquared(frames[i]);
+            }
+            frameCount += count;
+        }
+        std::printf("  %-10s RMS error %8.2f LSB over %llu frames, %llu restarts\n", name, std::sqrt(squared / (9.0 * frameCount)),
+                    static_cast<unsigned long long>(frameCount), static_cast<unsigned long long>(resampler.Restarts()));
+
+        uint64_t allocationsBefore = gAllocations;
+        Clock::time_point start = Clock::now();
+        float checksum = 0.0f;
+        for(int repeat = 0; repeat < THROUGHPUT_REPEATS; ++repeat)
+        {
+            resampler.Reset();
+            for(const IMUSample& sample : samples)
+            {
+                size_t count = resampler.Add(sample, frames, MAX_FRAMES);
+                if(count > 0)
+                {
+                    checksum += frames[count - 1].Gyro[0];
+                }
+            }
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        uint64_t allocations = gAllocations - allocationsBefore;
+        std::printf("  %-10s %.1f M samples/s, %.1f M frames/s, %llu heap allocations (checksum %.0f)\n", name,
+                    THROUGHPUT_REPEATS * samples.size() / elapsed / 1e6, THROUGHPUT_REPEATS * frameCount / elapsed / 1e6,
+                    static_cast<unsigned long long>(allocations), checksum);
+        bPassed = bPassed && allocations == 0 && frameCount > 0;
+    }
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+# Load test of SampleServer with many clients over 127.0.0.1, some too slow to keep up
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SPSCRing.h \
+              $$APP_DIR/SampleMerger.h \
+              $$APP_DIR/SampleServer.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SampleServer.cpp
+
+unix:LIBS  += -lpthread
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "SampleServer.h"
+
+// Load test of SampleServer over 127.0.0.1:
+//   ServerBench [clients] [slow clients] [seconds] [samples per second]
+// Samples are published in blocks of eight, as BLE packets bring them, while the clients
+// read the stream.  The slow ones have small receive buffers and only read a little every
+// SLOW_READ_INTERVAL, so the server has to drop frames for them.  Exits with 1 if 99% of
+// publishes don't finish within MAX_PUBLISH_US, if anything is garbled, or if a client
+// that keeps up misses any frames.
+
+namespace
+{
+    constexpr size_t PACKET_SAMPLES = 8;
+    constexpr uint16_t DEVICES = 32;
+    constexpr auto   SLOW_READ_INTERVAL = std::chrono::milliseconds(100);
+    constexpr size_t SLOW_READ_BYTES = 16384;
+    constexpr int    SLOW_RECEIVE_BUFFER = 4096;
+    constexpr double MAX_PUBLISH_US = 50.0;
+    constexpr auto   DRAIN_TIME = std::chrono::milliseconds(500);
+
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    uint32_t Get32(const uint8_t* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    uint64_t Get64(const uint8_t* p)
+    {
+        return Get32(p) | (static_cast<uint64_t>(Get32(p + 4)) << 32);
+    }
+
+    struct TestClient
+    {
+        int                  Socket = -1;
+        bool                 bSlow = false;
+        std::vector<uint8_t> Buffer;
+        bool                 bGreeted = false;
+        bool                 bHaveFrame = false;
+        uint32_t             NextFrame = 0;
+        uint64_t             Frames = 0;
+        uint64_t             FramesMissed = 0;
+        uint64_t             Samples = 0;
+        uint64_t             Garbled = 0;
+        Clock::time_point    NextRead;
+
+        // Takes every whole frame out of Buffer
+        void Parse(std::vector<double>& LatenciesUs)
+        {
+            size_t offset = 0;
+            if(!bGreeted && Buffer.size() >= SampleStream::GREETING_SIZE)
+            {
+                bGreeted = true;
+                if(std::memcmp(Buffer.data(), SampleStream::MAGIC, sizeof(SampleStream::MAGIC)) != 0)
+                {
+                    ++Garbled;
+                }
+                offset = SampleStream::GREETING_SIZE;
+            }
+            uint64_t now = Now();
+            while(bGreeted && Buffer.size() - offset >= SampleStream::FRAME_HEADER_SIZE)
+            {
+                const uint8_t* p = Buffer.data() + offset;
+                size_t size = Get32(p) + sizeof(uint32_t);
+                if(Buffer.size() - offset < size)
+                {
+                    break;
+                }
+
+                uint32_t number = Get32(p + 4);
+                size_t count = p[8] | (p[9] << 8);
+                if(size != SampleStream::FRAME_HEADER_SIZE + count * SampleStream::SAMPLE_SIZE)
+                {
+                    ++Garbled;
+                }
+                if(bHaveFrame && number != NextFrame)
+                {
+                    FramesMissed += number - NextFrame;
+                }
+                bHaveFrame = true;
+                NextFrame = number + 1;
+                ++Frames;
+                Samples += count;
+
+                const uint8_t* pSample = p + SampleStream::FRAME_HEADER_SIZE;
+                for(size_t i = 0; i < count; ++i, pSample += SampleStream::SAMPLE_SIZE)
+                {
+                    if(Get32(pSample + 10) != ~Get32(pSample + 14))
+                    {
+                        ++Garbled;
+                    }
+                }
+                if(!bSlow && count > 0)
+                {
+                    LatenciesUs.push_back((now - Get64(p + SampleStream::FRAME_HEADER_SIZE)) / 1e3);
+                }
+                offset += size;
+            }
+            Buffer.erase(Buffer.begin(), Buffer.begin() + offset);
+        }
+    };
+
+    int Connect(uint16_t Port, bool bSlow)
+    {
+        int s = socket(AF_INET, SOCK_STREAM, 0);
+        if(bSlow)
+        {
+            setsockopt(s, SOL_SOCKET, SO_RCVBUF, &SLOW_RECEIVE_BUFFER, sizeof(SLOW_RECEIVE_BUFFER));
+        }
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(Port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            close(s);
+            return -1;
+        }
+        return s;
+    }
+
+    double Percentile(std::vector<double>& Values, double Fraction)
+    {
+        if(Values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(Values.begin(), Values.end());
+        return Values[std::min(Values.size() - 1, static_cast<size_t>(Values.size() * Fraction))];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t clientCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    size_t slowCount = std::min(clientCount, argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10);
+    double seconds = argc > 3 ? std::atof(argv[3]) : 2.0;
+    double rate = argc > 4 ? std::atof(argv[4]) : 32000.0;
+
+    SampleServer server;
+    if(!server.Open(0))
+    {
+        std::fprintf(stderr, "Can't listen on 127.0.0.1\n");
+        return 1;
+    }
+
+    std::vector<TestClient> clients(clientCount);
+    for(size_t i = 0; i < clientCount; ++i)
+    {
+        clients[i].bSlow = i < slowCount;
+        clients[i].Socket = Connect(server.Port(), clients[i].bSlow);
+        if(clients[i].Socket < 0)
+        {
+            std::fprintf(stderr, "Can't connect client %zu\n", i);
+            return 1;
+        }
+    }
+    while(server.Clients() < clientCount)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // Publishes as the decode thread would, timing every call
+    std::atomic<bool> bPublishing{true};
+    std::vector<double> publishUs;
+    uint64_t published = 0;
+    std::thread producer([&]()
+    {
+        IMUSample samples[PACKET_SAMPLES] = {};
+        uint64_t times[PACKET_SAMPLES];
+        uint32_t number = 0;
+        auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(PACKET_SAMPLES / rate));
+        Clock::time_point start = Clock::now();
+        Clock::time_point next = start;
+        for(uint16_t device = 0; next - start < std::chrono::duration<double>(seconds); device = (device + 1) % DEVICES)
+        {
+            next += interval;
+            std::this_thread::sleep_until(next);
+            uint64_t now = Now();
+            for(size_t i = 0; i < PACKET_SAMPLES; ++i, ++number)
+            {
+                samples[i].GyroTime = number;
+                samples[i].AccelMagTime = ~number;
+                times[i] = now;
+            }
+            Clock::time_point before = Clock::now();
+            server.Publish(device, samples, times, PACKET_SAMPLES);
+            publishUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+            published += PACKET_SAMPLES;
+        }
+        bPublishing = false;
+    });
+
+    std::vector<double> latenciesUs;
+    std::vector<pollfd> fds(clientCount);
+    std::vector<uint8_t> chunk(65536);
+    Clock::time_point drainUntil = Clock::time_point::max();
+    while(Clock::now() < drainUntil)
+    {
+        if(!bPublishing && drainUntil == Clock::time_point::max())
+        {
+            drainUntil = Clock::now() + DRAIN_TIME;
+        }
+
+        Clock::time_point now = Clock::now();
+        for(size_t i = 0; i < clientCount; ++i)
+        {
+            bool bRead = !clients[i].bSlow || now >= clients[i].NextRead;
+            fds[i] = { bRead ? clients[i].Socket : -1, POLLIN, 0 };
+        }
+        poll(fds.data(), fds.size(), 10);
+
+        for(size_t i = 0; i < clientCount; ++i)
+        {
+            TestClient& client = clients[i];
+            if(!(fds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            size_t most = client.bSlow ? SLOW_READ_BYTES : chunk.size();
+            ssize_t size = recv(client.Socket, chunk.data(), most, 0);
+            if(size > 0)
+            {
+                client.Buffer.insert(client.Buffer.end(), chunk.data(), chunk.data() + size);
+                client.Parse(latenciesUs);
+            }
+            client.NextRead = now + SLOW_READ_INTERVAL;
+        }
+    }
+    producer.join();
+
+    uint64_t fastFrames = 0, fastMissed = 0, slowFrames = 0, slowMissed = 0, garbled = 0;
+    for(const TestClient& client : clients)
+    {
+        (client.bSlow ? slowFrames : fastFrames) += client.Frames;
+        (client.bSlow ? slowMissed : fastMissed) += client.FramesMissed;
+        garbled += client.Garbled;
+        close(client.Socket);
+    }
+    size_t fastCount = clientCount - slowCount;
+
+    double publishP99Us = Percentile(publishUs, 0.99);
+    std::printf("%zu clients (%zu slow), %.0f samples/s for %.1fs: published %llu samples\n",
+                clientCount, slowCount, rate, seconds, static_cast<unsigned long long>(published));
+    std::printf("  publish took median %.1fus 99%% %.1fus max %.1fus\n", Percentile(publishUs, 0.5), publishP99Us, Percentile(publishUs, 1.0));
+    std::printf("  server sent %llu frames, dropped %llu for slow clients, %llu samples dropped before framing\n",
+                static_cast<unsigned long long>(server.FramesSent()), static_cast<unsigned long long>(server.FramesDropped()),
+                static_cast<unsigned long long>(server.SamplesDropped()));
+    std::printf("  clients keeping up: %.0f frames each, %llu missed, latency median %.0fus 99%% %.0fus max %.0fus\n",
+                fastCount ? static_cast<double>(fastFrames) / fastCount : 0.0, static_cast<unsigned long long>(fastMissed),
+                Percentile(latenciesUs, 0.5), Percentile(latenciesUs, 0.99), Percentile(latenciesUs, 1.0));
+    std::printf("  slow clients: %.0f frames each, %.0f missed each\n", slowCount ? static_cast<double>(slowFrames) / slowCount : 0.0,
+                slowCount ? static_cast<double>(slowMissed) / slowCount : 0.0);
+    std::printf("  garbled %llu\n", static_cast<unsigned long long>(garbled));
+    server.Close();
+
+    bool bPassed = publishP99Us <= MAX_PUBLISH_US && garbled == 0 && fastMissed == 0 && server.SamplesDropped() == 0;
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,18 @@
+# Throughput and latency of SamplePublisher to SampleSubscribers in other processes
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/IMUData.h \
+              $$APP_DIR/SamplePublisher.h \
+              $$APP_DIR/SampleSubscriber.h \
+              $$APP_DIR/SharedSampleRing.h
+SOURCES     = main.cpp \
+              $$APP_DIR/SamplePublisher.cpp \
+              $$APP_DIR/SampleSubscriber.cpp
+
+unix:!macx:LIBS += -lrt
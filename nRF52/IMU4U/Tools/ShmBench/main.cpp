@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "SamplePublisher.h"
+#include "SampleSubscriber.h"
+
+// Publishes samples to shared memory from this process and reads them back in others:
+//   ShmBench [subscriber processes] [seconds per test]
+// First the publisher goes flat out, to see how fast samples can be published and how
+// many each subscriber keeps up with.  Then it publishes a block every millisecond, about
+// 32 devices at 250Hz, stamped with the time, and each subscriber times how long blocks
+// take to reach it.  Exits with 1 if a subscriber misses or mangles anything in the
+// second test, where it should have no trouble keeping up.
+
+namespace
+{
+    constexpr size_t FLAT_OUT_BLOCK = 32;
+    constexpr size_t PACED_BLOCK = 8;
+    constexpr auto   PACED_INTERVAL = std::chrono::milliseconds(1);
+    constexpr size_t READ_SIZE = 1024;
+    constexpr size_t MAX_SUBSCRIBERS = 64;
+    constexpr size_t CAPACITY = SharedRing::DEFAULT_CAPACITY;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Written by each subscriber process, in memory shared with the publisher
+    struct SubscriberResult
+    {
+        uint64_t Read;
+        uint64_t Missed;
+        uint64_t Mangled;      // Not the sample the publisher put at that point
+        double   Seconds;
+        double   MedianUs;     // Block latencies, in the paced test
+        double   P99Us;
+        double   MaxUs;
+    };
+
+    struct Shared
+    {
+        std::atomic<uint32_t> SubscribersReady;
+        SubscriberResult      Results[MAX_SUBSCRIBERS];
+    };
+
+    uint64_t Now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    // The publisher numbers its samples in GyroTime, so subscribers can check them
+    void Subscribe(const std::string& Name, Shared& Shared, SubscriberResult& Result, bool bTimeBlocks)
+    {
+        SampleSubscriber subscriber;
+        bool bOpened = subscriber.Open(Name);
+        Shared.SubscribersReady.fetch_add(1);
+        if(!bOpened)
+        {
+            return;
+        }
+
+        std::vector<SharedSample> samples(READ_SIZE);
+        std::vector<double> latencies;
+        uint64_t mangled = 0;
+        Clock::time_point start = Clock::now();
+        Clock::time_point end = start;
+        for(;;)
+        {
+            bool bOpen = subscriber.PublisherOpen();
+            size_t count = subscriber.Read(samples.data(), samples.size());
+            if(count == 0)
+            {
+                if(!bOpen)
+                {
+                    break;
+                }
+
+                // Polling, but letting the publisher run if it shares our core
+                std::this_thread::yield();
+                continue;
+            }
+
+            uint64_t now = Now();
+            end = Clock::now();
+            for(size_t i = 0; i < count; ++i)
+            {
+                const SharedSample& sample = samples[i];
+                if(sample.Sample.AccelMagTime != ~sample.Sample.GyroTime)
+                {
+                    ++mangled;
+                }
+                if(bTimeBlocks && sample.Sample.GyroTime % PACED_BLOCK == 0)
+                {
+                    latencies.push_back((now - sample.Time) / 1e3);
+                }
+            }
+        }
+
+        Result.Read = subscriber.SamplesRead();
+        Result.Missed = subscriber.SamplesMissed();
+        Result.Mangled = mangled;
+        Result.Seconds = std::chrono::duration<double>(end - start).count();
+        if(!latencies.empty())
+        {
+            std::sort(latencies.begin(), latencies.end());
+            Result.MedianUs = latencies[latencies.size() / 2];
+            Result.P99Us = latencies[latencies.size() * 99 / 100];
+            Result.MaxUs = latencies.back();
+        }
+    }
+
+    // Runs Subscribers subscriber processes against Publish(), which is handed the open
+    // publisher.  Returns false if any subscriber couldn't be started.
+    template<typename PublishFunction>
+    bool Run(const std::string& Name, Shared& Shared, size_t Subscribers, bool bTimeBlocks, PublishFunction Publish)
+    {
+        SamplePublisher publisher;
+        if(!publisher.Open(Name, CAPACITY))
+        {
+            std::fprintf(stderr, "Can't open shared memory %s\n", Name.c_str());
+            return false;
+        }
+
+        Shared.SubscribersReady = 0;
+        std::vector<pid_t> children;
+        for(size_t i = 0; i < Subscribers; ++i)
+        {
+            Shared.Results[i] = SubscriberResult{};
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                Subscribe(Name, Shared, Shared.Results[i], bTimeBlocks);
+                _exit(0);
+            }
+            if(pid < 0)
+            {
+                return false;
+            }
+            children.push_back(pid);
+        }
+        while(Shared.SubscribersReady < Subscribers)
+        {
+            std::this_thread::yield();
+        }
+
+        Publish(publisher);
+        publisher.Close();
+        for(pid_t child : children)
+        {
+            waitpid(child, nullptr, 0);
+        }
+        return true;
+    }
+
+    void Fill(IMUSample* pSamples, uint64_t* pTimes, size_t Count, uint32_t& Number)
+    {
+        uint64_t now = Now();
+        for(size_t i = 0; i < Count; ++i)
+        {
+            pSamples[i].GyroTime = Number;
+            pSamples[i].AccelMagTime = ~Number;
+            pTimes[i] = now;
+            ++Number;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t subscribers = std::min<size_t>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4, MAX_SUBSCRIBERS);
+    double seconds = argc > 2 ? std::atof(argv[2]) : 1.0;
+    std::string name = "/IMU4U-ShmBench-" + std::to_string(getpid());
+
+    void* pMapping = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(pMapping == MAP_FAILED)
+    {
+        return 1;
+    }
+    Shared& shared = *new(pMapping) Shared;
+
+    IMUSample samples[FLAT_OUT_BLOCK] = {};
+    uint64_t times[FLAT_OUT_BLOCK];
+    uint32_t number = 0;
+    double publishSeconds = 0.0;
+    uint64_t published = 0;
+    bool bRan = Run(name, shared, subscribers, false, [&](SamplePublisher& Publisher)
+    {
+        Clock::time_point start = Clock::now();
+        while(publishSeconds < seconds)
+        {
+            for(int block = 0; block < 256; ++block)
+            {
+                Fill(samples, times, FLAT_OUT_BLOCK, number);
+                Publisher.Publish(0, samples, times, FLAT_OUT_BLOCK);
+            }
+            publishSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        published = Publisher.Published();
+    });
+    if(!bRan)
+    {
+        return 1;
+    }
+
+    std::printf("Flat out, %zu samples per block: published %.1f M samples/s\n", FLAT_OUT_BLOCK, published / publishSeconds / 1e6);
+    for(size_t i = 0; i < subscribers; ++i)
+    {
+        const SubscriberResult& result = shared.Results[i];
+        std::printf("  subscriber %zu read %.1f M samples/s, missed %.1f%%, mangled %llu\n", i, result.Read / std::max(result.Seconds, 1e-9) / 1e6,
+                    100.0 * result.Missed / std::max<uint64_t>(result.Read + result.Missed, 1),
+                    static_cast<unsigned long long>(result.Mangled));
+    }
+
+    number = 0;
+    bRan = Run(name, shared, subscribers, true, [&](SamplePublisher& Publisher)
+    {
+        Clock::time_point start = Clock::now();
+        Clock::time_point next = start;
+        while(std::chrono::duration<double>(next - start).count() < seconds)
+        {
+            next += PACED_INTERVAL;
+            std::this_thread::sleep_until(next);
+            Fill(samples, times, PACED_BLOCK, number);
+            Publisher.Publish(0, samples, times, PACED_BLOCK);
+        }
+        published = Publisher.Published();
+    });
+    if(!bRan)
+    {
+        return 1;
+    }
+
+    std::printf("Every %lldms, %zu samples per block: published %llu samples\n", static_cast<long long>(PACED_INTERVAL.count()),
+                PACED_BLOCK, static_cast<unsigned long long>(published));
+    bool bPassed = true;
+    for(size_t i = 0; i < subscribers; ++i)
+    {
+        const SubscriberResult& result = shared.Results[i];
+        std::printf("  subscriber %zu read %llu, missed %llu, mangled %llu, latency median %.1fus 99%% %.1fus max %.1fus\n", i,
+                    static_cast<unsigned long long>(result.Read), static_cast<unsigned long long>(result.Missed),
+                    static_cast<unsigned long long>(result.Mangled), result.MedianUs, result.P99Us, result.MaxUs);
+        bPassed = bPassed && result.Read == published && result.Mangled == 0;
+    }
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+# Throughput and latency of each of the host's processing stages, run as a StageGraph on synthetic packets (see QtApp/ProcessingStages.h)
+
+TEMPLATE    = app
+CONFIG     += console c++14
+CONFIG     -= qt app_bundle
+
+APP_DIR     = ../../QtApp
+INCLUDEPATH += $$APP_DIR
+
+HEADERS     = $$APP_DIR/FFTKernel.inl \
+              $$APP_DIR/FusionEngine.h \
+              $$APP_DIR/FusionKernel.inl \
+              $$APP_DIR/IMUData.h \
+              $$APP_DIR/MadgwickFilter.h \
+              $$APP_DIR/ProcessingStages.h \
+              $$APP_DIR/Quaternion.h \
+              $$APP_DIR/RealFFT.h \
+              $$APP_DIR/SPSCRing.h \
+              $$APP_DIR/SampleArchive.h \
+              $$APP_DIR/SampleCodec.h \
+              $$APP_DIR/SampleMerger.h \
+              $$APP_DIR/SensorResampler.h \
+              $$APP_DIR/SimdSupport.h \
+              $$APP_DIR/SpectrumAnalyzer.h \
+              $$APP_DIR/StageGraph.h \
+              $$APP_DIR/StreamDecoder.h \
+              $$APP_DIR/UnitConverter.h \
+              $$APP_DIR/WorkStealingPool.h
+SOURCES     = main.cpp \
+              $$APP_DIR/FusionEngine.cpp \
+              $$APP_DIR/MadgwickFilter.cpp \
+              $$APP_DIR/ProcessingStages.cpp \
+              $$APP_DIR/RealFFT.cpp \
+              $$APP_DIR/SampleArchive.cpp \
+              $$APP_DIR/SampleCodec.cpp \
+              $$APP_DIR/SampleMerger.cpp \
+              $$APP_DIR/SensorResampler.cpp \
+              $$APP_DIR/SimdSupport.cpp \
+              $$APP_DIR/SpectrumAnalyzer.cpp \
+              $$APP_DIR/StageGraph.cpp \
+              $$APP_DIR/StreamDecoder.cpp \
+              $$APP_DIR/UnitConverter.cpp \
+              $$APP_DIR/WorkStealingPool.cpp
+
+unix:LIBS  += -lpthread
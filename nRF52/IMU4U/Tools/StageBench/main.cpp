@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ProcessingStages.h"
+#include "SampleCodec.h"
+#include "StageGraph.h"
+
+// Runs synthetic stream packets through the host's stages, as Window would with a recording
+// going, then prints what each stage managed:
+//   StageBench [devices] [seconds] [rate Hz] [threads] [file]
+// Each device's sensors stop for GAP_S halfway through.  Exits with 1 if a stage lost or
+// made up items along the way, or a device's frames didn't mark the restart after the gap.
+
+namespace
+{
+    constexpr double TICKS_PER_SECOND = 32768.0;
+    constexpr double FILTER_RATE_HZ = 100.0;
+    constexpr size_t PACKET_SIZE = DevicePacket::MAX_SIZE;
+    constexpr size_t PUSH_BATCH = 64;              // Packets pushed at a time
+    constexpr double GAP_S = 3.0;                  // Longer than SensorResampler::MAX_GAP_S
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::duration Duration)
+    {
+        return std::chrono::duration<double>(Duration).count();
+    }
+
+    // A device turning slowly and buzzing at 12Hz, with some sensor noise
+    IMUSample MakeSample(uint64_t Index, uint16_t Device, double RateHz, std::mt19937& Random)
+    {
+        std::normal_distribution<double> noise(0.0, 8.0);
+        double t = Index / RateHz;
+        double angle = 0.5 * std::sin(0.3 * t + Device);
+        double buzz = 400.0 * std::sin(6.28318530717958647692 * 12.0 * t);
+
+        IMUSample sample = {};
+        sample.GyroTime = static_cast<uint32_t>(static_cast<uint64_t>(t * TICKS_PER_SECOND));
+        sample.AccelMagTime = sample.GyroTime + 3;
+        sample.Data.Accel.X = static_cast<int16_t>(buzz + noise(Random));
+        sample.Data.Accel.Y = static_cast<int16_t>(16384 * std::sin(angle) + noise(Random));
+        sample.Data.Accel.Z = static_cast<int16_t>(16384 * std::cos(angle) + noise(Random));
+        sample.Data.Gyro.X = static_cast<int16_t>(1000 * std::cos(0.3 * t + Device) + noise(Random));
+        sample.Data.Gyro.Y = static_cast<int16_t>(noise(Random));
+        sample.Data.Gyro.Z = static_cast<int16_t>(noise(Random));
+        sample.Data.Mag.X = static_cast<int16_t>(300 + noise(Random));
+        sample.Data.Mag.Y = static_cast<int16_t>(-400 * std::sin(angle) + noise(Random));
+        sample.Data.Mag.Z = static_cast<int16_t>(-400 * std::cos(angle) + noise(Random));
+        return sample;
+    }
+
+    // Packs a device's samples as Firmware/StreamEncoder.c would, filling each packet
+    void MakePackets(uint16_t Device, const std::vector<IMUSample>& Samples, double RateHz, std::vector<DevicePacket>& Packets)
+    {
+        SampleCodec codec;
+        uint16_t sequence = 0;
+        size_t next = 0;
+        while(next < Samples.size())
+        {
+            DevicePacket packet;
+            packet.Device = Device;
+            packet.TimeNs = static_cast<uint64_t>(next / RateHz * 1e9);
+            size_t size = StreamDecoder::HEADER_SIZE;
+            size_t count = 0;
+
+            codec.Reset();
+            while(next < Samples.size() && count < StreamDecoder::MAX_PACKET_SAMPLES)
+            {
+                size_t length = codec.Encode(Samples[next], &packet.Bytes[size], PACKET_SIZE - size);
+                if(length == 0)
+                {
+                    break;
+                }
+                size += length;
+                ++count;
+                ++next;
+            }
+
+            packet.Bytes[0] = static_cast<uint8_t>(PACKET_TYPE::SAMPLES);
+            packet.Bytes[1] = static_cast<uint8_t>(count);
+            packet.Bytes[2] = static_cast<uint8_t>(sequence & 0xFF);
+            packet.Bytes[3] = static_cast<uint8_t>(sequence >> 8);
+            packet.Size = static_cast<uint16_t>(size);
+            ++sequence;
+            Packets.push_back(packet);
+        }
+    }
+
+    // Counts the frames of each device that say its resampler restarted
+    class RestartCounter : public Sink<DeviceFrame>
+    {
+        public:
+            explicit RestartCounter(size_t DeviceCount) : Stage("Restarts"), m_Restarts(DeviceCount)
+            {
+            }
+
+            uint64_t Restarts(size_t Device) const
+            {
+                return m_Restarts[Device];
+            }
+
+        protected:
+            void Process(const DeviceFrame* pFrames, size_t Count) override
+            {
+                for(size_t i = 0; i < Count; ++i)
+                {
+                    if(pFrames[i].bRestart)
+                    {
+                        ++m_Restarts[pFrames[i].Device];
+                    }
+                }
+            }
+
+        private:
+            std::vector<uint64_t> m_Restarts;
+    };
+
+    bool Check(const char* pWhat, uint64_t Got, uint64_t Expected)
+    {
+        if(Got == Expected)
+        {
+            return true;
+        }
+        std::printf("%s: %llu, expected %llu\n", pWhat, static_cast<unsigned long long>(Got), static_cast<unsigned long long>(Expected));
+        return false;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int devices = argc > 1 ? std::atoi(argv[1]) : 8;
+    double seconds = argc > 2 ? std::atof(argv[2]) : 60.0;
+    double rateHz = argc > 3 ? std::atof(argv[3]) : 1000.0;
+    int threads = argc > 4 ? std::atoi(argv[4]) : 4;
+    std::string fileName = argc > 5 ? argv[5] : "StageBench.imu4u";
+
+    uint64_t samplesPerDevice = static_cast<uint64_t>(seconds * rateHz);
+    std::mt19937 random(1);
+
+    // Packets from every device interleaved in the order they'd arrive, generated up front
+    // so only the graph is timed
+    std::vector<std::vector<DevicePacket>> devicePackets(devices);
+    for(int device = 0; device < devices; ++device)
+    {
+        std::vector<IMUSample> samples;
+        samples.reserve(samplesPerDevice);
+        for(uint64_t i = 0; i < samplesPerDevice; ++i)
+        {
+            uint64_t index = i < samplesPerDevice / 2 ? i : i + static_cast<uint64_t>(GAP_S * rateHz);
+            samples.push_back(MakeSample(index, static_cast<uint16_t>(device), rateHz, random));
+        }
+        MakePackets(static_cast<uint16_t>(device), samples, rateHz, devicePackets[device]);
+    }
+    std::vector<DevicePacket> packets;
+    for(size_t i = 0; ; ++i)
+    {
+        bool bAny = false;
+        for(const auto& device : devicePackets)
+        {
+            if(i < device.size())
+            {
+                packets.push_back(device[i]);
+                bAny = true;
+            }
+        }
+        if(!bAny)
+        {
+            break;
+        }
+    }
+    devicePackets.clear();
+
+    SampleArchiveWriter writer;
+    if(!writer.Open(fileName))
+    {
+        std::fprintf(stderr, "Can't write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    SpectrumAnalyzer::Settings spectrumSettings;
+    spectrumSettings.Size = 256;
+    spectrumSettings.Hop = 32;
+    spectrumSettings.RateHz = FILTER_RATE_HZ;
+    SpectrumAnalyzer analyzer(spectrumSettings);
+
+    uint64_t pushRetries = 0;
+    double elapsed = 0.0;
+    std::vector<StageStats> stats;
+    std::vector<uint64_t> deviceRestarts;
+    {
+        StageGraph graph(threads);
+        auto& input = graph.Add<Source<DevicePacket>>("Input");
+        auto& decoder = graph.Add<DecoderStage>(devices);
+        auto& recorder = graph.Add<RecorderStage>(writer);
+        auto& resampler = graph.Add<ResamplerStage>(devices, FILTER_RATE_HZ);
+        auto& calibration = graph.Add<CalibrationStage>(devices);
+        auto& fusion = graph.Add<FusionStage>(devices, FILTER_RATE_HZ);
+        auto& orientations = graph.Add<OrientationSink>(devices);
+        auto& spectrum = graph.Add<SpectrumSink>(analyzer, 0);
+        auto& restarts = graph.Add<RestartCounter>(devices);
+
+        graph.Connect(input, decoder, 1024);
+        graph.Connect(decoder, recorder);
+        graph.Connect(decoder, resampler);
+        graph.Connect(resampler, calibration);
+        graph.Connect(calibration, fusion);
+        graph.Connect(fusion, orientations);
+        graph.Connect(resampler, spectrum);
+        graph.Connect(resampler, restarts);
+
+        Clock::time_point start = Clock::now();
+        size_t next = 0;
+        while(next < packets.size())
+        {
+            size_t count = std::min(PUSH_BATCH, packets.size() - next);
+            size_t pushed = input.Push(&packets[next], count);
+            next += pushed;
+            if(pushed < count)
+            {
+                ++pushRetries;
+                std::this_thread::yield();
+            }
+        }
+        graph.Wait();
+        elapsed = Seconds(Clock::now() - start);
+        stats = graph.Stats();
+        for(int device = 0; device < devices; ++device)
+        {
+            deviceRestarts.push_back(restarts.Restarts(device));
+        }
+
+        if(decoder.PacketsLost() != 0 || decoder.PacketsMalformed() != 0)
+        {
+            std::printf("Decoder: %llu packets lost, %llu malformed\n", static_cast<unsigned long long>(decoder.PacketsLost()),
+                        static_cast<unsigned long long>(decoder.PacketsMalformed()));
+            return 1;
+        }
+    }
+    bool bClosed = writer.Close();
+    std::remove(fileName.c_str());
+
+    uint64_t samples = samplesPerDevice * devices;
+    std::printf("%d devices, %.0fs at %.0fHz, %d threads: %zu packets, %llu samples in %.3fs, %.2fM samples/s (%.0fx real time), %llu retries pushing\n\n",
+                devices, seconds, rateHz, threads, packets.size(), static_cast<unsigned long long>(samples), elapsed,
+                samples / elapsed / 1e6, seconds / elapsed, static_cast<unsigned long long>(pushRetries));
+    std::printf("%-12s %10s %10s %8s %8s %9s %10s %10s %10s\n", "Stage", "In", "Out", "Runs", "Stalls", "Busy ms", "k items/s", "Mean ms", "Max ms");
+    for(const StageStats& stage : stats)
+    {
+        std::printf("%-12s %10llu %10llu %8llu %8llu %9.1f %10.0f %10.3f %10.3f\n", stage.Name.c_str(),
+                    static_cast<unsigned long long>(stage.ItemsIn), static_cast<unsigned long long>(stage.ItemsOut),
+                    static_cast<unsigned long long>(stage.Runs), static_cast<unsigned long long>(stage.Stalls), stage.BusyMs,
+                    stage.ItemsPerBusySecond / 1e3, stage.MeanLatencyMs, stage.MaxLatencyMs);
+    }
+    std::printf("\n%llu spectra of device 0\n", static_cast<unsigned long long>(analyzer.SpectraDone()));
+
+    // In the order added: Input, Decoder, Recorder, Resampler, Calibration, Fusion, Orientation,
+    // Spectrum, Restarts
+    bool bOk = bClosed && stats.size() == 9;
+    if(bOk)
+    {
+        bOk &= Check("Input out", stats[0].ItemsOut, packets.size());
+        bOk &= Check("Decoder in", stats[1].ItemsIn, packets.size());
+        bOk &= Check("Decoder out", stats[1].ItemsOut, samples);
+        bOk &= Check("Recorder in", stats[2].ItemsIn, samples);
+        bOk &= Check("Recorded", writer.SamplesWritten(), samples);
+        bOk &= Check("Resampler in", stats[3].ItemsIn, samples);
+        bOk &= Check("Calibration in", stats[4].ItemsIn, stats[3].ItemsOut);
+        bOk &= Check("Fusion in", stats[5].ItemsIn, stats[4].ItemsOut);
+        bOk &= Check("Fusion out", stats[5].ItemsOut, stats[5].ItemsIn);
+        bOk &= Check("Orientation in", stats[6].ItemsIn, stats[5].ItemsOut);
+        bOk &= Check("Spectrum in", stats[7].ItemsIn, stats[3].ItemsOut);
+        bOk &= Check("Restarts in", stats[8].ItemsIn, stats[3].ItemsOut);
+        for(int device = 0; device < devices; ++device)
+        {
+            char what[32];
+            std::snprintf(what, sizeof(what), "Device %d restarts", device);
+            bOk &= Check(what, deviceRestarts[device], 1);
+        }
+    }
+    std::printf("%s\n", bOk ? "OK" : "FAILED");
+    return bOk ? 0 : 1;
+}